@@ -0,0 +1,169 @@
+/* ansi_screen.cpp - implementation of the Ansi_screen class, which writes
+ * curses windows to the terminal with plain ANSI escape sequences.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include "ansi_screen.hpp"
+
+Ansi_screen::Ansi_screen(int fd, int rows, int cols):
+	its_fd(fd), its_rows(rows), its_cols(cols),
+	its_shown(rows * cols,' '), its_next(rows * cols,' '),
+	its_buffer(rows * (cols + 16) + 32), its_line(cols + 1),
+	its_used(0), its_cursor_row(0), its_cursor_col(0),
+	its_at_row(-1), its_at_col(-1), its_redraw_flag(true),
+	its_bytes(0), its_writes(0)
+{
+}
+
+void Ansi_screen::redraw()
+{
+	its_redraw_flag = true;
+}
+
+void Ansi_screen::copy(WINDOW *win)
+{
+	int top, left, rows, cols, cur_y, cur_x;
+	getbegyx(win,top,left);
+	getmaxyx(win,rows,cols);
+	getyx(win,cur_y,cur_x);
+	for (int y = 0;y<rows;y++)
+	{
+		int row = top + y;
+		if ((row <0) || (row >= its_rows))
+		{
+			continue;
+		}
+		int count = mvwinchnstr(win,y,0,its_line.data(),cols);
+		for (int x = 0;x<count;x++)
+		{
+			int col = left + x;
+			if ((col <0) || (col >= its_cols))
+			{
+				continue;
+			}
+			chtype cell = its_line[x];
+			char c = static_cast<char>(cell & A_CHARTEXT);
+			if ((cell & A_ALTCHARSET) != 0)
+			{
+				// Line drawing: q is a horizontal, x a vertical line
+				c = (c == 'q') ? '-' : ((c == 'x') ? '|' : '+');
+			}
+			else if ((c >= 0) && (c < ' '))
+			{
+				c = ' ';
+			}
+			its_next[row * its_cols + col] = c;
+		}
+	}
+	wmove(win,cur_y,cur_x); // reading moved the cursor
+	its_cursor_row = top + cur_y;
+	its_cursor_col = left + cur_x;
+}
+
+void Ansi_screen::append(const char *data, unsigned long int size)
+{
+	std::memcpy(its_buffer.data() + its_used,data,size);
+	its_used += size;
+}
+
+void Ansi_screen::move_to(int row, int col)
+{
+	if ((row == its_at_row) && (col == its_at_col))
+	{
+		return;
+	}
+	its_used += std::snprintf(its_buffer.data() + its_used,its_buffer.size() - its_used, \
+		"\x1b[%d;%dH",row + 1,col + 1);
+	its_at_row = row;
+	its_at_col = col;
+}
+
+bool Ansi_screen::flush()
+{
+	its_used = 0;
+	if (its_redraw_flag == true)
+	{
+		append("\x1b[H\x1b[2J",7);
+		its_at_row = 0;
+		its_at_col = 0;
+		std::fill(its_shown.begin(),its_shown.end(),' ');
+		its_redraw_flag = false;
+	}
+	for (int row = 0;row<its_rows;row++)
+	{
+		const char *shown = its_shown.data() + row * its_cols;
+		const char *next = its_next.data() + row * its_cols;
+		int first = 0;
+		while ((first < its_cols) && (shown[first] == next[first]))
+		{
+			first++;
+		}
+		if (first == its_cols)
+		{
+			continue;
+		}
+		int last = its_cols - 1;
+		while (shown[last] == next[last])
+		{
+			last--;
+		}
+		// Never write the last cell of the screen, it would scroll
+		if ((row == (its_rows - 1)) && (last == (its_cols - 1)))
+		{
+			last--;
+		}
+		if (last < first)
+		{
+			continue;
+		}
+		move_to(row,first);
+		append(next + first,last - first + 1);
+		its_at_col = last + 1;
+		if (its_at_col == its_cols)
+		{
+			its_at_row = -1; // some terminals wrap, some do not
+		}
+	}
+	move_to(its_cursor_row,its_cursor_col);
+	its_shown = its_next;
+	if (its_used == 0)
+	{
+		return true;
+	}
+	// The terminal cursor is where the frame leaves it, also on errors
+	unsigned long int done = 0;
+	while (done < its_used)
+	{
+		ssize_t result = write(its_fd,its_buffer.data() + done,its_used - done);
+		if (result <0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return false;
+		}
+		done += result;
+		its_writes++;
+	}
+	its_bytes += its_used;
+	return true;
+}
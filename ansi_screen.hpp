@@ -0,0 +1,68 @@
+/* ansi_screen.hpp - definition of the Ansi_screen class, which writes
+ * curses windows to the terminal with plain ANSI escape sequences.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_ANSI_SCREEN_HPP
+#define MWSD_ANSI_SCREEN_HPP
+
+#include <vector>
+#include <ncurses.h>
+
+/* Ansi_screen - a lightweight replacement for wnoutrefresh and doupdate
+ * The contents of windows are copied into the next frame, which is compared
+ * with the frame on the terminal. Each changed row is rewritten as one run
+ * from its first to its last changed column, so a screen reader gets whole
+ * words instead of single letters. All escape sequences of a frame are built
+ * in one buffer, reserved in the constructor, and written with one write().
+ * Only text is drawn, line drawing characters become + - and |.
+*/
+
+class Ansi_screen
+{
+	public:
+		Ansi_screen() = delete;
+		Ansi_screen(int fd, int rows, int cols);
+		~Ansi_screen() {}
+
+			// Access methods
+		unsigned long int get_bytes() const { return its_bytes; }
+		unsigned long int get_writes() const { return its_writes; }
+
+			// Utility methods
+		void copy(WINDOW *win); // into the next frame, its cursor becomes the cursor
+		bool flush(); // write the changes, false on a write error
+		void redraw(); // clear and write everything with the next flush
+	private:
+		void append(const char *data, unsigned long int size);
+		void move_to(int row, int col); // append a cursor position
+
+		int its_fd;
+		int its_rows, its_cols;
+		std::vector<char> its_shown; // frame on the terminal
+		std::vector<char> its_next; // frame to be written
+		std::vector<char> its_buffer; // escape sequences of one frame
+		std::vector<chtype> its_line; // one row read from a window
+		unsigned long int its_used; // bytes in its_buffer
+		int its_cursor_row, its_cursor_col; // wanted cursor position
+		int its_at_row, its_at_col; // terminal cursor while building a frame
+		bool its_redraw_flag;
+		unsigned long int its_bytes;
+		unsigned long int its_writes;
+};
+
+#endif // #ifndef MWSD_ANSI_SCREEN_HPP
@@ -20,33 +20,54 @@
 
 #include <thread>
 #include <chrono>
-#include <fstream>
 #include <iterator>
-#include <boost/date_time.hpp>
+#include <ctime>
+#include <cstdio>
+#include <system_error>
 #include "curses_mw_miner.hpp"
 
 using std::string;
 using std::to_string;
 using std::vector;
 using std::iterator;
-using boost::posix_time::ptime;
+
+const unsigned int Curses_mw_miner::disp_timeout_ms;
+const unsigned int Curses_mw_miner::max_unanswered;
+const unsigned int Curses_mw_miner::silent_poll_ms;
+
+// Current wall clock time in milliseconds since the epoch
+static std::int64_t now_ms()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>( \
+		std::chrono::system_clock::now().time_since_epoch()).count();
+}
 
 // Constructor: initialise flags, set values from params and create window
-Curses_mw_miner::Curses_mw_miner(RtMidiOut *midi_out, Synth_info *synth_info)
+Curses_mw_miner::Curses_mw_miner(RtMidiOut *midi_out, Synth_info *synth_info, \
+	Screen_compositor *compositor):
+	its_dump_filename(synth_info), its_out_scheduler(midi_out), its_hex_view(2)
 {
-	its_thru_flag.store(true);
-	its_disp_flag.store(false);
 	its_quit_flag.store(false);
-	its_new_flag.store(false);
 	its_error_flag.store(false);
-	its_paused.store(false);
-	its_unanswered.store(0);
+	its_disp_req_flag.store(false);
+	its_offline_flag.store(false);
+	its_disp_pending.store(false);
+	its_state_stamp.store(0);
+	its_frame_rate = 25;
+	its_shown_seq.store(0);
+	its_history = new Disp_history(1000,synth_info->get_disp_rows(),synth_info->get_disp_cols());
+	its_history_flag.store(false);
+	its_history_index = 0;
+	its_sink_hub = nullptr;
+	its_rt_policy = nullptr;
 	its_x = 2;
 	its_y = 3;
-	its_old_midi_msg.reserve(16);
+	its_last_midi = std::make_shared<const Midi_snapshot>( \
+		Midi_snapshot { vector<unsigned char>(), Dump_status::no_dump });
 	its_old_disp_msg.reserve(88);
 	its_midi_out = midi_out;
 	its_synth_info = synth_info;
+	its_compositor = compositor;
 	its_disp.reserve(synth_info->get_disp_rows());
 }
 
@@ -55,30 +76,42 @@ Curses_mw_miner::~Curses_mw_miner()
 {
 	its_disp.clear();
 	its_old_disp_msg.clear();
-	its_old_midi_msg.clear();
 	its_midi_out = nullptr;
 	its_synth_info = nullptr;
+	its_compositor = nullptr;
+	delete its_history;
 }
 
 // set up window
 void Curses_mw_miner::init_win()
 {
+	std::lock_guard<std::mutex> lock(its_compositor->get_mutex());
 	window = newwin(5,80,20,0);
 	box(window,0,0);
 	wmove(window,its_y,its_x);
-	wrefresh(window);
+	its_compositor->damage(window);
 }
 
 void Curses_mw_miner::shut_win()
 {
+	std::lock_guard<std::mutex> lock(its_compositor->get_mutex());
 	wclear(window);
-	wrefresh(window);
+	wnoutrefresh(window); // blank the area with the next frame
+	its_compositor->forget(window);
 	delwin(window);
 }
 
 void Curses_mw_miner::set_thru(bool thru_flag)
 {
-	its_thru_flag.store(thru_flag);
+	Mode_state::Word mode;
+	if (its_mode.apply((thru_flag == true) ? Mode_state::Event::direct_on : \
+		Mode_state::Event::direct_off,mode) == false)
+	{
+		return; // already set
+	}
+	post_mode(mode);
+	std::lock_guard<std::mutex> lock(its_compositor->get_mutex());
+	its_hex_view.reset();
 	if (thru_flag == true)
 	{
 		wmove(window,1,1);
@@ -94,7 +127,34 @@ void Curses_mw_miner::set_thru(bool thru_flag)
 	}
 	its_x = 2;
 	wmove(window,its_y,its_x);
-	wrefresh(window);
+	its_compositor->damage(window);
+}
+
+// Tell all sinks about the mode
+void Curses_mw_miner::post_mode(Mode_state::Word mode)
+{
+	if (its_sink_hub == nullptr)
+	{
+		return;
+	}
+	switch (Mode_state::get_mode(mode))
+	{
+		case Mode_state::Mode::continuous:
+		{
+			its_sink_hub->post(Sink_event::Kind::status,string("Continuous display mode"));
+			break;
+		}
+		case Mode_state::Mode::direct:
+		{
+			its_sink_hub->post(Sink_event::Kind::status,string("Direct MIDI mode"));
+			break;
+		}
+		default:
+		{
+			its_sink_hub->post(Sink_event::Kind::status,string("Display on demand mode"));
+			break;
+		}
+	}
 }
 
 void Curses_mw_miner::set_quit(bool quit_flag)
@@ -104,8 +164,15 @@ void Curses_mw_miner::set_quit(bool quit_flag)
 
 void Curses_mw_miner::set_disp(bool disp_flag)
 {
-	its_disp_flag.store(disp_flag);
-	if ((disp_flag == true) || (its_thru_flag == false))
+	Mode_state::Word mode;
+	if (its_mode.apply((disp_flag == true) ? Mode_state::Event::continuous_on : \
+		Mode_state::Event::continuous_off,mode) == false)
+	{
+		return; // already set
+	}
+	post_mode(mode);
+	std::lock_guard<std::mutex> lock(its_compositor->get_mutex());
+	if (Mode_state::get_mode(mode) != Mode_state::Mode::direct)
 	{
 		its_y = 2;
 	}
@@ -115,95 +182,262 @@ void Curses_mw_miner::set_disp(bool disp_flag)
 	}
 	its_x = 2;
 	wmove(window,its_y,its_x);
-	wrefresh(window);
+	its_compositor->damage(window);
 }
 
 // Set paused, to pause all active MIDI sending
 void Curses_mw_miner::set_paused(bool paused)
 {
-	if (its_paused != paused)
+	// Also forgets unanswered requests
+	its_mode.apply((paused == true) ? Mode_state::Event::pause : Mode_state::Event::resume);
+}
+
+// Compile the filter for incoming messages, set before run() is started.
+// SysEx from the synth always passes, so display dumps keep working.
+bool Curses_mw_miner::set_filter(string expr)
+{
+	if (its_filter.compile(expr) == false)
+	{
+		its_error_msg = its_filter.get_error_msg();
+		return false;
+	}
+	vector<unsigned char> synth_prefix { its_synth_info->get_man_id(), its_synth_info->get_equip_id() };
+	its_filter.add_sysex_prefix(synth_prefix);
+	return true;
+}
+
+void Curses_mw_miner::set_offline(bool offline)
+{
+	if (offline == false)
 	{
-		its_paused.store(paused);
-		its_unanswered = 0;
+		// New ports, failures and timeouts of the old ones are forgotten
+		its_out_scheduler.clear_error();
+		its_mode.apply(Mode_state::Event::answered);
 	}
+	its_offline_flag.store(offline);
+	its_refresh_trigger.wake();
+}
+
+void Curses_mw_miner::set_rt_policy(Rt_policy *rt_policy)
+{
+	its_rt_policy = rt_policy;
+	if (rt_policy != nullptr)
+	{
+		its_out_scheduler.set_setup([rt_policy]()
+		{
+			rt_policy->enter(string("MIDI output"));
+		});
+	}
+	else
+	{
+		its_out_scheduler.set_setup(nullptr);
+	}
+}
+
+void Curses_mw_miner::set_history_size(unsigned long int size)
+{
+	delete its_history;
+	its_history = new Disp_history(size,its_synth_info->get_disp_rows(),its_synth_info->get_disp_cols());
 }
 
 // The main loop for the mw_miner thread
 void Curses_mw_miner::run()
 {
-	std::chrono::milliseconds sleep_time(100);
-	vector<unsigned char> my_disp_req = its_synth_info->get_disp_req();
+	std::int64_t poll_ms = 100; // least time between continuous display requests
+	std::int64_t frame_ms = (its_frame_rate <1000) ? (1000 / its_frame_rate) : 1;
+	std::chrono::milliseconds frame_time(frame_ms);
+	std::int64_t next_request = Refresh_trigger::now_ms();
+	std::int64_t next_frame = next_request;
+	std::int64_t next_silent_request = next_request; // while the synth is silent
+	if (its_rt_policy != nullptr)
+	{
+		its_rt_policy->enter(string("Display requests"));
+	}
 	init_win();
+	try
+	{
+		its_correlator.start();
+		its_out_scheduler.start();
+		if (its_sink_hub != nullptr)
+		{
+			its_sink_hub->start();
+			post_mode(its_mode.load());
+		}
+	}
+	catch (std::system_error& e)
+	{
+		// Out of threads, those started are stopped below
+		its_error_flag = true;
+		its_error_msg = string("Could not start a thread: ") + string(e.what());
+		set_quit(true);
+	}
 	while (its_quit_flag == false)
 	{
-		if (its_paused == false)
+		Mode_state::Word mode = its_mode.load(); // one consistent mode per pass
+		if (Mode_state::get_paused(mode) == false)
 		{
-			if (its_unanswered >10)
+			if (its_offline_flag == true)
+			{
+				// Waiting for the UI to reconnect the ports
+				std::this_thread::sleep_for(frame_time);
+			}
+			else if (Mode_state::get_unanswered(mode) > max_unanswered)
+			{
+				// The synth is switched off or its cable pulled. It is asked
+				// now and then, the first answer ends the silence.
+				std::int64_t now = Refresh_trigger::now_ms();
+				if ((its_disp_pending == false) && (now >= next_silent_request))
+				{
+					request_disp_dump();
+					next_silent_request = now + silent_poll_ms;
+				}
+				its_refresh_trigger.wait(now + frame_ms);
+			}
+			else if (its_out_scheduler.get_error() == true)
 			{
-				its_error_flag = true;
-				its_error_msg = string("More than 10 unanswered requests from synthesizer.");
-				set_quit(true);
+				// Most likely the interface was unplugged, see Port_watcher
+				its_offline_flag.store(true);
 			}
 			else
 			{
-				if (its_disp_flag == true)
+				// One display request at a time, the next when it is
+				// answered or timed out. In display on demand mode MIDI
+				// activity triggers them, see Refresh_trigger.
+				std::int64_t now = Refresh_trigger::now_ms();
+				std::int64_t wake_time = next_frame;
+				if (its_disp_pending == false)
 				{
-					try
+					if ((Mode_state::get_disp(mode) == true) || (its_disp_req_flag == true))
 					{
-						its_midi_out->sendMessage(&my_disp_req);
+						if (now >= next_request)
+						{
+							request_disp_dump();
+							next_request = now + poll_ms;
+						}
 					}
-					catch (RtMidiError& e)
+					else if (Mode_state::get_thru(mode) == false)
 					{
-						its_error_flag.store(true);
-						its_quit_flag.store(true);
-						its_error_msg = e.getMessage();
+						if (its_refresh_trigger.take(now) == true)
+						{
+							request_disp_dump();
+						}
+						std::int64_t check_time = its_refresh_trigger.next_check(now);
+						wake_time = (check_time < wake_time) ? check_time : wake_time;
 					}
-					its_unanswered++;
-					std::this_thread::sleep_for(sleep_time);
 				}
-				else
+				// Controller changes are printed at most once per frame
+				if (now >= next_frame)
 				{
-					if ((its_thru_flag == false) && (its_new_flag == true))
+					next_frame = now + frame_ms;
+					wake_time = (next_frame < wake_time) ? next_frame : wake_time;
+					if ((Mode_state::get_mode(mode) == Mode_state::Mode::direct) && \
+						(its_history_flag == false) && (its_midi_state.get_seq() != its_shown_seq.load()))
 					{
-						try
-						{
-							its_midi_out->sendMessage(&my_disp_req);
-						}
-						catch (RtMidiError& e)
-						{
-							its_error_flag.store(true);
-							its_quit_flag.store(true);
-							its_error_msg = e.getMessage();
-						}
-						its_unanswered++;
-						std::this_thread::sleep_for(sleep_time);
+						post_thru(format_state(),its_state_stamp.exchange(0));
 					}
 				}
+				its_refresh_trigger.wait(wake_time);
 			}
 		}
+		else
+		{
+			std::this_thread::sleep_for(frame_time);
+		}
+	}
+	its_out_scheduler.stop();
+	its_correlator.stop();
+	// The curses sink draws into the window, so stop all sinks first
+	if (its_sink_hub != nullptr)
+	{
+		its_sink_hub->stop();
 	}
 	shut_win();
 }
 
-// Callback function for the RtMidiIn port
+// Queue a display request and register it with the correlator
+void Curses_mw_miner::request_disp_dump()
+{
+	// A synth set to the broadcast ID answers with its own ID
+	int dev_id = (its_synth_info->get_dev_id() == 0x7f) ? Req_pattern::any : \
+		its_synth_info->get_dev_id();
+	Req_pattern pattern = Req_pattern::sysex(its_synth_info->get_man_id(), \
+		its_synth_info->get_equip_id(),its_synth_info->get_disp_dump_cmd(),dev_id);
+	its_disp_pending.store(true);
+	its_correlator.add(pattern,disp_timeout_ms,[this](Req_correlator::Result result, \
+		const unsigned char *, unsigned long int)
+	{
+		if (result == Req_correlator::Result::answered)
+		{
+			its_mode.apply(Mode_state::Event::answered);
+		}
+		else if (result == Req_correlator::Result::timed_out)
+		{
+			its_mode.apply(Mode_state::Event::timed_out);
+		}
+		its_disp_pending.store(false);
+		its_refresh_trigger.wake();
+	});
+	its_out_scheduler.send(Out_priority::display_poll,its_synth_info->get_disp_req(),true);
+}
+
+// Next message of the input port, through the Input_gate
 void Curses_mw_miner::accept_msg(double delta_time, vector<unsigned char> *message)
 {
-	if (its_paused == false)
+	// All delays are measured from here
+	std::int64_t stamp_ns = Latency_stats::now_ns();
+	its_input_clock.stamp(stamp_ns,delta_time);
+	// Real time messages only go to the timing analyzer, on the driver's
+	// clock, which does not suffer from our own delays
+	if ((message->size() == 1) && (message->front() >= 0xf8))
+	{
+		its_timing.tick(message->front(),its_input_clock.get_driver_ns());
+		return;
+	}
+	// Nearly all messages are complete and go on as they are
+	if (its_assembler.passes(*message) == true)
+	{
+		handle_msg(message,stamp_ns);
+		return;
+	}
+	its_assembler.feed(*message,stamp_ns / 1000000,[this,stamp_ns](vector<unsigned char>& msg)
+	{
+		if ((msg.size() == 1) && (msg.front() >= 0xf8))
+		{
+			its_timing.tick(msg.front(),its_input_clock.get_driver_ns());
+			return;
+		}
+		handle_msg(&msg,stamp_ns);
+	});
+}
+
+// Handle one complete message
+void Curses_mw_miner::handle_msg(vector<unsigned char> *message, std::int64_t stamp_ns)
+{
+	// Filtered messages are dropped before any copy or comparison
+	if (its_filter.accept(message->data(),message->size()) == false)
+	{
+		return;
+	}
+	// Answers to our requests complete them right here
+	its_correlator.accept(message->data(),message->size());
+	// The whole message is handled in the mode it arrived in
+	Mode_state::Word mode = its_mode.load();
+	if (Mode_state::get_paused(mode) == false)
 	{
 		unsigned char cmd_byte; // command byte of the SysEx string
 		bool same = true; // used to compare vectors by element
 		unsigned long int comp_size = 0; // how many vector elements to compare
-		if (its_disp_flag == true)
+		// Controller data always goes into the state table
+		std::uint32_t seq = its_midi_state.get_seq();
+		bool is_controller = its_midi_state.update(message->data(),message->size());
+		if (Mode_state::get_disp(mode) == true)
 		{
 			if (message->size() >=5)
 			{
 				cmd_byte = message->at(4);
 				if (its_synth_info->get_disp_dump_cmd() == cmd_byte)
 				{
-					if (its_unanswered >0)
-					{
-						its_unanswered = 0;
-					}
+					its_disp_req_flag.store(false);
 
 					// Compare message to its_old_disp_msg
 					comp_size = message->size();
@@ -231,7 +465,8 @@ void Curses_mw_miner::accept_msg(double delta_time, vector<unsigned char> *messa
 							its_old_disp_msg.push_back(byte);
 						}
 						its_synth_info->prepare_disp(message,&its_disp);
-						print_msg();
+						its_history->append(its_disp,now_ms());
+						post_disp(stamp_ns);
 					}
 				}
 			}
@@ -246,53 +481,53 @@ void Curses_mw_miner::accept_msg(double delta_time, vector<unsigned char> *messa
 			{
 				cmd_byte = 0;
 			}
-			if (cmd_byte != its_synth_info->get_disp_dump_cmd()) // no display dump
+			if (is_controller == true)
 			{
-				// Compare message to its_old_midi_msg
-				same = true;
-				comp_size = message->size();
-				if (comp_size == its_old_midi_msg.size()) // different size, different msg
+				// Controller data is kept in the state table and printed
+				// by the mainloop at the frame rate
+				if (its_midi_state.get_seq() != seq)
 				{
-					for (long unsigned int i = 0;i<comp_size;i++)
+					std::int64_t none = 0;
+					its_state_stamp.compare_exchange_strong(none,stamp_ns);
+					publish_midi(message,Dump_status::no_dump);
+					if (Mode_state::get_thru(mode) == false)
 					{
-						if (message->at(i) != its_old_midi_msg[i])
-						{
-							same = false;
-							break;
-						}
+						its_refresh_trigger.activity(Refresh_trigger::now_ms());
 					}
 				}
-				else // different size here, so not equal per se
-				{
-					same = false;
-				}
-				if (same == false)
+			}
+			else if (cmd_byte != its_synth_info->get_disp_dump_cmd()) // no display dump
+			{
+				// Only a different message is published and shown
+				if (its_last_midi->msg != *message)
 				{
-					// save message to its_old_midi_msg
-					its_old_midi_msg.clear();
-					for (auto byte: *message)
+					publish_midi(message,its_synth_info->check_dump(*message));
+					if (Mode_state::get_thru(mode) == true)
 					{
-						its_old_midi_msg.push_back(byte);
-					}
-					if (its_thru_flag == true)
-					{
-						print_msg();
+						if ((message->at(0) == 0xf0) && ((message->size() <5) || \
+							(its_synth_info->get_dump_name(cmd_byte).empty())))
+						{
+							// The sinks share the snapshot, drawing copies nothing
+							post_thru(format_thru(),std::shared_ptr<const vector<unsigned char> >( \
+								its_last_midi,&its_last_midi->msg),stamp_ns);
+						}
+						else
+						{
+							post_thru(format_thru(),stamp_ns);
+						}
 					}
 					else // Not in direct data mode, display on demand
 					{
-						its_new_flag = true;
+						its_refresh_trigger.activity(Refresh_trigger::now_ms());
 					}
 				}
 			}
 			else // message is a display dump
 			{
-				if (its_unanswered >0)
-				{
-					its_unanswered = 0;
-				}
-				if (its_thru_flag == false)
+				// A requested display is shown even in direct data mode
+				bool requested = its_disp_req_flag.exchange(false);
+				if ((Mode_state::get_thru(mode) == false) || (requested == true))
 				{
-					its_new_flag = false;
 					// Compare message to its_old_disp_msg
 					same = true;
 					comp_size = message->size();
@@ -320,24 +555,44 @@ void Curses_mw_miner::accept_msg(double delta_time, vector<unsigned char> *messa
 							its_old_disp_msg.push_back(byte);
 						}
 						its_synth_info->prepare_disp(message,&its_disp);
-						print_msg();
+						its_history->append(its_disp,now_ms());
+						post_disp(stamp_ns);
 					}
 				}
 			}
 		}
 	}
 	/* JBS no action for else
-		else // its_paused is true
+		else // paused
 		{
 			// JBS only accept identity response
 		}
 	*/
 }
 
-void Curses_mw_miner::print_disp()
+// A new port delivers from now on, its delta times, SysEx and clock start
+// afresh
+void Curses_mw_miner::restart_input()
 {
+	its_input_clock.restart();
+	its_assembler.reset();
+	its_timing.reset(); // no interval across the swap, no stale sensing
+}
+
+// Replace the snapshot of the last direct message, called from the
+// MIDI thread only
+void Curses_mw_miner::publish_midi(const vector<unsigned char> *message, Dump_status status)
+{
+	std::shared_ptr<const Midi_snapshot> snapshot = std::make_shared<const Midi_snapshot>( \
+		Midi_snapshot { *message, status });
+	std::atomic_store(&its_last_midi,snapshot);
+}
+
+void Curses_mw_miner::print_disp(const vector<string>& lines, std::int64_t stamp_ns)
+{
+	std::lock_guard<std::mutex> lock(its_compositor->get_mutex());
 	int i = 0; // line index
-	for (auto line: its_disp)
+	for (auto& line: lines)
 	{
 		wmove(window,(1+i),1);
 		wclrtoeol(window);
@@ -346,98 +601,218 @@ void Curses_mw_miner::print_disp()
 	}
 	wmove(window,its_y,its_x);
 	box(window,0,0);
-	wrefresh(window);
+	its_compositor->damage(window,stamp_ns);
 }
 
-void Curses_mw_miner::print_thru()
+// Print one line of direct data into line 3
+void Curses_mw_miner::print_thru(const string& line, std::int64_t stamp_ns)
 {
+	std::lock_guard<std::mutex> lock(its_compositor->get_mutex());
+	if (its_hex_view.empty() == false)
+	{
+		its_hex_view.reset();
+		wmove(window,1,1);
+		wclrtoeol(window);
+		wmove(window,2,1);
+		wclrtoeol(window);
+	}
 	// clear line and repaint box
 	wmove(window,3,1);
 	wclrtoeol(window);
 	box(window,0,0);
+	mvwprintw(window,3,2,"%.76s",line.c_str());
+	wmove(window,its_y,its_x);
+	its_compositor->damage(window,stamp_ns);
+}
+
+// Show a SysEx message of unknown type: a header in line 1 and the
+// first rows of the hex view below
+void Curses_mw_miner::print_hex(const string& line, \
+	const std::shared_ptr<const vector<unsigned char> >& data, std::int64_t stamp_ns)
+{
+	std::lock_guard<std::mutex> lock(its_compositor->get_mutex());
+	its_hex_view.set_data(data);
+	wmove(window,1,1);
+	wclrtoeol(window);
+	mvwprintw(window,1,2,"%.50s, PgUp/PgDn/Home/End to browse",line.c_str());
+	draw_hex(stamp_ns);
+}
+
+// Draw the rows of the hex view, requires the compositor mutex
+void Curses_mw_miner::draw_hex(std::int64_t stamp_ns)
+{
+	its_hex_view.draw(window,2,2);
+	box(window,0,0);
+	wmove(window,its_y,its_x);
+	its_compositor->damage(window,stamp_ns);
+}
+
+// Describe the last direct message, channel controller data is described
+// by format_state
+string Curses_mw_miner::format_thru() const
+{
+	string text;
+	const vector<unsigned char>& last_msg = its_last_midi->msg;
+	if (last_msg.empty() || (last_msg[0] != 0xf0)) // no SysEx
+	{
+		return text;
+	}
 	unsigned char cmd_byte;
-	if (its_old_midi_msg.size() >= 5)
+	if (last_msg.size() >= 5)
 	{
-		cmd_byte = its_old_midi_msg[4];
+		cmd_byte = last_msg[4];
 	}
 	else
 	{
 		cmd_byte = 255;
 	}
-	if (its_old_midi_msg[0] == 0xf0) // it's SysEx
+	char buffer[80];
+	// Examine SysEx for type and gracefully handle long dumps
+	string cmd_name = its_synth_info->get_dump_name(cmd_byte);
+	if (!cmd_name.empty())
 	{
-		// Examine SysEx for type and gracefully handle long dumps
-			  string cmd_name = its_synth_info->get_dump_name(cmd_byte);
-		if (!cmd_name.empty())
+		if (cmd_name.compare("mode") == 0)
 		{
-			if (cmd_name.compare("mode") == 0)
+			if (last_msg.size() <7) // F0 man equip dev cmd mode F7
 			{
-				if (its_old_midi_msg[5] == 0)
-				{
-					mvwprintw(window,3,2,"Mode: sound");
-				}
-				else
-				{
-					mvwprintw(window,3,2,"Mode: multi");
-				}
+				text = string("Mode: too short");
 			}
-			else if (cmd_name.compare("remote") == 0)
+			else if (last_msg[5] == 0)
 			{
-				mvwprintw(window,3,2,"Remote: Element: %d Movement: %d",its_old_midi_msg[5],its_old_midi_msg[6]);
+				text = string("Mode: sound");
 			}
 			else
 			{
-				mvwprintw(window,3,2,"%s dump",cmd_name.c_str());
+				text = string("Mode: multi");
 			}
 		}
-		else // It's not a dump command, so print plain SysEx
+		else if (cmd_name.compare("remote") == 0)
 		{
-			int i = 0; // column to print the byte
-			for (auto byte: its_old_midi_msg)
+			if (last_msg.size() <8) // F0 man equip dev cmd element movement F7
 			{
-				mvwprintw(window,3,(2 + (3*i)),"%02x",byte);
-				i++;
+				text = string("Remote: too short");
 			}
-		}
-	}
-	else // The message is normal MIDI
-	{
-		switch(its_old_midi_msg[0])
-		{
-			case 176:
-			{
-				mvwprintw(window,3,2,"Controller %d: %d",its_old_midi_msg[1],its_old_midi_msg[2]);
-				break;
-			}
-			case 192:
+			else
 			{
-				mvwprintw(window,3,2,"Program change: %d %d",its_old_midi_msg[1],its_old_midi_msg[2]);
-				break;
+				snprintf(buffer,sizeof(buffer),"Remote: Element: %d Movement: %d",last_msg[5],last_msg[6]);
+				text = buffer;
 			}
-			default:
+		}
+		else
+		{
+			Dump_status status = its_last_midi->status;
+			text = cmd_name + string(" dump");
+			if ((status != Dump_status::ok) && (status != Dump_status::no_dump))
 			{
-				break;
+				text += string(" - INVALID: ") + its_synth_info->get_dump_status_text(status);
 			}
 		}
 	}
-	wmove(window,its_y,its_x);
-	wrefresh(window);
+	else // It's not a dump command, the bytes go to the hex view
+	{
+		snprintf(buffer,sizeof(buffer),"SysEx, %lu bytes",last_msg.size());
+		text = buffer;
+	}
+	return text;
+}
+
+// Describe the last change of the controller state table
+string Curses_mw_miner::format_state()
+{
+	its_shown_seq.store(its_midi_state.get_seq());
+	std::uint32_t event = its_midi_state.get_last_event();
+	unsigned int status = (event >> 16) & 0xff;
+	unsigned int data1 = (event >> 8) & 0xff;
+	unsigned int data2 = event & 0xff;
+	unsigned int channel = (status & 0x0f) + 1;
+	char buffer[80];
+	buffer[0] = '\0';
+	switch(status & 0xf0)
+	{
+		case 0xb0:
+		{
+			snprintf(buffer,sizeof(buffer),"Controller %u: %u (channel %u)",data1,data2,channel);
+			break;
+		}
+		case 0xc0:
+		{
+			snprintf(buffer,sizeof(buffer),"Program change: %u (channel %u)",data1,channel);
+			break;
+		}
+		case 0xd0:
+		{
+			snprintf(buffer,sizeof(buffer),"Aftertouch: %u (channel %u)",data1,channel);
+			break;
+		}
+		case 0xe0:
+		{
+			snprintf(buffer,sizeof(buffer),"Pitch bend: %d (channel %u)",static_cast<int>((data2 << 7) | data1) - 8192,channel);
+			break;
+		}
+		default:
+		{
+			break;
+		}
+	}
+	return string(buffer);
+}
+
+// Hand the current display contents to all sinks
+void Curses_mw_miner::post_disp(std::int64_t stamp_ns)
+{
+	if (its_sink_hub != nullptr)
+	{
+		its_sink_hub->post(Sink_event::Kind::display,its_disp,nullptr,stamp_ns);
+	}
+}
+
+// Hand a line of direct data to all sinks
+void Curses_mw_miner::post_thru(const string& line, std::int64_t stamp_ns)
+{
+	if (its_sink_hub != nullptr)
+	{
+		its_sink_hub->post(Sink_event::Kind::midi,line,nullptr,stamp_ns);
+	}
+}
+
+void Curses_mw_miner::post_thru(const string& line, \
+	const std::shared_ptr<const vector<unsigned char> >& data, std::int64_t stamp_ns)
+{
+	if (its_sink_hub != nullptr)
+	{
+		its_sink_hub->post(Sink_event::Kind::midi,line,data,stamp_ns);
+	}
 }
 
-void Curses_mw_miner::print_msg()
+// Draw an event into the data window, called by the curses sink
+void Curses_mw_miner::draw_event(const Sink_event& event)
 {
-	if ((its_disp_flag == true) || (its_thru_flag == false))
+	if (its_history_flag == true) // don't overwrite the history frame
 	{
-		print_disp();
+		return;
 	}
-	else if (its_thru_flag == true)
+	bool disp_mode = (Mode_state::get_mode(its_mode.load()) != Mode_state::Mode::direct);
+	if ((event.kind == Sink_event::Kind::display) && (disp_mode == true))
 	{
-		print_thru();
+		print_disp(event.lines,event.stamp_ns);
+	}
+	else if ((event.kind == Sink_event::Kind::midi) && (disp_mode == false) && \
+		(!event.lines.empty()))
+	{
+		if (event.data != nullptr)
+		{
+			print_hex(event.lines[0],event.data,event.stamp_ns);
+		}
+		else
+		{
+			print_thru(event.lines[0],event.stamp_ns);
+		}
 	}
 }
 
 void Curses_mw_miner::process_cmd(int ch)
 {
+	std::lock_guard<std::mutex> lock(its_compositor->get_mutex());
 	switch(ch)
 	{
 		case KEY_UP:
@@ -458,201 +833,185 @@ void Curses_mw_miner::process_cmd(int ch)
 			}
 			break;
 		}
+		case KEY_PPAGE:
+		case KEY_NPAGE:
+		case KEY_HOME:
+		case KEY_END:
+		{
+			if ((its_hex_view.empty() == true) || (its_history_flag == true))
+			{
+				break;
+			}
+			if (ch == KEY_HOME)
+			{
+				its_hex_view.home();
+			}
+			else if (ch == KEY_END)
+			{
+				its_hex_view.end();
+			}
+			else
+			{
+				its_hex_view.page((ch == KEY_NPAGE) ? 1 : -1);
+			}
+			draw_hex();
+			return;
+		}
 		default: // JBS: further data window commands to here
 		{
 			break;
 		}
 	}
-	wrefresh(window);
-}
-
-// Bring the cursor to the data window, called after main window had action
-void Curses_mw_miner::focus()
-{
-	wmove(window,its_y,its_x);
-	wrefresh(window);
+	its_compositor->damage(window);
 }
 
-string Curses_mw_miner::get_last_type() const
+// Step through the display history, stepping past the newest frame returns
+// to the live display
+bool Curses_mw_miner::history_step(int delta)
 {
-	if (its_old_midi_msg[0] != 0xf0) // not SysEx
+	std::uint64_t count = its_history->get_count();
+	std::uint64_t first = its_history->get_first();
+	if (count == 0)
 	{
-		return string();
+		return false;
 	}
-	else
+	if (its_history_flag == false)
 	{
-		if (its_old_midi_msg.size() <5) // probably incomplete sysEx
+		if (delta >= 0)
 		{
-			return string();
+			return false;
 		}
-		else
+		its_history_index = count; // one past the newest frame
+	}
+	if (its_history_index < first) // frames were overwritten meanwhile
+	{
+		its_history_index = first;
+	}
+	if (delta <0)
+	{
+		if (its_history_index == first)
+		{
+			return false;
+		}
+		its_history_index--;
+	}
+	else
+	{
+		if ((its_history_index + 1) >= count)
 		{
-			return its_synth_info->get_dump_name(its_old_midi_msg[4]);
+			history_live();
+			return true;
 		}
+		its_history_index++;
 	}
+	its_history_flag.store(true);
+	print_history();
+	return true;
 }
 
-bool Curses_mw_miner::write_last_dump(string filename)
+bool Curses_mw_miner::history_jump(std::int64_t time_ms)
 {
-	bool return_value = true;
-	std::ofstream fout(filename.c_str(), std::ios::out | std::ios::binary);
-	if (!fout.bad())
+	if (its_history->get_count() == 0)
 	{
-		fout.write((const char*)(&its_old_midi_msg[0]),static_cast<long>(its_old_midi_msg.size()));
-		fout.close();
+		return false;
+	}
+	its_history_index = its_history->find_time(time_ms);
+	its_history_flag.store(true);
+	print_history();
+	return true;
+}
+
+void Curses_mw_miner::history_live()
+{
+	its_history_flag.store(false);
+	its_shown_seq.store(its_midi_state.get_seq() - 1); // print the last change again
+	if (Mode_state::get_mode(its_mode.load()) != Mode_state::Mode::direct)
+	{
+		print_disp(its_disp);
 	}
 	else
 	{
-		return_value = false;
+		std::lock_guard<std::mutex> lock(its_compositor->get_mutex());
+		its_hex_view.reset();
+		wmove(window,1,1);
+		wclrtoeol(window);
+		wmove(window,2,1);
+		wclrtoeol(window);
+		wmove(window,3,1);
+		wclrtoeol(window);
+		box(window,0,0);
+		wmove(window,its_y,its_x);
+		its_compositor->damage(window);
 	}
-	return return_value;
 }
 
-string Curses_mw_miner::get_suggested_dump_filename() const
+void Curses_mw_miner::print_history()
 {
-	string filename;
-	string msg_type = get_last_type();
-	if (its_old_midi_msg.size() > 5)
+	std::lock_guard<std::mutex> lock(its_compositor->get_mutex());
+	vector<string> frame;
+	std::int64_t time_ms = 0;
+	bool valid = its_history->get(its_history_index,frame,time_ms);
+	for (int line = 1;line<4;line++)
 	{
-		unsigned char cmd = its_old_midi_msg.at(4);
-			// Check the message type and prepare the name accordingly
-		if (msg_type.compare("global") == 0)
-		{
-			filename = msg_type;
-		}
-		else if (msg_type.compare("remote") == 0)
-		{
-			filename = msg_type;
-		}
-		else if (msg_type.compare("wave") == 0)
-		{
-			if (its_old_midi_msg.size() == 137)
-			{
-				unsigned int bank_no = its_old_midi_msg.at(its_synth_info->get_dump_bank(cmd));
-				unsigned int patch_no = its_old_midi_msg.at(its_synth_info->get_dump_patch(cmd));
-				unsigned int wave_no = (128 * bank_no) + patch_no;
-				if (wave_no <10)
-				{
-					filename = string("000");
-				}
-				else if (wave_no <100)
-				{
-					filename = string("00");
-				}
-				else if (wave_no <1000)
-				{
-					filename = string("0");
-				}
-				filename = filename + to_string(wave_no) + string("-") + msg_type;
-			}
-			else
-			{
-				filename = string("waves");
-			}
-		}
-		else if (msg_type.compare("wave control table") == 0)
+		wmove(window,line,1);
+		wclrtoeol(window);
+	}
+	if (valid == true)
+	{
+		int i = 0; // line index
+		for (auto& line: frame)
 		{
-			if (its_old_midi_msg.size() == 265)
-			{
-				unsigned int patch_no = its_old_midi_msg.at(its_synth_info->get_dump_patch(cmd));
-				if (patch_no <10)
-				{
-					filename = string("00");
-				}
-				else if (patch_no <100)
-				{
-					filename = string("0");
-				}
-				filename = filename + to_string(patch_no) + string("-") + msg_type;
-			}
-			else
-			{
-				filename = string("wave control tables");
-			}
+			mvwprintw(window,(1+i),2,"%s",line.c_str());
+			i++;
 		}
-		else if (msg_type.compare("sound") == 0)
+		std::time_t seconds = static_cast<std::time_t>(time_ms / 1000);
+		struct tm local;
+		localtime_r(&seconds,&local);
+		mvwprintw(window,3,2,"History %llu of %llu at %02d:%02d:%02d.%03d, '[' and ']' to browse", \
+			static_cast<unsigned long long>(its_history_index - its_history->get_first() + 1), \
+			static_cast<unsigned long long>(its_history->get_count() - its_history->get_first()), \
+			local.tm_hour,local.tm_min,local.tm_sec,static_cast<int>(time_ms % 1000));
+	}
+	else
+	{
+		mvwprintw(window,3,2,"This history frame has been overwritten.");
+	}
+	box(window,0,0);
+	wmove(window,1,2);
+	its_compositor->damage(window);
+}
+
+// Bring the cursor to the data window, called after main window had action
+void Curses_mw_miner::focus()
+{
+	std::lock_guard<std::mutex> lock(its_compositor->get_mutex());
+	wmove(window,its_y,its_x);
+	its_compositor->damage(window);
+}
+
+string Curses_mw_miner::get_dump_type(const Midi_snapshot& snapshot) const
+{
+	if (snapshot.msg.empty() || (snapshot.msg[0] != 0xf0)) // not SysEx
+	{
+		return string();
+	}
+	else
+	{
+		if (snapshot.msg.size() <5) // probably incomplete sysEx
 		{
-			if (its_old_midi_msg.size() == 265)
-			{
-				unsigned int bank_no = its_old_midi_msg.at(its_synth_info->get_dump_bank(cmd));
-				unsigned int patch_no = its_old_midi_msg.at(its_synth_info->get_dump_patch(cmd));
-				unsigned int name_start = its_synth_info->get_dump_name_start(cmd);
-				unsigned int name_chars = its_synth_info->get_dump_name_chars(cmd);
-				string patch_name;
-				if (bank_no <= 1) // This is a sound not an edit buffer dump
-				{
-					if (bank_no == 0)
-					{
-						filename = string("A");
-					}
-					else if (bank_no == 1)
-					{
-						filename = string("B");
-					}
-					if (patch_no <10)
-					{
-						filename = filename + string("00");
-					}
-					else if (patch_no <100)
-					{
-						filename = filename + string("0");
-					}
-					filename = filename + to_string(patch_no) + string("-");
-				}
-				string tmp_name;
-				auto start_it = (its_old_midi_msg.begin() + name_start);
-				auto end_it = (start_it + name_chars);
-				tmp_name = string(start_it,end_it);
-				size_t start_pos = tmp_name.find_first_not_of(' ');
-				size_t end_pos = tmp_name.find_last_not_of(' ');
-				patch_name = tmp_name.substr(start_pos,(end_pos - start_pos +1));
-				filename = filename + patch_name;
-			}
-			else // A dump of all sounds
-			{
-				filename = string("sounds");
-			}
+			return string();
 		}
-		else if (msg_type.compare("multi") == 0)
+		else
 		{
-			if (its_old_midi_msg.size() == 265)
-			{
-				unsigned int bank_no = its_old_midi_msg.at(its_synth_info->get_dump_bank(cmd));
-				unsigned int patch_no = its_old_midi_msg.at(its_synth_info->get_dump_patch(cmd));
-				if (bank_no == 0) // This is a multi, not an edit buffer
-				{
-					if (patch_no <10)
-					{
-						filename = string("00");
-					}
-					else if (patch_no <100)
-					{
-						filename = string("0");
-					}
-					filename = filename + to_string(patch_no) + string("-");
-				}
-				unsigned int name_start = its_synth_info->get_dump_name_start(cmd);
-				unsigned int name_chars = its_synth_info->get_dump_name_chars(cmd);
-				string tmp_name, patch_name;
-				auto start_it = (its_old_midi_msg.begin() + name_start);
-				auto end_it = (start_it + name_chars);
-				tmp_name = string(start_it,end_it);
-				size_t start_pos = tmp_name.find_first_not_of(' ');
-				size_t end_pos = tmp_name.find_last_not_of(' ');
-				patch_name = tmp_name.substr(start_pos,(end_pos - start_pos +1));
-				filename = filename + patch_name;
-			}
-			else // It's all multis
-			{
-				filename = string("multis");
-			}
+			return its_synth_info->get_dump_name(snapshot.msg[4]);
 		}
 	}
+}
 
-	// Add the suffix of the current date and time
-	ptime now = boost::posix_time::second_clock::local_time();
-	string full_date = boost::posix_time::to_iso_string(now);
-	string time_suffix = full_date.substr(0,4) + string("-") + full_date.substr(4,2) + string("-") + full_date.substr(6,2) + string("-") + full_date.substr(9,2) + string("-") + full_date.substr(11,2) + string("-") + full_date.substr(13,2);
-	filename = filename + string("-") + time_suffix + string(".syx");
-	return filename;
+string Curses_mw_miner::get_suggested_dump_filename(const Midi_snapshot& snapshot)
+{
+	char filename[Dump_filename::max_length];
+	unsigned long int length = its_dump_filename.format(snapshot.msg.data(), \
+		snapshot.msg.size(),std::time(nullptr),filename);
+	return string(filename,length);
 }
@@ -24,11 +24,39 @@
 #define MWSD_CURSES_MW_MINER_HPP
 
 #include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 #include <ncurses.h>
 #include <rtmidi/RtMidi.h>
 #include "synth_info.hpp" // contains Synth_info data class
+#include "midi_state.hpp"
+#include "midi_filter.hpp"
+#include "disp_history.hpp"
+#include "output_sink.hpp"
+#include "dump_filename.hpp"
+#include "req_correlator.hpp"
+#include "midi_out_scheduler.hpp"
+#include "refresh_trigger.hpp"
+#include "screen_compositor.hpp"
+#include "hex_view.hpp"
+#include "mode_state.hpp"
+#include "syx_assembler.hpp"
+#include "latency_stats.hpp"
+#include "timing_analyzer.hpp"
+#include "rt_policy.hpp"
+
+/* Midi_snapshot - the last direct message and the validation of it
+ * A snapshot never changes once published. The MIDI thread swaps in a new
+ * one with an atomic pointer store, other threads keep what they loaded as
+ * long as they need it, e.g. while a dump is being saved.
+*/
+
+struct Midi_snapshot
+{
+	std::vector<unsigned char> msg;
+	Dump_status status;
+};
 
 /* Curses_mw_miner - the main work class
  * receive data
@@ -38,8 +66,15 @@
 
 class Curses_mw_miner {
 	public:
+		static const unsigned int disp_timeout_ms = 200; // for display requests
+			// After more unanswered requests the synth counts as silent and
+			// is only asked every silent_poll_ms until it answers again
+		static const unsigned int max_unanswered = 10;
+		static const unsigned int silent_poll_ms = 2000;
+
 		Curses_mw_miner() = delete;
-		Curses_mw_miner(RtMidiOut *midi_out, Synth_info *synth_info);
+		Curses_mw_miner(RtMidiOut *midi_out, Synth_info *synth_info, \
+			Screen_compositor *compositor);
 		~Curses_mw_miner();
 
 			// Basic access methods
@@ -47,50 +82,120 @@ class Curses_mw_miner {
 		void set_quit(bool quit_flag);
 		void set_disp(bool disp_flag);
 		void set_paused(bool paused);
-		bool get_thru() const { return its_thru_flag.load(); }
+			// The MIDI ports are gone, no requests until they are back
+		void set_offline(bool offline);
+		void set_frame_rate(unsigned int frame_rate) { its_frame_rate = frame_rate; }
+		bool set_filter(std::string expr); // compile the input filter
+		void set_history_size(unsigned long int size); // before run() only
+		void set_sink_hub(Sink_hub *sink_hub) { its_sink_hub = sink_hub; }
+			// Real-time mode of the MIDI threads, before run(), nullptr for none
+		void set_rt_policy(Rt_policy *rt_policy);
+		bool get_history() const { return its_history_flag.load(); }
+		unsigned long int get_history_memory() const { return its_history->get_memory(); }
+		std::string get_filter() const { return its_filter.get_expression(); }
+		bool get_thru() const { return Mode_state::get_thru(its_mode.load()); }
 		bool get_quit() const { return its_quit_flag.load(); }
-		bool get_disp() const { return its_disp_flag.load(); }
+		bool get_disp() const { return Mode_state::get_disp(its_mode.load()); }
 		bool get_error() const { return its_error_flag.load(); }
-		bool get_paused() const { return its_paused.load(); }
-		unsigned short int get_unanswered() const { return its_unanswered.load(); }
+		bool get_paused() const { return Mode_state::get_paused(its_mode.load()); }
+		bool get_offline() const { return its_offline_flag.load(); }
+		unsigned short int get_unanswered() const \
+			{ return Mode_state::get_unanswered(its_mode.load()); }
+		bool get_silent() const { return get_unanswered() > max_unanswered; }
 		std::string get_error_msg() const { return its_error_msg; }
+		Dump_status get_dump_status() const { return get_last_snapshot()->status; }
+			// Last direct message, safe from any thread
+		std::shared_ptr<const Midi_snapshot> get_last_snapshot() const \
+			{ return std::atomic_load(&its_last_midi); }
+		Midi_state& get_midi_state() { return its_midi_state; }
+		Req_correlator& get_correlator() { return its_correlator; }
+		Midi_out_scheduler& get_out_scheduler() { return its_out_scheduler; }
+		Refresh_trigger& get_refresh_trigger() { return its_refresh_trigger; }
+		Syx_assembler& get_assembler() { return its_assembler; }
+		const Input_clock& get_input_clock() const { return its_input_clock; }
+		Timing_analyzer& get_timing() { return its_timing; }
 
 			// Utility methods
 		void init_win();
 		void shut_win();
 		void run(); // mainloop for the thread
-			// Callback function for RtMidiIn
+			// Next message of the input, see Input_gate
 		void accept_msg(double delta_time, std::vector<unsigned char> *message);
+		void restart_input(); // the input port was swapped
 		void focus(); // just move the cursor into the data window
 		void process_cmd(int ch); // process user input from main thread
-		void print_msg(); // wrapper function for printing data
-		std::string get_last_type() const; // return dump type of last msg or empty
-		bool write_last_dump(std::string filename); // Write last dump to file
-		std::string get_suggested_dump_filename() const; // from the MIDI message
+		void request_disp() { its_disp_req_flag.store(true); } // one update, e.g. remote
+		void draw_event(const Sink_event& event); // print event to the window
+		std::string get_last_type() const { return get_dump_type(*get_last_snapshot()); }
+		std::vector<unsigned char> get_last_msg() const { return get_last_snapshot()->msg; }
+		std::string get_dump_type(const Midi_snapshot& snapshot) const; // dump type or empty
+			// Display history, called from the UI thread
+		bool history_step(int delta); // move back (<0) or forward in history
+		bool history_jump(std::int64_t time_ms); // show frame at a time
+		void history_live(); // leave history, show the live display
+			// From the MIDI message, called from the UI thread only
+		std::string get_suggested_dump_filename(const Midi_snapshot& snapshot);
 	private:
 			// Private methods
-		void print_thru(); // print direct data
-		void print_disp(); // print display contents
+			// A complete message, which arrived at stamp_ns
+		void handle_msg(std::vector<unsigned char> *message, std::int64_t stamp_ns);
+			// stamp_ns of the print and post methods: arrival of the MIDI
+			// input shown or 0
+		void print_thru(const std::string& line, std::int64_t stamp_ns = 0); // print direct data
+		void print_hex(const std::string& line, \
+			const std::shared_ptr<const std::vector<unsigned char> >& data, \
+			std::int64_t stamp_ns = 0);
+		void draw_hex(std::int64_t stamp_ns = 0); // draw the hex view rows
+		void print_disp(const std::vector<std::string>& lines, std::int64_t stamp_ns = 0);
+		std::string format_thru() const; // describe the last direct message
+		std::string format_state(); // describe the last controller change
+		void post_disp(std::int64_t stamp_ns); // send display contents to the sinks
+		void post_thru(const std::string& line, std::int64_t stamp_ns); // direct data
+		void post_thru(const std::string& line, \
+			const std::shared_ptr<const std::vector<unsigned char> >& data, \
+			std::int64_t stamp_ns);
+		void post_mode(Mode_state::Word mode); // send the mode to the sinks
+		void print_history(); // print the selected history frame
+		void request_disp_dump(); // send and register a display request
+		void publish_midi(const std::vector<unsigned char> *message, Dump_status status);
 
 			// Internal state flags
-		std::atomic_bool its_thru_flag; // direct data / display
-		std::atomic_bool its_disp_flag; // toggle continuous display mode
+		Mode_state its_mode; // display mode, paused, unanswered requests
 		std::atomic_bool its_quit_flag; // set to true to quit the program
-		std::atomic_bool its_new_flag; // set to true, when new data is there
 		std::atomic_bool its_error_flag; // set to true upon error
-		std::atomic_bool its_paused; // to be set, when action should be paused
+		std::atomic_bool its_disp_req_flag; // a display update was requested
+		std::atomic_bool its_offline_flag; // the ports are gone or sending failed
+		std::atomic_bool its_disp_pending; // a display request is outstanding
 
 			// Other internal variables
-		std::atomic_ushort its_unanswered; // count of unanswered commands, reset by
-			// an answered command
+		Req_correlator its_correlator; // outstanding requests to the synth
+		Refresh_trigger its_refresh_trigger; // display requests on demand
+		unsigned int its_frame_rate; // maximum screen updates per second
+		std::atomic<std::uint32_t> its_shown_seq; // last Midi_state change printed,
+			// reset by the UI thread
+		Midi_state its_midi_state; // live controller values
+		std::atomic<std::int64_t> its_state_stamp; // first change not yet shown or 0
+		Input_clock its_input_clock; // arrival stamps against RtMidi's delta times
+		Timing_analyzer its_timing; // MIDI clock and active sensing
+		Syx_assembler its_assembler; // SysEx arriving in pieces, before the filter
+		Midi_filter its_filter; // filter applied to complete messages
+		Disp_history *its_history; // last display frames
+		std::atomic_bool its_history_flag; // a history frame is shown
+		std::uint64_t its_history_index; // index of the shown frame
+		Sink_hub *its_sink_hub; // outputs for display and MIDI events
+		Rt_policy *its_rt_policy; // real-time mode or nullptr
+		Dump_filename its_dump_filename; // names for saved dumps
+		Midi_out_scheduler its_out_scheduler; // paces all messages to the synth
+		Hex_view its_hex_view; // long SysEx, guarded by the compositor mutex
 		int its_x; // x position on the data window
 		int its_y; // y position on the data window
-		std::vector<unsigned char> its_old_midi_msg; // previous different MIDI
-			// message, which is not a display dump
+		std::shared_ptr<const Midi_snapshot> its_last_midi; // previous different
+			// MIDI message, which is not a display dump
 		std::vector<unsigned char> its_old_disp_msg; // previous different display dump
 		RtMidiOut *its_midi_out; // MIDI output port to send display request
 		std::vector<std::string> its_disp; // processed display contents
 		Synth_info *its_synth_info;
+		Screen_compositor *its_compositor; // draws the window to the terminal
 		std::string its_error_msg; // error message string
 		WINDOW *window; // data window
 };
@@ -24,13 +24,20 @@
 #include <chrono>
 #include <boost/filesystem.hpp>
 #include <thread>
+#include <future>
+#include <memory>
 #include <cmath>
 #include <cstring>
 #include <cctype>
+#include <cstdio>
+#include <ctime>
+#include <system_error>
 #include <form.h>
 #include "curses_mw_ui.hpp"
+#include "curses_sink.hpp"
 
 using std::string;
+using std::to_string;
 using std::cout;
 using std::endl;
 using std::ofstream;
@@ -39,21 +46,134 @@ using std::vector;
 using std::ceil;
 using std::strlen;
 using std::isspace;
+using std::toupper;
 namespace fs = boost::filesystem;
 
+// Answer to a universal identity request
+static bool is_identity_reply(const vector<unsigned char>& msg)
+{
+	return (msg.size() >= 6) && (msg[0] == 0xf0) && (msg[1] == 0x7e) && \
+		(msg[3] == 0x06) && (msg[4] == 0x02);
+}
+
+// Send the identity request to all ports named in candidates at once
+// and wait up to timeout_ms for the reply fingerprint. Each port is
+// looked up by name in the list of the client opening it, the list it was
+// taken from may be outdated. Returns the input and output name of the
+// port that answered, empty names if none did.
+static std::pair<string,string> probe_fingerprint(string client_name, \
+	vector<string> candidates, vector<unsigned char> fingerprint, unsigned int timeout_ms)
+{
+	struct Probe
+	{
+		std::unique_ptr<RtMidiIn> midi_in;
+		std::unique_ptr<RtMidiOut> midi_out;
+		string input_name;
+		string output_name;
+	};
+	vector<unsigned char> idreq { 0xf0, 0x7e, 0x7f, 0x06, 0x01, 0xf7 };
+	vector<Probe> probes;
+	for (auto& name: candidates)
+	{
+		try
+		{
+			Probe probe { std::unique_ptr<RtMidiIn>(new RtMidiIn(RtMidi::Api::UNSPECIFIED,client_name)), \
+				std::unique_ptr<RtMidiOut>(new RtMidiOut(RtMidi::Api::UNSPECIFIED,client_name)), \
+				string(), string() };
+			vector<string> inputs;
+			vector<string> outputs;
+			for (unsigned int i = 0;i<probe.midi_in->getPortCount();i++)
+			{
+				inputs.push_back(probe.midi_in->getPortName(i));
+			}
+			for (unsigned int i = 0;i<probe.midi_out->getPortCount();i++)
+			{
+				outputs.push_back(probe.midi_out->getPortName(i));
+			}
+			int in_n = Port_watcher::find(inputs,name);
+			int out_n = Port_watcher::find(outputs,name);
+			if ((in_n <0) || (out_n <0))
+			{
+				continue; // gone again
+			}
+			probe.input_name = inputs[static_cast<unsigned long int>(in_n)];
+			probe.output_name = outputs[static_cast<unsigned long int>(out_n)];
+			probe.midi_in->openPort(static_cast<unsigned int>(in_n),string("In"));
+			probe.midi_in->ignoreTypes(false,true,true);
+			probe.midi_out->openPort(static_cast<unsigned int>(out_n),string("Out"));
+			probe.midi_out->sendMessage(&idreq);
+			probes.push_back(std::move(probe));
+		}
+		catch (RtMidiError&)
+		{
+			// Not usable, try the next one
+		}
+	}
+
+	vector<unsigned char> answer;
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + \
+		std::chrono::milliseconds(timeout_ms);
+	while ((probes.empty() == false) && (std::chrono::steady_clock::now() < end))
+	{
+		bool quiet = true;
+		for (auto& probe: probes)
+		{
+			probe.midi_in->getMessage(&answer);
+			if (answer == fingerprint)
+			{
+				return std::make_pair(probe.input_name,probe.output_name);
+			}
+			quiet = quiet && answer.empty();
+		}
+		if (quiet == true)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+	return std::make_pair(string(),string());
+}
+
+const unsigned int Curses_mw_ui::probe_timeout_ms;
+const unsigned int Curses_mw_ui::default_input_queue;
+const unsigned int Curses_mw_ui::timing_view_ms;
+
 Curses_mw_ui::Curses_mw_ui(string res_dir):
 	its_use_res_dir(true), its_res_dir(res_dir), its_cfg_file_name(""),
 	its_midi_input_name("In"), its_midi_output_name("Out"), its_error_msg(""),
 	its_x(3), its_y(3), its_ch(0), its_status_line(17), its_error_line(18),
-	its_suggested_dev_id(0x7f)
+	its_suggested_dev_id(0x7f), its_grid_flag(false), its_grid_channel(0),
+	its_timing_flag(false), its_timing_view(false),
+	its_frame_rate(25), its_history_size(1000),
+	its_settle_time(Refresh_trigger::default_settle_ms),
+	its_request_rate(Refresh_trigger::default_max_rate), its_batch_input(false),
+	its_input_queue(default_input_queue), its_rt_failures(0), its_offline(false),
+	its_silent(false), its_port_changes(0), its_reopened(false), its_probed_changes(0)
 {
 	its_error_flag.store(false);
+	its_probe_correlator.store(nullptr);
+	its_midi_reader = nullptr;
 	its_midi_name = string("MWII Display");
-	its_midi_in = new RtMidiIn(RtMidi::Api::UNSPECIFIED,its_midi_name);
+	its_midi_in = new RtMidiIn(RtMidi::Api::UNSPECIFIED,its_midi_name,its_input_queue);
 	its_midi_out = new RtMidiOut(RtMidi::Api::UNSPECIFIED,its_midi_name);
 	its_synth_info = new Synth_info(0x3e,0x0e,0x7f,0x05,0x15,40,2);
-	its_mw_miner = new Curses_mw_miner(its_midi_out,its_synth_info);
-	its_discovery_flag.store(false);
+	its_compositor = new Screen_compositor();
+	its_mw_miner = new Curses_mw_miner(its_midi_out,its_synth_info,its_compositor);
+	its_dump_decoder = new Dump_decoder(its_synth_info);
+	its_dump_library = new Dump_library(its_synth_info,its_dump_decoder);
+	its_dump_writer = new Dump_writer();
+	its_sink_hub = new Sink_hub();
+	its_sink_hub->add_sink(new Curses_sink(its_mw_miner));
+	its_mw_miner->set_sink_hub(its_sink_hub);
+	Curses_mw_miner *miner = its_mw_miner;
+	its_input_gate = new Input_gate([miner](double delta_time, vector<unsigned char> *msg)
+	{
+		miner->accept_msg(delta_time,msg);
+	},[miner]()
+	{
+		miner->restart_input();
+	});
+	its_input_route = nullptr;
+	its_port_watcher = new Port_watcher(Port_watcher::rtmidi_lister(its_midi_name + string(" Watcher")));
 }
 
 Curses_mw_ui::~Curses_mw_ui()
@@ -66,23 +186,35 @@ Curses_mw_ui::~Curses_mw_ui()
 	{
 		its_midi_out->closePort();
 	}
+	delete its_midi_reader;
 	delete its_midi_in;
 	delete its_midi_out;
+	delete its_input_route;
+	delete its_input_gate;
+	delete its_port_watcher;
 	if (its_mw_miner->get_quit() == false)
 	{
 		its_mw_miner->set_quit(true);
 	}
+	delete its_sink_hub; // stops the curses sink before the miner goes
 	delete its_mw_miner;
+	delete its_compositor;
+	delete its_dump_writer; // writes what is still queued
+	delete its_dump_library;
+	delete its_dump_decoder;
 	delete its_synth_info;
 }
 
-bool Curses_mw_ui::set_midi_input(unsigned int port_number)
+bool Curses_mw_ui::set_midi_input(unsigned int port_number, bool verify)
 {
 	unsigned int port_count = its_midi_in->getPortCount();
 	if (port_count == 0)
 	{
 		its_error_msg = string("There are no MIDI input ports available");
-		its_error_flag.store(true);
+		if (its_offline == false) // else reconnecting, the session waits
+		{
+			its_error_flag.store(true);
+		}
 		return false;
 	}
 
@@ -91,83 +223,72 @@ bool Curses_mw_ui::set_midi_input(unsigned int port_number)
 		its_error_msg = string("There is no MIDI input port with that number.");
 		return false;
 	}
-	else
+	// Make before break: the new port is opened while the old one delivers
+	RtMidiIn *midi_in = nullptr;
+	try
 	{
-		if (its_midi_in->isPortOpen())
-		{
-			its_midi_in->closePort();
-		}
-		try
+		midi_in = new RtMidiIn(RtMidi::Api::UNSPECIFIED,its_midi_name,its_input_queue);
+		midi_in->openPort(port_number,string("In"));
+	}
+	catch (RtMidiError& e)
+	{
+		delete midi_in;
+		its_error_msg = e.getMessage();
+		if ((its_midi_in->isPortOpen() == false) && (its_offline == false))
 		{
-			its_midi_in->openPort(port_number,string("In"));
+			its_error_flag.store(true);
 		}
-		catch (RtMidiError& e)
+		return false;
+	}
+	string port_name = midi_in->getPortName(port_number);
+	if (its_input_route == nullptr)
+	{
+		// Nothing is delivered yet, the port is just replaced
+		if (its_midi_in->isPortOpen())
 		{
-			its_error_msg = e.getMessage();
-			its_error_flag.store(true);
-			return false;
+			its_midi_in->closePort();
 		}
-		its_midi_input_name = its_midi_in->getPortName(port_number);
+		delete its_midi_in;
+		its_midi_in = midi_in;
+		its_midi_input_name = port_name;
+		return true;
 	}
-	return true;
+	return swap_input(midi_in,port_name,verify);
 }
 
-bool Curses_mw_ui::set_midi_input(string port_name)
+bool Curses_mw_ui::set_midi_input(string port_name, bool verify)
 {
-	int port_number = -1;
 	unsigned int port_count = its_midi_in->getPortCount();
-	string cur_port_name;
 	if (port_count == 0)
 	{
 		its_error_msg = string("There are no MIDI input ports available.");
-		its_error_flag.store(true);
+		if (its_offline == false) // else reconnecting, the session waits
+		{
+			its_error_flag.store(true);
+		}
 		return false;
 	}
-	else
+	for (unsigned int i = 0;i<port_count;i++)
 	{
-		for (unsigned int i = 0;i<port_count;i++)
-		{
-			cur_port_name = its_midi_in->getPortName(i);
-			if (cur_port_name == port_name)
-			{
-				port_number = static_cast<int>(i);
-				break;
-			}
-		}
-		if (port_number == -1) // no port found
+		if (its_midi_in->getPortName(i) == port_name)
 		{
-			its_error_msg = string("A port of this name does not exist.");
-			return false;
-		}
-		else
-		{
-			if (its_midi_in->isPortOpen())
-			{
-				its_midi_in->closePort();
-			}
-			try
-			{
-				its_midi_in->openPort(static_cast<unsigned int>(port_number),string("In"));
-			}
-			catch (RtMidiError& e)
-			{
-				its_error_msg = e.getMessage();
-				its_error_flag.store(true);
-				return false;
-			}
-			its_midi_input_name = cur_port_name;
+			return set_midi_input(i,verify);
 		}
 	}
-	return true;
+	its_error_msg = string("A port of this name does not exist.");
+	return false;
 }
 
-bool Curses_mw_ui::set_midi_output(unsigned int port_number)
+bool Curses_mw_ui::set_midi_output(unsigned int port_number, bool verify)
 {
 	unsigned int port_count = its_midi_out->getPortCount();
 	if (port_count == 0)
 	{
 		its_error_msg = string("There are no MIDI output ports available");
-		its_error_flag.store(true);
+		if (its_offline == false) // else reconnecting, the session waits
+		{
+			its_error_flag.store(true);
+		}
 		return false;
 	}
 
@@ -176,72 +297,301 @@ bool Curses_mw_ui::set_midi_output(unsigned int port_number)
 		its_error_msg = string("There is no MIDI output port with that number.");
 		return false;
 	}
-	else
+	// Make before break: the new port is opened while the old one sends
+	RtMidiOut *midi_out = nullptr;
+	try
+	{
+		midi_out = new RtMidiOut(RtMidi::Api::UNSPECIFIED,its_midi_name);
+		midi_out->openPort(port_number,string("Out"));
+	}
+	catch (RtMidiError& e)
 	{
-		if (its_midi_out->isPortOpen())
+		delete midi_out;
+		its_error_msg = e.getMessage();
+		if ((its_midi_out->isPortOpen() == false) && (its_offline == false))
 		{
-			its_midi_out->closePort();
+			its_error_flag.store(true);
 		}
+		return false;
+	}
+	string port_name = midi_out->getPortName(port_number);
+	if ((its_input_route != nullptr) && (verify == true))
+	{
+		// The answer to an identity request on the new port comes on the input
+		its_input_gate->expect(its_input_gate->get_active(),&is_identity_reply);
+		vector<unsigned char> idreq { 0xf0, 0x7e, 0x7f, 0x06, 0x01, 0xf7 };
 		try
 		{
-			its_midi_out->openPort(port_number,string("Out"));
+			midi_out->sendMessage(&idreq);
 		}
-		catch (RtMidiError& e)
+		catch (RtMidiError&)
 		{
-			its_error_msg = e.getMessage();
-			its_error_flag.store(true);
+			// Then there will be no answer either
+		}
+		if ((its_input_gate->wait_expected(probe_timeout_ms,&its_fingerprint) == false) && \
+			(confirm(string("The synthesizer does not answer through ") + port_name + \
+			string(". Switch anyway?")) == false))
+		{
+			delete midi_out;
+			its_error_msg = string("Kept MIDI output ") + its_midi_output_name;
 			return false;
 		}
-		its_midi_output_name = its_midi_out->getPortName(port_number);
 	}
+	// The scheduler sends to the new port from the next message on
+	std::int64_t start_ns = Latency_stats::now_ns();
+	its_mw_miner->get_out_scheduler().set_sender([midi_out](vector<unsigned char>& msg)
+	{
+		midi_out->sendMessage(&msg);
+	});
+	its_swap_time.add(Latency_stats::now_ns() - start_ns);
+	if (its_midi_out->isPortOpen())
+	{
+		its_midi_out->closePort();
+	}
+	delete its_midi_out;
+	its_midi_out = midi_out;
+	its_midi_output_name = port_name;
 	return true;
 }
 
-bool Curses_mw_ui::set_midi_output(string port_name)
+bool Curses_mw_ui::set_midi_output(string port_name, bool verify)
 {
-	int port_number = -1;
 	unsigned int port_count = its_midi_out->getPortCount();
-	string cur_port_name;
 	if (port_count == 0)
 	{
 		its_error_msg = string("There are no MIDI output ports available.");
-		its_error_flag.store(true);
+		if (its_offline == false) // else reconnecting, the session waits
+		{
+			its_error_flag.store(true);
+		}
 		return false;
 	}
-	else
+	for (unsigned int i = 0;i<port_count;i++)
 	{
-		for (unsigned int i = 0;i<port_count;i++)
+		if (its_midi_out->getPortName(i) == port_name)
 		{
-			cur_port_name = its_midi_out->getPortName(i);
-			if (cur_port_name == port_name)
-			{
-				port_number = static_cast<int>(i);
-				break;
-			}
+			return set_midi_output(i,verify);
 		}
-		if (port_number == -1) // no port found
+	}
+	its_error_msg = string("A port of this name does not exist.");
+	return false;
+}
+
+// Switch to an opened input port while the miner runs. The new port is
+// verified with an identity request, then swapped in, then the old one
+// is closed.
+bool Curses_mw_ui::swap_input(RtMidiIn *midi_in, string port_name, bool verify)
+{
+	midi_in->ignoreTypes(false,!its_timing_flag,!its_timing_flag);
+	Input_route *route = new_route(its_input_gate->open_next());
+	Midi_reader *reader = start_input(midi_in,route);
+	if ((its_midi_out->isPortOpen()) && (verify == true))
+	{
+		its_input_gate->expect(route->generation,&is_identity_reply);
+		its_mw_miner->get_out_scheduler().send(Out_priority::user, \
+			vector<unsigned char> { 0xf0, 0x7e, 0x7f, 0x06, 0x01, 0xf7 });
+		if ((its_input_gate->wait_expected(probe_timeout_ms,&its_fingerprint) == false) && \
+			(confirm(string("The synthesizer does not answer on ") + port_name + \
+			string(". Switch anyway?")) == false))
 		{
-			its_error_msg = string("A port of this name does not exist.");
+			stop_input(midi_in,reader);
+			midi_in->closePort();
+			its_input_gate->cancel();
+			delete midi_in;
+			delete route;
+			its_error_msg = string("Kept MIDI input ") + its_midi_input_name;
 			return false;
 		}
-		else
+	}
+	std::int64_t start_ns = Latency_stats::now_ns();
+	its_input_gate->swap();
+	its_swap_time.add(Latency_stats::now_ns() - start_ns);
+	// Whatever the old port still delivers is dropped by the gate
+	stop_input(its_midi_in,its_midi_reader);
+	its_midi_in->closePort();
+	delete its_midi_in;
+	delete its_input_route;
+	its_midi_in = midi_in;
+	its_midi_reader = reader;
+	its_input_route = route;
+	its_midi_input_name = port_name;
+	return true;
+}
+
+// The route of an input port to the gate. Real-time mode is entered by
+// the thread delivering its first message.
+Input_route *Curses_mw_ui::new_route(unsigned long int generation)
+{
+	Input_route *route = new Input_route { its_input_gate, generation, nullptr, false };
+	if (its_rt_policy.get_enabled() == true)
+	{
+		Rt_policy *rt_policy = &its_rt_policy;
+		route->setup = [rt_policy]()
 		{
-			if (its_midi_out->isPortOpen())
-			{
-				its_midi_out->closePort();
-			}
-			try
-			{
-				its_midi_out->openPort(static_cast<unsigned int>(port_number),string("Out"));
-			}
-			catch (RtMidiError& e)
+			rt_policy->enter(string("MIDI input"));
+		};
+	}
+	return route;
+}
+
+// Deliver from midi_in to its route, returns the Midi_reader in batch mode
+Midi_reader *Curses_mw_ui::start_input(RtMidiIn *midi_in, Input_route *route)
+{
+	if (its_batch_input == false)
+	{
+		midi_in->setCallback(&mw_midi_callback,static_cast<void *>(route));
+		return nullptr;
+	}
+	// A thread of its own drains the RtMidi queue
+	Midi_reader *reader = new Midi_reader(midi_in,[route]( \
+		vector<vector<unsigned char> >& batch, const vector<double>& delta_times, \
+		unsigned long int count)
+	{
+		if (route->set_up == false)
+		{
+			route->set_up = true;
+			if (route->setup)
 			{
-				its_error_msg = e.getMessage();
-				its_error_flag.store(true);
-				return false;
+				route->setup();
 			}
-			its_midi_output_name = cur_port_name;
 		}
+		route->gate->deliver_batch(route->generation,batch,delta_times,count);
+	});
+	reader->start();
+	return reader;
+}
+
+void Curses_mw_ui::stop_input(RtMidiIn *midi_in, Midi_reader *reader)
+{
+	if (reader != nullptr)
+	{
+		reader->stop();
+		delete reader;
+	}
+	else
+	{
+		midi_in->cancelCallback();
+	}
+}
+
+void Curses_mw_ui::set_frame_rate(unsigned int frame_rate)
+{
+	its_frame_rate = frame_rate;
+	its_mw_miner->set_frame_rate(frame_rate);
+	its_compositor->set_max_fps(frame_rate);
+}
+
+void Curses_mw_ui::set_history_size(unsigned long int size)
+{
+	its_history_size = size;
+	its_mw_miner->set_history_size(size);
+}
+
+void Curses_mw_ui::set_settle_time(unsigned int settle_ms)
+{
+	its_settle_time = settle_ms;
+	its_mw_miner->get_refresh_trigger().set_settle_time(settle_ms);
+}
+
+void Curses_mw_ui::set_request_rate(unsigned int per_second)
+{
+	its_request_rate = per_second;
+	its_mw_miner->get_refresh_trigger().set_max_rate(per_second);
+}
+
+bool Curses_mw_ui::set_input_mode(string name)
+{
+	if (name == "callback")
+	{
+		its_batch_input = false;
+	}
+	else if (name == "batch")
+	{
+		its_batch_input = true;
+	}
+	else
+	{
+		its_error_msg = string("Unknown input mode ") + name + string(", use callback or batch.");
+		return false;
+	}
+	return true;
+}
+
+bool Curses_mw_ui::set_realtime(string policy)
+{
+	if (its_rt_policy.set_policy(policy) == false)
+	{
+		its_error_msg = its_rt_policy.get_error_msg();
+		return false;
+	}
+	return true;
+}
+
+// RtMidi only takes the queue size when the input is created
+void Curses_mw_ui::set_input_queue(unsigned int size)
+{
+	its_input_queue = size;
+	if (its_midi_in->isPortOpen())
+	{
+		its_midi_in->closePort();
+	}
+	delete its_midi_in;
+	its_midi_in = new RtMidiIn(RtMidi::Api::UNSPECIFIED,its_midi_name,its_input_queue);
+}
+
+bool Curses_mw_ui::add_sink(string spec)
+{
+	Output_sink *sink = nullptr;
+	if (spec.compare(0,7,"socket:") == 0)
+	{
+		Socket_sink *socket_sink = Socket_sink::create(spec.substr(7),its_error_msg);
+		if (socket_sink != nullptr)
+		{
+			its_socket_sinks.push_back(socket_sink);
+		}
+		sink = socket_sink;
+	}
+	else if (spec.compare(0,4,"shm:") == 0)
+	{
+		sink = Shm_sink::create(spec.substr(4),its_synth_info,its_error_msg);
+	}
+	else
+	{
+		sink = Text_sink::create(spec,its_error_msg);
+	}
+	if (sink == nullptr)
+	{
+		return false;
+	}
+	its_sink_hub->add_sink(sink);
+	its_sink_specs.push_back(spec);
+	return true;
+}
+
+bool Curses_mw_ui::set_filter(string expr)
+{
+	bool return_value = its_mw_miner->set_filter(expr);
+	if (return_value == false)
+	{
+		its_error_msg = its_mw_miner->get_error_msg();
+	}
+	return return_value;
+}
+
+bool Curses_mw_ui::set_backend(string name)
+{
+	if (name == "curses")
+	{
+		its_compositor->set_backend(Screen_backend::curses);
+	}
+	else if (name == "ansi")
+	{
+		its_compositor->set_backend(Screen_backend::ansi);
+	}
+	else
+	{
+		its_error_msg = string("Unknown screen backend ") + name + string(", use curses or ansi.");
+		return false;
 	}
 	return true;
 }
@@ -250,6 +600,8 @@ bool Curses_mw_ui::set_midi_output(string port_name)
 void Curses_mw_ui::print_main_screen()
 {
 	int cur_line = 1; // line number to print to
+	its_grid_flag = false;
+	its_timing_view = false;
 	wclear(its_win);
 	box(its_win,0,0);
 	mvwprintw(its_win,cur_line,5,"%s",PACKAGE_STRING);
@@ -309,28 +661,126 @@ void Curses_mw_ui::print_main_screen()
 	its_y = its_status_line;
 	its_x = 2;
 	wmove(its_win,its_y,its_x);
-	wrefresh(its_win);
+	its_compositor->refresh(its_win);
 }
 
-// Print help screen
-void Curses_mw_ui::print_help()
+// Print the controller grid of the current channel. Only cells changed since
+// the last call are printed, unless full is true.
+void Curses_mw_ui::print_grid(bool full)
 {
-	bool local_quit = false; // Set to true when leaving help screen
+	Midi_state& state = its_mw_miner->get_midi_state();
+	unsigned int channel = its_grid_channel;
+	bool drawn = full; // whether anything was printed
+	if (full == true)
+	{
+		wclear(its_win);
+		box(its_win,0,0);
+		mvwprintw(its_win,1,5,"%s",PACKAGE_STRING);
+		mvwprintw(its_win,2,3,"Controllers on MIDI channel %u, LEFT/RIGHT to change, 'G' to leave",channel + 1);
+		for (int row = 0;row<8;row++)
+		{
+			mvwprintw(its_win,4 + row,2,"CC %3d-%3d:",row * 16,(row * 16) + 15);
+		}
+		state.mark_all(channel);
+		its_y = 4;
+		its_x = 14;
+	}
+	for (unsigned int cc = 0;cc<128;cc++)
+	{
+		if (state.take_dirty(channel,cc) == true)
+		{
+			its_y = 4 + static_cast<int>(cc / 16);
+			its_x = 14 + static_cast<int>(4 * (cc % 16));
+			mvwprintw(its_win,its_y,its_x,"%3d",state.get_cc(channel,cc));
+			drawn = true;
+		}
+	}
+	if (state.take_dirty(channel,Midi_state::program_cell) == true)
+	{
+		its_y = 13;
+		its_x = 2;
+		mvwprintw(its_win,its_y,its_x,"Program: %3d",state.get_program(channel));
+		drawn = true;
+	}
+	if (state.take_dirty(channel,Midi_state::bend_cell) == true)
+	{
+		its_y = 13;
+		its_x = 18;
+		mvwprintw(its_win,its_y,its_x,"Pitch bend: %5d",state.get_bend(channel));
+		drawn = true;
+	}
+	if (state.take_dirty(channel,Midi_state::aftertouch_cell) == true)
+	{
+		its_y = 13;
+		its_x = 40;
+		mvwprintw(its_win,its_y,its_x,"Aftertouch: %3d",state.get_aftertouch(channel));
+		drawn = true;
+	}
+	if (drawn == true)
+	{
+		// Leave the cursor on the last changed cell for screen readers
+		wmove(its_win,its_y,its_x);
+		its_compositor->refresh(its_win);
+	}
+}
 
-	// Prepare window and print header
+// Print the timing analysis, all values are printed each time
+void Curses_mw_ui::print_timing()
+{
+	Timing_report report = its_mw_miner->get_timing().get_report(Latency_stats::now_ns());
 	wclear(its_win);
 	box(its_win,0,0);
 	mvwprintw(its_win,1,5,"%s",PACKAGE_STRING);
-	mvwprintw(its_win,2,3,"Press 'H' to leave the help screen, PGUP/PGDOWN to scroll");
+	mvwprintw(its_win,2,3,"MIDI clock and active sensing, 'T' to leave");
+	if (its_timing_flag == false)
+	{
+		mvwprintw(its_win,4,2,"Clock and active sensing are ignored, start with --timing");
+		its_y = 4;
+		its_x = 2;
+		wmove(its_win,its_y,its_x);
+		its_compositor->refresh(its_win);
+		return;
+	}
+	mvwprintw(its_win,4,2,"Clock: %s, %lu clocks, %lu dropouts", \
+		(report.running == true) ? "running" : "stopped",report.clocks,report.dropouts);
+	mvwprintw(its_win,5,2,"Tempo: %.1f BPM, mean interval %s",report.bpm, \
+		Latency_stats::format_ns(report.interval_ns).c_str());
+	mvwprintw(its_win,6,2,"Jitter: deviation %s, 99%% within %s, max %s", \
+		Latency_stats::format_ns(report.jitter_sd_ns).c_str(), \
+		Latency_stats::format_ns(report.jitter_p99_ns).c_str(), \
+		Latency_stats::format_ns(report.jitter_max_ns).c_str());
+	mvwprintw(its_win,7,2,"Start: %lu, continue: %lu, stop: %lu",report.starts, \
+		report.continues,report.stops);
+	mvwprintw(its_win,9,2,"Active sensing: %s, %lu messages, %lu timeouts", \
+		(report.sensing_alive == true) ? "present" : "absent",report.sensings, \
+		report.sensing_timeouts);
+	mvwprintw(its_win,10,2,"Sensing interval: mean %s, max %s", \
+		Latency_stats::format_ns(report.sensing_interval_ns).c_str(), \
+		Latency_stats::format_ns(report.sensing_max_ns).c_str());
+	its_y = 5;
+	its_x = 2;
+	wmove(its_win,its_y,its_x);
+	its_compositor->refresh(its_win);
+}
 
-	// Set up messages and paging system
+// Print help screen
+void Curses_mw_ui::print_help()
+{
+	// Set up messages
 	vector<string> content; // List of commands to print
-	content.reserve(14);
+	content.reserve(20);
 	content.push_back(string("Cursor UP - Move one line up in the display window"));
 	content.push_back(string("Cursor DOWN - Move one line down in the display ewindow"));
+	content.push_back(string("PAGE UP/DOWN, HOME, END - Browse a long SysEx message"));
+	content.push_back(string("[ / ] - Step back/forward through the display history"));
+	content.push_back(string("J - Jump to the display shown at a certain time"));
+	content.push_back(string("A - Show statistics of requests and outputs"));
 	content.push_back(string("SPACE - Toggle direct data/display on demand modes"));
+	content.push_back(string("C - Compare the last sound/multi dump with the saved ones"));
 	content.push_back(string("D - Turn continuous display mode on/off"));
+	content.push_back(string("G - Show/hide the controller grid, LEFT/RIGHT select the channel"));
 	content.push_back(string("H - Turn help mode on/off"));
+	content.push_back(string("T - Show/hide tempo and jitter of MIDI clock and active sensing"));
 	content.push_back(string("Q - Quit the program"));
 	content.push_back(string("I - Select a new MIDI input"));
 	content.push_back(string("O - Select a new MIDI output"));
@@ -340,62 +790,62 @@ void Curses_mw_ui::print_help()
 	content.push_back(string("U - Toggle use of resource folder"));
 	content.push_back(string("V - Select a new device ID"));
 	content.push_back(string("W - Write the configuration file"));
+	show_lines(string("Press 'H' to leave the help screen, PGUP/PGDOWN to scroll"),content,'h');
+}
+
+// Show a list of lines with a paging system, leave_key leaves the screen
+void Curses_mw_ui::show_lines(string header, const vector<string>& content, int leave_key)
+{
+	bool local_quit = false; // Set to true when leaving the screen
 	int start_line = 3;
 	unsigned int num_lines = static_cast<unsigned int>(its_status_line - start_line); // Available screen lines
 	unsigned int num_pages = static_cast<unsigned int>(ceil(content.size() / float(num_lines))); // number of pages
 	unsigned int cur_page = 0; // number of current page
 	unsigned long int max_msg = 0; // maximum message index to print
-
-	// print first page
-	if (content.size() < (num_lines * (cur_page +1) -1))
+	bool redraw = true; // print the current page
+	if (num_pages == 0)
 	{
-		max_msg = content.size();
+		num_pages = 1;
 	}
-	else
+
+	while ((its_mw_miner->get_quit()) != true && (local_quit == false))
 	{
-		max_msg = (num_lines * (cur_page + 1));
-	}
-	int cur_line = start_line;
-	for (unsigned int i = (cur_page * num_lines);i<max_msg;i++, cur_line++)
-	{
-		mvwprintw(its_win,cur_line,2,"%s",content[i].c_str());
-	}
-	wmove(its_win,2,1);
-	wrefresh(its_win);
-
-	while ((its_mw_miner->get_quit()) != true && (local_quit == false))
-	{
-		its_ch = getch();
+		if (redraw == true)
+		{
+			if (content.size() < (num_lines * (cur_page +1) - 1))
+			{
+				max_msg = content.size();
+			}
+			else
+			{
+				max_msg = (num_lines * (cur_page + 1));
+			}
+			int cur_line = start_line;
+			wclear(its_win);
+			box(its_win,0,0);
+			mvwprintw(its_win,1,5,"%s",PACKAGE_STRING);
+			mvwprintw(its_win,2,3,"%s",header.c_str());
+			for (unsigned int i = (cur_page * num_lines);i<max_msg;i++, cur_line++)
+			{
+				mvwprintw(its_win,cur_line,2,"%s",content[i].c_str());
+			}
+			wmove(its_win,2,1);
+			its_compositor->refresh(its_win);
+			redraw = false;
+		}
+		its_ch = its_compositor->read_key();
 		switch(its_ch)
 		{
 			case KEY_PPAGE:
 			{
 				if (cur_page == 0)
 				{
-					beep();
+					its_compositor->bell();
 				}
 				else
 				{
 					cur_page--;
-					if (content.size() < (num_lines * (cur_page +1) - 1))
-					{
-						max_msg = content.size();
-					}
-					else
-					{
-						max_msg = (num_lines * (cur_page + 1));
-					}
-					cur_line = start_line;
-					wclear(its_win);
-					box(its_win,0,0);
-					mvwprintw(its_win,1,5,"%s",PACKAGE_STRING);
-					mvwprintw(its_win,2,3,"Press 'H' to leave the help screen, PGUP/PGDOWN to scroll");
-					for (unsigned int i = (cur_page * num_lines);i<max_msg;i++, cur_line++)
-					{
-						mvwprintw(its_win,cur_line,2,"%s",content[i].c_str());
-					}
-					wmove(its_win,2,1);
-					wrefresh(its_win);
+					redraw = true;
 				}
 				break;
 			}
@@ -403,30 +853,12 @@ void Curses_mw_ui::print_help()
 			{
 				if (cur_page == (num_pages -1))
 				{
-					beep();
+					its_compositor->bell();
 				}
 				else
 				{
 					cur_page++;
-					if (content.size() < (num_lines * (cur_page +1) - 1))
-					{
-						max_msg = content.size();
-					}
-					else
-					{
-						max_msg = (num_lines * (cur_page + 1));
-					}
-					cur_line = start_line;
-					wclear(its_win);
-					box(its_win,0,0);
-					mvwprintw(its_win,1,5,"%s",PACKAGE_STRING);
-					mvwprintw(its_win,2,3,"Press 'H' to leave the help screen, PGUP/PGDOWN to scroll");
-					for (unsigned int i = (cur_page * num_lines);i<max_msg;i++, cur_line++)
-					{
-						mvwprintw(its_win,cur_line,2,"%s",content[i].c_str());
-					}
-					wmove(its_win,2,1);
-					wrefresh(its_win);
+					redraw = true;
 				}
 				break;
 			}
@@ -436,8 +868,6 @@ void Curses_mw_ui::print_help()
 				its_mw_miner->set_quit(true);
 				break;
 			}
-			case 'h':
-			case 'H':
 			case 27:
 			{
 				local_quit = true;
@@ -445,9 +875,13 @@ void Curses_mw_ui::print_help()
 			}
 			default:
 			{
-				if (its_ch != ERR)
+				if ((its_ch == leave_key) || (its_ch == toupper(leave_key)))
+				{
+					local_quit = true;
+				}
+				else if (its_ch != ERR)
 				{
-					beep();
+					its_compositor->bell();
 				}
 				break;
 			}
@@ -511,10 +945,10 @@ bool Curses_mw_ui::change_port(char designation)
 	its_y = 5;
 	its_x = 3;
 	wmove(its_win,its_y,its_x);
-	wrefresh(its_win);
+	its_compositor->refresh(its_win);
 	while (search_quit == false && its_mw_miner->get_quit() == false)
 	{
-		its_ch = getch();
+		its_ch = its_compositor->read_key();
 		switch(its_ch)
 		{
 			case KEY_UP:
@@ -524,11 +958,11 @@ bool Curses_mw_ui::change_port(char designation)
 				{
 					its_y--;
 					wmove(its_win,its_y,its_x);
-					wrefresh(its_win);
+					its_compositor->refresh(its_win);
 				}
 				else
 				{
-					beep();
+					its_compositor->bell();
 				}
 				break;
 			}
@@ -539,11 +973,11 @@ bool Curses_mw_ui::change_port(char designation)
 				{
 					its_y++;
 					wmove(its_win,its_y,its_x);
-					wrefresh(its_win);
+					its_compositor->refresh(its_win);
 				}
 				else
 				{
-					beep();
+					its_compositor->bell();
 				}
 				break;
 			}
@@ -565,7 +999,7 @@ bool Curses_mw_ui::change_port(char designation)
 			{
 				if (its_ch != ERR)
 				{
-					beep();
+					its_compositor->bell();
 				}
 				break;
 			}
@@ -583,6 +1017,12 @@ bool Curses_mw_ui::change_port(char designation)
 		{
 			return_value = set_midi_output(static_cast<unsigned int>(cur_port_number));
 		}
+		if ((return_value == true) && (its_offline == true))
+		{
+			// The user found the ports
+			its_offline = false;
+			its_mw_miner->set_offline(false);
+		}
 	}
 	return return_value;
 }
@@ -620,8 +1060,8 @@ void Curses_mw_ui::change_dev_id()
 			mvwprintw(its_win,its_y,its_x,"%d",cur_id);
 		}
 		wmove(its_win,its_y,its_x);
-		wrefresh(its_win);
-		its_ch = getch();
+		its_compositor->refresh(its_win);
+		its_ch = its_compositor->read_key();
 		switch(its_ch)
 		{
 			case KEY_DOWN:
@@ -632,7 +1072,7 @@ void Curses_mw_ui::change_dev_id()
 				}
 				else
 				{
-					beep();
+					its_compositor->bell();
 				}
 				break;
 			}
@@ -644,7 +1084,7 @@ void Curses_mw_ui::change_dev_id()
 				}
 				else
 				{
-					beep();
+					its_compositor->bell();
 				}
 				break;
 			}
@@ -665,7 +1105,7 @@ void Curses_mw_ui::change_dev_id()
 			{
 				if (its_ch != ERR)
 				{
-					beep();
+					its_compositor->bell();
 				}
 				break;
 			}
@@ -695,6 +1135,46 @@ bool Curses_mw_ui::write_cfg()
 	cfg_out << "input_port = " << its_midi_input_name << "\n";
 	cfg_out << "output_port = " << its_midi_output_name << "\n";
 	cfg_out << "device_id = " << static_cast<unsigned short int>(its_synth_info->get_dev_id()) << "\n";
+	cfg_out << "frame_rate = " << its_frame_rate << "\n";
+	cfg_out << "history_size = " << its_history_size << "\n";
+	cfg_out << "settle_time = " << its_settle_time << "\n";
+	cfg_out << "request_rate = " << its_request_rate << "\n";
+	if (its_compositor->get_backend() == Screen_backend::ansi)
+	{
+		cfg_out << "backend = ansi\n";
+	}
+	if (its_batch_input == true)
+	{
+		cfg_out << "input_mode = batch\n";
+	}
+	if (its_input_queue != default_input_queue)
+	{
+		cfg_out << "input_queue = " << its_input_queue << "\n";
+	}
+	if (its_timing_flag == true)
+	{
+		cfg_out << "timing = true\n";
+	}
+	if (its_rt_policy.get_enabled() == true)
+	{
+		cfg_out << "realtime = " << its_rt_policy.get_policy_name() << "\n";
+		if (its_rt_policy.get_priority() != Rt_policy::default_priority)
+		{
+			cfg_out << "rt_priority = " << its_rt_policy.get_priority() << "\n";
+		}
+		if (its_rt_policy.get_cpu() >= 0)
+		{
+			cfg_out << "rt_cpu = " << its_rt_policy.get_cpu() << "\n";
+		}
+	}
+	for (auto& spec: its_sink_specs)
+	{
+		cfg_out << "sink = " << spec << "\n";
+	}
+	if (!its_mw_miner->get_filter().empty())
+	{
+		cfg_out << "filter = " << its_mw_miner->get_filter() << "\n";
+	}
 	cfg_out << "resource_folder = " << its_res_dir;
 	cfg_out.close();
 	return true;
@@ -744,11 +1224,15 @@ void Curses_mw_ui::init_ui()
 	nodelay(stdscr,TRUE);
 	its_win = newwin(20,80,0,0);
 	wrefresh(its_win);
+	// From here on only the compositor writes to the terminal
+	its_compositor->start();
+	its_dump_writer->start();
 }
 
 // Stop ncurses UI
 void Curses_mw_ui::shut_ui()
 {
+	its_compositor->stop();
 	delwin(its_win);
 	clear();
 	refresh();
@@ -785,7 +1269,9 @@ string Curses_mw_ui::trim(char *str) const
 bool Curses_mw_ui::save_dump()
 {
 	bool return_value = true;
-	string msg_type = its_mw_miner->get_last_type();
+	// Capture goes on meanwhile, everything below uses this snapshot
+	std::shared_ptr<const Midi_snapshot> last = its_mw_miner->get_last_snapshot();
+	string msg_type = its_mw_miner->get_dump_type(*last);
 	if (msg_type.empty())
 	{
 		return false;
@@ -798,9 +1284,19 @@ bool Curses_mw_ui::save_dump()
 		}
 		else // it's not a display/mode/remote dump, so save
 		{
+			Dump_status status = last->status;
+			if ((status != Dump_status::ok) && (status != Dump_status::no_dump))
+			{
+				string question = string("The ") + msg_type + string(" dump is invalid (") + its_synth_info->get_dump_status_text(status) + string("). Save anyway?");
+				if (confirm(question) == false)
+				{
+					its_error_msg = string("Invalid ") + msg_type + string(" dump not saved.");
+					return false;
+				}
+			}
 			bool local_quit = false; // set to true, when quitting
 			string filename;
-			filename = its_mw_miner->get_suggested_dump_filename();
+			filename = its_mw_miner->get_suggested_dump_filename(*last);
 			wclear(its_win);
 			box(its_win,0,0);
 			mvwprintw(its_win,1,5,"%s",PACKAGE_STRING);
@@ -825,90 +1321,642 @@ bool Curses_mw_ui::save_dump()
 			set_form_sub(form,derwin(its_win,2,78,3,1));
 			post_form(form);
 			form_driver(form,REQ_END_LINE);
-			refresh();
-			wrefresh(its_win);
+			its_compositor->refresh(its_win);
 			while ((local_quit == false) && (its_mw_miner->get_quit() == false))
 			{
-				its_ch = getch();
-				switch(its_ch)
+				its_ch = its_compositor->read_key();
+				switch(its_ch)
+				{
+					case KEY_LEFT:
+					{
+						form_driver(form, REQ_PREV_CHAR);
+						break;
+					}
+					case KEY_RIGHT:
+					{
+						form_driver(form, REQ_NEXT_CHAR);
+						break;
+					}
+					case KEY_BACKSPACE:
+					case 127:
+					{
+						form_driver(form, REQ_DEL_PREV);
+						break;
+					}
+					case KEY_DC:
+					{
+						form_driver(form, REQ_DEL_CHAR);
+						break;
+					}
+					case KEY_HOME:
+					case KEY_BEG:
+					{
+						form_driver(form,REQ_BEG_LINE);
+						break;
+					}
+					case KEY_END:
+					{
+						form_driver(form,REQ_END_LINE);
+						break;
+					}
+					case 27:
+					{
+						local_quit = true;
+						break;
+					}
+					case 10: // Return
+					{
+						form_driver(form, REQ_PREV_FIELD);
+						form_driver(form, REQ_NEXT_FIELD);
+						filename = trim(field_buffer(fields[2],0));
+						if (!filename.empty())
+						{
+							if (its_use_res_dir == true)
+							{
+								filename = its_res_dir + string("/") + msg_type + string("/") + filename;
+							}
+							// The result shows up on the error line when written
+							std::shared_ptr<const vector<unsigned char> > data(last,&last->msg);
+							return_value = its_dump_writer->save(data,filename,msg_type);
+							if (return_value == false)
+							{
+								its_error_msg = string("Too many saves pending, ") + msg_type + string(" dump not saved to ") + filename;
+							}
+						}
+						local_quit = true;
+						break;
+					}
+					default:
+					{
+						if (its_ch != ERR)
+						{
+							form_driver(form,its_ch);
+						}
+						break;
+					}
+				}
+				its_compositor->refresh(its_win);
+			}
+			free_form(form);
+			free_field(fields[0]);
+			free_field(fields[1]);
+			free_field(fields[2]);
+			free_field(fields[3]);
+			wclear(its_win);
+		}
+	}
+	return return_value;
+}
+
+// Compare the last sound/multi dump with all saved dumps of its type
+bool Curses_mw_ui::compare_dump()
+{
+	vector<unsigned char> dump = its_mw_miner->get_last_msg();
+	if ((dump.size() <5) || (dump[0] != 0xf0) || \
+		(its_dump_decoder->has_table(dump[4]) == false))
+	{
+		its_error_msg = string("The last message is no sound or multi dump.");
+		return false;
+	}
+	if (its_synth_info->check_dump(dump) != Dump_status::ok)
+	{
+		its_error_msg = string("The last dump is invalid and can't be compared.");
+		return false;
+	}
+	if (dump.size() != its_synth_info->get_dump_length(dump[4]))
+	{
+		its_error_msg = string("Only single dumps can be compared.");
+		return false;
+	}
+
+	string msg_type = its_synth_info->get_dump_name(dump[4]);
+	string lib_dir = its_res_dir + string("/") + msg_type;
+	unsigned long int lib_size = its_dump_library->load(lib_dir,dump[4]);
+	if (lib_size == 0)
+	{
+		its_error_msg = string("There are no saved ") + msg_type + string(" dumps in ") + lib_dir;
+		return false;
+	}
+
+	vector<Dump_match> matches = its_dump_library->find_nearest(dump,10);
+	vector<string> content;
+	content.reserve(matches.size() * 8);
+	unsigned int rank = 1;
+	for (auto& match: matches)
+	{
+		content.push_back(to_string(rank) + string(". ") + \
+			its_dump_library->get_file_name(match.index) + string(": ") + \
+			to_string(match.diffs.size()) + string(" differing parameters"));
+		for (auto& diff: match.diffs)
+		{
+			content.push_back(string("    ") + diff.param->name + string(": ") + \
+				diff.value + string(" (saved: ") + diff.other_value + string(")"));
+		}
+		rank++;
+	}
+	show_lines(string("Nearest of ") + to_string(lib_size) + string(" saved ") + msg_type + \
+		string(" dumps, press 'C' to leave"),content,'c');
+	return true;
+}
+
+// Show counters of all outputs
+void Curses_mw_ui::show_stats()
+{
+	vector<string> content;
+	Req_correlator& correlator = its_mw_miner->get_correlator();
+	content.push_back(string("Requests to the synthesizer: answered ") + \
+		to_string(correlator.get_answered()) + string(", timed out ") + \
+		to_string(correlator.get_timed_out()) + string(", pending ") + \
+		to_string(correlator.get_pending()));
+	Midi_out_scheduler& scheduler = its_mw_miner->get_out_scheduler();
+	content.push_back(string("MIDI output: sent ") + to_string(scheduler.get_sent()) + \
+		string(" messages, ") + to_string(scheduler.get_sent_bytes()) + string(" bytes, ") + \
+		to_string(scheduler.get_rate()) + string(" bytes/s, coalesced ") + \
+		to_string(scheduler.get_coalesced()));
+	content.push_back(string("    queued user ") + \
+		to_string(scheduler.get_depth(Out_priority::user)) + string(", dump requests ") + \
+		to_string(scheduler.get_depth(Out_priority::dump_request)) + string(", display polls ") + \
+		to_string(scheduler.get_depth(Out_priority::display_poll)));
+	content.push_back(string("Screen: ") + to_string(its_compositor->get_damages()) + \
+		string(" window updates drawn in ") + to_string(its_compositor->get_frames()) + \
+		string(" frames"));
+	if (its_compositor->get_backend() == Screen_backend::ansi)
+	{
+		content.push_back(string("    ANSI backend: ") + to_string(its_compositor->get_bytes()) + \
+			string(" bytes in ") + to_string(its_compositor->get_writes()) + string(" writes"));
+	}
+	content.push_back(string("Saved dumps: ") + to_string(its_dump_writer->get_saved()) + \
+		string(", failed ") + to_string(its_dump_writer->get_failed()) + \
+		string(", pending ") + to_string(its_dump_writer->get_pending()) + \
+		string(", syncs ") + to_string(its_dump_writer->get_syncs()));
+	const Input_clock& input_clock = its_mw_miner->get_input_clock();
+	content.push_back(string("MIDI input delay after the driver: ") + \
+		input_clock.get_delay().format());
+	content.push_back(string("    jitter against RtMidi's delta times: ") + \
+		input_clock.get_jitter().format());
+	const Latency_stats& latency = its_compositor->get_latency();
+	content.push_back(string("MIDI input to screen: ") + to_string(latency.get_count()) + \
+		string(" frames, ") + latency.format());
+	Syx_assembler& assembler = its_mw_miner->get_assembler();
+	content.push_back(string("SysEx in pieces: ") + to_string(assembler.get_assembled()) + \
+		string(" joined, ") + to_string(assembler.get_dropped()) + \
+		string(" incomplete or too long"));
+	if (its_midi_reader != nullptr)
+	{
+		content.push_back(string("MIDI input: ") + to_string(its_midi_reader->get_messages()) + \
+			string(" messages in ") + to_string(its_midi_reader->get_batches()) + \
+			string(" batches, largest ") + to_string(its_midi_reader->get_largest()) + \
+			string(", ") + to_string(its_midi_reader->get_wakeups()) + string(" wakeups"));
+	}
+	if (its_timing_flag == true)
+	{
+		Timing_report timing = its_mw_miner->get_timing().get_report(Latency_stats::now_ns());
+		content.push_back(string("MIDI clock: ") + to_string(timing.clocks) + \
+			string(" clocks, ") + to_string(timing.dropouts) + string(" dropouts, jitter ") + \
+			Latency_stats::format_ns(timing.jitter_sd_ns) + string(", p99 ") + \
+			Latency_stats::format_ns(timing.jitter_p99_ns));
+		content.push_back(string("    active sensing ") + to_string(timing.sensings) + \
+			string(" messages, ") + to_string(timing.sensing_timeouts) + string(" timeouts"));
+	}
+	content.push_back(string("Port watcher: ") + to_string(its_port_watcher->get_scans()) + \
+		string(" scans, last ") + Latency_stats::format_ns(its_port_watcher->get_scan_ns()) + \
+		string(", ") + to_string(its_port_watcher->get_changes()) + string(" changes"));
+	content.push_back(string("    reconnected ") + to_string(its_reconnect_time.get_count()) + \
+		string(" times after ") + its_reconnect_time.format());
+	content.push_back(string("MIDI port swaps: ") + to_string(its_swap_time.get_count()) + \
+		string(", ") + its_swap_time.format() + string(", held input dropped ") + \
+		to_string(its_input_gate->get_dropped()));
+	if (its_rt_policy.get_enabled() == true)
+	{
+		content.push_back(string("Real-time mode:"));
+		for (auto& line: its_rt_policy.get_report())
+		{
+			content.push_back(string("    ") + line);
+		}
+	}
+	Refresh_trigger& trigger = its_mw_miner->get_refresh_trigger();
+	content.push_back(string("Display on demand: ") + to_string(trigger.get_leading()) + \
+		string(" requests at the start and ") + to_string(trigger.get_trailing()) + \
+		string(" at the end of MIDI activity"));
+	for (auto sink: its_sink_hub->get_sinks())
+	{
+		content.push_back(string("Output ") + sink->get_name() + string(":"));
+		content.push_back(string("    posted ") + to_string(sink->get_posted()) + \
+			string(", written ") + to_string(sink->get_written()) + \
+			string(", dropped ") + to_string(sink->get_dropped()) + \
+			string(", coalesced ") + to_string(sink->get_coalesced()) + \
+			string(", queued ") + to_string(sink->get_depth()));
+	}
+	for (auto sink: its_socket_sinks)
+	{
+		content.push_back(string("Clients of ") + sink->get_name() + string(": ") + \
+			to_string(sink->get_clients()));
+	}
+	show_lines(string("Statistics, press 'A' to leave"),content,'a');
+}
+
+// Report finished saves on the error line
+void Curses_mw_ui::show_save_results()
+{
+	Save_result result;
+	bool shown = false;
+	while (its_dump_writer->take_result(result) == true)
+	{
+		wmove(its_win,its_error_line,2);
+		wclrtoeol(its_win);
+		box(its_win,0,0);
+		if (result.ok == true)
+		{
+			mvwprintw(its_win,its_error_line,2,"Saved %s dump to %s",result.label.c_str(), \
+				result.filename.c_str());
+		}
+		else
+		{
+			its_compositor->bell();
+			mvwprintw(its_win,its_error_line,2,"Couldn't save %s dump to %s: %s", \
+				result.label.c_str(),result.filename.c_str(),result.error_msg.c_str());
+		}
+		shown = true;
+	}
+	if (shown == true)
+	{
+		its_compositor->refresh(its_win);
+	}
+}
+
+// Follow the port list of the watcher. When a port of ours is gone or the
+// output fails the session waits, history and settings are kept. When
+// the port names are back, or new ports with the synth behind them, the
+// ports are opened again and the display is requested.
+void Curses_mw_ui::check_ports()
+{
+	unsigned long int changes = its_port_watcher->get_changes();
+	bool failed = (its_offline == false) && (its_mw_miner->get_offline() == true);
+	bool probed = (its_fingerprint_probe.valid() == true) && \
+		(its_fingerprint_probe.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+	if ((changes == its_port_changes) && (failed == false) && (probed == false))
+	{
+		return;
+	}
+	if (changes != its_port_changes)
+	{
+		its_port_changes = changes;
+		its_reopened = false;
+	}
+	vector<string> inputs = its_port_watcher->get_inputs();
+	vector<string> outputs = its_port_watcher->get_outputs();
+	int input_n = Port_watcher::find(inputs,its_midi_input_name);
+	int output_n = Port_watcher::find(outputs,its_midi_output_name);
+	bool present = (input_n >= 0) && (output_n >= 0);
+	string input_name = (input_n >= 0) ? inputs[static_cast<unsigned long int>(input_n)] : string();
+	string output_name = (output_n >= 0) ? outputs[static_cast<unsigned long int>(output_n)] : string();
+	if (its_offline == false)
+	{
+		if (probed == true)
+		{
+			its_fingerprint_probe.get(); // back online meanwhile, not needed
+		}
+		if ((present == true) && (failed == false))
+		{
+			return; // another device came or went
+		}
+		its_offline = true;
+		its_offline_inputs = inputs;
+		its_offline_outputs = outputs;
+		its_mw_miner->set_offline(true);
+		if (present == false)
+		{
+			show_port_msg(string("Lost the MIDI ports, waiting for them to return"));
+			return;
+		}
+		// Only sending failed, the ports are opened again once per port list
+		if (its_reopened == true)
+		{
+			show_port_msg(string("Sending MIDI failed, waiting for the ports to change"));
+			return;
+		}
+		its_reopened = true;
+	}
+	if ((present == false) && (its_fingerprint.empty() == false))
+	{
+		present = find_fingerprint(inputs,outputs,input_name,output_name);
+	}
+	if (present == false)
+	{
+		return;
+	}
+	if ((set_midi_input(input_name,false) == false) || \
+		(set_midi_output(output_name,false) == false))
+	{
+		// Tried again with the next change of the ports
+		show_port_msg(string("Couldn't reconnect: ") + its_error_msg);
+		its_error_msg.clear();
+		return;
+	}
+	its_offline = false;
+	its_mw_miner->set_offline(false);
+	if (its_mw_miner->get_thru() == false)
+	{
+		its_mw_miner->request_disp();
+	}
+	its_reconnect_time.add(Latency_stats::now_ns() - its_port_watcher->get_change_ns());
+	show_port_msg(string("Reconnected to ") + its_midi_input_name);
+}
+
+// The ports are there but the synth does not answer. The session goes on,
+// the miner asks it every few seconds.
+void Curses_mw_ui::check_synth()
+{
+	bool silent = its_mw_miner->get_silent();
+	if (silent == its_silent)
+	{
+		return;
+	}
+	its_silent = silent;
+	if (silent == true)
+	{
+		show_port_msg(string("The synthesizer does not answer, asking every ") + \
+			to_string(Curses_mw_miner::silent_poll_ms / 1000) + string(" s"));
+	}
+	else
+	{
+		show_port_msg(string("The synthesizer answers again"));
+	}
+}
+
+// Ports which came since the disconnection and lead to the synth, which
+// answers the identity request with the fingerprint. Input and output of
+// an interface have the same name. They are probed by a thread of their
+// own, each port list once, so the UI carries on meanwhile.
+bool Curses_mw_ui::find_fingerprint(const vector<string>& inputs, \
+	const vector<string>& outputs, string& input_name, string& output_name)
+{
+	if (its_fingerprint_probe.valid() == true)
+	{
+		if (its_fingerprint_probe.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			return false;
+		}
+		std::pair<string,string> found = its_fingerprint_probe.get();
+		if (found.first.empty() == false)
+		{
+			input_name = found.first;
+			output_name = found.second;
+			return true;
+		}
+	}
+	if (its_probed_changes == its_port_changes)
+	{
+		return false; // this list was probed, wait for the next change
+	}
+	its_probed_changes = its_port_changes;
+	vector<string> candidates;
+	for (auto& name: inputs)
+	{
+		if (Port_watcher::find(its_offline_inputs,name) >= 0)
+		{
+			continue; // not new
+		}
+		int out_n = Port_watcher::find(outputs,name);
+		if ((out_n <0) || (Port_watcher::find(its_offline_outputs, \
+			outputs[static_cast<unsigned long int>(out_n)]) >= 0))
+		{
+			continue;
+		}
+		candidates.push_back(name);
+	}
+	if (candidates.empty() == false)
+	{
+		try
+		{
+			its_fingerprint_probe = std::async(std::launch::async,&probe_fingerprint, \
+				its_midi_name + string(" Probe"),candidates,its_fingerprint,probe_timeout_ms);
+		}
+		catch (std::system_error&)
+		{
+			// No thread for it, probed with the next change of the ports
+		}
+	}
+	return false;
+}
+
+// The identity of the synth, to find it on other ports, see check_ports
+void Curses_mw_ui::learn_fingerprint()
+{
+	if ((its_midi_in->isPortOpen() == false) || (its_midi_out->isPortOpen() == false))
+	{
+		return;
+	}
+	its_input_gate->expect(its_input_gate->get_active(),&is_identity_reply);
+	its_mw_miner->get_out_scheduler().send(Out_priority::user, \
+		vector<unsigned char> { 0xf0, 0x7e, 0x7f, 0x06, 0x01, 0xf7 });
+	its_input_gate->wait_expected(probe_timeout_ms,&its_fingerprint);
+}
+
+void Curses_mw_ui::show_port_msg(const string& msg)
+{
+	wmove(its_win,its_error_line,2);
+	wclrtoeol(its_win);
+	box(its_win,0,0);
+	mvwprintw(its_win,its_error_line,2,"%s",msg.c_str());
+	its_compositor->refresh(its_win);
+}
+
+// Point to the statistics when a thread or the memory lock failed
+void Curses_mw_ui::show_rt_failures()
+{
+	unsigned long int failures = its_rt_policy.get_failures();
+	if (failures == its_rt_failures)
+	{
+		return;
+	}
+	its_rt_failures = failures;
+	wmove(its_win,its_error_line,2);
+	wclrtoeol(its_win);
+	box(its_win,0,0);
+	mvwprintw(its_win,its_error_line,2,"Real-time mode is incomplete, press 'A' for details");
+	its_compositor->refresh(its_win);
+}
+
+// Commands of socket clients, a display request is handled right here
+int Curses_mw_ui::take_remote_key()
+{
+	string command;
+	for (auto sink: its_socket_sinks)
+	{
+		while (sink->take_command(command) == true)
+		{
+			if (command == "disp")
+			{
+				its_mw_miner->request_disp();
+				continue;
+			}
+			string key = command.substr(4); // "key <name>"
+			if (key == "space")
+			{
+				return ' ';
+			}
+			else if (key == "up")
+			{
+				return KEY_UP;
+			}
+			else if (key == "down")
+			{
+				return KEY_DOWN;
+			}
+			else if (key == "left")
+			{
+				return KEY_LEFT;
+			}
+			else if (key == "right")
+			{
+				return KEY_RIGHT;
+			}
+			return key[0];
+		}
+	}
+	return ERR;
+}
+
+// Ask a yes/no question, return true only for yes
+bool Curses_mw_ui::confirm(string question)
+{
+	bool answer = false;
+	bool local_quit = false; // set to true, when answered
+	wclear(its_win);
+	box(its_win,0,0);
+	mvwprintw(its_win,1,5,"%s",PACKAGE_STRING);
+	mvwprintw(its_win,2,2,"%s",question.c_str());
+	mvwprintw(its_win,3,2,"Press Y to confirm or N to cancel.");
+	wmove(its_win,2,2);
+	its_compositor->refresh(its_win);
+	while ((local_quit == false) && (its_mw_miner->get_quit() == false))
+	{
+		its_ch = its_compositor->read_key();
+		switch(its_ch)
+		{
+			case 'y':
+			case 'Y':
+			{
+				answer = true;
+				local_quit = true;
+				break;
+			}
+			case 'n':
+			case 'N':
+			case 27:
+			{
+				local_quit = true;
+				break;
+			}
+			default:
+			{
+				if (its_ch != ERR)
+				{
+					its_compositor->bell();
+				}
+				break;
+			}
+		}
+	}
+	return answer;
+}
+
+// Ask for a line of text, return an empty string if cancelled
+string Curses_mw_ui::ask_text(string question)
+{
+	string answer;
+	bool local_quit = false; // set to true, when answered
+	wclear(its_win);
+	box(its_win,0,0);
+	mvwprintw(its_win,1,5,"%s",PACKAGE_STRING);
+	mvwprintw(its_win,2,2,"%s",question.c_str());
+	mvwprintw(its_win,3,2,"Press return to confirm or escape to cancel.");
+	while ((local_quit == false) && (its_mw_miner->get_quit() == false))
+	{
+		wmove(its_win,5,2);
+		wclrtoeol(its_win);
+		box(its_win,0,0);
+		mvwprintw(its_win,5,2,"%s",answer.c_str());
+		its_compositor->refresh(its_win);
+		its_ch = ERR;
+		while ((its_ch == ERR) && (its_mw_miner->get_quit() == false))
+		{
+			its_ch = its_compositor->read_key();
+		}
+		switch(its_ch)
+		{
+			case 10: // Return
+			{
+				local_quit = true;
+				break;
+			}
+			case 27:
+			{
+				answer.clear();
+				local_quit = true;
+				break;
+			}
+			case KEY_BACKSPACE:
+			case 127:
+			{
+				if (answer.empty())
 				{
-					case KEY_LEFT:
-					{
-						form_driver(form, REQ_PREV_CHAR);
-						break;
-					}
-					case KEY_RIGHT:
-					{
-						form_driver(form, REQ_NEXT_CHAR);
-						break;
-					}
-					case KEY_BACKSPACE:
-					case 127:
-					{
-						form_driver(form, REQ_DEL_PREV);
-						break;
-					}
-					case KEY_DC:
-					{
-						form_driver(form, REQ_DEL_CHAR);
-						break;
-					}
-					case KEY_HOME:
-					case KEY_BEG:
-					{
-						form_driver(form,REQ_BEG_LINE);
-						break;
-					}
-					case KEY_END:
-					{
-						form_driver(form,REQ_END_LINE);
-						break;
-					}
-					case 27:
-					{
-						local_quit = true;
-						break;
-					}
-					case 10: // Return
-					{
-						form_driver(form, REQ_PREV_FIELD);
-						form_driver(form, REQ_NEXT_FIELD);
-						filename = trim(field_buffer(fields[2],0));
-						if (!filename.empty())
-						{
-							if (its_use_res_dir == true)
-							{
-								filename = its_res_dir + string("/") + its_mw_miner->get_last_type() + string("/") + filename;
-							}
-							return_value = its_mw_miner->write_last_dump(filename);
-							if (return_value == false)
-							{
-								its_error_msg = string("Couldn't save ") + msg_type + string(" dump to ") + filename;
-							}
-						}
-						local_quit = true;
-						break;
-					}
-					default:
-					{
-						if (its_ch != ERR)
-						{
-							form_driver(form,its_ch);
-						}
-						break;
-					}
+					its_compositor->bell();
+				}
+				else
+				{
+					answer.erase(answer.size() - 1);
 				}
-				wrefresh(its_win);
+				break;
+			}
+			default:
+			{
+				if ((its_ch >= 32) && (its_ch <127) && (answer.size() <70))
+				{
+					answer.push_back(static_cast<char>(its_ch));
+				}
+				else
+				{
+					its_compositor->bell();
+				}
+				break;
 			}
-			free_form(form);
-			free_field(fields[0]);
-			free_field(fields[1]);
-			free_field(fields[2]);
-			free_field(fields[3]);
-			wclear(its_win);
 		}
 	}
-	return return_value;
+	return answer;
+}
+
+// Ask for a time of today and show the display frame of that time
+bool Curses_mw_ui::jump_history()
+{
+	string answer = ask_text(string("Jump to the display at time (HH:MM or HH:MM:SS):"));
+	if (answer.empty())
+	{
+		return true;
+	}
+	int hour = 0, minute = 0, second = 0;
+	int fields = sscanf(answer.c_str(),"%d:%d:%d",&hour,&minute,&second);
+	if ((fields <2) || (hour <0) || (hour >23) || (minute <0) || (minute >59) || \
+		(second <0) || (second >59))
+	{
+		its_error_msg = string("Invalid time ") + answer;
+		return false;
+	}
+	std::time_t now = std::time(nullptr);
+	struct tm local;
+	localtime_r(&now,&local);
+	local.tm_hour = hour;
+	local.tm_min = minute;
+	local.tm_sec = second;
+	local.tm_isdst = -1;
+	std::int64_t time_ms = static_cast<std::int64_t>(std::mktime(&local)) * 1000 + 999;
+	if (its_mw_miner->history_jump(time_ms) == false)
+	{
+		its_error_msg = string("The display history is empty.");
+		return false;
+	}
+	return true;
 }
 
 // Main UI event loop for the program
@@ -916,17 +1964,47 @@ bool Curses_mw_ui::run()
 {
 	bool ret = true; // used to capture return values from other function calls
 
-	// MIDI in will accept SysEx, but no clock and active sensing
-	its_midi_in->ignoreTypes(false,true,true);
-	// Set callback for MIDI input, so Curses_mw_miner is notified on new data
-	its_midi_in->setCallback(&mw_midi_callback,static_cast<void *>(its_mw_miner));
+	// MIDI in will accept SysEx, clock and active sensing only for the analyzer
+	its_midi_in->ignoreTypes(false,!its_timing_flag,!its_timing_flag);
+	// Memory is locked before the miner starts its threads
+	if (its_rt_policy.get_enabled() == true)
+	{
+		its_rt_policy.lock_memory();
+		its_mw_miner->set_rt_policy(&its_rt_policy);
+	}
+	// MIDI input goes through the gate to the miner, from now on ports
+	// are switched make before break
+	its_input_route = new_route(its_input_gate->get_active());
+	its_midi_reader = start_input(its_midi_in,its_input_route);
 	print_main_screen();
-	thread mw_miner_thread(&Curses_mw_miner::run,its_mw_miner);
+	thread mw_miner_thread;
+	try
+	{
+		mw_miner_thread = thread(&Curses_mw_miner::run,its_mw_miner);
+	}
+	catch (std::system_error& e)
+	{
+		its_error_msg = string("Could not start the miner: ") + string(e.what());
+		its_error_flag = true;
+	}
+	if (its_error_flag == false)
+	{
+		learn_fingerprint();
+		its_port_changes = its_port_watcher->get_changes();
+		if (its_port_watcher->start() == false)
+		{
+			show_port_msg(string("Could not watch the MIDI ports, no reconnection"));
+		}
+	}
 	std::chrono::milliseconds sleep_time(5); // 5ms between each read
 
 	while (its_mw_miner->get_quit() == false && its_error_flag == false)
 	{
-		its_ch = getch();
+		its_ch = its_compositor->read_key();
+		if (its_ch == ERR)
+		{
+			its_ch = take_remote_key();
+		}
 		switch(its_ch)
 		{
 			case ' ':
@@ -946,7 +2024,7 @@ bool Curses_mw_ui::run()
 					{
 						mvwprintw(its_win,its_status_line,2,"[Direct MIDI mode]");
 					}
-					wrefresh(its_win);
+					its_compositor->refresh(its_win);
 					its_mw_miner->focus();
 				}
 				break;
@@ -962,7 +2040,7 @@ bool Curses_mw_ui::run()
 					wclrtoeol(its_win);
 					box(its_win,0,0);
 					mvwprintw(its_win,its_status_line,2,"[Continuous display mode]");
-					wrefresh(its_win);
+					its_compositor->refresh(its_win);
 					its_mw_miner->focus();
 				}
 				break;
@@ -977,6 +2055,14 @@ bool Curses_mw_ui::run()
 				its_mw_miner->process_cmd(its_ch);
 				break;
 			}
+			case KEY_PPAGE:
+			case KEY_NPAGE:
+			case KEY_HOME:
+			case KEY_END:
+			{
+				its_mw_miner->process_cmd(its_ch);
+				break;
+			}
 			case 'q':
 			case 'Q':
 			{
@@ -994,9 +2080,7 @@ bool Curses_mw_ui::run()
 			case 's':
 			case 'S':
 			{
-				its_mw_miner->set_paused(true);
 				ret = save_dump();
-				its_mw_miner->set_paused(false);
 				print_main_screen();
 				if ((ret == false) && (its_error_msg.empty() == false))
 				{
@@ -1011,12 +2095,12 @@ bool Curses_mw_ui::run()
 				ret = write_cfg();
 				if (ret == false && its_error_flag == false)
 				{
-					beep();
+					its_compositor->bell();
 					wmove(its_win,its_error_line,2);
 					wclrtoeol(its_win);
 					box(its_win,0,0);
 					mvwprintw(its_win,its_error_line,2,"%s",its_error_msg.c_str());
-					wrefresh(its_win);
+					its_compositor->refresh(its_win);
 					its_mw_miner->focus();
 					its_error_msg.clear();
 				}
@@ -1029,7 +2113,6 @@ bool Curses_mw_ui::run()
 			case 'i':
 			case 'I':
 			{
-				its_mw_miner->set_paused(true);
 				ret = change_port('i');
 				print_main_screen();
 				if (ret == false && its_error_flag == false)
@@ -1038,24 +2121,19 @@ bool Curses_mw_ui::run()
 					wclrtoeol(its_win);
 					box(its_win,0,0);
 					mvwprintw(its_win,its_error_line,2,"%s",its_error_msg.c_str());
-					wrefresh(its_win);
+					its_compositor->refresh(its_win);
 					its_error_msg.clear();
 				}
 				if (its_error_flag == true)
 				{
 					its_mw_miner->set_quit(true);
 				}
-				else
-				{
-					its_mw_miner->set_paused(false);
-				}
 				its_mw_miner->focus();
 				break;
 			}
 			case 'o':
 			case 'O':
 			{
-				its_mw_miner->set_paused(true);
 				ret = change_port('o');
 				print_main_screen();
 				if (ret == false && its_error_flag == false)
@@ -1064,17 +2142,13 @@ bool Curses_mw_ui::run()
 					wclrtoeol(its_win);
 					box(its_win,0,0);
 					mvwprintw(its_win,its_error_line,2,"%s",its_error_msg.c_str());
-					wrefresh(its_win);
+					its_compositor->refresh(its_win);
 					its_error_msg.clear();
 				}
 				if (its_error_flag == true)
 				{
 					its_mw_miner->set_quit(true);
 				}
-				else
-				{
-					its_mw_miner->set_paused(false);
-				}
 				its_mw_miner->focus();
 				break;
 			}
@@ -1116,25 +2190,171 @@ bool Curses_mw_ui::run()
 				print_main_screen();
 				break;
 			}
-			case 'r':
-			case 'R':
+			case 'g':
+			case 'G':
+			{
+				if (its_grid_flag == true)
+				{
+					print_main_screen();
+					its_mw_miner->focus();
+				}
+				else
+				{
+					its_timing_view = false;
+					print_grid(true);
+					its_grid_flag = true;
+					its_next_frame = std::chrono::steady_clock::now();
+				}
+				break;
+			}
+			case 't':
+			case 'T':
+			{
+				if (its_timing_view == true)
+				{
+					print_main_screen();
+					its_mw_miner->focus();
+				}
+				else
+				{
+					its_grid_flag = false;
+					print_timing();
+					its_timing_view = true;
+					its_next_frame = std::chrono::steady_clock::now() + \
+						std::chrono::milliseconds(timing_view_ms);
+				}
+				break;
+			}
+			case KEY_LEFT:
+			case KEY_RIGHT:
+			{
+				if (its_grid_flag == true)
+				{
+					if (its_ch == KEY_LEFT)
+					{
+						its_grid_channel = (its_grid_channel + 15) % 16;
+					}
+					else
+					{
+						its_grid_channel = (its_grid_channel + 1) % 16;
+					}
+					print_grid(true);
+				}
+				else
+				{
+					its_compositor->bell();
+				}
+				break;
+			}
+			case '[':
+			case ']':
+			{
+				if (its_mw_miner->history_step((its_ch == '[') ? -1 : 1) == false)
+				{
+					its_compositor->bell();
+				}
+				break;
+			}
+			case 'j':
+			case 'J':
+			{
+				ret = jump_history();
+				print_main_screen();
+				if ((ret == false) && (its_error_msg.empty() == false))
+				{
+					mvwprintw(its_win,its_error_line,2,"%s",its_error_msg.c_str());
+					its_compositor->refresh(its_win);
+					its_error_msg.clear();
+				}
+				its_mw_miner->focus();
+				break;
+			}
+			case 'a':
+			case 'A':
+			{
+				show_stats();
+				print_main_screen();
+				its_mw_miner->focus();
+				break;
+			}
+			case 'c':
+			case 'C':
 			{
+				ret = compare_dump();
 				print_main_screen();
+				if ((ret == false) && (its_error_msg.empty() == false))
+				{
+					mvwprintw(its_win,its_error_line,2,"%s",its_error_msg.c_str());
+					its_compositor->refresh(its_win);
+					its_error_msg.clear();
+				}
 				its_mw_miner->focus();
 				break;
 			}
+			case 'r':
+			case 'R':
+			{
+				if (its_grid_flag == true)
+				{
+					print_grid(true);
+				}
+				else if (its_timing_view == true)
+				{
+					print_timing();
+				}
+				else
+				{
+					print_main_screen();
+					its_mw_miner->focus();
+				}
+				break;
+			}
 			default:
 			{
 				if (its_ch != ERR)
 				{
-					beep();
+					its_compositor->bell();
 				}
 				break;
 			}
 		}
+		show_save_results();
+		show_rt_failures();
+		check_ports();
+		check_synth();
+		// The controller grid is updated at most once per frame
+		if (its_grid_flag == true)
+		{
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (now >= its_next_frame)
+			{
+				print_grid(false);
+				its_next_frame = now + std::chrono::microseconds(1000000 / its_frame_rate);
+			}
+		}
+		// The timing analysis is read more slowly, so it can be followed
+		if (its_timing_view == true)
+		{
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (now >= its_next_frame)
+			{
+				print_timing();
+				its_next_frame = now + std::chrono::milliseconds(timing_view_ms);
+			}
+		}
 		std::this_thread::sleep_for(sleep_time);
 	}
-	mw_miner_thread.join();
+	if (mw_miner_thread.joinable() == true)
+	{
+		mw_miner_thread.join();
+	}
+	its_port_watcher->stop();
+	if (its_fingerprint_probe.valid() == true)
+	{
+		its_fingerprint_probe.wait(); // its ports close before ours
+	}
+	stop_input(its_midi_in,its_midi_reader);
+	its_midi_reader = nullptr;
 
 
 	// Close MIDI ports if necessary
@@ -1168,45 +2388,51 @@ bool Curses_mw_ui::run()
 // Local part of port discovery RtMidi callback
 void Curses_mw_ui::discover_port(vector<unsigned char> *message)
 {
-	if (message->size() != 14) // 14 bytes for identity reply
-	{
-		return;
-	}
-	if (message->at(0) == 0xf0) // sysEx start
+	Req_correlator *correlator = its_probe_correlator.load();
+	if (correlator != nullptr)
 	{
-		if (message->at(1) == 0x7e) // General MIDI
-		{
-			if (message->at(2) == 0x06) // Information related
-			{
-				if (message->at(3) == 02) // Identity response
-				{
-					if (message->at(4) == its_synth_info->get_man_id()) // man ID
-					{
-						if (message->at(5) == its_synth_info->get_equip_id()) // Equipment ID
-						{
-							its_discovery_flag.store(true);
-						}
-					}
-				}
-			}
-		}
+		correlator->accept(message->data(),message->size());
 	}
 }
 
 // Local part of RtMidi dev ID discovery callback
 void Curses_mw_ui::discover_id(vector<unsigned char> *message)
 {
-	if (message->size() != 14) // size of a correct identity response
+	Req_correlator *correlator = its_probe_correlator.load();
+	if (correlator != nullptr)
 	{
-		return;
+		correlator->accept(message->data(),message->size());
 	}
-	if (message->at(2) == 0x06) // MIDI information related
-	{
-		if (message->at(3) == 0x02) // identity response
+}
+
+// Send an identity request and wait until it is answered or timed out.
+// The device ID of the answer is stored in its_suggested_dev_id.
+bool Curses_mw_ui::request_identity(RtMidiOut *mout)
+{
+	vector<unsigned char> idreq { 0xf0, 0x7e, 0x7f, 0x06, 0x01, 0xf7 };
+	std::promise<bool> answer;
+	std::future<bool> answered = answer.get_future();
+	Req_correlator *correlator = its_probe_correlator.load();
+	std::uint64_t id = correlator->add(Req_pattern::identity(its_synth_info->get_man_id(), \
+		its_synth_info->get_equip_id()),probe_timeout_ms,[this,&answer](Req_correlator::Result result, \
+		const unsigned char *msg, unsigned long int size)
+	{
+		if ((result == Req_correlator::Result::answered) && (size == 14))
 		{
-			its_suggested_dev_id = message->at(6); // where the MWII puts it
+			its_suggested_dev_id = msg[6]; // where the MWII puts it
 		}
+		answer.set_value(result == Req_correlator::Result::answered);
+	});
+	try
+	{
+		mout->sendMessage(&idreq);
+	}
+	catch (RtMidiError& e)
+	{
+		correlator->cancel(id); // answer must not outlive this call
+		throw;
 	}
+	return answered.get();
 }
 
 // Probe for a synthy (for now MWII/Xt only)
@@ -1217,11 +2443,10 @@ bool Curses_mw_ui::probe_synth()
 	box(its_win,0,0);
 	mvwprintw(its_win,2,2,"Please wait, this may take a few seconds...");
 	wmove(its_win,2,1);
-	wrefresh(its_win);
+	its_compositor->refresh(its_win);
 
 		// general function variables
 	bool return_value = true;
-	std::chrono::milliseconds sleep_time(100); // wait for synth reply
 	string probe_client_name("MWSD Synth Probe"); // RtMidi client name
 	string tmp_name; // Used for probe port names
 	bool search_quit = false; // Whether to quit the event loop or not
@@ -1255,9 +2480,10 @@ bool Curses_mw_ui::probe_synth()
 		// vector holding I/O pairs for discovered synths
 	vector<std::pair<unsigned int, unsigned int> > synth_ports;
 	bool found = false; // set to true when the first synth is discovered
-		// Vector holding identity request message
-	vector<unsigned char> idreq { 0xf0, 0x7e, 0x7f, 0x06, 0x01, 0xf7 };
-	its_discovery_flag.store(false); // will be set by discovery callbacks
+		// Identity requests are matched with their answers here
+	Req_correlator probe_correlator;
+	probe_correlator.start();
+	its_probe_correlator.store(&probe_correlator);
 
 	// Prepare the I/O listing and all vectors
 	for (unsigned int i = 0;i<incount;i++)
@@ -1275,28 +2501,21 @@ bool Curses_mw_ui::probe_synth()
 	}
 
 	// Discover synths and store I/O port_number pairs
-	its_discovery_flag.store(false);
 	for (unsigned int i = 0;i<outcount;i++)
 	{
 		for (unsigned int j = 0;j<incount;j++)
 		{
 			vmin[j]->setCallback(&mw_port_discovery_callback,this);
-			if (vmout[i]->isPortOpen())
+			if ((vmout[i]->isPortOpen()) && (request_identity(vmout[i]) == true))
 			{
-				vmout[i]->sendMessage(&idreq);
-				std::this_thread::sleep_for(sleep_time);
-				if (its_discovery_flag == true) // a synth was discovered
-				{
-					synth_ports.push_back(std::pair<unsigned int, unsigned int> \
-						(j,i));
-					found = true;
-					its_discovery_flag.store(false);
-				}
+				// a synth was discovered
+				synth_ports.push_back(std::pair<unsigned int, unsigned int> \
+					(j,i));
+				found = true;
 			}
 			vmin[j]->cancelCallback();
 		}
 	}
-	its_discovery_flag.store(false);
 	
 		// show the choices, if any
 	if (found == true)
@@ -1324,12 +2543,12 @@ bool Curses_mw_ui::probe_synth()
 		its_x = 2;
 		its_y = 4;
 		wmove(its_win,its_y,its_x);
-		wrefresh(its_win);
+		its_compositor->refresh(its_win);
 
 		found = false; // reuse to mark that a synth was chosen
 		while (search_quit == false && its_mw_miner->get_quit() == false)
 		{
-			its_ch = getch();
+			its_ch = its_compositor->read_key();
 			switch(its_ch)
 			{
 				case KEY_UP:
@@ -1339,11 +2558,11 @@ bool Curses_mw_ui::probe_synth()
 						choice--;
 						its_y = 4 + (3 * static_cast<int>(choice));
 						wmove(its_win,its_y,its_x);
-						wrefresh(its_win);
+						its_compositor->refresh(its_win);
 					}
 					else
 					{
-						beep();
+						its_compositor->bell();
 					}
 					break;
 				}
@@ -1354,11 +2573,11 @@ bool Curses_mw_ui::probe_synth()
 						choice++;
 						its_y = 4 + (3 * static_cast<int>(choice));
 						wmove(its_win,its_y,its_x);
-						wrefresh(its_win);
+						its_compositor->refresh(its_win);
 					}
 					else
 					{
-						beep();
+						its_compositor->bell();
 					}
 					break;
 				}
@@ -1380,7 +2599,7 @@ bool Curses_mw_ui::probe_synth()
 				{
 					if (its_ch != ERR)
 					{
-						beep();
+						its_compositor->bell();
 					}
 					break;
 				}
@@ -1393,9 +2612,10 @@ bool Curses_mw_ui::probe_synth()
 			unsigned int input_n = synth_ports[choice].first;
 			unsigned int output_n = synth_ports[choice].second;
 			vmin[static_cast<unsigned long int>(input_n)]->setCallback(&mw_dev_id_discovery_callback,this);
-			vmout[static_cast<unsigned long int>(output_n)]->sendMessage(&idreq);
-			std::this_thread::sleep_for(sleep_time);
-			its_synth_info->set_dev_id(its_suggested_dev_id);
+			if (request_identity(vmout[static_cast<unsigned long int>(output_n)]) == true)
+			{
+				its_synth_info->set_dev_id(its_suggested_dev_id);
+			}
 			its_midi_input_name = vmin[static_cast<unsigned long int>(input_n)]->getPortName(input_n);
 			its_midi_output_name = vmout[static_cast<unsigned long int>(output_n)]->getPortName(output_n);
 			return_value = set_midi_input(input_n);
@@ -1422,8 +2642,8 @@ bool Curses_mw_ui::probe_synth()
 		mvwprintw(its_win,2,2,"No synthesizers detected. You can try manually.");
 		mvwprintw(its_win,3,2,"Press any key to return to main screen...");
 		wmove(its_win,2,2);
-		wrefresh(its_win);
-		while (getch() == ERR);
+		its_compositor->refresh(its_win);
+		while (its_compositor->read_key() == ERR);
 	}
 
 		// Cleanup: close all ports, delete all new'ed objects
@@ -1444,6 +2664,8 @@ bool Curses_mw_ui::probe_synth()
 		}
 		delete port;
 	}
+	// Closing joins the input threads, no callback can reach it any more
+	its_probe_correlator.store(nullptr);
 
 	for (auto port: vmout)
 	{
@@ -1458,8 +2680,16 @@ bool Curses_mw_ui::probe_synth()
 
 void mw_midi_callback(double delta_time, vector<unsigned char>* message, void* user_data)
 {
-	Curses_mw_miner *my_miner = static_cast<Curses_mw_miner *>(user_data);
-	my_miner->accept_msg(delta_time,message);
+	Input_route *route = static_cast<Input_route *>(user_data);
+	if (route->set_up == false)
+	{
+		route->set_up = true;
+		if (route->setup)
+		{
+			route->setup();
+		}
+	}
+	route->gate->deliver(route->generation,delta_time,message);
 }
 
 // RtMidi callback for port probing for synths
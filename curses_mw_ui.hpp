@@ -24,25 +24,62 @@
 #include <ncurses.h>
 #include <string>
 #include <atomic>
+#include <chrono>
+#include <future>
+#include <utility>
 #include <rtmidi/RtMidi.h>
 #include "synth_info.hpp"
 #include "curses_mw_miner.hpp"
+#include "dump_decoder.hpp"
+#include "dump_library.hpp"
+#include "dump_writer.hpp"
+#include "midi_reader.hpp"
+#include "input_gate.hpp"
+#include "port_watcher.hpp"
+#include "latency_stats.hpp"
+#include "rt_policy.hpp"
+#include "output_sink.hpp"
+#include "socket_sink.hpp"
+#include "shm_sink.hpp"
+#include "screen_compositor.hpp"
 
 class Curses_mw_ui
 {
 	public:
+		static const unsigned int probe_timeout_ms = 100; // wait for an identity reply
+		static const unsigned int default_input_queue = 100; // messages, as RtMidi
+		static const unsigned int timing_view_ms = 250; // between timing view updates
+
 			// Constructor and destructor
 		Curses_mw_ui(std::string res_dir);
 		~Curses_mw_ui();
 
 			// Access methods
 		void set_dev_id(unsigned char id) { its_synth_info->set_dev_id(id); }
-		bool set_midi_input(unsigned int port_number);
-		bool set_midi_input(std::string port_name);
-		bool set_midi_output(unsigned int port_number);
-		bool set_midi_output(std::string port_name);
+			// Once running a new port is verified with an identity request,
+			// unless verify is false
+		bool set_midi_input(unsigned int port_number, bool verify = true);
+		bool set_midi_input(std::string port_name, bool verify = true);
+		bool set_midi_output(unsigned int port_number, bool verify = true);
+		bool set_midi_output(std::string port_name, bool verify = true);
 		void set_cfg_file_name(std::string name) { its_cfg_file_name = name; }
 		void set_res_dir(std::string res_dir) { its_res_dir = res_dir; }
+		void set_frame_rate(unsigned int frame_rate);
+		bool set_filter(std::string expr); // set the MIDI input filter
+		void set_history_size(unsigned long int size);
+		void set_settle_time(unsigned int settle_ms); // display on demand
+		void set_request_rate(unsigned int per_second); // display on demand
+		bool set_backend(std::string name); // curses or ansi, before init_ui
+		bool set_input_mode(std::string name); // callback or batch, before run
+			// Size of the RtMidi input queue, before the input port is set
+		void set_input_queue(unsigned int size);
+			// Receive clock and active sensing for the analyzer, before run
+		void set_timing(bool flag) { its_timing_flag = flag; }
+			// Real-time mode of the MIDI threads: fifo, rr or off, before run
+		bool set_realtime(std::string policy);
+		void set_rt_priority(int priority) { its_rt_policy.set_priority(priority); }
+		void set_rt_cpu(int cpu) { its_rt_policy.set_cpu(cpu); }
+		bool add_sink(std::string spec); // add an output for display events
 		std::string get_error_msg() const { return its_error_msg; }
 		bool get_error() const { return its_error_flag.load(); }
 			// local part of port discovery RtMidi callback
@@ -55,10 +92,39 @@ class Curses_mw_ui
 			// UI screen functions
 		void print_main_screen(); // just print the main screen again
 		void print_help(); // print help screen
+		void print_grid(bool full); // print changed cells of controller grid
+		void print_timing(); // print the clock and active sensing analysis
+			// Show lines with paging until leave_key is pressed
+		void show_lines(std::string header, const std::vector<std::string>& content, \
+			int leave_key);
 		bool change_port(char port_designation); // Change MIDI I or O port
+			// Switch to midi_in while running
+		bool swap_input(RtMidiIn *midi_in, std::string port_name, bool verify);
+		Input_route *new_route(unsigned long int generation); // to its_input_gate
+			// Deliver through route, returns the Midi_reader in batch mode
+		Midi_reader *start_input(RtMidiIn *midi_in, Input_route *route);
+		void stop_input(RtMidiIn *midi_in, Midi_reader *reader);
 		void change_dev_id(); // Change device ID
 		bool probe_synth(); // probe for the synth (MWII/XT for now)
+		bool request_identity(RtMidiOut *mout); // true if a synth answered
 		bool save_dump(); // Save last MIDI message, if it's a dump
+		bool confirm(std::string question); // Ask a yes/no question
+		std::string ask_text(std::string question); // Ask for a line of text
+		bool jump_history(); // Ask for a time and show the display at that time
+		void show_stats(); // Show statistics of the outputs
+		int take_remote_key(); // next key command of a socket client or ERR
+		void show_save_results(); // Report finished saves on the error line
+		void show_rt_failures(); // Report new real-time setup failures
+		void check_ports(); // Go offline or reconnect on port changes
+		void check_synth(); // Report the synth falling silent and answering again
+			// New ports whose synth answers with its_fingerprint, probed
+			// by a thread of its own. True once it found their names.
+		bool find_fingerprint(const std::vector<std::string>& inputs, \
+			const std::vector<std::string>& outputs, std::string& input_name, \
+			std::string& output_name);
+		void learn_fingerprint(); // Ask the synth for its identity
+		void show_port_msg(const std::string& msg); // on the error line
+		bool compare_dump(); // Compare last dump with the resource folder
 		bool write_cfg(); // Write configuration to file
 		void init_ui(); // Set up curses UI
 		void shut_ui(); // Shut down curses UI
@@ -77,17 +143,54 @@ class Curses_mw_ui
 		int its_status_line; // where to print status information
 		int its_error_line; // where to print errors
 		unsigned char its_suggested_dev_id; // used for synth probing
+		bool its_grid_flag; // controller grid is shown
+		unsigned int its_grid_channel; // MIDI channel of controller grid
+		bool its_timing_flag; // clock and active sensing are received
+		bool its_timing_view; // timing analysis is shown
+		unsigned int its_frame_rate; // maximum screen updates per second
+		unsigned long int its_history_size; // number of display frames kept
+		unsigned int its_settle_time; // quiet ms before the trailing request
+		unsigned int its_request_rate; // display requests per second on demand
+		bool its_batch_input; // read MIDI input with a Midi_reader
+		unsigned int its_input_queue; // size of the RtMidi input queue
+		Rt_policy its_rt_policy; // real-time mode of the MIDI threads
+		unsigned long int its_rt_failures; // real-time failures reported so far
+		std::chrono::steady_clock::time_point its_next_frame; // next grid or timing update
 		std::atomic_bool its_error_flag; // set upon error
 		std::string its_midi_name; // Port name for MIDI I/O ports
 		RtMidiIn *its_midi_in; // MIDI input port
+		Midi_reader *its_midi_reader; // batch input while running or nullptr
+		Input_gate *its_input_gate; // all MIDI input goes through here
+		Input_route *its_input_route; // of its_midi_in once running or nullptr
+		Latency_stats its_swap_time; // of MIDI port swaps
+		Port_watcher *its_port_watcher; // notices ports coming and going
+		bool its_offline; // our ports are gone, waiting for them
+		bool its_silent; // the synth does not answer display requests
+		unsigned long int its_port_changes; // last change of the watcher seen
+		bool its_reopened; // ports opened again after a failure, for this list
+		std::vector<std::string> its_offline_inputs; // ports when going offline
+		std::vector<std::string> its_offline_outputs;
+		std::vector<unsigned char> its_fingerprint; // identity reply of the synth
+		std::future<std::pair<std::string,std::string> > its_fingerprint_probe; // names
+			// of the input and output found or empty, valid while probing
+		unsigned long int its_probed_changes; // port list last probed
+		Latency_stats its_reconnect_time; // from the port change seen to reconnected
 		RtMidiOut *its_midi_out; // MIDI output port
 		Synth_info *its_synth_info; // data class holding synth specific info
 		Curses_mw_miner *its_mw_miner;
-		std::atomic_bool its_discovery_flag; // used for port/dev_id probing
+		Screen_compositor *its_compositor; // the only writer to the terminal
+		Dump_decoder *its_dump_decoder; // named parameters of dumps
+		Dump_library *its_dump_library; // saved dumps for comparison
+		Dump_writer *its_dump_writer; // saves dumps in the background
+		Sink_hub *its_sink_hub; // all outputs for display events
+		std::vector<std::string> its_sink_specs; // user defined outputs
+		std::vector<Socket_sink *> its_socket_sinks; // owned by its_sink_hub
+		std::atomic<Req_correlator *> its_probe_correlator; // identity requests while
+			// probing, read by the probe ports' callbacks
 		WINDOW *its_win; // main window
 };
 
-// Callback function to be passed to RtMidiIn, user_data the Mw_miner
+// Callback function to be passed to RtMidiIn, user_data its Input_route
 void mw_midi_callback(double deltatime, std::vector<unsigned char>* message, void * user_data);
 // RtMidi callback function for synth probing, user_data is the
 // Curses_mw_ui object
@@ -0,0 +1,38 @@
+/* curses_sink.cpp - implementation of the Curses_sink class, the output
+ * sink for the curses data window.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "curses_sink.hpp"
+
+using std::string;
+
+Curses_sink::Curses_sink(Curses_mw_miner *miner):
+	Output_sink(string("screen"),16,Overflow_policy::coalesce), its_miner(miner)
+{
+}
+
+Curses_sink::~Curses_sink()
+{
+	stop(); // the dispatch thread calls write_event
+}
+
+bool Curses_sink::write_event(const Sink_event& event)
+{
+	its_miner->draw_event(event);
+	return true;
+}
@@ -0,0 +1,42 @@
+/* curses_sink.hpp - definition of the Curses_sink class, the output sink
+ * drawing display and MIDI events into the data window.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_CURSES_SINK_HPP
+#define MWSD_CURSES_SINK_HPP
+
+#include "output_sink.hpp"
+#include "curses_mw_miner.hpp"
+
+/* Curses_sink - hands events to the miner, which owns the data window
+ * Only the latest display frame is of interest, so events are coalesced.
+*/
+
+class Curses_sink: public Output_sink
+{
+	public:
+		Curses_sink() = delete;
+		Curses_sink(Curses_mw_miner *miner);
+		~Curses_sink();
+	protected:
+		bool write_event(const Sink_event& event);
+	private:
+		Curses_mw_miner *its_miner;
+};
+
+#endif // #ifndef MWSD_CURSES_SINK_HPP
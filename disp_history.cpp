@@ -0,0 +1,146 @@
+/* disp_history.cpp - implementation of the Disp_history class, the ring
+ * buffer of display frames used for scrolling back in time.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <cstring>
+#include "disp_history.hpp"
+
+using std::string;
+using std::vector;
+using std::int64_t;
+using std::uint64_t;
+using std::memcpy;
+
+const unsigned long int Disp_history::max_capacity;
+
+Disp_history::Disp_history(unsigned long int capacity, unsigned int rows, unsigned int cols):
+	its_capacity(capacity), its_rows(rows), its_cols(cols)
+{
+	if (its_capacity <1)
+	{
+		its_capacity = 1;
+	}
+	else if (its_capacity > max_capacity)
+	{
+		its_capacity = max_capacity;
+	}
+	its_text_words = ((its_rows * its_cols) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+	its_record_words = 1 + its_text_words;
+	its_arena = vector<std::atomic<uint64_t> >(its_capacity * its_record_words);
+	for (auto& word: its_arena)
+	{
+		word.store(0,std::memory_order_relaxed);
+	}
+	its_count.store(0);
+}
+
+uint64_t Disp_history::get_first() const
+{
+	uint64_t count = get_count();
+	return (count >= its_capacity) ? (count - its_capacity + 1) : 0;
+}
+
+void Disp_history::append(const vector<string>& disp, int64_t time_ms)
+{
+	uint64_t count = its_count.load(std::memory_order_relaxed);
+	vector<char> text(its_text_words * sizeof(uint64_t),' ');
+	for (unsigned int row = 0;(row<its_rows) && (row<disp.size());row++)
+	{
+		unsigned long int length = disp[row].size();
+		if (length > its_cols)
+		{
+			length = its_cols;
+		}
+		memcpy(&text[row * its_cols],disp[row].data(),length);
+	}
+	// A reader seeing any word written from here on sees count, which
+	// already marks the overwritten frame as gone
+	std::atomic_thread_fence(std::memory_order_release);
+	std::atomic<uint64_t> *record = &its_arena[(count % its_capacity) * its_record_words];
+	uint64_t word = 0;
+	memcpy(&word,&time_ms,sizeof(int64_t));
+	record[0].store(word,std::memory_order_relaxed);
+	for (unsigned long int i = 0;i<its_text_words;i++)
+	{
+		memcpy(&word,&text[i * sizeof(uint64_t)],sizeof(uint64_t));
+		record[1 + i].store(word,std::memory_order_relaxed);
+	}
+	its_count.store(count + 1,std::memory_order_release);
+}
+
+bool Disp_history::get(uint64_t index, vector<string>& disp, int64_t& time_ms) const
+{
+	if (alive(index,get_count()) == false)
+	{
+		return false;
+	}
+	const std::atomic<uint64_t> *record = &its_arena[(index % its_capacity) * its_record_words];
+	uint64_t word = record[0].load(std::memory_order_relaxed);
+	memcpy(&time_ms,&word,sizeof(int64_t));
+	vector<char> text(its_text_words * sizeof(uint64_t));
+	for (unsigned long int i = 0;i<its_text_words;i++)
+	{
+		word = record[1 + i].load(std::memory_order_relaxed);
+		memcpy(&text[i * sizeof(uint64_t)],&word,sizeof(uint64_t));
+	}
+	// The writer may have started on this record while copying
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (alive(index,get_count()) == false)
+	{
+		return false;
+	}
+	disp.clear();
+	for (unsigned int row = 0;row<its_rows;row++)
+	{
+		disp.push_back(string(&text[row * its_cols],its_cols));
+	}
+	return true;
+}
+
+// The time of a frame, any value if it was overwritten meanwhile
+int64_t Disp_history::get_time(uint64_t index) const
+{
+	int64_t time_ms = 0;
+	uint64_t word = its_arena[(index % its_capacity) * its_record_words].load(std::memory_order_relaxed);
+	memcpy(&time_ms,&word,sizeof(int64_t));
+	return time_ms;
+}
+uint64_t Disp_history::find_time(int64_t time_ms) const
+{
+	uint64_t low = get_first();
+	uint64_t high = get_count();
+	if (high == low)
+	{
+		return low;
+	}
+	// Frames are appended in time order, so search binary for the last
+	// frame not later than time_ms
+	while ((high - low) >1)
+	{
+		uint64_t mid = low + ((high - low) / 2);
+		if (get_time(mid) <= time_ms)
+		{
+			low = mid;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	return low;
+}
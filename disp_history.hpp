@@ -0,0 +1,77 @@
+/* disp_history.hpp - definition of the Disp_history class, a ring buffer of
+ * the last display frames with their time of arrival.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_DISP_HISTORY_HPP
+#define MWSD_DISP_HISTORY_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Disp_history - fixed size records in one arena allocated up front
+ * Each record holds the time in milliseconds since the epoch followed by
+ * rows * cols characters, packed into words. append() is called by one
+ * writer (the MIDI thread), get() may be called from any other thread.
+ * The words are atomics, so a reader never races the writer. The record
+ * being overwritten counts as gone from the start of append(), and
+ * get() checks after copying whether the writer reached its record.
+*/
+
+class Disp_history
+{
+	public:
+		static const unsigned long int max_capacity = 100000;
+
+		Disp_history() = delete;
+		Disp_history(unsigned long int capacity, unsigned int rows, unsigned int cols);
+		~Disp_history() {}
+
+			// Access methods
+		unsigned long int get_capacity() const { return its_capacity; }
+		unsigned long int get_memory() const { return its_arena.size() * sizeof(std::uint64_t); }
+			// Number of frames ever appended
+		std::uint64_t get_count() const { return its_count.load(std::memory_order_acquire); }
+			// Index of the oldest frame still held, once the arena is full
+			// the one written next is not
+		std::uint64_t get_first() const;
+
+			// Utility methods
+		void append(const std::vector<std::string>& disp, std::int64_t time_ms);
+			// Copy frame index into disp and time_ms, false if it is gone
+		bool get(std::uint64_t index, std::vector<std::string>& disp, \
+			std::int64_t& time_ms) const;
+			// Index of the last frame at or before time_ms
+		std::uint64_t find_time(std::int64_t time_ms) const;
+	private:
+		std::int64_t get_time(std::uint64_t index) const;
+			// Frame index is held and not being overwritten at count
+		bool alive(std::uint64_t index, std::uint64_t count) const \
+			{ return ((index < count) && ((index + its_capacity) > count)); }
+
+		unsigned long int its_capacity;
+		unsigned int its_rows;
+		unsigned int its_cols;
+		unsigned long int its_text_words; // of the characters
+		unsigned long int its_record_words; // time stamp plus characters
+		std::vector<std::atomic<std::uint64_t> > its_arena; // all records
+		std::atomic<std::uint64_t> its_count;
+};
+
+#endif // #ifndef MWSD_DISP_HISTORY_HPP
@@ -0,0 +1,278 @@
+/* dump_decoder.cpp - implementation of the Dump_decoder class, a table
+ * driven decoder for Microwave II/XT sound and multi dumps.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "dump_decoder.hpp"
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+/* Parameter tables, offsets count from the first data byte (after the bank
+ * and patch number), exactly like in the Waldorf SysEx documentation.
+ * Unlisted bytes are shown as generic data bytes.
+*/
+static const Dump_param sound_table[] = {
+	{ 1, 1, "Osc 1 Octave", 16, 112 },
+	{ 2, 1, "Osc 1 Semitone", 52, 76 },
+	{ 3, 1, "Osc 1 Detune", 0, 127 },
+	{ 4, 1, "Osc 1 Bend Range", 0, 127 },
+	{ 5, 1, "Osc 1 Keytrack", 0, 127 },
+	{ 6, 1, "Osc 1 FM Source", 0, 11 },
+	{ 7, 1, "Osc 1 FM Amount", 0, 127 },
+	{ 17, 1, "Osc 2 Octave", 16, 112 },
+	{ 18, 1, "Osc 2 Semitone", 52, 76 },
+	{ 19, 1, "Osc 2 Detune", 0, 127 },
+	{ 20, 1, "Osc 2 Bend Range", 0, 127 },
+	{ 21, 1, "Osc 2 Keytrack", 0, 127 },
+	{ 22, 1, "Osc 2 FM Source", 0, 11 },
+	{ 23, 1, "Osc 2 FM Amount", 0, 127 },
+	{ 24, 1, "Osc 2 Link", 0, 1 },
+	{ 33, 1, "Wavetable", 0, 127 },
+	{ 34, 1, "Wave 1 Startwave", 0, 63 },
+	{ 35, 1, "Wave 1 Startwave Mod Source", 0, 31 },
+	{ 36, 1, "Wave 1 Startwave Mod Amount", 0, 127 },
+	{ 37, 1, "Wave 1 Wave Env Amount", 0, 127 },
+	{ 38, 1, "Wave 1 Wave Env Velocity", 0, 127 },
+	{ 39, 1, "Wave 1 Keytrack", 0, 127 },
+	{ 49, 1, "Wave 2 Startwave", 0, 63 },
+	{ 50, 1, "Wave 2 Startwave Mod Source", 0, 31 },
+	{ 51, 1, "Wave 2 Startwave Mod Amount", 0, 127 },
+	{ 52, 1, "Wave 2 Wave Env Amount", 0, 127 },
+	{ 53, 1, "Wave 2 Wave Env Velocity", 0, 127 },
+	{ 54, 1, "Wave 2 Keytrack", 0, 127 },
+	{ 55, 1, "Wave 2 Link", 0, 1 },
+	{ 65, 1, "Mixer Wave 1 Level", 0, 127 },
+	{ 66, 1, "Mixer Wave 1 Mod Source", 0, 31 },
+	{ 67, 1, "Mixer Wave 1 Mod Amount", 0, 127 },
+	{ 68, 1, "Mixer Wave 2 Level", 0, 127 },
+	{ 69, 1, "Mixer Wave 2 Mod Source", 0, 31 },
+	{ 70, 1, "Mixer Wave 2 Mod Amount", 0, 127 },
+	{ 71, 1, "Mixer Noise Level", 0, 127 },
+	{ 72, 1, "Mixer Noise Mod Source", 0, 31 },
+	{ 73, 1, "Mixer Noise Mod Amount", 0, 127 },
+	{ 81, 1, "Filter Cutoff", 0, 127 },
+	{ 82, 1, "Filter Cutoff Mod Source", 0, 31 },
+	{ 83, 1, "Filter Cutoff Mod Amount", 0, 127 },
+	{ 84, 1, "Filter Env Amount", 0, 127 },
+	{ 85, 1, "Filter Env Velocity", 0, 127 },
+	{ 86, 1, "Filter Keytrack", 0, 127 },
+	{ 87, 1, "Filter Resonance", 0, 127 },
+	{ 88, 1, "Filter Resonance Mod Source", 0, 31 },
+	{ 89, 1, "Filter Resonance Mod Amount", 0, 127 },
+	{ 90, 1, "Filter Type", 0, 3 },
+	{ 97, 1, "Amp Volume", 0, 127 },
+	{ 98, 1, "Amp Volume Mod Source", 0, 31 },
+	{ 99, 1, "Amp Volume Mod Amount", 0, 127 },
+	{ 100, 1, "Amp Env Velocity", 0, 127 },
+	{ 101, 1, "Amp Keytrack", 0, 127 },
+	{ 102, 1, "Pan", 0, 127 },
+	{ 103, 1, "Pan Mod Source", 0, 31 },
+	{ 104, 1, "Pan Mod Amount", 0, 127 },
+	{ 113, 1, "LFO 1 Rate", 0, 127 },
+	{ 114, 1, "LFO 1 Shape", 0, 5 },
+	{ 115, 1, "LFO 1 Symmetry", 0, 127 },
+	{ 116, 1, "LFO 1 Humanize", 0, 127 },
+	{ 117, 1, "LFO 1 Sync", 0, 1 },
+	{ 121, 1, "LFO 2 Rate", 0, 127 },
+	{ 122, 1, "LFO 2 Shape", 0, 5 },
+	{ 123, 1, "LFO 2 Symmetry", 0, 127 },
+	{ 124, 1, "LFO 2 Humanize", 0, 127 },
+	{ 125, 1, "LFO 2 Sync", 0, 1 },
+	{ 126, 1, "LFO 2 Phase", 0, 127 },
+	{ 129, 1, "Filter Env Attack", 0, 127 },
+	{ 130, 1, "Filter Env Decay", 0, 127 },
+	{ 131, 1, "Filter Env Sustain", 0, 127 },
+	{ 132, 1, "Filter Env Release", 0, 127 },
+	{ 137, 1, "Amp Env Attack", 0, 127 },
+	{ 138, 1, "Amp Env Decay", 0, 127 },
+	{ 139, 1, "Amp Env Sustain", 0, 127 },
+	{ 140, 1, "Amp Env Release", 0, 127 },
+	{ 145, 1, "Wave Env Time 1", 0, 127 },
+	{ 146, 1, "Wave Env Level 1", 0, 127 },
+	{ 147, 1, "Wave Env Time 2", 0, 127 },
+	{ 148, 1, "Wave Env Level 2", 0, 127 },
+	{ 149, 1, "Wave Env Time 3", 0, 127 },
+	{ 150, 1, "Wave Env Level 3", 0, 127 },
+	{ 151, 1, "Wave Env Time 4", 0, 127 },
+	{ 152, 1, "Wave Env Level 4", 0, 127 },
+	{ 177, 1, "Glide Rate", 0, 127 },
+	{ 178, 1, "Glide Mode", 0, 3 },
+	{ 179, 1, "Play Mode", 0, 3 },
+	{ 180, 1, "Sound Category", 0, 15 },
+	{ 240, 16, "Name", 32, 127 }
+};
+
+static const Dump_param multi_table[] = {
+	{ 0, 1, "Multi Volume", 0, 127 },
+	{ 1, 1, "Control W", 0, 121 },
+	{ 2, 1, "Control X", 0, 121 },
+	{ 3, 1, "Control Y", 0, 121 },
+	{ 4, 1, "Control Z", 0, 121 },
+	{ 5, 1, "Arpeggiator Tempo", 0, 127 },
+	{ 16, 16, "Name", 32, 127 }
+};
+
+Dump_decoder::Dump_decoder(Synth_info *synth_info):
+	its_synth_info(synth_info)
+{
+	its_params.reserve(2);
+	its_offsets.reserve(2);
+	add_table(0x10,sound_table,sizeof(sound_table) / sizeof(sound_table[0]));
+	add_table(0x11,multi_table,sizeof(multi_table) / sizeof(multi_table[0]));
+}
+
+// Build the full parameter list and offset lookup table for one dump type
+void Dump_decoder::add_table(unsigned char cmd, const Dump_param *table, \
+	unsigned int count)
+{
+	unsigned int data_start = its_synth_info->get_dump_chk_start(cmd);
+	unsigned int length = its_synth_info->get_dump_length(cmd);
+	if ((data_start == 0) || (length < (data_start + 2)))
+	{
+		return;
+	}
+	unsigned int data_end = length - 2; // the checksum and 0xf7 follow
+
+	vector<Dump_param> params;
+	params.reserve(data_end - data_start);
+	vector<int> offsets(length,-1);
+	unsigned int next = data_start; // next offset not yet covered
+	for (unsigned int i = 0;i<=count;i++)
+	{
+		unsigned int table_offset = data_end;
+		if (i <count)
+		{
+			table_offset = data_start + table[i].offset;
+		}
+		// Generic entries for the bytes between two table entries
+		for (;next<table_offset;next++)
+		{
+			offsets[next] = static_cast<int>(params.size());
+			params.push_back(Dump_param { next, 1, string("Data byte ") + to_string(next - data_start), 0, 127 });
+		}
+		if (i <count)
+		{
+			Dump_param param = table[i];
+			param.offset = table_offset;
+			for (unsigned int j = 0;j<param.width;j++)
+			{
+				offsets[table_offset + j] = static_cast<int>(params.size());
+			}
+			params.push_back(param);
+			next = table_offset + param.width;
+		}
+	}
+	its_params[cmd] = params;
+	its_offsets[cmd] = offsets;
+}
+
+bool Dump_decoder::has_table(unsigned char cmd) const
+{
+	return (its_params.find(cmd) != its_params.end());
+}
+
+// Return the parameter covering offset or nullptr
+const Dump_param* Dump_decoder::get_param(unsigned char cmd, unsigned int offset) const
+{
+	auto offsets = its_offsets.find(cmd);
+	if ((offsets == its_offsets.end()) || (offset >= offsets->second.size()))
+	{
+		return nullptr;
+	}
+	int index = offsets->second[offset];
+	if (index <0)
+	{
+		return nullptr;
+	}
+	return &(its_params.at(cmd)[static_cast<unsigned long int>(index)]);
+}
+
+string Dump_decoder::format_value(const Dump_param *param, const unsigned char *dump) const
+{
+	if (param->width == 1)
+	{
+		return to_string(dump[param->offset]);
+	}
+	string text(reinterpret_cast<const char *>(dump + param->offset),param->width);
+	size_t end_pos = text.find_last_not_of(' ');
+	if (end_pos == string::npos)
+	{
+		return string();
+	}
+	return text.substr(0,end_pos + 1);
+}
+
+vector<Param_value> Dump_decoder::decode(const vector<unsigned char>& dump) const
+{
+	vector<Param_value> values;
+	if (dump.size() <5)
+	{
+		return values;
+	}
+	auto params = its_params.find(dump[4]);
+	if ((params == its_params.end()) || (dump.size() != its_offsets.at(dump[4]).size()))
+	{
+		return values;
+	}
+	values.reserve(params->second.size());
+	for (auto& param: params->second)
+	{
+		bool in_range = true;
+		for (unsigned int i = 0;i<param.width;i++)
+		{
+			unsigned char byte = dump[param.offset + i];
+			if ((byte < param.min) || (byte > param.max))
+			{
+				in_range = false;
+			}
+		}
+		values.push_back(Param_value { &param, format_value(&param,dump.data()), in_range });
+	}
+	return values;
+}
+
+// Compare two dumps byte by byte and decode only the differing offsets
+vector<Param_diff> Dump_decoder::diff(const unsigned char *dump, \
+	const unsigned char *other, unsigned long int size) const
+{
+	vector<Param_diff> diffs;
+	if ((size <5) || (dump[4] != other[4]))
+	{
+		return diffs;
+	}
+	auto offsets = its_offsets.find(dump[4]);
+	if ((offsets == its_offsets.end()) || (offsets->second.size() != size))
+	{
+		return diffs;
+	}
+	const Dump_param *last = nullptr; // text parameters span several bytes
+	for (unsigned long int i = 0;i<size;i++)
+	{
+		if (dump[i] != other[i])
+		{
+			const Dump_param *param = get_param(dump[4],static_cast<unsigned int>(i));
+			if ((param != nullptr) && (param != last))
+			{
+				diffs.push_back(Param_diff { param, format_value(param,dump), format_value(param,other) });
+				last = param;
+			}
+		}
+	}
+	return diffs;
+}
@@ -0,0 +1,90 @@
+/* dump_decoder.hpp - definition of the Dump_decoder class, which turns
+ * sound and multi dumps into named parameters and compares dumps on the
+ * parameter level.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_DUMP_DECODER_HPP
+#define MWSD_DUMP_DECODER_HPP
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "synth_info.hpp"
+
+/* Dump_param - one parameter of a dump, width is larger than 1 for text
+ * parameters like the patch name
+*/
+struct Dump_param
+{
+	unsigned int offset; // first byte inside the complete SysEx message
+	unsigned int width; // number of bytes
+	std::string name;
+	unsigned char min;
+	unsigned char max;
+};
+
+// A decoded parameter value
+struct Param_value
+{
+	const Dump_param *param;
+	std::string value;
+	bool in_range; // false if the value lies outside min/max
+};
+
+// A parameter which differs between two dumps
+struct Param_diff
+{
+	const Dump_param *param;
+	std::string value; // value in the first dump
+	std::string other_value; // value in the second dump
+};
+
+/* Dump_decoder - table driven decoder for dumps with a known layout
+ * Bytes of the data range not covered by a table get a generic entry, so
+ * every byte of a dump maps to exactly one parameter.
+*/
+
+class Dump_decoder
+{
+	public:
+		Dump_decoder() = delete;
+		Dump_decoder(Synth_info *synth_info);
+		~Dump_decoder() {}
+
+			// Access methods
+		bool has_table(unsigned char cmd) const;
+		const Dump_param* get_param(unsigned char cmd, unsigned int offset) const;
+			// Utility methods
+		std::vector<Param_value> decode(const std::vector<unsigned char>& dump) const;
+			// Differing parameters of two dumps of equal type and size
+		std::vector<Param_diff> diff(const unsigned char *dump, \
+			const unsigned char *other, unsigned long int size) const;
+		std::string format_value(const Dump_param *param, \
+			const unsigned char *dump) const;
+	private:
+		void add_table(unsigned char cmd, const Dump_param *table, \
+			unsigned int count);
+
+		Synth_info *its_synth_info;
+			// All parameters of a dump type in offset order
+		std::unordered_map<unsigned char,std::vector<Dump_param> > its_params;
+			// Byte offset to index into its_params, -1 if outside the data
+		std::unordered_map<unsigned char,std::vector<int> > its_offsets;
+};
+
+#endif // #ifndef MWSD_DUMP_DECODER_HPP
@@ -0,0 +1,208 @@
+/* dump_filename.cpp - implementation of the Dump_filename class, which
+ * builds file names for received dumps without heap allocations.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include "dump_filename.hpp"
+
+const unsigned long int Dump_filename::max_length;
+
+namespace
+{
+	// Bounded writer into the name buffer, always leaves room for the 0
+	struct Name_writer
+	{
+		char *pos;
+		char *end;
+
+		void add(const char *text)
+		{
+			while ((*text != 0) && (pos < end))
+			{
+				*pos++ = *text++;
+			}
+		}
+
+		void add(char ch)
+		{
+			if (pos < end)
+			{
+				*pos++ = ch;
+			}
+		}
+
+		// Add a number with at least digits digits, zero padded
+		void add_number(unsigned int number, unsigned int digits)
+		{
+			char tmp[12];
+			unsigned int count = 0;
+			do
+			{
+				tmp[count++] = static_cast<char>('0' + (number % 10));
+				number /= 10;
+			} while ((number >0) && (count < sizeof(tmp)));
+			while (count < digits)
+			{
+				tmp[count++] = '0';
+			}
+			while (count >0)
+			{
+				add(tmp[--count]);
+			}
+		}
+
+		// Add the patch name without surrounding blanks, characters
+		// which don't belong into file names are replaced by _
+		void add_name(const unsigned char *name, unsigned long int length)
+		{
+			unsigned long int start = 0;
+			while ((start < length) && (name[start] == ' '))
+			{
+				start++;
+			}
+			while ((length > start) && (name[length - 1] == ' '))
+			{
+				length--;
+			}
+			for (unsigned long int i = start;i<length;i++)
+			{
+				char ch = static_cast<char>(name[i]);
+				if ((name[i] < 32) || (name[i] > 126) || (ch == '/'))
+				{
+					ch = '_';
+				}
+				add(ch);
+			}
+		}
+	};
+}
+
+Dump_filename::Dump_filename(Synth_info *synth_info):
+	its_synth_info(synth_info), its_suffix_time(-1)
+{
+	its_suffix[0] = 0;
+}
+
+const char *Dump_filename::get_suffix(std::time_t now)
+{
+	if (now != its_suffix_time)
+	{
+		struct tm local;
+		localtime_r(&now,&local);
+		std::snprintf(its_suffix,sizeof(its_suffix),"-%04d-%02d-%02d-%02d-%02d-%02d.syx", \
+			local.tm_year + 1900,local.tm_mon + 1,local.tm_mday,local.tm_hour, \
+			local.tm_min,local.tm_sec);
+		its_suffix_time = now;
+	}
+	return its_suffix;
+}
+
+unsigned long int Dump_filename::format(const unsigned char *msg, unsigned long int size, \
+	std::time_t now, char *buffer)
+{
+	Name_writer name { buffer, buffer + max_length - 1 };
+	if ((size > 5) && (msg[0] == 0xf0))
+	{
+		unsigned char cmd = msg[4];
+		unsigned int bank_no = 0;
+		unsigned int patch_no = 0;
+		unsigned long int single_length = its_synth_info->get_dump_length(cmd);
+		bool single = ((single_length >0) && (size == single_length));
+		if (single == true)
+		{
+			bank_no = msg[its_synth_info->get_dump_bank(cmd)];
+			patch_no = msg[its_synth_info->get_dump_patch(cmd)];
+		}
+		switch(cmd)
+		{
+			case 0x10: // sound
+			{
+				if (single == false) // a dump of all sounds
+				{
+					name.add("sounds");
+					break;
+				}
+				if (bank_no <= 1) // a stored sound, not the edit buffer
+				{
+					name.add((bank_no == 0) ? 'A' : 'B');
+					name.add_number(patch_no,3);
+					name.add('-');
+				}
+				name.add_name(msg + its_synth_info->get_dump_name_start(cmd), \
+					its_synth_info->get_dump_name_chars(cmd));
+				break;
+			}
+			case 0x11: // multi
+			{
+				if (single == false)
+				{
+					name.add("multis");
+					break;
+				}
+				if (bank_no == 0) // a stored multi, not the edit buffer
+				{
+					name.add_number(patch_no,3);
+					name.add('-');
+				}
+				name.add_name(msg + its_synth_info->get_dump_name_start(cmd), \
+					its_synth_info->get_dump_name_chars(cmd));
+				break;
+			}
+			case 0x12: // wave
+			{
+				if (single == false)
+				{
+					name.add("waves");
+					break;
+				}
+				name.add_number((128 * bank_no) + patch_no,4);
+				name.add("-wave");
+				break;
+			}
+			case 0x13: // wave control table
+			{
+				if (single == false)
+				{
+					name.add("wave control tables");
+					break;
+				}
+				name.add_number(patch_no,3);
+				name.add("-wave control table");
+				break;
+			}
+			case 0x14:
+			{
+				name.add("global");
+				break;
+			}
+			case 0x26:
+			{
+				name.add("remote");
+				break;
+			}
+			default:
+			{
+				break;
+			}
+		}
+	}
+	name.add(get_suffix(now));
+	*name.pos = 0;
+	return static_cast<unsigned long int>(name.pos - buffer);
+}
@@ -0,0 +1,53 @@
+/* dump_filename.hpp - definition of the Dump_filename class, which builds
+ * file names for received dumps without heap allocations.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_DUMP_FILENAME_HPP
+#define MWSD_DUMP_FILENAME_HPP
+
+#include <ctime>
+#include "synth_info.hpp"
+
+/* Dump_filename - names like A012-Init Sound-2020-04-01-12-30-00.syx
+ * The name is written into a caller supplied buffer, chosen by the
+ * command byte of the dump. The date and time suffix is formatted once
+ * per second and reused. Not thread-safe, use one object per thread.
+*/
+
+class Dump_filename
+{
+	public:
+		static const unsigned long int max_length = 64; // including the 0
+
+		Dump_filename() = delete;
+		Dump_filename(Synth_info *synth_info);
+		~Dump_filename() {}
+
+			// Write the zero terminated name for a dump received at time now
+			// into buffer of max_length bytes, return the length of the name
+		unsigned long int format(const unsigned char *msg, unsigned long int size, \
+			std::time_t now, char *buffer);
+	private:
+		const char *get_suffix(std::time_t now); // -date-time.syx
+
+		Synth_info *its_synth_info;
+		std::time_t its_suffix_time; // second of the cached suffix
+		char its_suffix[80]; // room for any int in each field of the format
+};
+
+#endif // #ifndef MWSD_DUMP_FILENAME_HPP
@@ -0,0 +1,140 @@
+/* dump_library.cpp - implementation of the Dump_library class, a collection
+ * of saved dumps used to find the patches nearest to a received dump.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <algorithm>
+#include <fstream>
+#include <utility>
+#include <boost/filesystem.hpp>
+#include "sysex_check.hpp"
+#include "dump_library.hpp"
+
+using std::string;
+using std::vector;
+using std::pair;
+using std::ifstream;
+namespace fs = boost::filesystem;
+
+Dump_library::Dump_library(Synth_info *synth_info, Dump_decoder *decoder):
+	its_synth_info(synth_info), its_decoder(decoder), its_cmd(0),
+	its_length(0), its_dir(""), its_dir_time(0)
+{
+}
+
+string Dump_library::get_file_name(unsigned long int index) const
+{
+	if (index >= its_file_names.size())
+	{
+		return string();
+	}
+	return its_file_names[index];
+}
+
+unsigned long int Dump_library::load(string dir, unsigned char cmd)
+{
+	fs::path dir_path(dir);
+	boost::system::error_code ec;
+	if (!fs::is_directory(dir_path,ec))
+	{
+		its_arena.clear();
+		its_file_names.clear();
+		its_dir.clear();
+		return 0;
+	}
+	std::time_t dir_time = fs::last_write_time(dir_path,ec);
+	if ((dir == its_dir) && (cmd == its_cmd) && (dir_time == its_dir_time))
+	{
+		return its_file_names.size(); // nothing has changed
+	}
+
+	its_arena.clear();
+	its_file_names.clear();
+	its_dir = dir;
+	its_cmd = cmd;
+	its_dir_time = dir_time;
+	its_length = its_synth_info->get_dump_length(cmd);
+	if (its_length == 0)
+	{
+		return 0;
+	}
+	vector<unsigned char> dump(its_length);
+	for (fs::directory_iterator it(dir_path,ec), end;it != end;it.increment(ec))
+	{
+		if ((!fs::is_regular_file(it->status())) || \
+			(fs::file_size(it->path(),ec) != its_length))
+		{
+			continue;
+		}
+		ifstream fin(it->path().string().c_str(), std::ios::in | std::ios::binary);
+		if (!fin.read(reinterpret_cast<char *>(dump.data()),static_cast<long>(its_length)))
+		{
+			continue;
+		}
+		if ((dump[0] != 0xf0) || (dump[4] != cmd))
+		{
+			continue;
+		}
+		its_arena.insert(its_arena.end(),dump.begin(),dump.end());
+		its_file_names.push_back(it->path().filename().string());
+	}
+	return its_file_names.size();
+}
+
+vector<Dump_match> Dump_library::find_nearest(const vector<unsigned char>& dump, \
+	unsigned long int count) const
+{
+	vector<Dump_match> matches;
+	if ((dump.size() != its_length) || (its_length == 0) || (dump[4] != its_cmd))
+	{
+		return matches;
+	}
+
+	// The distance counts differing data bytes, a differing name counts once
+	unsigned long int data_start = its_synth_info->get_dump_chk_start(its_cmd);
+	unsigned long int data_size = its_length - 2 - data_start;
+	unsigned long int name_start = its_synth_info->get_dump_name_start(its_cmd);
+	unsigned long int name_chars = its_synth_info->get_dump_name_chars(its_cmd);
+	unsigned long int lib_size = its_file_names.size();
+	vector<pair<unsigned long int,unsigned long int> > ranks; // distance and index
+	ranks.reserve(lib_size);
+	const unsigned char *entry = its_arena.data();
+	for (unsigned long int i = 0;i<lib_size;i++, entry += its_length)
+	{
+		unsigned long int distance = sysex_diff_count(dump.data() + data_start,entry + data_start,data_size);
+		if (name_chars >0)
+		{
+			unsigned long int name_diff = sysex_diff_count(dump.data() + name_start,entry + name_start,name_chars);
+			if (name_diff >0)
+			{
+				distance = distance - name_diff + 1;
+			}
+		}
+		ranks.push_back(pair<unsigned long int,unsigned long int>(distance,i));
+	}
+
+	count = std::min(count,lib_size);
+	std::partial_sort(ranks.begin(),ranks.begin() + static_cast<long>(count),ranks.end());
+	matches.reserve(count);
+	for (unsigned long int i = 0;i<count;i++)
+	{
+		const unsigned char *lib_dump = its_arena.data() + (ranks[i].second * its_length);
+		matches.push_back(Dump_match { ranks[i].second, ranks[i].first, \
+			its_decoder->diff(dump.data(),lib_dump,its_length) });
+	}
+	return matches;
+}
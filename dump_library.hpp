@@ -0,0 +1,69 @@
+/* dump_library.hpp - definition of the Dump_library class, which holds all
+ * saved dumps of one type from the resource folder and finds the dumps
+ * nearest to a given one.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_DUMP_LIBRARY_HPP
+#define MWSD_DUMP_LIBRARY_HPP
+
+#include <ctime>
+#include <string>
+#include <vector>
+#include "synth_info.hpp"
+#include "dump_decoder.hpp"
+
+// A library entry close to the compared dump
+struct Dump_match
+{
+	unsigned long int index; // index into the library
+	unsigned long int distance; // number of differing parameter bytes
+	std::vector<Param_diff> diffs;
+};
+
+/* Dump_library - all dumps of one type, stored back to back in one arena
+ * so a comparison streams through memory
+*/
+
+class Dump_library
+{
+	public:
+		Dump_library() = delete;
+		Dump_library(Synth_info *synth_info, Dump_decoder *decoder);
+		~Dump_library() {}
+
+			// Access methods
+		unsigned long int get_size() const { return its_file_names.size(); }
+		std::string get_file_name(unsigned long int index) const;
+			// Utility methods
+			// (Re)load all dumps of type cmd from dir, if dir has changed
+		unsigned long int load(std::string dir, unsigned char cmd);
+			// Ranked list of the count library dumps nearest to dump
+		std::vector<Dump_match> find_nearest(const std::vector<unsigned char>& dump, \
+			unsigned long int count) const;
+	private:
+		Synth_info *its_synth_info;
+		Dump_decoder *its_decoder;
+		unsigned char its_cmd; // command byte of the loaded dumps
+		unsigned long int its_length; // length of each dump
+		std::string its_dir; // loaded folder
+		std::time_t its_dir_time; // modification time of the loaded folder
+		std::vector<unsigned char> its_arena; // all dumps back to back
+		std::vector<std::string> its_file_names; // file name of each dump
+};
+
+#endif // #ifndef MWSD_DUMP_LIBRARY_HPP
@@ -0,0 +1,285 @@
+/* dump_writer.cpp - implementation of the Dump_writer class, which saves
+ * dumps to files in a thread of its own.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <fcntl.h>
+#include <unistd.h>
+#include "dump_writer.hpp"
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+const unsigned long int Dump_writer::default_capacity;
+
+Dump_writer::Dump_writer(unsigned long int capacity):
+	its_capacity(capacity), its_busy(0), its_stop_flag(false)
+{
+	if (its_capacity <1)
+	{
+		its_capacity = 1;
+	}
+	its_saved.store(0);
+	its_failed.store(0);
+	its_syncs.store(0);
+}
+
+Dump_writer::~Dump_writer()
+{
+	stop();
+}
+
+unsigned long int Dump_writer::get_pending()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	return its_queue.size() + its_busy;
+}
+
+void Dump_writer::start()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	if (its_thread.joinable())
+	{
+		return;
+	}
+	its_stop_flag = false;
+	its_thread = std::thread(&Dump_writer::run,this);
+}
+
+void Dump_writer::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(its_mutex);
+		its_stop_flag = true;
+	}
+	its_cond.notify_one();
+	if (its_thread.joinable())
+	{
+		its_thread.join();
+	}
+}
+
+bool Dump_writer::save(std::shared_ptr<const vector<unsigned char> > data, \
+	string filename, string label)
+{
+	{
+		std::lock_guard<std::mutex> lock(its_mutex);
+		if ((its_queue.size() + its_busy) >= its_capacity)
+		{
+			return false;
+		}
+		Job job;
+		job.data = data;
+		job.filename = filename;
+		job.label = label;
+		job.fd = -1;
+		its_queue.push_back(job);
+	}
+	its_cond.notify_one();
+	return true;
+}
+
+bool Dump_writer::take_result(Save_result& result)
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	if (its_results.empty())
+	{
+		return false;
+	}
+	result = its_results.front();
+	its_results.pop_front();
+	return true;
+}
+
+void Dump_writer::run()
+{
+	std::unique_lock<std::mutex> lock(its_mutex);
+	while (true)
+	{
+		its_cond.wait(lock,[this]() { return ((its_stop_flag == true) || (!its_queue.empty())); });
+		if (its_queue.empty())
+		{
+			break; // stopped and nothing left to write
+		}
+		// All waiting saves share the syncs
+		vector<Job> batch(its_queue.begin(),its_queue.end());
+		its_queue.clear();
+		its_busy = batch.size();
+		lock.unlock();
+		write_batch(batch);
+		lock.lock();
+		its_busy = 0;
+		for (auto& job: batch)
+		{
+			Save_result result;
+			result.filename = job.filename;
+			result.label = job.label;
+			result.ok = job.error_msg.empty();
+			result.error_msg = job.error_msg;
+			its_results.push_back(result);
+			if (result.ok == true)
+			{
+				its_saved++;
+			}
+			else
+			{
+				its_failed++;
+			}
+		}
+	}
+}
+
+void Dump_writer::write_batch(vector<Job>& batch)
+{
+	// Saves by folder, each folder is synced once
+	std::map<string, vector<Job *> > folders;
+	for (auto& job: batch)
+	{
+		string::size_type slash = job.filename.rfind('/');
+		if (slash == string::npos)
+		{
+			folders["."].push_back(&job);
+		}
+		else
+		{
+			folders[(slash == 0) ? string("/") : job.filename.substr(0,slash)].push_back(&job);
+		}
+	}
+
+	for (auto& folder: folders)
+	{
+		vector<Job *>& jobs = folder.second;
+		int dir_fd = open(folder.first.c_str(),O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (dir_fd <0)
+		{
+			string error_msg = string(std::strerror(errno));
+			for (auto job: jobs)
+			{
+				job->error_msg = error_msg;
+			}
+			continue;
+		}
+		for (auto job: jobs)
+		{
+			write_temp(*job);
+		}
+		// The data must be on disk before a rename makes it the file
+		sync_data(jobs);
+		bool renamed = false;
+		for (auto job: jobs)
+		{
+			if (job->fd <0)
+			{
+				continue;
+			}
+			if (close(job->fd) <0)
+			{
+				job->error_msg = string(std::strerror(errno));
+			}
+			job->fd = -1;
+			if (job->error_msg.empty())
+			{
+				if (std::rename(job->temp_name.c_str(),job->filename.c_str()) == 0)
+				{
+					renamed = true;
+					continue;
+				}
+				job->error_msg = string(std::strerror(errno));
+			}
+			unlink(job->temp_name.c_str());
+		}
+		// Make the new names permanent
+		if (renamed == true)
+		{
+			its_syncs++;
+			if (fsync(dir_fd) <0)
+			{
+				string error_msg = string(std::strerror(errno));
+				for (auto job: jobs)
+				{
+					if (job->error_msg.empty())
+					{
+						job->error_msg = error_msg;
+					}
+				}
+			}
+		}
+		close(dir_fd);
+	}
+}
+
+// Create a new file next to the target and write the data to it
+void Dump_writer::write_temp(Job& job)
+{
+	string prefix = job.filename + string(".tmp") + to_string(getpid()) + string(".");
+	for (unsigned int i = 0;job.fd <0;i++)
+	{
+		job.temp_name = prefix + to_string(i);
+		// Not inherited by the commands of cmd: sinks
+		job.fd = open(job.temp_name.c_str(),O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,0666);
+		if ((job.fd <0) && (errno != EEXIST))
+		{
+			job.error_msg = string(std::strerror(errno));
+			return;
+		}
+	}
+
+	const unsigned char *data = job.data->data();
+	unsigned long int left = job.data->size();
+	while (left >0)
+	{
+		ssize_t written = write(job.fd,data,left);
+		if (written <0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			job.error_msg = string(std::strerror(errno));
+			return;
+		}
+		data += written;
+		left -= static_cast<unsigned long int>(written);
+	}
+}
+
+// Sync the data of the written temporary files, a failed one is not
+// renamed. Only our files are flushed, so a busy file system does not
+// hold up the save, and errors are reported for each file.
+void Dump_writer::sync_data(vector<Job *>& jobs)
+{
+	for (auto job: jobs)
+	{
+		if ((job->fd >=0) && (job->error_msg.empty()))
+		{
+			its_syncs++;
+#ifdef __linux__
+			if (fdatasync(job->fd) <0)
+#else
+			if (fsync(job->fd) <0)
+#endif
+			{
+				job->error_msg = string(std::strerror(errno));
+			}
+		}
+	}
+}
@@ -0,0 +1,101 @@
+/* dump_writer.hpp - definition of the Dump_writer class, which saves
+ * dumps to files in a thread of its own.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_DUMP_WRITER_HPP
+#define MWSD_DUMP_WRITER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Outcome of one save, label is e.g. the dump type
+struct Save_result
+{
+	std::string filename;
+	std::string label;
+	bool ok;
+	std::string error_msg; // empty if ok
+};
+
+/* Dump_writer - saves dumps without blocking the caller
+ * save() only queues the data, a bounded queue of capacity saves. The
+ * writer thread takes all waiting saves at once. Each goes to a temporary
+ * file in the target folder, which replaces the target by rename, so a
+ * file is either complete or not there. The data of each file is synced
+ * before its rename, the folder once after all renames in it.
+ * Results are collected with take_result().
+*/
+
+class Dump_writer
+{
+	public:
+		static const unsigned long int default_capacity = 16; // saves
+
+		Dump_writer(unsigned long int capacity = default_capacity);
+		~Dump_writer();
+
+			// Access methods
+		unsigned long int get_pending();
+		unsigned long int get_saved() const { return its_saved.load(); }
+		unsigned long int get_failed() const { return its_failed.load(); }
+		unsigned long int get_syncs() const { return its_syncs.load(); }
+
+			// Utility methods
+		void start();
+		void stop(); // write what is queued, then stop
+			// Queue a save, false if the queue is full
+		bool save(std::shared_ptr<const std::vector<unsigned char> > data, \
+			std::string filename, std::string label);
+			// Next finished save, false if there is none
+		bool take_result(Save_result& result);
+	private:
+		struct Job
+		{
+			std::shared_ptr<const std::vector<unsigned char> > data;
+			std::string filename;
+			std::string label;
+			std::string temp_name; // while being written
+			int fd; // of the temporary file or -1
+			std::string error_msg;
+		};
+
+		void run(); // main loop of the writer thread
+		void write_batch(std::vector<Job>& batch);
+		void write_temp(Job& job);
+		void sync_data(std::vector<Job *>& jobs);
+
+		unsigned long int its_capacity;
+		std::deque<Job> its_queue;
+		std::deque<Save_result> its_results;
+		unsigned long int its_busy; // saves taken by the writer thread
+		bool its_stop_flag;
+		std::atomic_ulong its_saved;
+		std::atomic_ulong its_failed;
+		std::atomic_ulong its_syncs;
+		std::mutex its_mutex;
+		std::condition_variable its_cond;
+		std::thread its_thread;
+};
+
+#endif // #ifndef MWSD_DUMP_WRITER_HPP
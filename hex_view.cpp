@@ -0,0 +1,153 @@
+/* hex_view.cpp - implementation of the Hex_view class, a scrollable hex
+ * and ASCII view of long SysEx messages.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <cstring>
+#include "hex_view.hpp"
+
+const unsigned long int Hex_view::row_bytes;
+const unsigned long int Hex_view::row_length;
+
+// Two hex digits for every byte value
+static const char hex_table[] =
+	"000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+	"202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+	"404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+	"606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+	"808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+	"a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+	"c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+	"e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+Hex_view::Hex_view(unsigned int rows):
+	its_rows(rows), its_top(0)
+{
+}
+
+void Hex_view::set_data(const std::shared_ptr<const std::vector<unsigned char> >& data)
+{
+	its_data = data;
+	its_top = 0;
+}
+
+unsigned long int Hex_view::row_count() const
+{
+	if (its_data == nullptr)
+	{
+		return 0;
+	}
+	return (its_data->size() + row_bytes - 1) / row_bytes;
+}
+
+bool Hex_view::step(long int rows)
+{
+	unsigned long int count = row_count();
+	unsigned long int last = (count > its_rows) ? (count - its_rows) : 0;
+	long int top = static_cast<long int>(its_top) + rows;
+	if (top <0)
+	{
+		top = 0;
+	}
+	if (static_cast<unsigned long int>(top) > last)
+	{
+		top = last;
+	}
+	bool moved = (static_cast<unsigned long int>(top) != its_top);
+	its_top = top;
+	return moved;
+}
+
+void Hex_view::end()
+{
+	unsigned long int count = row_count();
+	its_top = (count > its_rows) ? (count - its_rows) : 0;
+}
+
+void Hex_view::format_row(const unsigned char *data, unsigned long int size, \
+	unsigned long int offset, char *buffer)
+{
+	char *out = buffer;
+	// Five hex digits of the offset
+	for (int shift = 16;shift >= 0;shift -= 4)
+	{
+		*out++ = hex_table[((offset >> shift) & 0x0f) * 2 + 1];
+	}
+	*out++ = ' ';
+	unsigned long int count = size - offset;
+	count = (count < row_bytes) ? count : row_bytes;
+	for (unsigned long int i = 0;i<row_bytes;i++)
+	{
+		if (i < count)
+		{
+			const char *digits = hex_table + data[offset + i] * 2;
+			out[0] = digits[0];
+			out[1] = digits[1];
+		}
+		else
+		{
+			out[0] = ' ';
+			out[1] = ' ';
+		}
+		out[2] = ' ';
+		out += 3;
+	}
+	*out++ = ' ';
+	for (unsigned long int i = 0;i<count;i++)
+	{
+		unsigned char byte = data[offset + i];
+		*out++ = ((byte >= 0x20) && (byte < 0x7f)) ? static_cast<char>(byte) : '.';
+	}
+	*out = '\0';
+}
+
+void Hex_view::append_bytes(const unsigned char *data, unsigned long int size, \
+	std::string& text)
+{
+	unsigned long int start = text.size();
+	text.resize(start + size * 3);
+	char *out = &text[start];
+	for (unsigned long int i = 0;i<size;i++)
+	{
+		const char *digits = hex_table + data[i] * 2;
+		out[0] = digits[0];
+		out[1] = digits[1];
+		out[2] = ' ';
+		out += 3;
+	}
+	if (size >0)
+	{
+		text.resize(text.size() - 1); // no trailing space
+	}
+}
+
+void Hex_view::draw(WINDOW *win, int line, int col) const
+{
+	char buffer[row_length + 1];
+	unsigned long int count = row_count();
+	for (unsigned int i = 0;i<its_rows;i++)
+	{
+		wmove(win,line + i,col);
+		wclrtoeol(win);
+		unsigned long int row = its_top + i;
+		if (row < count)
+		{
+			format_row(its_data->data(),its_data->size(),row * row_bytes,buffer);
+			waddstr(win,buffer);
+		}
+	}
+}
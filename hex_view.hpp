@@ -0,0 +1,71 @@
+/* hex_view.hpp - definition of the Hex_view class, a scrollable hex and
+ * ASCII view of long SysEx messages.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_HEX_VIEW_HPP
+#define MWSD_HEX_VIEW_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <ncurses.h>
+
+/* Hex_view - shows a few rows of 16 bytes of a message
+ * Rows look like "00030 f0 3e 0e ... 7f  .>.........". The view shares the
+ * message buffer and formats only the visible rows, so drawing costs the
+ * same for a message of 20 or 20000 bytes. Not thread-safe.
+*/
+
+class Hex_view
+{
+	public:
+		static const unsigned long int row_bytes = 16;
+		static const unsigned long int row_length = 71; // characters
+
+		Hex_view() = delete;
+		Hex_view(unsigned int rows);
+		~Hex_view() {}
+
+			// Access methods
+		void set_data(const std::shared_ptr<const std::vector<unsigned char> >& data);
+		void reset() { its_data.reset(); }
+		bool empty() const { return (its_data == nullptr); }
+		unsigned long int get_top() const { return its_top; } // first shown row
+
+			// Utility methods
+		bool step(long int rows); // false if already at the start or end
+		bool page(int pages) { return step(pages * static_cast<long int>(its_rows)); }
+		void home() { its_top = 0; }
+		void end();
+			// Draw the rows into win from line, starting at column col
+		void draw(WINDOW *win, int line, int col) const;
+			// Format row into buffer, at least row_length + 1 bytes
+		static void format_row(const unsigned char *data, unsigned long int size, \
+			unsigned long int offset, char *buffer);
+			// Append all bytes as "f0 3e ..." to text
+		static void append_bytes(const unsigned char *data, unsigned long int size, \
+			std::string& text);
+	private:
+		unsigned long int row_count() const;
+
+		std::shared_ptr<const std::vector<unsigned char> > its_data;
+		unsigned int its_rows; // visible rows
+		unsigned long int its_top;
+};
+
+#endif // #ifndef MWSD_HEX_VIEW_HPP
@@ -0,0 +1,137 @@
+/* input_gate.cpp - implementation of the Input_gate class, which hands MIDI
+ * input to the miner and swaps input ports without a gap.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <chrono>
+#include "input_gate.hpp"
+
+using std::vector;
+
+const unsigned long int Input_gate::max_held;
+
+Input_gate::Input_gate(Target target, Restart restart):
+	its_target(target), its_restart(restart), its_pending(0), its_next(2),
+	its_expected(0), its_caught(false)
+{
+	its_active.store(1);
+	its_swaps.store(0);
+	its_dropped.store(0);
+}
+
+unsigned long int Input_gate::open_next()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	its_held.clear();
+	its_pending = its_next;
+	its_next++;
+	return its_pending;
+}
+
+void Input_gate::deliver(unsigned long int generation, double delta_time, vector<unsigned char> *msg)
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	pass(generation,delta_time,msg);
+}
+
+void Input_gate::deliver_batch(unsigned long int generation, vector<vector<unsigned char> >& batch, \
+	const vector<double>& delta_times, unsigned long int count)
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	for (unsigned long int i = 0;i<count;i++)
+	{
+		pass(generation,delta_times[i],&batch[i]);
+	}
+}
+
+void Input_gate::swap()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	if (its_pending == 0)
+	{
+		return;
+	}
+	its_active.store(its_pending);
+	its_pending = 0;
+	if (its_restart)
+	{
+		its_restart();
+	}
+	for (auto& held: its_held)
+	{
+		its_target(held.first,&held.second);
+	}
+	its_held.clear();
+	its_swaps++;
+}
+
+void Input_gate::cancel()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	its_pending = 0;
+	its_held.clear();
+}
+
+void Input_gate::expect(unsigned long int generation, Match match)
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	its_expected = generation;
+	its_match = match;
+	its_caught = false;
+}
+
+bool Input_gate::wait_expected(unsigned int timeout_ms, vector<unsigned char> *caught_msg)
+{
+	std::unique_lock<std::mutex> lock(its_mutex);
+	its_cond.wait_for(lock,std::chrono::milliseconds(timeout_ms),[this]() { return its_caught; });
+	bool caught = its_caught;
+	if ((caught == true) && (caught_msg != nullptr))
+	{
+		*caught_msg = its_caught_msg;
+	}
+	its_expected = 0;
+	its_match = nullptr;
+	its_caught = false;
+	return caught;
+}
+
+void Input_gate::pass(unsigned long int generation, double delta_time, vector<unsigned char> *msg)
+{
+	if ((generation == its_expected) && (its_caught == false) && (its_match(*msg) == true))
+	{
+		its_caught = true;
+		its_caught_msg = *msg;
+		its_cond.notify_all();
+		return;
+	}
+	if (generation == its_active.load(std::memory_order_relaxed))
+	{
+		its_target(delta_time,msg);
+	}
+	else if (generation == its_pending)
+	{
+		if (its_held.size() < max_held)
+		{
+			its_held.emplace_back(delta_time,*msg);
+		}
+		else
+		{
+			its_dropped++;
+		}
+	}
+	// Anything else comes from a port about to be closed
+}
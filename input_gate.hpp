@@ -0,0 +1,103 @@
+/* input_gate.hpp - definition of the Input_gate class, which hands MIDI
+ * input to the miner and swaps input ports without a gap.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_INPUT_GATE_HPP
+#define MWSD_INPUT_GATE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+class Input_gate;
+
+// What an RtMidi callback or a Midi_reader of one port delivers to
+struct Input_route
+{
+	Input_gate *gate;
+	unsigned long int generation; // of the port
+	std::function<void()> setup; // run once by the delivering thread, may be empty
+	bool set_up; // setup has run
+};
+
+/* Input_gate - make-before-break switching of the MIDI input
+ * Every open port has a generation and delivers through the gate, which
+ * passes messages of the active generation on to the target. A new port
+ * is opened as the pending generation: its messages are held, up to
+ * max_held, until swap makes it active and hands them on first. From
+ * then on messages of the old port are dropped and it can be closed. One
+ * mutex serialises all deliveries, so the target sees a single stream.
+ * A message can be expected from one generation, e.g. the answer to an
+ * identity request, which is then taken out instead of handed on.
+*/
+
+class Input_gate
+{
+	public:
+		typedef std::function<void(double delta_time, std::vector<unsigned char> *msg)> Target;
+		typedef std::function<void()> Restart; // called on swap, before held messages
+		typedef std::function<bool(const std::vector<unsigned char>& msg)> Match;
+
+		static const unsigned long int max_held = 4096; // messages
+
+		Input_gate() = delete;
+		Input_gate(Target target, Restart restart);
+
+			// Access methods
+		unsigned long int get_active() const { return its_active.load(); }
+		unsigned long int get_swaps() const { return its_swaps.load(); }
+		unsigned long int get_dropped() const { return its_dropped.load(); } // held overflow
+
+			// Utility methods
+		unsigned long int open_next(); // a new pending generation
+		void deliver(unsigned long int generation, double delta_time, \
+			std::vector<unsigned char> *msg);
+		void deliver_batch(unsigned long int generation, \
+			std::vector<std::vector<unsigned char> >& batch, \
+			const std::vector<double>& delta_times, unsigned long int count);
+		void swap(); // the pending generation becomes active
+		void cancel(); // forget the pending generation and its messages
+			// Catch the next matching message of generation
+		void expect(unsigned long int generation, Match match);
+			// True if it was caught, then it is copied into caught
+		bool wait_expected(unsigned int timeout_ms, std::vector<unsigned char> *caught = nullptr);
+	private:
+		void pass(unsigned long int generation, double delta_time, \
+			std::vector<unsigned char> *msg); // requires its_mutex
+
+		Target its_target;
+		Restart its_restart;
+		std::atomic_ulong its_active;
+		unsigned long int its_pending; // 0 if none
+		unsigned long int its_next; // next generation to give out
+		std::vector<std::pair<double,std::vector<unsigned char> > > its_held;
+		unsigned long int its_expected; // generation to catch from, 0 if none
+		Match its_match;
+		bool its_caught;
+		std::vector<unsigned char> its_caught_msg;
+		std::atomic_ulong its_swaps;
+		std::atomic_ulong its_dropped;
+		std::mutex its_mutex;
+		std::condition_variable its_cond;
+};
+
+#endif // #ifndef MWSD_INPUT_GATE_HPP
@@ -0,0 +1,114 @@
+/* latency_stats.cpp - implementation of the Latency_stats and Input_clock
+ * classes, which measure delays of MIDI input on its way to the screen.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "latency_stats.hpp"
+
+using std::string;
+using std::int64_t;
+
+const int64_t Input_clock::max_drift_ppm;
+
+Latency_stats::Latency_stats()
+{
+	its_count.store(0);
+	its_sum.store(0);
+	its_max.store(0);
+	its_last.store(0);
+}
+
+int64_t Latency_stats::get_mean() const
+{
+	unsigned long int count = its_count.load();
+	return (count >0) ? (its_sum.load() / static_cast<int64_t>(count)) : 0;
+}
+
+void Latency_stats::add(int64_t delay_ns)
+{
+	its_sum.store(its_sum.load(std::memory_order_relaxed) + delay_ns,std::memory_order_relaxed);
+	if (delay_ns > its_max.load(std::memory_order_relaxed))
+	{
+		its_max.store(delay_ns,std::memory_order_relaxed);
+	}
+	its_last.store(delay_ns,std::memory_order_relaxed);
+	its_count.fetch_add(1);
+}
+
+string Latency_stats::format() const
+{
+	return string("mean ") + format_ns(get_mean()) + string(", max ") + \
+		format_ns(get_max()) + string(", last ") + format_ns(get_last());
+}
+
+int64_t Latency_stats::now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>( \
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+string Latency_stats::format_ns(int64_t ns)
+{
+	char buffer[32];
+	if (ns < 10000)
+	{
+		snprintf(buffer,sizeof(buffer),"%lld ns",static_cast<long long int>(ns));
+	}
+	else if (ns < 10000000)
+	{
+		snprintf(buffer,sizeof(buffer),"%lld us",static_cast<long long int>(ns / 1000));
+	}
+	else
+	{
+		snprintf(buffer,sizeof(buffer),"%.1f ms",ns / 1e6);
+	}
+	return string(buffer);
+}
+
+Input_clock::Input_clock():
+	its_started(false), its_last_ns(0), its_driver_ns(0), its_min_offset(0)
+{
+}
+
+void Input_clock::stamp(int64_t arrival_ns, double delta_time)
+{
+	int64_t delta_ns = std::llround(delta_time * 1e9);
+	if (its_started == false)
+	{
+		// Both clocks start together, RtMidi gives 0 for the first message
+		its_started = true;
+		its_last_ns = arrival_ns;
+		its_driver_ns = arrival_ns;
+		return;
+	}
+	its_driver_ns += delta_ns;
+	int64_t interval = arrival_ns - its_last_ns;
+	its_last_ns = arrival_ns;
+	its_jitter.add(std::llabs(interval - delta_ns));
+
+	int64_t offset = arrival_ns - its_driver_ns;
+	its_min_offset += (interval * max_drift_ppm) / 1000000;
+	if (offset < its_min_offset)
+	{
+		its_min_offset = offset;
+	}
+	its_delay.add(offset - its_min_offset);
+}
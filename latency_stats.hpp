@@ -0,0 +1,91 @@
+/* latency_stats.hpp - definition of the Latency_stats and Input_clock
+ * classes, which measure delays of MIDI input on its way to the screen.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_LATENCY_STATS_HPP
+#define MWSD_LATENCY_STATS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/* Latency_stats - count, mean, maximum and last of a series of delays
+ * Written by one thread, read by any. All times are nanoseconds of the
+ * steady clock, see now_ns().
+*/
+
+class Latency_stats
+{
+	public:
+		Latency_stats();
+
+			// Access methods
+		unsigned long int get_count() const { return its_count.load(); }
+		std::int64_t get_mean() const;
+		std::int64_t get_max() const { return its_max.load(); }
+		std::int64_t get_last() const { return its_last.load(); }
+
+			// Utility methods
+		void add(std::int64_t delay_ns); // from one thread only
+		std::string format() const; // mean, max and last for the statistics
+		static std::int64_t now_ns();
+		static std::string format_ns(std::int64_t ns); // e.g. 850 us, 12.3 ms
+	private:
+		std::atomic_ulong its_count;
+		std::atomic<std::int64_t> its_sum;
+		std::atomic<std::int64_t> its_max;
+		std::atomic<std::int64_t> its_last;
+};
+
+/* Input_clock - compares our arrival stamps with RtMidi's delta times
+ * RtMidi gives the time between two messages as seen by the driver. The
+ * difference of both clocks is smallest for a message handed over at
+ * once, so its excess over the smallest difference so far is the delay
+ * on the way from the driver to us. The smallest difference may rise by
+ * 1000 ppm of the elapsed time, so a drift of the clocks is followed.
+ * Jitter is the difference between the intervals of both clocks.
+*/
+
+class Input_clock
+{
+	public:
+		static const std::int64_t max_drift_ppm = 1000;
+
+		Input_clock();
+
+			// Access methods
+		const Latency_stats& get_delay() const { return its_delay; }
+		const Latency_stats& get_jitter() const { return its_jitter; }
+			// Time of the last message by the driver's clock, on our time scale
+		std::int64_t get_driver_ns() const { return its_driver_ns; }
+
+			// Utility methods
+			// A message arrived at arrival_ns, delta_time seconds after
+			// the last one according to RtMidi, from one thread only
+		void stamp(std::int64_t arrival_ns, double delta_time);
+		void restart() { its_started = false; } // e.g. a new port, same thread
+	private:
+		bool its_started;
+		std::int64_t its_last_ns; // arrival of the last message
+		std::int64_t its_driver_ns; // sum of the delta times
+		std::int64_t its_min_offset; // smallest arrival - driver time
+		Latency_stats its_delay;
+		Latency_stats its_jitter;
+};
+
+#endif // #ifndef MWSD_LATENCY_STATS_HPP
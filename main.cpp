@@ -26,6 +26,7 @@ namespace fs = boost::filesystem;
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
 #include "synth_info.hpp"
 #include "curses_mw_miner.hpp"
 #include "curses_mw_ui.hpp"
@@ -34,6 +35,7 @@ using std::cout;
 using std::endl;
 using std::ifstream;
 using std::string;
+using std::vector;
 using std::exception;
 using std::getenv;
 
@@ -68,6 +70,19 @@ int main(int argc, char *argv[])
 			("io_ports,p", po::value<string>()->value_name("port_name"), "Set input and output MIDI ports.")
 			("device_id,d", po::value<unsigned short int>()->value_name("ID"), "Set the device ID")
 			("resource_folder,r", po::value<string>()->value_name("path"), "Set a different resource folder")
+			("frame_rate,f", po::value<unsigned int>()->value_name("fps"), "Maximum screen updates per second (1-1000)")
+			("filter,F", po::value<string>()->value_name("expression"), "Only accept MIDI messages matching the filter")
+			("history_size,H", po::value<unsigned long int>()->value_name("frames"), "Number of display frames kept in the history (1-100000)")
+			("settle_time,T", po::value<unsigned int>()->value_name("ms"), "Quiet time before the last display request on demand (0-10000)")
+			("request_rate,R", po::value<unsigned int>()->value_name("requests"), "Maximum display requests per second on demand (1-100)")
+			("backend,B", po::value<string>()->value_name("name"), "Screen output: curses (default) or ansi, which writes each frame at once")
+			("input_mode,I", po::value<string>()->value_name("mode"), "MIDI input: callback (default) or batch, a thread draining the input queue")
+			("input_queue,Q", po::value<unsigned int>()->value_name("messages"), "Size of the MIDI input queue (1-65536, default 100)")
+			("realtime,X", po::value<string>()->value_name("policy"), "Real-time priority for the MIDI threads: fifo, rr or off (default), also locks memory")
+			("rt_priority", po::value<int>()->value_name("priority"), "Priority of the MIDI threads in real-time mode (1-99, default 40)")
+			("rt_cpu", po::value<int>()->value_name("cpu"), "Bind the MIDI threads to one CPU in real-time mode (Linux only)")
+			("timing,t", po::value<bool>()->implicit_value(true)->value_name("bool"), "Receive MIDI clock and active sensing and analyze their timing")
+			("sink,S", po::value<vector<string> >()->composing()->value_name("output"), "Also send display events to file:path, pipe:path, cmd:command, socket:path, shm:/name or stdout")
 		;
 		po::options_description commandline_desc;
 		commandline_desc.add(info_desc).add(config_desc);
@@ -147,6 +162,18 @@ int main(int argc, char *argv[])
 			return 0;
 		}
 
+		// The input queue is set up before the input port is opened
+		if (vm.count("input_queue"))
+		{
+			unsigned int input_queue = vm["input_queue"].as<unsigned int>();
+			if ((input_queue <1) || (input_queue >65536))
+			{
+				cout << "ERROR:\nThe input queue size must be between 1 and 65536.\n";
+				return 1;
+			}
+			my_ui.set_input_queue(input_queue);
+		}
+
 		if (vm.count("input_port"))
 		{
 			has_midi_in = my_ui.set_midi_input(vm["input_port"].as<string>());
@@ -166,6 +193,125 @@ int main(int argc, char *argv[])
 			has_midi_out = my_ui.set_midi_output(vm["io_ports"].as<string>());
 		}
 
+		if (vm.count("frame_rate"))
+		{
+			unsigned int frame_rate = vm["frame_rate"].as<unsigned int>();
+			if ((frame_rate <1) || (frame_rate >1000))
+			{
+				cout << "ERROR:\nThe frame rate must be between 1 and 1000.\n";
+				return 1;
+			}
+			my_ui.set_frame_rate(frame_rate);
+		}
+
+		if (vm.count("history_size"))
+		{
+			unsigned long int history_size = vm["history_size"].as<unsigned long int>();
+			if ((history_size <1) || (history_size > Disp_history::max_capacity))
+			{
+				cout << "ERROR:\nThe history size must be between 1 and " << Disp_history::max_capacity << ".\n";
+				return 1;
+			}
+			my_ui.set_history_size(history_size);
+		}
+
+		if (vm.count("settle_time"))
+		{
+			unsigned int settle_time = vm["settle_time"].as<unsigned int>();
+			if (settle_time >10000)
+			{
+				cout << "ERROR:\nThe settle time must be between 0 and 10000 ms.\n";
+				return 1;
+			}
+			my_ui.set_settle_time(settle_time);
+		}
+
+		if (vm.count("request_rate"))
+		{
+			unsigned int request_rate = vm["request_rate"].as<unsigned int>();
+			if ((request_rate <1) || (request_rate >100))
+			{
+				cout << "ERROR:\nThe request rate must be between 1 and 100.\n";
+				return 1;
+			}
+			my_ui.set_request_rate(request_rate);
+		}
+
+		if (vm.count("sink"))
+		{
+			for (auto& spec: vm["sink"].as<vector<string> >())
+			{
+				if (my_ui.add_sink(spec) == false)
+				{
+					cout << "ERROR:\n" << my_ui.get_error_msg() << endl;
+					return 1;
+				}
+			}
+		}
+
+		if (vm.count("backend"))
+		{
+			if (my_ui.set_backend(vm["backend"].as<string>()) == false)
+			{
+				cout << "ERROR:\n" << my_ui.get_error_msg() << endl;
+				return 1;
+			}
+		}
+
+		if (vm.count("input_mode"))
+		{
+			if (my_ui.set_input_mode(vm["input_mode"].as<string>()) == false)
+			{
+				cout << "ERROR:\n" << my_ui.get_error_msg() << endl;
+				return 1;
+			}
+		}
+
+		if (vm.count("realtime"))
+		{
+			if (my_ui.set_realtime(vm["realtime"].as<string>()) == false)
+			{
+				cout << "ERROR:\n" << my_ui.get_error_msg() << endl;
+				return 1;
+			}
+		}
+
+		if (vm.count("rt_priority"))
+		{
+			int rt_priority = vm["rt_priority"].as<int>();
+			if ((rt_priority <1) || (rt_priority >99))
+			{
+				cout << "ERROR:\nThe real-time priority must be between 1 and 99.\n";
+				return 1;
+			}
+			my_ui.set_rt_priority(rt_priority);
+		}
+
+		if (vm.count("rt_cpu"))
+		{
+			int rt_cpu = vm["rt_cpu"].as<int>();
+			if (rt_cpu <0)
+			{
+				cout << "ERROR:\nThe CPU number must not be negative.\n";
+				return 1;
+			}
+			my_ui.set_rt_cpu(rt_cpu);
+		}
+
+		if (vm.count("timing"))
+		{
+			my_ui.set_timing(vm["timing"].as<bool>());
+		}
+
+		if (vm.count("filter"))
+		{
+			if (my_ui.set_filter(vm["filter"].as<string>()) == false)
+			{
+				cout << "ERROR:\n" << my_ui.get_error_msg() << endl;
+				return 1;
+			}
+		}
+
 		if (vm.count("device_id"))
 		{
 			my_ui.set_dev_id(static_cast<unsigned char>(vm["device_id"].as<unsigned short int>()));
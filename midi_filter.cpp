@@ -0,0 +1,290 @@
+/* midi_filter.cpp - implementation of the Midi_filter class, which compiles
+ * a filter expression into lookup tables evaluated for every message.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <sstream>
+#include <cstdlib>
+#include "midi_filter.hpp"
+
+using std::string;
+using std::vector;
+using std::istringstream;
+using std::size_t;
+using std::uint64_t;
+using std::strtoul;
+
+// Status byte of the channel message terms note to bend
+static const unsigned int type_status[6] = { 0x90, 0xa0, 0xb0, 0xc0, 0xd0, 0xe0 };
+
+// Parse "a-b" or "a" into from and to, false on error
+static bool parse_range(string text, unsigned long int& from, unsigned long int& to)
+{
+	char *end = nullptr;
+	from = strtoul(text.c_str(),&end,10);
+	if (end == text.c_str())
+	{
+		return false;
+	}
+	if (*end == '\0')
+	{
+		to = from;
+		return true;
+	}
+	if (*end != '-')
+	{
+		return false;
+	}
+	const char *second = end + 1;
+	to = strtoul(second,&end,10);
+	return ((end != second) && (*end == '\0') && (from <= to));
+}
+
+Midi_filter::Midi_filter():
+	its_enabled(false), its_expression(""), its_error_msg("")
+{
+	for (unsigned int i = 0;i<256;i++)
+	{
+		its_status[i] = pass;
+	}
+	for (unsigned int ch = 0;ch<16;ch++)
+	{
+		its_cc[ch][0] = ~uint64_t(0);
+		its_cc[ch][1] = ~uint64_t(0);
+	}
+}
+
+bool Midi_filter::compile(string expr)
+{
+	bool types[7] = { false, false, false, false, false, false, false }; // note to bend, system
+	bool any_sysex = false; // plain sysex term
+	unsigned int channels = 0; // bit mask, 0 means all
+	uint64_t cc_mask[2] = { 0, 0 };
+	bool cc_all = false;
+	vector<vector<unsigned char> > prefixes;
+	bool has_terms = false;
+
+	istringstream terms(expr);
+	string term;
+	while (terms >> term)
+	{
+		has_terms = true;
+		string name = term;
+		string args;
+		size_t colon = term.find(':');
+		if (colon != string::npos)
+		{
+			name = term.substr(0,colon);
+			args = term.substr(colon + 1);
+			if (args.empty())
+			{
+				its_error_msg = string("Missing value in filter term ") + term;
+				return false;
+			}
+		}
+		if ((name == "note") && (args.empty()))
+		{
+			types[0] = true;
+		}
+		else if ((name == "poly") && (args.empty()))
+		{
+			types[1] = true;
+		}
+		else if (name == "cc")
+		{
+			types[2] = true;
+			if (args.empty())
+			{
+				cc_all = true;
+			}
+			else
+			{
+				unsigned long int from, to;
+				if ((parse_range(args,from,to) == false) || (to >127))
+				{
+					its_error_msg = string("Bad controller range in filter term ") + term;
+					return false;
+				}
+				for (unsigned long int cc = from;cc<=to;cc++)
+				{
+					cc_mask[cc >> 6] |= (uint64_t(1) << (cc & 63));
+				}
+			}
+		}
+		else if ((name == "program") && (args.empty()))
+		{
+			types[3] = true;
+		}
+		else if ((name == "aftertouch") && (args.empty()))
+		{
+			types[4] = true;
+		}
+		else if ((name == "bend") && (args.empty()))
+		{
+			types[5] = true;
+		}
+		else if ((name == "system") && (args.empty()))
+		{
+			types[6] = true;
+		}
+		else if (name == "sysex")
+		{
+			if (args.empty())
+			{
+				any_sysex = true;
+			}
+			else
+			{
+				if ((args.size() % 2) != 0)
+				{
+					its_error_msg = string("Bad SysEx prefix in filter term ") + term;
+					return false;
+				}
+				vector<unsigned char> prefix;
+				for (size_t i = 0;i<args.size();i += 2)
+				{
+					char *end = nullptr;
+					string hex = args.substr(i,2);
+					unsigned long int byte = strtoul(hex.c_str(),&end,16);
+					if ((*end != '\0') || (byte >127))
+					{
+						its_error_msg = string("Bad SysEx prefix in filter term ") + term;
+						return false;
+					}
+					prefix.push_back(static_cast<unsigned char>(byte));
+				}
+				prefixes.push_back(prefix);
+			}
+		}
+		else if ((name == "ch") && (!args.empty()))
+		{
+			istringstream ranges(args);
+			string range;
+			while (std::getline(ranges,range,','))
+			{
+				unsigned long int from, to;
+				if ((parse_range(range,from,to) == false) || (from <1) || (to >16))
+				{
+					its_error_msg = string("Bad channel in filter term ") + term;
+					return false;
+				}
+				for (unsigned long int ch = from;ch<=to;ch++)
+				{
+					channels |= (1u << (ch - 1));
+				}
+			}
+		}
+		else
+		{
+			its_error_msg = string("Unknown filter term ") + term;
+			return false;
+		}
+	}
+
+	// Build the tables, data bytes (continued messages) are always passed
+	its_expression = expr;
+	its_enabled = has_terms;
+	its_prefixes.clear();
+	if (channels == 0)
+	{
+		channels = 0xffff;
+	}
+	if (cc_all == true)
+	{
+		cc_mask[0] = ~uint64_t(0);
+		cc_mask[1] = ~uint64_t(0);
+	}
+	for (unsigned int i = 0;i<256;i++)
+	{
+		its_status[i] = (i <0x80) ? pass : reject;
+	}
+	for (unsigned int ch = 0;ch<16;ch++)
+	{
+		its_cc[ch][0] = 0;
+		its_cc[ch][1] = 0;
+		if ((channels & (1u << ch)) == 0)
+		{
+			continue;
+		}
+		for (unsigned int type = 0;type<6;type++)
+		{
+			if (types[type] == true)
+			{
+				its_status[type_status[type] + ch] = (type == 2) ? check_cc : pass;
+			}
+		}
+		if (types[0] == true) // note off
+		{
+			its_status[0x80 + ch] = pass;
+		}
+		its_cc[ch][0] = cc_mask[0];
+		its_cc[ch][1] = cc_mask[1];
+	}
+	if (types[6] == true)
+	{
+		for (unsigned int i = 0xf1;i<256;i++)
+		{
+			its_status[i] = pass;
+		}
+	}
+	if (any_sysex == true)
+	{
+		its_status[0xf0] = pass;
+	}
+	else if (!prefixes.empty())
+	{
+		its_status[0xf0] = check_sysex;
+		its_prefixes = prefixes;
+	}
+	its_status[0xf7] = pass; // end of a SysEx continued over several chunks
+	return true;
+}
+
+void Midi_filter::add_sysex_prefix(const vector<unsigned char>& prefix)
+{
+	if ((its_enabled == false) || (its_status[0xf0] == pass))
+	{
+		return;
+	}
+	its_status[0xf0] = check_sysex;
+	its_prefixes.push_back(prefix);
+}
+
+bool Midi_filter::match_sysex(const unsigned char *message, size_t size) const
+{
+	for (auto& prefix: its_prefixes)
+	{
+		if (size <= prefix.size())
+		{
+			continue;
+		}
+		bool match = true;
+		for (size_t i = 0;i<prefix.size();i++)
+		{
+			if (message[i + 1] != prefix[i])
+			{
+				match = false;
+				break;
+			}
+		}
+		if (match == true)
+		{
+			return true;
+		}
+	}
+	return false;
+}
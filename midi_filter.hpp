@@ -0,0 +1,91 @@
+/* midi_filter.hpp - definition of the Midi_filter class, a compiled filter
+ * for incoming MIDI messages by type, channel, controller and SysEx prefix.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_MIDI_FILTER_HPP
+#define MWSD_MIDI_FILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Midi_filter - a filter expression compiled into lookup tables
+ * The expression is a list of terms separated by spaces:
+ * note, poly, cc[:from-to], program, aftertouch, bend, system,
+ * sysex[:hex prefix] and ch:channels (e.g. ch:1-4,10) which restricts all
+ * channel message terms. An empty expression accepts everything.
+ * accept() costs one table lookup for most messages.
+*/
+
+class Midi_filter
+{
+	public:
+		Midi_filter();
+		~Midi_filter() {}
+
+			// Access methods
+		bool get_enabled() const { return its_enabled; }
+		std::string get_expression() const { return its_expression; }
+		std::string get_error_msg() const { return its_error_msg; }
+
+			// Utility methods
+			// Compile expr into the tables, false on a syntax error
+		bool compile(std::string expr);
+			// Accept SysEx starting with prefix (bytes after 0xf0)
+		void add_sysex_prefix(const std::vector<unsigned char>& prefix);
+		bool accept(const unsigned char *message, std::size_t size) const
+		{
+			if ((its_enabled == false) || (size == 0))
+			{
+				return true;
+			}
+			switch(its_status[message[0]])
+			{
+				case pass:
+				{
+					return true;
+				}
+				case check_cc:
+				{
+					return ((size >1) && \
+						(((its_cc[message[0] & 0x0f][(message[1] >> 6) & 1] >> (message[1] & 63)) & 1) != 0));
+				}
+				case check_sysex:
+				{
+					return match_sysex(message,size);
+				}
+				default:
+				{
+					return false;
+				}
+			}
+		}
+	private:
+		enum Action : unsigned char { reject = 0, pass, check_cc, check_sysex };
+		bool match_sysex(const unsigned char *message, std::size_t size) const;
+
+		bool its_enabled; // false if no filter is set
+		std::string its_expression; // source of the compiled filter
+		std::string its_error_msg;
+		Action its_status[256]; // action per status byte
+		std::uint64_t its_cc[16][2]; // accepted controllers per channel
+		std::vector<std::vector<unsigned char> > its_prefixes; // accepted SysEx
+};
+
+#endif // #ifndef MWSD_MIDI_FILTER_HPP
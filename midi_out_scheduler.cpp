@@ -0,0 +1,231 @@
+/* midi_out_scheduler.cpp - implementation of the Midi_out_scheduler class,
+ * the only sender on the MIDI output port.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "midi_out_scheduler.hpp"
+
+using std::string;
+using std::vector;
+using std::chrono::steady_clock;
+
+const unsigned long int Midi_out_scheduler::din_rate;
+const unsigned long int Midi_out_scheduler::default_burst;
+const unsigned int Midi_out_scheduler::priorities;
+
+Midi_out_scheduler::Midi_out_scheduler(RtMidiOut *midi_out):
+	Midi_out_scheduler([midi_out](vector<unsigned char>& msg) { midi_out->sendMessage(&msg); })
+{
+}
+
+Midi_out_scheduler::Midi_out_scheduler(Sender sender):
+	its_sender(sender), its_rate(din_rate), its_burst(default_burst),
+	its_tokens(default_burst), its_window_bytes(0), its_last_rate(0),
+	its_stop_flag(false)
+{
+	its_error_flag.store(false);
+	its_sent.store(0);
+	its_sent_bytes.store(0);
+	its_coalesced.store(0);
+	its_last_refill = steady_clock::now();
+	its_window_start = its_last_refill;
+}
+
+Midi_out_scheduler::~Midi_out_scheduler()
+{
+	stop();
+}
+
+void Midi_out_scheduler::set_rate(unsigned long int bytes_per_second, unsigned long int burst)
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	its_rate = (bytes_per_second >0) ? bytes_per_second : 1;
+	its_burst = (burst >0) ? burst : 1;
+	if (its_tokens > its_burst)
+	{
+		its_tokens = its_burst;
+	}
+}
+
+// Waits for a message being sent, so the old output is free afterwards
+void Midi_out_scheduler::set_sender(Sender sender)
+{
+	std::lock_guard<std::mutex> send_lock(its_send_mutex);
+	its_sender = sender;
+}
+
+unsigned long int Midi_out_scheduler::get_depth(Out_priority priority)
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	return its_queues[static_cast<unsigned int>(priority)].size();
+}
+
+unsigned long int Midi_out_scheduler::get_rate()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	if ((steady_clock::now() - its_window_start) >= std::chrono::seconds(2))
+	{
+		return 0; // nothing sent for a while
+	}
+	return its_last_rate;
+}
+
+string Midi_out_scheduler::get_error_msg()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	return its_error_msg;
+}
+
+void Midi_out_scheduler::clear_error()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	its_error_msg.clear();
+	its_error_flag.store(false);
+}
+
+void Midi_out_scheduler::start()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	if (its_thread.joinable())
+	{
+		return;
+	}
+	its_stop_flag = false;
+	its_thread = std::thread(&Midi_out_scheduler::run,this);
+}
+
+void Midi_out_scheduler::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(its_mutex);
+		its_stop_flag = true;
+	}
+	its_cond.notify_one();
+	if (its_thread.joinable())
+	{
+		its_thread.join();
+	}
+}
+
+bool Midi_out_scheduler::send(Out_priority priority, const vector<unsigned char>& msg, bool coalesce)
+{
+	{
+		std::lock_guard<std::mutex> lock(its_mutex);
+		std::deque<vector<unsigned char> >& queue = its_queues[static_cast<unsigned int>(priority)];
+		if (coalesce == true)
+		{
+			for (auto& waiting: queue)
+			{
+				if (waiting == msg)
+				{
+					its_coalesced++;
+					return false;
+				}
+			}
+		}
+		queue.push_back(msg);
+	}
+	its_cond.notify_one();
+	return true;
+}
+
+// Add the tokens earned since the last refill. Requires its_mutex.
+void Midi_out_scheduler::refill(steady_clock::time_point now)
+{
+	double elapsed = std::chrono::duration<double>(now - its_last_refill).count();
+	its_last_refill = now;
+	its_tokens += elapsed * its_rate;
+	if (its_tokens > its_burst)
+	{
+		its_tokens = its_burst;
+	}
+}
+
+void Midi_out_scheduler::run()
+{
+	if (its_setup)
+	{
+		its_setup();
+	}
+	std::unique_lock<std::mutex> lock(its_mutex);
+	while (true)
+	{
+		// Highest priority first
+		std::deque<vector<unsigned char> > *queue = nullptr;
+		for (auto& candidate: its_queues)
+		{
+			if (!candidate.empty())
+			{
+				queue = &candidate;
+				break;
+			}
+		}
+		if (queue == nullptr)
+		{
+			if (its_stop_flag == true)
+			{
+				break;
+			}
+			its_cond.wait(lock);
+			continue;
+		}
+
+		// Messages larger than the bucket go out once it is full
+		double size = static_cast<double>(queue->front().size());
+		double needed = (size < its_burst) ? size : its_burst;
+		steady_clock::time_point now = steady_clock::now();
+		refill(now);
+		if (its_tokens < needed)
+		{
+			// A more urgent message may arrive meanwhile, so choose again
+			std::chrono::duration<double> wait_time((needed - its_tokens) / its_rate);
+			its_cond.wait_for(lock,wait_time);
+			continue;
+		}
+		its_tokens -= size;
+		vector<unsigned char> msg;
+		msg.swap(queue->front());
+		queue->pop_front();
+
+		lock.unlock();
+		try
+		{
+			std::lock_guard<std::mutex> send_lock(its_send_mutex);
+			its_sender(msg);
+		}
+		catch (RtMidiError& e)
+		{
+			lock.lock();
+			its_error_msg = e.getMessage();
+			its_error_flag.store(true);
+			continue;
+		}
+		lock.lock();
+		its_sent++;
+		its_sent_bytes += msg.size();
+		// Bytes per second over windows of at least one second
+		now = steady_clock::now();
+		if ((now - its_window_start) >= std::chrono::seconds(1))
+		{
+			its_last_rate = static_cast<unsigned long int>(its_window_bytes / \
+				std::chrono::duration<double>(now - its_window_start).count());
+			its_window_bytes = 0;
+			its_window_start = now;
+		}
+		its_window_bytes += msg.size();
+	}
+}
@@ -0,0 +1,106 @@
+/* midi_out_scheduler.hpp - definition of the Midi_out_scheduler class,
+ * the only sender on the MIDI output port.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_MIDI_OUT_SCHEDULER_HPP
+#define MWSD_MIDI_OUT_SCHEDULER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <rtmidi/RtMidi.h>
+
+// Queues of the scheduler, sent in this order
+enum class Out_priority { user = 0, dump_request, display_poll };
+
+/* Midi_out_scheduler - one thread sends everything for the MIDI output
+ * Messages wait in one queue per priority. A token bucket filled at the
+ * DIN MIDI rate (31250 baud, 10 bits per byte) paces the sends, so the
+ * synth never gets more than burst bytes ahead of the wire. A message
+ * may be marked to coalesce: it is dropped if an equal one is waiting.
+*/
+
+class Midi_out_scheduler
+{
+	public:
+		typedef std::function<void(std::vector<unsigned char>& msg)> Sender;
+		typedef std::function<void()> Setup; // run first in the sending thread
+
+		static const unsigned long int din_rate = 3125; // bytes per second
+		static const unsigned long int default_burst = 64; // bytes
+
+		Midi_out_scheduler() = delete;
+		Midi_out_scheduler(RtMidiOut *midi_out);
+		Midi_out_scheduler(Sender sender); // e.g. a simulated link
+		~Midi_out_scheduler();
+
+			// Access methods
+		void set_rate(unsigned long int bytes_per_second, unsigned long int burst);
+		void set_setup(Setup setup) { its_setup = setup; } // before start
+			// A new output, e.g. another port, from the next message on
+		void set_sender(Sender sender);
+		unsigned long int get_depth(Out_priority priority);
+		unsigned long int get_sent() const { return its_sent.load(); }
+		unsigned long int get_sent_bytes() const { return its_sent_bytes.load(); }
+		unsigned long int get_coalesced() const { return its_coalesced.load(); }
+		unsigned long int get_rate(); // bytes sent in the last full second
+		bool get_error() const { return its_error_flag.load(); }
+		std::string get_error_msg();
+		void clear_error(); // e.g. after a new port was opened
+
+			// Utility methods
+		void start();
+		void stop(); // send what is queued, then stop
+			// Queue a message, false if it was coalesced
+		bool send(Out_priority priority, const std::vector<unsigned char>& msg, \
+			bool coalesce = false);
+	private:
+		static const unsigned int priorities = 3;
+
+		void run(); // main loop of the sending thread
+		void refill(std::chrono::steady_clock::time_point now);
+
+		Sender its_sender;
+		Setup its_setup; // e.g. real-time priority, may be empty
+		std::deque<std::vector<unsigned char> > its_queues[priorities];
+		double its_rate; // bytes per second
+		double its_burst; // bucket size in bytes
+		double its_tokens; // bytes that may be sent right now
+		std::chrono::steady_clock::time_point its_last_refill;
+		std::chrono::steady_clock::time_point its_window_start; // for get_rate
+		unsigned long int its_window_bytes;
+		unsigned long int its_last_rate;
+		bool its_stop_flag;
+		std::string its_error_msg;
+		std::atomic_bool its_error_flag;
+		std::atomic_ulong its_sent;
+		std::atomic_ulong its_sent_bytes;
+		std::atomic_ulong its_coalesced;
+		std::mutex its_mutex;
+		std::mutex its_send_mutex; // held while its_sender runs
+		std::condition_variable its_cond;
+		std::thread its_thread;
+};
+
+#endif // #ifndef MWSD_MIDI_OUT_SCHEDULER_HPP
@@ -0,0 +1,107 @@
+/* midi_reader.cpp - implementation of the Midi_reader class, which takes
+ * MIDI input from the RtMidi queue in batches.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <chrono>
+#include "midi_reader.hpp"
+
+using std::vector;
+
+const unsigned int Midi_reader::min_idle_ms;
+const unsigned int Midi_reader::max_idle_ms;
+const unsigned long int Midi_reader::max_batch;
+
+Midi_reader::Midi_reader(RtMidiIn *midi_in, Handler handler):
+	Midi_reader([midi_in](vector<unsigned char>& msg) { return midi_in->getMessage(&msg); }, \
+		handler)
+{
+}
+
+Midi_reader::Midi_reader(Source source, Handler handler):
+	its_source(source), its_handler(handler), its_batch(max_batch),
+	its_delta_times(max_batch)
+{
+	its_stop_flag.store(false);
+	its_messages.store(0);
+	its_batches.store(0);
+	its_largest.store(0);
+	its_wakeups.store(0);
+}
+
+Midi_reader::~Midi_reader()
+{
+	stop();
+}
+
+void Midi_reader::start()
+{
+	if (its_thread.joinable())
+	{
+		return;
+	}
+	its_stop_flag.store(false);
+	its_thread = std::thread(&Midi_reader::run,this);
+}
+
+void Midi_reader::stop()
+{
+	its_stop_flag.store(true);
+	if (its_thread.joinable())
+	{
+		its_thread.join();
+	}
+}
+
+void Midi_reader::run()
+{
+	unsigned int idle_ms = min_idle_ms;
+	while (its_stop_flag == false)
+	{
+		its_wakeups++;
+		unsigned long int count = 0;
+		while (count < max_batch)
+		{
+			its_delta_times[count] = its_source(its_batch[count]);
+			if (its_batch[count].empty())
+			{
+				break;
+			}
+			count++;
+		}
+		if (count >0)
+		{
+			its_handler(its_batch,its_delta_times,count);
+			its_messages += count;
+			its_batches++;
+			if (count > its_largest)
+			{
+				its_largest.store(count);
+			}
+			idle_ms = min_idle_ms;
+			if (count == max_batch)
+			{
+				continue; // there is more
+			}
+		}
+		else if (idle_ms < max_idle_ms)
+		{
+			idle_ms *= 2;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(idle_ms));
+	}
+}
@@ -0,0 +1,79 @@
+/* midi_reader.hpp - definition of the Midi_reader class, which takes
+ * MIDI input from the RtMidi queue in batches.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_MIDI_READER_HPP
+#define MWSD_MIDI_READER_HPP
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <rtmidi/RtMidi.h>
+
+/* Midi_reader - one thread drains the input queue of RtMidiIn
+ * Instead of a callback per message the thread takes every queued
+ * message with getMessage into buffers, which are kept from batch to
+ * batch, and hands them to the handler at once. RtMidi has no blocking
+ * read, so an empty queue is polled again after a pause, which doubles
+ * from min_idle_ms up to max_idle_ms while nothing arrives.
+*/
+
+class Midi_reader
+{
+	public:
+			// Next message into msg (empty if there is none), returns delta time
+		typedef std::function<double(std::vector<unsigned char>& msg)> Source;
+			// Called with the first count buffers of batch and their delta times
+		typedef std::function<void(std::vector<std::vector<unsigned char> >& batch, \
+			const std::vector<double>& delta_times, unsigned long int count)> Handler;
+
+		static const unsigned int min_idle_ms = 1;
+		static const unsigned int max_idle_ms = 8;
+		static const unsigned long int max_batch = 256; // messages
+
+		Midi_reader() = delete;
+		Midi_reader(RtMidiIn *midi_in, Handler handler);
+		Midi_reader(Source source, Handler handler); // e.g. a simulated port
+		~Midi_reader();
+
+			// Access methods
+		unsigned long int get_messages() const { return its_messages.load(); }
+		unsigned long int get_batches() const { return its_batches.load(); }
+		unsigned long int get_largest() const { return its_largest.load(); }
+		unsigned long int get_wakeups() const { return its_wakeups.load(); }
+
+			// Utility methods
+		void start();
+		void stop();
+	private:
+		void run(); // main loop of the reader thread
+
+		Source its_source;
+		Handler its_handler;
+		std::vector<std::vector<unsigned char> > its_batch; // reused buffers
+		std::vector<double> its_delta_times; // of the messages in its_batch
+		std::atomic_bool its_stop_flag;
+		std::atomic_ulong its_messages;
+		std::atomic_ulong its_batches;
+		std::atomic_ulong its_largest; // most messages in one batch
+		std::atomic_ulong its_wakeups;
+		std::thread its_thread;
+};
+
+#endif // #ifndef MWSD_MIDI_READER_HPP
@@ -0,0 +1,137 @@
+/* midi_state.cpp - implementation of the Midi_state class, the live table
+ * of controller, program, pitch bend and aftertouch values.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "midi_state.hpp"
+
+using std::uint16_t;
+using std::uint32_t;
+using std::size_t;
+
+const unsigned int Midi_state::program_cell;
+const unsigned int Midi_state::bend_cell;
+const unsigned int Midi_state::aftertouch_cell;
+const unsigned int Midi_state::num_cells;
+
+Midi_state::Midi_state()
+{
+	for (unsigned int ch = 0;ch<16;ch++)
+	{
+		for (unsigned int cc = 0;cc<128;cc++)
+		{
+			its_cc[ch][cc].store(0);
+		}
+		its_program[ch].store(0);
+		its_bend[ch].store(8192);
+		its_aftertouch[ch].store(0);
+		for (unsigned int i = 0;i<5;i++)
+		{
+			its_dirty[ch][i].store(0);
+		}
+	}
+	its_seq.store(0);
+	its_last_event.store(0);
+}
+
+bool Midi_state::update(const unsigned char *message, size_t size)
+{
+	if (size <2)
+	{
+		return false;
+	}
+	unsigned char status = message[0];
+	unsigned int channel = status & 0x0f;
+	unsigned int cell = 0;
+	bool changed = false;
+	switch(status & 0xf0)
+	{
+		case 0xb0: // control change
+		{
+			if (size <3)
+			{
+				return false;
+			}
+			cell = message[1] & 0x7f;
+			changed = (its_cc[channel][cell].exchange(message[2],std::memory_order_relaxed) != message[2]);
+			break;
+		}
+		case 0xc0: // program change
+		{
+			cell = program_cell;
+			changed = (its_program[channel].exchange(message[1],std::memory_order_relaxed) != message[1]);
+			break;
+		}
+		case 0xd0: // channel aftertouch
+		{
+			cell = aftertouch_cell;
+			changed = (its_aftertouch[channel].exchange(message[1],std::memory_order_relaxed) != message[1]);
+			break;
+		}
+		case 0xe0: // pitch bend
+		{
+			if (size <3)
+			{
+				return false;
+			}
+			cell = bend_cell;
+			uint16_t bend = static_cast<uint16_t>((message[2] << 7) | message[1]);
+			changed = (its_bend[channel].exchange(bend,std::memory_order_relaxed) != bend);
+			break;
+		}
+		default:
+		{
+			return false;
+		}
+	}
+	if (changed == true)
+	{
+		mark(channel,cell);
+		uint32_t event = (static_cast<uint32_t>(status) << 16) | (static_cast<uint32_t>(message[1]) << 8);
+		if (size >2)
+		{
+			event |= message[2];
+		}
+		its_last_event.store(event,std::memory_order_release);
+		its_seq.fetch_add(1,std::memory_order_release);
+	}
+	return true;
+}
+
+void Midi_state::mark(unsigned int channel, unsigned int cell)
+{
+	its_dirty[channel][cell >> 5].fetch_or(1u << (cell & 31),std::memory_order_release);
+}
+
+bool Midi_state::take_dirty(unsigned int channel, unsigned int cell)
+{
+	uint32_t bit = 1u << (cell & 31);
+	std::atomic<uint32_t>& word = its_dirty[channel][cell >> 5];
+	if ((word.load(std::memory_order_relaxed) & bit) == 0)
+	{
+		return false;
+	}
+	return ((word.fetch_and(~bit,std::memory_order_acquire) & bit) != 0);
+}
+
+void Midi_state::mark_all(unsigned int channel)
+{
+	for (unsigned int i = 0;i<5;i++)
+	{
+		its_dirty[channel][i].store(0xffffffff,std::memory_order_release);
+	}
+}
@@ -0,0 +1,82 @@
+/* midi_state.hpp - definition of the Midi_state class, a table holding the
+ * current value of every controller, program, pitch bend and aftertouch
+ * on all 16 MIDI channels.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_MIDI_STATE_HPP
+#define MWSD_MIDI_STATE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+/* Midi_state - live state of all channel controllers
+ * update() is called for every incoming message and costs O(1), the
+ * renderers pick up changes through dirty bits and the last event.
+ * Cells are single atomics, so one writer and several readers need no lock.
+*/
+
+class Midi_state
+{
+	public:
+		// Dirty bit indices beyond the 128 controllers of a channel
+		static const unsigned int program_cell = 128;
+		static const unsigned int bend_cell = 129;
+		static const unsigned int aftertouch_cell = 130;
+		static const unsigned int num_cells = 131;
+
+		Midi_state();
+		~Midi_state() {}
+
+			// Access methods
+		unsigned char get_cc(unsigned int channel, unsigned int cc) const \
+			{ return its_cc[channel][cc].load(std::memory_order_relaxed); }
+		unsigned char get_program(unsigned int channel) const \
+			{ return its_program[channel].load(std::memory_order_relaxed); }
+			// Pitch bend as a signed value, 0 is the centre
+		int get_bend(unsigned int channel) const \
+			{ return static_cast<int>(its_bend[channel].load(std::memory_order_relaxed)) - 8192; }
+		unsigned char get_aftertouch(unsigned int channel) const \
+			{ return its_aftertouch[channel].load(std::memory_order_relaxed); }
+			// Counter of changes, to detect a new last event
+		std::uint32_t get_seq() const { return its_seq.load(std::memory_order_acquire); }
+			// Status, data 1 and data 2 of the last changing message packed
+		std::uint32_t get_last_event() const { return its_last_event.load(std::memory_order_acquire); }
+
+			// Utility methods
+			// Update the table, returns true if the message is a channel
+			// controller, program, pitch bend or aftertouch message
+		bool update(const unsigned char *message, std::size_t size);
+			// Fetch and clear the dirty bit of a cell
+		bool take_dirty(unsigned int channel, unsigned int cell);
+			// Mark all cells of a channel dirty, e.g. after a redraw
+		void mark_all(unsigned int channel);
+	private:
+		void mark(unsigned int channel, unsigned int cell);
+
+		std::atomic<unsigned char> its_cc[16][128];
+		std::atomic<unsigned char> its_program[16];
+		std::atomic<std::uint16_t> its_bend[16];
+		std::atomic<unsigned char> its_aftertouch[16];
+			// One bit per cell, 5 words cover 131 cells
+		std::atomic<std::uint32_t> its_dirty[16][5];
+		std::atomic<std::uint32_t> its_seq;
+		std::atomic<std::uint32_t> its_last_event;
+};
+
+#endif // #ifndef MWSD_MIDI_STATE_HPP
@@ -0,0 +1,132 @@
+/* mode_state.cpp - implementation of the Mode_state class, the mode of the
+ * miner in a single atomic word.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "mode_state.hpp"
+
+const Mode_state::Word Mode_state::thru_bit;
+const Mode_state::Word Mode_state::disp_bit;
+const Mode_state::Word Mode_state::paused_bit;
+const unsigned int Mode_state::unanswered_shift;
+const unsigned int Mode_state::max_unanswered;
+
+Mode_state::Mode_state()
+{
+	its_word.store(thru_bit);
+}
+
+Mode_state::Mode Mode_state::get_mode(Word word)
+{
+	if (get_disp(word) == true)
+	{
+		return Mode::continuous;
+	}
+	return (get_thru(word) == true) ? Mode::direct : Mode::on_demand;
+}
+
+bool Mode_state::next(Word state, Event event, Word& next_state)
+{
+	Word flags = state & ((static_cast<Word>(1) << unanswered_shift) - 1);
+	unsigned int unanswered = get_unanswered(state);
+	switch (event)
+	{
+		case Event::direct_on:
+		case Event::direct_off:
+		{
+			bool thru = (event == Event::direct_on);
+			if (get_thru(state) == thru)
+			{
+				return false;
+			}
+			flags ^= thru_bit;
+			break;
+		}
+		case Event::continuous_on:
+		case Event::continuous_off:
+		{
+			bool disp = (event == Event::continuous_on);
+			if (get_disp(state) == disp)
+			{
+				return false;
+			}
+			flags ^= disp_bit;
+			break;
+		}
+		case Event::pause:
+		case Event::resume:
+		{
+			bool paused = (event == Event::pause);
+			if (get_paused(state) == paused)
+			{
+				return false;
+			}
+			// Requests before the pause are not held against the synth
+			flags ^= paused_bit;
+			unanswered = 0;
+			break;
+		}
+		case Event::answered:
+		{
+			if ((get_paused(state) == true) || (unanswered == 0))
+			{
+				return false;
+			}
+			unanswered = 0;
+			break;
+		}
+		case Event::timed_out:
+		{
+			if ((get_paused(state) == true) || (unanswered >= max_unanswered))
+			{
+				return false;
+			}
+			unanswered++;
+			break;
+		}
+		default:
+		{
+			return false;
+		}
+	}
+	next_state = flags | (static_cast<Word>(unanswered) << unanswered_shift);
+	return true;
+}
+
+bool Mode_state::apply(Event event, Word& after)
+{
+	Word state = its_word.load(std::memory_order_acquire);
+	while (true)
+	{
+		if (next(state,event,after) == false)
+		{
+			after = state;
+			return false;
+		}
+		if (its_word.compare_exchange_weak(state,after,std::memory_order_acq_rel, \
+			std::memory_order_acquire) == true)
+		{
+			return true;
+		}
+	}
+}
+
+bool Mode_state::apply(Event event)
+{
+	Word after;
+	return apply(event,after);
+}
@@ -0,0 +1,70 @@
+/* mode_state.hpp - definition of the Mode_state class, the mode of the
+ * miner in a single atomic word.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_MODE_STATE_HPP
+#define MWSD_MODE_STATE_HPP
+
+#include <atomic>
+#include <cstdint>
+
+/* Mode_state - direct/on demand/continuous, paused and unanswered requests
+ * All parts live in one word, so a reader gets them with one load and
+ * never sees half of a change. The continuous display mode keeps the
+ * direct flag, leaving it returns to the mode before. Changes go through
+ * Mode_state::next, which rejects events that do not apply to a state:
+ * e.g. switching to the mode already set, or counting answers while
+ * paused. apply() changes the word with a compare and swap loop.
+*/
+
+class Mode_state
+{
+	public:
+		typedef std::uint32_t Word;
+		enum class Mode { direct, on_demand, continuous };
+		enum class Event { direct_on, direct_off, continuous_on, continuous_off, \
+			pause, resume, answered, timed_out };
+
+		static const Word thru_bit = 0x01; // direct MIDI, unless continuous
+		static const Word disp_bit = 0x02; // continuous display
+		static const Word paused_bit = 0x04;
+		static const unsigned int unanswered_shift = 8;
+		static const unsigned int max_unanswered = 255; // counting stops here
+
+		Mode_state(); // direct MIDI, running
+
+			// Access methods
+		Word load() const { return its_word.load(std::memory_order_acquire); }
+		static Mode get_mode(Word word);
+		static bool get_thru(Word word) { return ((word & thru_bit) != 0); }
+		static bool get_disp(Word word) { return ((word & disp_bit) != 0); }
+		static bool get_paused(Word word) { return ((word & paused_bit) != 0); }
+		static unsigned int get_unanswered(Word word) { return (word >> unanswered_shift); }
+
+			// Utility methods
+			// The state after event, false if the event is not valid in state
+		static bool next(Word state, Event event, Word& next_state);
+			// Apply event, false if it was rejected. after is the new word
+			// or, if rejected, the current one.
+		bool apply(Event event, Word& after);
+		bool apply(Event event);
+	private:
+		std::atomic<Word> its_word;
+};
+
+#endif // #ifndef MWSD_MODE_STATE_HPP
@@ -0,0 +1,289 @@
+/* mwsd_client.cpp - mwsd-client, shows the display of a running mwsd
+ * from its socket, sends commands and measures the delivery latency.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "config.h"
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+using std::int64_t;
+
+// One connection to mwsd and the parser state of its stream
+struct Connection
+{
+	int fd;
+	string input; // received, but not yet parsed
+	unsigned long int lines_left; // lines of the current event still to come
+	unsigned long int displays; // display events received
+};
+
+int connect_to(const string& path)
+{
+	struct sockaddr_un address;
+	if (path.size() >= sizeof(address.sun_path))
+	{
+		return -1;
+	}
+	int fd = socket(AF_UNIX,SOCK_STREAM,0);
+	if (fd <0)
+	{
+		return -1;
+	}
+	std::memset(&address,0,sizeof(address));
+	address.sun_family = AF_UNIX;
+	std::strncpy(address.sun_path,path.c_str(),sizeof(address.sun_path) - 1);
+	if (connect(fd,reinterpret_cast<struct sockaddr *>(&address),sizeof(address)) <0)
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+int64_t now_us()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>( \
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool send_line(int fd, string line)
+{
+	line += "\n";
+	return (write(fd,line.data(),line.size()) == static_cast<ssize_t>(line.size()));
+}
+
+int main(int argc, char *argv[])
+{
+	string socket_path;
+	unsigned long int client_count = 1;
+	unsigned long int event_count = 0; // 0: until mwsd quits
+	bool latency_flag = false;
+	vector<string> commands;
+	try
+	{
+		po::options_description desc("Options");
+		desc.add_options()
+			("help,h", "Show this help")
+			("socket,s", po::value<string>()->value_name("path"), "Socket of mwsd (the path of its socket: sink)")
+			("clients,n", po::value<unsigned long int>()->value_name("count"), "Number of simultaneous connections (1-256)")
+			("count,c", po::value<unsigned long int>()->value_name("events"), "Quit after this many display events")
+			("latency,l", "Measure the delivery latency instead of printing events")
+			("request,r", "Request a display update")
+			("key,k", po::value<vector<string> >()->composing()->value_name("key"), "Press a key: space, d, g, [, ], up, down, left or right")
+		;
+		po::variables_map vm;
+		store(po::parse_command_line(argc,argv,desc), vm);
+		notify(vm);
+		if ((vm.count("help")) || (!vm.count("socket")))
+		{
+			cout << "mwsd-client, " << PACKAGE_STRING << endl;
+			cout << "Copyright (c) 2018-2020 by Jeanette C.\n";
+			cout << "Released under the GPL version 3.\n";
+			cout << desc << endl;
+			return (vm.count("help") ? 0 : 1);
+		}
+		socket_path = vm["socket"].as<string>();
+		if (vm.count("clients"))
+		{
+			client_count = vm["clients"].as<unsigned long int>();
+			if ((client_count <1) || (client_count >256))
+			{
+				cerr << "ERROR:\nThe number of clients must be between 1 and 256.\n";
+				return 1;
+			}
+		}
+		if (vm.count("count"))
+		{
+			event_count = vm["count"].as<unsigned long int>();
+		}
+		if (vm.count("latency") || (client_count >1))
+		{
+			latency_flag = true;
+		}
+		if (vm.count("key"))
+		{
+			for (auto& key: vm["key"].as<vector<string> >())
+			{
+				commands.push_back(string("key ") + key);
+			}
+		}
+		if (vm.count("request"))
+		{
+			commands.push_back(string("disp"));
+		}
+	}
+	catch (std::exception& e)
+	{
+		cerr << "ERROR:\n" << e.what() << endl;
+		return 1;
+	}
+
+	vector<Connection> connections;
+	vector<struct pollfd> poll_fds;
+	for (unsigned long int i = 0;i<client_count;i++)
+	{
+		int fd = connect_to(socket_path);
+		if (fd <0)
+		{
+			cerr << "ERROR:\nCannot connect to " << socket_path << ": " << std::strerror(errno) << endl;
+			return 1;
+		}
+		connections.push_back(Connection { fd, string(), 0, 0 });
+		poll_fds.push_back(pollfd { fd, POLLIN, 0 });
+	}
+	for (auto& command: commands)
+	{
+		send_line(connections[0].fd,command);
+	}
+	if ((commands.empty() == false) && (event_count == 0) && (latency_flag == false))
+	{
+		event_count = 1; // just show the answer to the commands
+	}
+
+	vector<int64_t> latencies; // of all display events on all connections
+	unsigned long int received = 0; // display events on the first connection
+	unsigned long int open_count = connections.size();
+	char buffer[4096];
+	while ((open_count >0) && ((event_count == 0) || (received < event_count)))
+	{
+		if (poll(poll_fds.data(),poll_fds.size(),-1) <0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			break;
+		}
+		for (unsigned long int i = 0;i<connections.size();i++)
+		{
+			if (poll_fds[i].revents == 0)
+			{
+				continue;
+			}
+			ssize_t count = read(connections[i].fd,buffer,sizeof(buffer));
+			int64_t arrival = now_us();
+			if (count <= 0)
+			{
+				close(connections[i].fd);
+				poll_fds[i].fd = -1;
+				open_count--;
+				continue;
+			}
+			Connection& con = connections[i];
+			con.input.append(buffer,static_cast<unsigned long int>(count));
+			string::size_type end = con.input.find('\n');
+			while (end != string::npos)
+			{
+				string line = con.input.substr(0,end);
+				con.input.erase(0,end + 1);
+				end = con.input.find('\n');
+				if (con.lines_left >0) // a line of the current event
+				{
+					con.lines_left--;
+					if ((latency_flag == false) && (i == 0))
+					{
+						cout << "  " << line << "\n";
+					}
+					continue;
+				}
+				// event header: kind time_ms post_us line_count
+				std::istringstream header(line);
+				string kind;
+				int64_t time_ms = 0;
+				int64_t post_us = 0;
+				unsigned long int line_count = 0;
+				header >> kind;
+				if ((kind != "display") && (kind != "midi") && (kind != "status"))
+				{
+					if ((latency_flag == false) && (i == 0))
+					{
+						cout << line << "\n"; // greeting or answer to a command
+					}
+					continue;
+				}
+				header >> time_ms >> post_us >> line_count;
+				con.lines_left = line_count;
+				if (kind == "display")
+				{
+					// The first display is the stored one sent on connect
+					if (con.displays >0)
+					{
+						latencies.push_back(arrival - post_us);
+					}
+					con.displays++;
+					if (i == 0)
+					{
+						received++;
+					}
+				}
+				if ((latency_flag == false) && (i == 0))
+				{
+					cout << kind << ":\n";
+				}
+			}
+			if ((latency_flag == false) && (i == 0))
+			{
+				cout.flush();
+			}
+		}
+	}
+	for (auto& con: connections)
+	{
+		close(con.fd);
+	}
+
+	if ((latency_flag == true) && (!latencies.empty()))
+	{
+		// From posting the event in mwsd to its arrival here
+		std::sort(latencies.begin(),latencies.end());
+		int64_t sum = 0;
+		for (auto value: latencies)
+		{
+			sum += value;
+		}
+		unsigned long int p99 = (latencies.size() * 99) / 100;
+		if (p99 >= latencies.size())
+		{
+			p99 = latencies.size() - 1;
+		}
+		cout << "Clients: " << client_count << ", display events: " << latencies.size() << "\n";
+		cout << "Latency in microseconds: mean " << (sum / static_cast<int64_t>(latencies.size())) << \
+			", median " << latencies[latencies.size() / 2] << ", p99 " << latencies[p99] << \
+			", max " << latencies.back() << endl;
+	}
+	return 0;
+}
@@ -0,0 +1,142 @@
+/* mwsd_shm.cpp - mwsd-shm, shows the shared-memory display mirror of a
+ * running mwsd and measures the cost of reading it.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "config.h"
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "mwsd_shm.hpp"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::string;
+
+void print_data(const Mwsd_shm_data& data)
+{
+	cout << data.mode << ", device ID " << data.dev_id << "\n";
+	for (std::uint32_t i = 0;(i<data.rows) && (i<4);i++)
+	{
+		cout << "  " << data.display[i] << "\n";
+	}
+	if (data.midi[0] != 0)
+	{
+		cout << "MIDI: " << data.midi << "\n";
+	}
+	cout << "Frames " << data.frames << ", MIDI events " << data.midi_events << \
+		", mode changes " << data.status_changes << ", last update took " << \
+		data.publish_ns << " ns" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+	string name("/mwsd");
+	unsigned long int bench_count = 0;
+	bool watch_flag = false;
+	try
+	{
+		po::options_description desc("Options");
+		desc.add_options()
+			("help,h", "Show this help")
+			("name,m", po::value<string>()->value_name("name"), "Name of the shared memory (the name of the shm: sink, default /mwsd)")
+			("watch,w", "Print every change until mwsd quits")
+			("bench,b", po::value<unsigned long int>()->value_name("reads"), "Measure the time of this many snapshots")
+		;
+		po::variables_map vm;
+		store(po::parse_command_line(argc,argv,desc), vm);
+		notify(vm);
+		if (vm.count("help"))
+		{
+			cout << "mwsd-shm, " << PACKAGE_STRING << endl;
+			cout << "Copyright (c) 2018-2020 by Jeanette C.\n";
+			cout << "Released under the GPL version 3.\n";
+			cout << desc << endl;
+			return 0;
+		}
+		if (vm.count("name"))
+		{
+			name = vm["name"].as<string>();
+		}
+		if (vm.count("bench"))
+		{
+			bench_count = vm["bench"].as<unsigned long int>();
+		}
+		if (vm.count("watch"))
+		{
+			watch_flag = true;
+		}
+	}
+	catch (std::exception& e)
+	{
+		cerr << "ERROR:\n" << e.what() << endl;
+		return 1;
+	}
+
+	Mwsd_shm_reader reader;
+	if (reader.open_shm(name) == false)
+	{
+		cerr << "ERROR:\nCannot open the shared memory " << name << ". Is mwsd running with the output shm:" << name << "?\n";
+		return 1;
+	}
+	Mwsd_shm_data data;
+
+	if (bench_count >0)
+	{
+		unsigned long int failed = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned long int i = 0;i<bench_count;i++)
+		{
+			if (reader.read(data) == false)
+			{
+				failed++;
+			}
+		}
+		double total_ns = std::chrono::duration_cast<std::chrono::nanoseconds>( \
+			std::chrono::steady_clock::now() - start).count();
+		cout << bench_count << " snapshots, " << (total_ns / bench_count) << " ns each, " << \
+			failed << " failed" << endl;
+		cout << "Last update in mwsd took " << data.publish_ns << " ns" << endl;
+		return 0;
+	}
+
+	std::uint32_t last_seq = 0;
+	do
+	{
+		std::uint32_t seq = reader.get_seq();
+		if (seq != last_seq)
+		{
+			if (reader.read(data) == false)
+			{
+				cerr << "ERROR:\nNo consistent snapshot of " << name << endl;
+				return 1;
+			}
+			print_data(data);
+			last_seq = seq;
+		}
+		if (watch_flag == true)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		}
+	} while (watch_flag == true);
+	return 0;
+}
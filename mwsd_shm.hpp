@@ -0,0 +1,136 @@
+/* mwsd_shm.hpp - layout of the shared-memory display mirror of mwsd and a
+ * lock-free reader for other programs.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_SHM_HPP
+#define MWSD_SHM_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#if ATOMIC_INT_LOCK_FREE != 2
+#error "The shared-memory mirror needs lock-free atomic integers"
+#endif
+
+/* The segment holds a sequence counter and the data it guards (a seqlock).
+ * mwsd makes the counter odd, updates the data and makes it even again.
+ * A reader copies the data and retries if the counter was odd or changed
+ * meanwhile, so it never blocks mwsd and needs no system call.
+*/
+
+const std::uint32_t mwsd_shm_magic = 0x4453574d; // "MWSD"
+const std::uint32_t mwsd_shm_version = 1;
+
+struct Mwsd_shm_data
+{
+	std::uint32_t magic;
+	std::uint32_t version;
+	std::uint32_t dev_id; // device ID of the synthesizer
+	std::uint32_t rows; // used lines of display
+	std::int64_t time_ms; // wall clock time of the last update
+	std::uint64_t frames; // display frames published
+	std::uint64_t midi_events; // direct MIDI lines published
+	std::uint64_t status_changes; // mode changes published
+	std::uint64_t publish_ns; // time taken by the last update in mwsd
+	char mode[48]; // e.g. "Direct MIDI mode"
+	char display[4][81]; // display lines
+	char midi[81]; // last direct MIDI line
+};
+
+struct Mwsd_shm_layout
+{
+	std::atomic<std::uint32_t> seq; // odd while mwsd writes
+	Mwsd_shm_data data;
+};
+
+/* Mwsd_shm_reader - maps the segment read-only and takes snapshots
+ * The name is the one given to mwsd, e.g. shm:/mwsd gives "/mwsd".
+*/
+
+class Mwsd_shm_reader
+{
+	public:
+		Mwsd_shm_reader(): its_layout(nullptr) {}
+		~Mwsd_shm_reader() { close_shm(); }
+
+		bool open_shm(const std::string& name)
+		{
+			close_shm();
+			int fd = shm_open(name.c_str(),O_RDONLY,0);
+			if (fd <0)
+			{
+				return false;
+			}
+			void *address = mmap(nullptr,sizeof(Mwsd_shm_layout),PROT_READ,MAP_SHARED,fd,0);
+			close(fd);
+			if (address == MAP_FAILED)
+			{
+				return false;
+			}
+			its_layout = static_cast<const Mwsd_shm_layout *>(address);
+			return true;
+		}
+
+		void close_shm()
+		{
+			if (its_layout != nullptr)
+			{
+				munmap(const_cast<Mwsd_shm_layout *>(its_layout),sizeof(Mwsd_shm_layout));
+				its_layout = nullptr;
+			}
+		}
+
+		// Copy a consistent snapshot, false if none was found in max_tries
+		bool read(Mwsd_shm_data& data, unsigned long int max_tries = 1000) const
+		{
+			if (its_layout == nullptr)
+			{
+				return false;
+			}
+			for (unsigned long int i = 0;i<max_tries;i++)
+			{
+				std::uint32_t before = its_layout->seq.load(std::memory_order_acquire);
+				if (before & 1) // being written
+				{
+					continue;
+				}
+				std::memcpy(&data,&its_layout->data,sizeof(data));
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (its_layout->seq.load(std::memory_order_relaxed) == before)
+				{
+					return ((data.magic == mwsd_shm_magic) && (data.version == mwsd_shm_version));
+				}
+			}
+			return false;
+		}
+
+		// Cheap check for news: the sequence only changes with the data
+		std::uint32_t get_seq() const
+		{
+			return (its_layout == nullptr) ? 0 : its_layout->seq.load(std::memory_order_acquire);
+		}
+	private:
+		const Mwsd_shm_layout *its_layout;
+};
+
+#endif // #ifndef MWSD_SHM_HPP
@@ -0,0 +1,403 @@
+/* output_sink.cpp - implementation of the Output_sink base class, the
+ * Text_sink for files, pipes and external commands and the Sink_hub.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <chrono>
+#include <ctime>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include "output_sink.hpp"
+#include "hex_view.hpp"
+
+using std::string;
+using std::vector;
+using std::shared_ptr;
+using std::make_shared;
+using std::int64_t;
+
+Output_sink::Output_sink(string name, unsigned long int capacity, Overflow_policy policy):
+	its_name(name), its_capacity(capacity), its_policy(policy), its_head(0),
+	its_count(0), its_stop_flag(false)
+{
+	if (its_capacity <1)
+	{
+		its_capacity = 1;
+	}
+	its_buffer.resize(its_capacity);
+	its_posted.store(0);
+	its_written.store(0);
+	its_dropped.store(0);
+	its_coalesced.store(0);
+}
+
+Output_sink::~Output_sink()
+{
+	stop();
+}
+
+unsigned long int Output_sink::get_depth()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	return its_count;
+}
+
+void Output_sink::start()
+{
+	if (its_thread.joinable())
+	{
+		return;
+	}
+	its_stop_flag = false;
+	its_thread = std::thread(&Output_sink::run,this);
+}
+
+void Output_sink::stop()
+{
+	if (!its_thread.joinable())
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(its_mutex);
+		its_stop_flag = true;
+	}
+	its_cond.notify_one();
+	its_thread.join();
+}
+
+// Queue an event, apply the overflow policy if the buffer is full
+void Output_sink::post(const shared_ptr<const Sink_event>& event)
+{
+	its_posted++;
+	{
+		std::lock_guard<std::mutex> lock(its_mutex);
+		if (its_count == its_capacity)
+		{
+			bool coalesced = false;
+			if (its_policy == Overflow_policy::coalesce)
+			{
+				// Replace the newest event of the same kind
+				for (unsigned long int i = its_count;i>0;i--)
+				{
+					unsigned long int pos = (its_head + i - 1) % its_capacity;
+					if (its_buffer[pos]->kind == event->kind)
+					{
+						its_buffer[pos] = event;
+						coalesced = true;
+						break;
+					}
+				}
+			}
+			if (coalesced == true)
+			{
+				its_coalesced++;
+				return;
+			}
+			its_buffer[its_head].reset(); // drop the oldest event
+			its_head = (its_head + 1) % its_capacity;
+			its_count--;
+			its_dropped++;
+		}
+		its_buffer[(its_head + its_count) % its_capacity] = event;
+		its_count++;
+	}
+	its_cond.notify_one();
+}
+
+void Output_sink::run()
+{
+	bool is_open = open_sink();
+	std::unique_lock<std::mutex> lock(its_mutex);
+	while (true)
+	{
+		its_cond.wait(lock,[this]{ return ((its_count >0) || (its_stop_flag == true)); });
+		if (its_count == 0) // stop flag set and all events written
+		{
+			break;
+		}
+		shared_ptr<const Sink_event> event;
+		event.swap(its_buffer[its_head]);
+		its_head = (its_head + 1) % its_capacity;
+		its_count--;
+		lock.unlock();
+		if (is_open == false)
+		{
+			is_open = open_sink(); // e.g. a named pipe without reader
+		}
+		if ((is_open == true) && (write_event(*event) == true))
+		{
+			its_written++;
+		}
+		else
+		{
+			its_dropped++;
+		}
+		lock.lock();
+	}
+	lock.unlock();
+	close_sink();
+}
+
+Text_sink::Text_sink(Type type, string target, Overflow_policy policy):
+	Output_sink(target.empty() ? string("stdout") : target,256,policy),
+	its_type(type), its_target(target), its_fd(-1), its_cmd(nullptr)
+{
+}
+
+Text_sink::~Text_sink()
+{
+	stop(); // the dispatch thread calls our virtual methods
+}
+
+Text_sink* Text_sink::create(string spec, string& error_msg)
+{
+	Overflow_policy policy = Overflow_policy::drop_oldest;
+	string::size_type comma = spec.rfind(',');
+	if (comma != string::npos)
+	{
+		string policy_name = spec.substr(comma + 1);
+		if (policy_name == "coalesce")
+		{
+			policy = Overflow_policy::coalesce;
+			spec = spec.substr(0,comma);
+		}
+		else if (policy_name == "drop_oldest")
+		{
+			spec = spec.substr(0,comma);
+		}
+	}
+	if (spec == "stdout")
+	{
+		return new Text_sink(Type::stdout_file,string(),policy);
+	}
+	string::size_type colon = spec.find(':');
+	if ((colon == string::npos) || (colon == (spec.size() - 1)))
+	{
+		error_msg = string("Invalid output sink ") + spec;
+		return nullptr;
+	}
+	string type_name = spec.substr(0,colon);
+	string target = spec.substr(colon + 1);
+	if (type_name == "file")
+	{
+		return new Text_sink(Type::file,target,policy);
+	}
+	else if (type_name == "pipe")
+	{
+		return new Text_sink(Type::pipe,target,policy);
+	}
+	else if (type_name == "cmd")
+	{
+		// A speech pipeline only needs the latest text, unless told otherwise
+		if (comma == string::npos)
+		{
+			policy = Overflow_policy::coalesce;
+		}
+		return new Text_sink(Type::command,target,policy);
+	}
+	error_msg = string("Unknown output sink type ") + type_name;
+	return nullptr;
+}
+
+bool Text_sink::open_sink()
+{
+	switch(its_type)
+	{
+		case Type::file:
+		{
+			its_fd = open(its_target.c_str(),O_WRONLY | O_CREAT | O_APPEND,0644);
+			break;
+		}
+		case Type::pipe:
+		{
+			// Non-blocking open fails while nobody reads, so retry later
+			its_fd = open(its_target.c_str(),O_WRONLY | O_NONBLOCK);
+			if (its_fd >= 0)
+			{
+				fcntl(its_fd,F_SETFL,fcntl(its_fd,F_GETFL) & ~O_NONBLOCK);
+			}
+			break;
+		}
+		case Type::command:
+		{
+			its_cmd = popen(its_target.c_str(),"w");
+			if (its_cmd != nullptr)
+			{
+				its_fd = fileno(its_cmd);
+			}
+			break;
+		}
+		case Type::stdout_file:
+		{
+			its_fd = STDOUT_FILENO;
+			break;
+		}
+	}
+	return (its_fd >= 0);
+}
+
+bool Text_sink::write_event(const Sink_event& event)
+{
+	// One line per event: time, kind and the lines separated by " | "
+	string text;
+	std::time_t seconds = static_cast<std::time_t>(event.time_ms / 1000);
+	struct tm local;
+	localtime_r(&seconds,&local);
+	char stamp[32];
+	snprintf(stamp,sizeof(stamp),"%02d:%02d:%02d.%03d ",local.tm_hour, \
+		local.tm_min,local.tm_sec,static_cast<int>(event.time_ms % 1000));
+	text = stamp;
+	switch(event.kind)
+	{
+		case Sink_event::Kind::display:
+		{
+			text += "display: ";
+			break;
+		}
+		case Sink_event::Kind::midi:
+		{
+			text += "midi: ";
+			break;
+		}
+		case Sink_event::Kind::status:
+		{
+			text += "status: ";
+			break;
+		}
+	}
+	for (unsigned long int i = 0;i<event.lines.size();i++)
+	{
+		if (i >0)
+		{
+			text += " | ";
+		}
+		text += event.lines[i];
+	}
+	if (event.data != nullptr)
+	{
+		text += ": ";
+		Hex_view::append_bytes(event.data->data(),event.data->size(),text);
+	}
+	text += "\n";
+
+	const char *data = text.data();
+	unsigned long int left = text.size();
+	while (left >0)
+	{
+		ssize_t written = write(its_fd,data,left);
+		if (written <0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			// The reader of a pipe has gone, reopen on the next event
+			if (its_type == Type::pipe)
+			{
+				close_sink();
+			}
+			return false;
+		}
+		data += written;
+		left -= static_cast<unsigned long int>(written);
+	}
+	return true;
+}
+
+void Text_sink::close_sink()
+{
+	if (its_cmd != nullptr)
+	{
+		pclose(its_cmd);
+		its_cmd = nullptr;
+	}
+	else if ((its_fd >= 0) && (its_type != Type::stdout_file))
+	{
+		close(its_fd);
+	}
+	its_fd = -1;
+}
+
+Sink_hub::~Sink_hub()
+{
+	stop();
+	for (auto sink: its_sinks)
+	{
+		delete sink;
+	}
+	its_sinks.clear();
+}
+
+void Sink_hub::add_sink(Output_sink *sink)
+{
+	its_sinks.push_back(sink);
+}
+
+void Sink_hub::start()
+{
+	// A pipe reader going away must not kill the program
+	std::signal(SIGPIPE,SIG_IGN);
+	for (auto sink: its_sinks)
+	{
+		sink->start();
+	}
+}
+
+void Sink_hub::stop()
+{
+	for (auto sink: its_sinks)
+	{
+		sink->stop();
+	}
+}
+
+void Sink_hub::post(Sink_event::Kind kind, const vector<string>& lines)
+{
+	post(kind,lines,nullptr);
+}
+
+void Sink_hub::post(Sink_event::Kind kind, string line)
+{
+	post(kind,vector<string>(1,line),nullptr);
+}
+
+void Sink_hub::post(Sink_event::Kind kind, string line, \
+	const shared_ptr<const vector<unsigned char> >& data, int64_t stamp_ns)
+{
+	post(kind,vector<string>(1,line),data,stamp_ns);
+}
+
+void Sink_hub::post(Sink_event::Kind kind, const vector<string>& lines, \
+	const shared_ptr<const vector<unsigned char> >& data, int64_t stamp_ns)
+{
+	if (its_sinks.empty())
+	{
+		return;
+	}
+	int64_t time_ms = std::chrono::duration_cast<std::chrono::milliseconds>( \
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	int64_t post_us = std::chrono::duration_cast<std::chrono::microseconds>( \
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+	shared_ptr<const Sink_event> event = make_shared<const Sink_event>(Sink_event { kind, time_ms, post_us, lines, data, stamp_ns });
+	for (auto sink: its_sinks)
+	{
+		sink->post(event);
+	}
+}
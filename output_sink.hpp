@@ -0,0 +1,156 @@
+/* output_sink.hpp - definition of the Output_sink class, the base of all
+ * outputs for display and MIDI events, its text based implementation
+ * Text_sink and the Sink_hub, which feeds events to all sinks.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_OUTPUT_SINK_HPP
+#define MWSD_OUTPUT_SINK_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// An event for the sinks: a display frame, decoded MIDI or a status change
+struct Sink_event
+{
+	enum class Kind { display, midi, status };
+	Kind kind;
+	std::int64_t time_ms; // wall clock time in milliseconds since the epoch
+	std::int64_t post_us; // steady clock time of posting in microseconds
+	std::vector<std::string> lines;
+	std::shared_ptr<const std::vector<unsigned char> > data; // raw message, if any
+	std::int64_t stamp_ns; // steady clock arrival of the MIDI input behind it or 0
+};
+
+// What a full sink buffer does with a new event
+enum class Overflow_policy
+{
+	drop_oldest, // discard the oldest queued event
+	coalesce // replace the newest queued event of the same kind
+};
+
+/* Output_sink - base class of all outputs
+ * Every sink has its own bounded buffer and dispatch thread, so a slow
+ * sink never stalls the thread posting events or any other sink.
+*/
+
+class Output_sink
+{
+	public:
+		Output_sink() = delete;
+		Output_sink(std::string name, unsigned long int capacity, Overflow_policy policy);
+		virtual ~Output_sink();
+
+			// Access methods
+		std::string get_name() const { return its_name; }
+		unsigned long int get_posted() const { return its_posted.load(); }
+		unsigned long int get_written() const { return its_written.load(); }
+		unsigned long int get_dropped() const { return its_dropped.load(); }
+		unsigned long int get_coalesced() const { return its_coalesced.load(); }
+		unsigned long int get_depth();
+
+			// Utility methods
+		void start(); // start the dispatch thread
+		void stop(); // write all queued events and stop the thread
+		void post(const std::shared_ptr<const Sink_event>& event);
+	protected:
+			// Called from the dispatch thread only
+		virtual bool open_sink() { return true; }
+		virtual bool write_event(const Sink_event& event) = 0;
+		virtual void close_sink() {}
+	private:
+		void run(); // main loop of the dispatch thread
+
+		std::string its_name;
+		unsigned long int its_capacity;
+		Overflow_policy its_policy;
+		std::vector<std::shared_ptr<const Sink_event> > its_buffer; // ring buffer
+		unsigned long int its_head; // oldest queued event
+		unsigned long int its_count; // queued events
+		bool its_stop_flag;
+		std::mutex its_mutex;
+		std::condition_variable its_cond;
+		std::thread its_thread;
+		std::atomic_ulong its_posted;
+		std::atomic_ulong its_written;
+		std::atomic_ulong its_dropped;
+		std::atomic_ulong its_coalesced;
+};
+
+/* Text_sink - writes events as lines of text to a file, standard output,
+ * a named pipe or the standard input of an external command
+ * The specification is file:path, pipe:path, cmd:command or stdout,
+ * optionally followed by ,drop_oldest or ,coalesce
+*/
+
+class Text_sink: public Output_sink
+{
+	public:
+		enum class Type { file, pipe, command, stdout_file };
+		Text_sink() = delete;
+		Text_sink(Type type, std::string target, Overflow_policy policy);
+		~Text_sink();
+			// Create a sink from a specification, nullptr on error
+		static Text_sink* create(std::string spec, std::string& error_msg);
+	protected:
+		bool open_sink();
+		bool write_event(const Sink_event& event);
+		void close_sink();
+	private:
+		Type its_type;
+		std::string its_target;
+		int its_fd; // file descriptor written to, -1 if closed
+		std::FILE *its_cmd; // pipe to the external command
+};
+
+/* Sink_hub - the single entry point for events, fans each event out to
+ * all sinks without copying it
+*/
+
+class Sink_hub
+{
+	public:
+		Sink_hub() {}
+		~Sink_hub();
+
+			// Access methods
+		const std::vector<Output_sink *>& get_sinks() const { return its_sinks; }
+
+			// Utility methods
+		void add_sink(Output_sink *sink); // takes ownership, before start()
+		void start();
+		void stop();
+		void post(Sink_event::Kind kind, const std::vector<std::string>& lines);
+		void post(Sink_event::Kind kind, std::string line);
+		void post(Sink_event::Kind kind, std::string line, \
+			const std::shared_ptr<const std::vector<unsigned char> >& data, \
+			std::int64_t stamp_ns = 0);
+		void post(Sink_event::Kind kind, const std::vector<std::string>& lines, \
+			const std::shared_ptr<const std::vector<unsigned char> >& data, \
+			std::int64_t stamp_ns = 0);
+	private:
+		std::vector<Output_sink *> its_sinks;
+};
+
+#endif // #ifndef MWSD_OUTPUT_SINK_HPP
@@ -0,0 +1,203 @@
+/* port_watcher.cpp - implementation of the Port_watcher class, which notices
+ * MIDI ports coming and going.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <cctype>
+#include <chrono>
+#include <memory>
+#include <system_error>
+#include <rtmidi/RtMidi.h>
+#include "port_watcher.hpp"
+
+using std::string;
+using std::vector;
+
+const unsigned int Port_watcher::default_poll_ms;
+
+Port_watcher::Port_watcher(Lister lister, unsigned int poll_ms):
+	its_lister(lister), its_poll_ms(poll_ms), its_stop_flag(false)
+{
+	its_changes.store(0);
+	its_change_ns.store(0);
+	its_scans.store(0);
+	its_scan_ns.store(0);
+	its_failed_scans.store(0);
+	if (its_lister(its_inputs,its_outputs) == false)
+	{
+		its_inputs.clear(); // the first scan of the thread fills them
+		its_outputs.clear();
+	}
+}
+
+Port_watcher::~Port_watcher()
+{
+	stop();
+}
+
+Port_watcher::Lister Port_watcher::rtmidi_lister(const string& client_name)
+{
+	std::shared_ptr<RtMidiIn> midi_in = std::make_shared<RtMidiIn>(RtMidi::Api::UNSPECIFIED,client_name);
+	std::shared_ptr<RtMidiOut> midi_out = std::make_shared<RtMidiOut>(RtMidi::Api::UNSPECIFIED,client_name);
+	return [midi_in,midi_out](vector<string>& inputs, vector<string>& outputs)
+	{
+		inputs.clear();
+		outputs.clear();
+		try
+		{
+			unsigned int port_count = midi_in->getPortCount();
+			for (unsigned int i = 0;i<port_count;i++)
+			{
+				inputs.push_back(midi_in->getPortName(i));
+			}
+			port_count = midi_out->getPortCount();
+			for (unsigned int i = 0;i<port_count;i++)
+			{
+				outputs.push_back(midi_out->getPortName(i));
+			}
+		}
+		catch (RtMidiError&)
+		{
+			// A port went away while listing, the next scan sees them all
+			return false;
+		}
+		return true;
+	};
+}
+
+vector<string> Port_watcher::get_inputs()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	return its_inputs;
+}
+
+vector<string> Port_watcher::get_outputs()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	return its_outputs;
+}
+
+bool Port_watcher::start()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	if (its_thread.joinable())
+	{
+		return true;
+	}
+	its_stop_flag = false;
+	try
+	{
+		its_thread = std::thread(&Port_watcher::run,this);
+	}
+	catch (std::system_error&)
+	{
+		return false; // out of threads or memory, the ports are not watched
+	}
+	return true;
+}
+
+void Port_watcher::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(its_mutex);
+		its_stop_flag = true;
+	}
+	its_cond.notify_one();
+	if (its_thread.joinable())
+	{
+		its_thread.join();
+	}
+}
+
+int Port_watcher::find(const vector<string>& names, const string& wanted)
+{
+	for (unsigned long int i = 0;i<names.size();i++)
+	{
+		if (names[i] == wanted)
+		{
+			return static_cast<int>(i);
+		}
+	}
+	string wanted_base = base_name(wanted);
+	for (unsigned long int i = 0;i<names.size();i++)
+	{
+		if (base_name(names[i]) == wanted_base)
+		{
+			return static_cast<int>(i);
+		}
+	}
+	return -1;
+}
+
+// ALSA port names end in client:port, e.g. "UM-ONE:UM-ONE MIDI 1 24:0"
+string Port_watcher::base_name(const string& name)
+{
+	string::size_type pos = name.size();
+	while ((pos >0) && std::isdigit(static_cast<unsigned char>(name[pos - 1])))
+	{
+		pos--;
+	}
+	if ((pos == name.size()) || (pos == 0) || (name[pos - 1] != ':'))
+	{
+		return name;
+	}
+	pos--;
+	string::size_type colon = pos;
+	while ((pos >0) && std::isdigit(static_cast<unsigned char>(name[pos - 1])))
+	{
+		pos--;
+	}
+	if ((pos == colon) || (pos == 0) || (name[pos - 1] != ' '))
+	{
+		return name;
+	}
+	return name.substr(0,pos - 1);
+}
+
+void Port_watcher::run()
+{
+	vector<string> inputs;
+	vector<string> outputs;
+	std::unique_lock<std::mutex> lock(its_mutex);
+	while (its_stop_flag == false)
+	{
+		its_cond.wait_for(lock,std::chrono::milliseconds(its_poll_ms));
+		if (its_stop_flag == true)
+		{
+			break;
+		}
+		lock.unlock();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bool complete = its_lister(inputs,outputs);
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		its_scans++;
+		its_scan_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+		if (complete == false)
+		{
+			its_failed_scans++;
+		}
+		lock.lock();
+		if ((complete == true) && ((inputs != its_inputs) || (outputs != its_outputs)))
+		{
+			its_inputs.swap(inputs);
+			its_outputs.swap(outputs);
+			its_change_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>( \
+				end.time_since_epoch()).count());
+			its_changes++;
+		}
+	}
+}
@@ -0,0 +1,93 @@
+/* port_watcher.hpp - definition of the Port_watcher class, which notices
+ * MIDI ports coming and going.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_PORT_WATCHER_HPP
+#define MWSD_PORT_WATCHER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Port_watcher - a thread listing the MIDI ports every poll_ms
+ * RtMidi announces no changes, so the names of all input and output
+ * ports are read again and again. That is cheap, a few sequencer queries,
+ * and is done by a client of its own, never touching the open ports.
+ * Every difference to the last list counts as a change, a scan which
+ * failed halfway is skipped and the last lists are kept. The lists are
+ * read with get_inputs and get_outputs. ALSA adds client and port
+ * numbers to a name, which change when a USB interface is plugged in
+ * again, so find also matches a name without them.
+*/
+
+class Port_watcher
+{
+	public:
+			// Names of all ports, inputs into the first, outputs into the
+			// second, false if they could not all be read
+		typedef std::function<bool(std::vector<std::string>& inputs, \
+			std::vector<std::string>& outputs)> Lister;
+
+		static const unsigned int default_poll_ms = 25;
+
+		Port_watcher() = delete;
+		Port_watcher(Lister lister, unsigned int poll_ms = default_poll_ms);
+		~Port_watcher();
+			// Lists with an RtMidi client of its own named client_name
+		static Lister rtmidi_lister(const std::string& client_name);
+
+			// Access methods
+		std::vector<std::string> get_inputs();
+		std::vector<std::string> get_outputs();
+		unsigned long int get_changes() const { return its_changes.load(); }
+		std::int64_t get_change_ns() const { return its_change_ns.load(); } // of the last
+		unsigned long int get_scans() const { return its_scans.load(); }
+		std::int64_t get_scan_ns() const { return its_scan_ns.load(); } // time of the last
+		unsigned long int get_failed_scans() const { return its_failed_scans.load(); }
+
+			// Utility methods
+		bool start(); // false if the thread could not be started
+		void stop();
+			// Index of wanted in names, or of the same name without ALSA
+			// numbers, -1 if neither is there
+		static int find(const std::vector<std::string>& names, const std::string& wanted);
+		static std::string base_name(const std::string& name); // without " 24:0"
+	private:
+		void run(); // main loop of the watching thread
+
+		Lister its_lister;
+		unsigned int its_poll_ms;
+		std::vector<std::string> its_inputs;
+		std::vector<std::string> its_outputs;
+		bool its_stop_flag;
+		std::atomic_ulong its_changes;
+		std::atomic<std::int64_t> its_change_ns;
+		std::atomic_ulong its_scans;
+		std::atomic<std::int64_t> its_scan_ns;
+		std::atomic_ulong its_failed_scans;
+		std::mutex its_mutex;
+		std::condition_variable its_cond; // wakes the thread to stop
+		std::thread its_thread;
+};
+
+#endif // #ifndef MWSD_PORT_WATCHER_HPP
@@ -0,0 +1,153 @@
+/* refresh_trigger.cpp - implementation of the Refresh_trigger class,
+ * which decides when MIDI activity calls for a new display request.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <chrono>
+#include "refresh_trigger.hpp"
+
+const unsigned int Refresh_trigger::default_settle_ms;
+const unsigned int Refresh_trigger::default_max_rate;
+const std::int64_t Refresh_trigger::never;
+
+Refresh_trigger::Refresh_trigger():
+	its_covered(0), its_last_request(0), its_active(false),
+	its_leading_due(false), its_woken(false)
+{
+	its_last_activity.store(0);
+	its_settle_ms.store(default_settle_ms);
+	its_max_rate.store(default_max_rate);
+	its_leading.store(0);
+	its_trailing.store(0);
+	its_armed.store(true);
+}
+
+void Refresh_trigger::set_settle_time(unsigned int settle_ms)
+{
+	its_settle_ms.store(settle_ms);
+}
+
+void Refresh_trigger::set_max_rate(unsigned int per_second)
+{
+	its_max_rate.store((per_second >0) ? per_second : 1);
+}
+
+std::int64_t Refresh_trigger::now_ms()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>( \
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::int64_t Refresh_trigger::min_interval() const
+{
+	return 1000 / its_max_rate.load();
+}
+
+void Refresh_trigger::activity(std::int64_t now)
+{
+	its_last_activity.store(now);
+	// Only the start of a burst wakes the sending thread
+	if (its_armed.exchange(false) == true)
+	{
+		wake();
+	}
+}
+
+bool Refresh_trigger::take(std::int64_t now)
+{
+	if (its_active == false)
+	{
+		// Arm before looking, so no burst start is missed
+		its_armed.store(true);
+	}
+	std::int64_t last = its_last_activity.load();
+	if (last <= its_covered)
+	{
+		if ((its_active == true) && ((now - last) >= its_settle_ms.load()))
+		{
+			its_active = false; // nothing new since the last request
+		}
+		return false;
+	}
+	if (its_active == false)
+	{
+		its_active = true;
+		its_leading_due = true;
+	}
+	if ((now - its_last_request) < min_interval())
+	{
+		return false;
+	}
+	bool settled = ((now - last) >= its_settle_ms.load());
+	if ((its_leading_due == false) && (settled == false))
+	{
+		return false;
+	}
+	if (its_leading_due == true)
+	{
+		its_leading++;
+	}
+	else
+	{
+		its_trailing++;
+	}
+	its_leading_due = false;
+	its_covered = last;
+	its_last_request = now;
+	if (settled == true)
+	{
+		its_active = false;
+	}
+	return true;
+}
+
+std::int64_t Refresh_trigger::next_check(std::int64_t now)
+{
+	std::int64_t last = its_last_activity.load();
+	if (last <= its_covered)
+	{
+		// Still inside a burst, wait for the end of it
+		return (its_active == true) ? (last + its_settle_ms.load()) : never;
+	}
+	std::int64_t due = its_last_request + min_interval();
+	if ((its_active == true) && (its_leading_due == false))
+	{
+		std::int64_t settled = last + its_settle_ms.load();
+		due = (settled > due) ? settled : due;
+	}
+	return (due > now) ? due : now;
+}
+
+void Refresh_trigger::wait(std::int64_t until)
+{
+	std::unique_lock<std::mutex> lock(its_mutex);
+	std::int64_t timeout = until - now_ms();
+	if (timeout >0)
+	{
+		its_cond.wait_for(lock,std::chrono::milliseconds(timeout),[this]() { return its_woken; });
+	}
+	its_woken = false;
+}
+
+void Refresh_trigger::wake()
+{
+	{
+		std::lock_guard<std::mutex> lock(its_mutex);
+		its_woken = true;
+	}
+	its_cond.notify_one();
+}
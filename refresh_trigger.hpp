@@ -0,0 +1,83 @@
+/* refresh_trigger.hpp - definition of the Refresh_trigger class, which
+ * decides when MIDI activity calls for a new display request.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_REFRESH_TRIGGER_HPP
+#define MWSD_REFRESH_TRIGGER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+/* Refresh_trigger - leading and trailing edge debounce of MIDI activity
+ * The first message after a quiet phase makes a request due at once.
+ * While messages keep coming nothing more is due; once they have stopped
+ * for the settle time, one more request catches the final state. Both
+ * edges together never exceed the maximum rate. activity() may be called
+ * from any thread, the rest by the one thread sending the requests.
+ * Times are milliseconds of the steady clock, see now_ms().
+*/
+
+class Refresh_trigger
+{
+	public:
+		static const unsigned int default_settle_ms = 60;
+		static const unsigned int default_max_rate = 10; // requests per second
+		static const std::int64_t never = INT64_MAX;
+
+		Refresh_trigger();
+		~Refresh_trigger() {}
+
+			// Access methods
+		void set_settle_time(unsigned int settle_ms);
+		unsigned int get_settle_time() const { return its_settle_ms.load(); }
+		void set_max_rate(unsigned int per_second);
+		unsigned int get_max_rate() const { return its_max_rate.load(); }
+		unsigned long int get_leading() const { return its_leading.load(); }
+		unsigned long int get_trailing() const { return its_trailing.load(); }
+
+			// Utility methods
+		static std::int64_t now_ms();
+		void activity(std::int64_t now); // a message changed something
+			// True if a request should be sent now, counts it as sent
+		bool take(std::int64_t now);
+			// Earliest time take() may become true, never if no activity
+		std::int64_t next_check(std::int64_t now);
+			// Sleep until then, a new burst of activity or wake()
+		void wait(std::int64_t until);
+		void wake();
+	private:
+		std::int64_t min_interval() const;
+
+		std::atomic<std::int64_t> its_last_activity; // time of the last message
+		std::int64_t its_covered; // last activity seen by a request
+		std::int64_t its_last_request;
+		bool its_active; // inside a burst of activity
+		bool its_leading_due; // burst started, leading request not sent yet
+		std::atomic_uint its_settle_ms;
+		std::atomic_uint its_max_rate;
+		std::atomic_ulong its_leading; // requests sent at the leading edge
+		std::atomic_ulong its_trailing; // requests sent at the trailing edge
+		std::atomic_bool its_armed; // the next activity starts a burst
+		bool its_woken;
+		std::mutex its_mutex;
+		std::condition_variable its_cond;
+};
+
+#endif // #ifndef MWSD_REFRESH_TRIGGER_HPP
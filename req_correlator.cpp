@@ -0,0 +1,532 @@
+/* req_correlator.cpp - implementation of the Req_correlator class, which
+ * matches answers of the synthesizer to outstanding requests.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <limits>
+#include "req_correlator.hpp"
+
+using std::vector;
+using std::uint32_t;
+using std::uint64_t;
+using std::int64_t;
+
+const int Req_pattern::any;
+const uint32_t Req_correlator::none;
+const unsigned int Req_correlator::wheel_levels;
+
+namespace
+{
+	// Wheel geometry: 256 slots of 1 ms, 64 of 256 ms, 64 of 16384 ms
+	const unsigned int level_shift[3] = { 0, 8, 14 };
+	const unsigned int level_slots[3] = { 256, 64, 64 };
+	const int64_t wheel_range = int64_t(1) << 20; // ticks covered
+}
+
+Req_pattern Req_pattern::sysex(unsigned char man_id, unsigned char equip_id, \
+	unsigned char cmd, int dev_id)
+{
+	return Req_pattern { (uint32_t(man_id) << 16) | (uint32_t(equip_id) << 8) | cmd, \
+		dev_id, { 0, 0 }, { any, any } };
+}
+
+Req_pattern Req_pattern::identity(unsigned char man_id, unsigned char equip_id, int dev_id)
+{
+	// F0 7E dev 06 02 man equip ...
+	return Req_pattern { (uint32_t(0x7e) << 16) | (uint32_t(0x06) << 8) | 0x02, \
+		dev_id, { 5, 6 }, { man_id, equip_id } };
+}
+
+Req_correlator::Req_correlator():
+	its_now(0), its_next_id(1), its_pending(0),
+	its_start(std::chrono::steady_clock::now()), its_stop_flag(false)
+{
+	its_answered.store(0);
+	its_timed_out.store(0);
+	for (unsigned int level = 0;level<wheel_levels;level++)
+	{
+		its_slots[level].assign(level_slots[level],none);
+		for (auto& word: its_used[level])
+		{
+			word = 0;
+		}
+	}
+}
+
+Req_correlator::~Req_correlator()
+{
+	stop();
+}
+
+unsigned long int Req_correlator::get_pending()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	return its_pending;
+}
+
+int64_t Req_correlator::get_now()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	return its_now;
+}
+
+int64_t Req_correlator::steady_ms() const
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>( \
+		std::chrono::steady_clock::now() - its_start).count();
+}
+
+void Req_correlator::start()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	if (its_thread.joinable())
+	{
+		return;
+	}
+	its_stop_flag = false;
+	its_now = steady_ms(); // from now on the wheel follows the clock
+	its_thread = std::thread(&Req_correlator::run,this);
+}
+
+void Req_correlator::stop()
+{
+	vector<Fired> fired;
+	{
+		std::lock_guard<std::mutex> lock(its_mutex);
+		its_stop_flag = true;
+	}
+	its_cond.notify_one();
+	if (its_thread.joinable())
+	{
+		its_thread.join();
+	}
+	{
+		std::lock_guard<std::mutex> lock(its_mutex);
+		for (uint32_t i = 0;i<its_requests.size();i++)
+		{
+			if (its_requests[i].id != 0)
+			{
+				fired.push_back(Fired { std::move(its_requests[i].done), Result::cancelled });
+				unlink(i);
+			}
+		}
+	}
+	fire(fired);
+}
+
+bool Req_correlator::message_key(const unsigned char *msg, unsigned long int size, \
+	uint32_t& key, int& dev_id)
+{
+	if ((size <5) || (msg[0] != 0xf0))
+	{
+		return false;
+	}
+	if ((msg[1] == 0x7e) || (msg[1] == 0x7f)) // universal SysEx
+	{
+		key = (uint32_t(msg[1]) << 16) | (uint32_t(msg[3]) << 8) | msg[4];
+		dev_id = msg[2];
+	}
+	else
+	{
+		key = (uint32_t(msg[1]) << 16) | (uint32_t(msg[2]) << 8) | msg[4];
+		dev_id = msg[3];
+	}
+	return true;
+}
+
+// 9 bits per field, 0x100 stands for any
+uint64_t Req_correlator::bucket_key(uint32_t key, int dev_id, int value0, int value1)
+{
+	uint64_t dev = (dev_id == Req_pattern::any) ? 0x100 : (uint64_t(dev_id) & 0xff);
+	uint64_t v0 = (value0 == Req_pattern::any) ? 0x100 : (uint64_t(value0) & 0xff);
+	uint64_t v1 = (value1 == Req_pattern::any) ? 0x100 : (uint64_t(value1) & 0xff);
+	return (uint64_t(key) << 27) | (dev << 18) | (v0 << 9) | v1;
+}
+
+uint64_t Req_correlator::add(const Req_pattern& pattern, unsigned int timeout_ms, Completion done)
+{
+	vector<Fired> fired;
+	uint64_t id = 0;
+	{
+		std::lock_guard<std::mutex> lock(its_mutex);
+		auto key_info = its_keys.find(pattern.key);
+		if (key_info == its_keys.end())
+		{
+			key_info = its_keys.emplace(pattern.key,Key_info { { pattern.check_pos[0], \
+				pattern.check_pos[1] }, 0 }).first;
+		}
+		else if ((key_info->second.check_pos[0] != pattern.check_pos[0]) || \
+			(key_info->second.check_pos[1] != pattern.check_pos[1]))
+		{
+			return 0;
+		}
+		key_info->second.count++;
+		if (its_thread.joinable())
+		{
+			expire(fired,steady_ms()); // the wheel may lag behind the clock
+		}
+
+		uint32_t index = 0;
+		if (its_free.empty())
+		{
+			index = static_cast<uint32_t>(its_requests.size());
+			its_requests.emplace_back();
+		}
+		else
+		{
+			index = its_free.back();
+			its_free.pop_back();
+		}
+		Request& request = its_requests[index];
+		id = (its_next_id++ << 32) | index; // the index makes cancel() cheap
+		request.id = id;
+		request.bucket = bucket_key(pattern.key,pattern.dev_id,pattern.check_value[0], \
+			pattern.check_value[1]);
+		request.deadline = its_now + ((timeout_ms >0) ? timeout_ms : 1);
+		request.done = std::move(done);
+
+		// Append to the FIFO of its bucket
+		Bucket& bucket = its_buckets.emplace(request.bucket,Bucket { none, none }).first->second;
+		request.bucket_prev = bucket.tail;
+		request.bucket_next = none;
+		if (bucket.tail != none)
+		{
+			its_requests[bucket.tail].bucket_next = index;
+		}
+		else
+		{
+			bucket.head = index;
+		}
+		bucket.tail = index;
+
+		wheel_insert(index);
+		its_pending++;
+	}
+	its_cond.notify_one(); // the next deadline may be earlier now
+	fire(fired);
+	return id;
+}
+
+bool Req_correlator::cancel(uint64_t id)
+{
+	vector<Fired> fired;
+	{
+		std::lock_guard<std::mutex> lock(its_mutex);
+		uint32_t index = static_cast<uint32_t>(id & 0xffffffff);
+		if ((id != 0) && (index < its_requests.size()) && (its_requests[index].id == id))
+		{
+			fired.push_back(Fired { std::move(its_requests[index].done), Result::cancelled });
+			unlink(index);
+		}
+	}
+	fire(fired);
+	return (!fired.empty());
+}
+
+bool Req_correlator::accept(const unsigned char *msg, unsigned long int size)
+{
+	const unsigned char *answer = msg;
+	unsigned char fixed[32];
+	if ((size >4) && (size < sizeof(fixed)) && (msg[0] == 0xf0) && (msg[1] == 0x7e) && \
+		(msg[2] == 0x06) && (msg[3] == 0x02))
+	{
+		// Identity reply without device byte, insert 7F
+		fixed[0] = 0xf0;
+		fixed[1] = 0x7e;
+		fixed[2] = 0x7f;
+		for (unsigned long int i = 2;i<size;i++)
+		{
+			fixed[i + 1] = msg[i];
+		}
+		answer = fixed;
+	}
+	unsigned long int answer_size = (answer == fixed) ? (size + 1) : size;
+	uint32_t key = 0;
+	int dev_id = 0;
+	if (message_key(answer,answer_size,key,dev_id) == false)
+	{
+		return false;
+	}
+	Completion done;
+	{
+		std::lock_guard<std::mutex> lock(its_mutex);
+		if (its_pending == 0)
+		{
+			return false;
+		}
+		auto key_info = its_keys.find(key);
+		if (key_info == its_keys.end())
+		{
+			return false;
+		}
+		int values[2] = { Req_pattern::any, Req_pattern::any };
+		const unsigned int *pos = key_info->second.check_pos;
+		if ((pos[0] >0) && (pos[0] < answer_size) && (pos[1] < answer_size))
+		{
+			values[0] = answer[pos[0]];
+			values[1] = answer[pos[1]];
+		}
+		// Most specific pattern first
+		const uint64_t probes[4] = {
+			bucket_key(key,dev_id,values[0],values[1]),
+			bucket_key(key,dev_id,Req_pattern::any,Req_pattern::any),
+			bucket_key(key,Req_pattern::any,values[0],values[1]),
+			bucket_key(key,Req_pattern::any,Req_pattern::any,Req_pattern::any)
+		};
+		uint32_t index = none;
+		for (auto probe: probes)
+		{
+			auto bucket = its_buckets.find(probe);
+			if (bucket != its_buckets.end())
+			{
+				index = bucket->second.head;
+				break;
+			}
+		}
+		if (index == none)
+		{
+			return false;
+		}
+		done = std::move(its_requests[index].done);
+		unlink(index);
+		its_answered++;
+	}
+	if (done)
+	{
+		done(Result::answered,msg,size);
+	}
+	return true;
+}
+
+void Req_correlator::advance(int64_t now_ms)
+{
+	vector<Fired> fired;
+	{
+		std::lock_guard<std::mutex> lock(its_mutex);
+		expire(fired,now_ms);
+	}
+	fire(fired);
+}
+
+void Req_correlator::wheel_insert(uint32_t index)
+{
+	Request& request = its_requests[index];
+	int64_t delta = request.deadline - its_now;
+	unsigned int level = 0;
+	int64_t tick = request.deadline;
+	if (delta >= wheel_range)
+	{
+		// Park it in the last slot of the top level, it is placed again
+		// when that slot comes round
+		level = wheel_levels - 1;
+		tick = its_now - (int64_t(1) << level_shift[level]);
+	}
+	else
+	{
+		while ((level < (wheel_levels - 1)) && \
+			(delta >= (int64_t(level_slots[level]) << level_shift[level])))
+		{
+			level++;
+		}
+	}
+	unsigned int slot = static_cast<unsigned int>(tick >> level_shift[level]) & (level_slots[level] - 1);
+	request.level = level;
+	request.slot = slot;
+	request.slot_prev = none;
+	request.slot_next = its_slots[level][slot];
+	if (request.slot_next != none)
+	{
+		its_requests[request.slot_next].slot_prev = index;
+	}
+	its_slots[level][slot] = index;
+	its_used[level][slot >> 6] |= (uint64_t(1) << (slot & 63));
+}
+
+void Req_correlator::wheel_remove(uint32_t index)
+{
+	Request& request = its_requests[index];
+	if (request.slot_prev != none)
+	{
+		its_requests[request.slot_prev].slot_next = request.slot_next;
+	}
+	else
+	{
+		its_slots[request.level][request.slot] = request.slot_next;
+		if (request.slot_next == none)
+		{
+			its_used[request.level][request.slot >> 6] &= ~(uint64_t(1) << (request.slot & 63));
+		}
+	}
+	if (request.slot_next != none)
+	{
+		its_requests[request.slot_next].slot_prev = request.slot_prev;
+	}
+}
+
+void Req_correlator::unlink(uint32_t index)
+{
+	Request& request = its_requests[index];
+	auto bucket = its_buckets.find(request.bucket);
+	if (request.bucket_prev != none)
+	{
+		its_requests[request.bucket_prev].bucket_next = request.bucket_next;
+	}
+	else
+	{
+		bucket->second.head = request.bucket_next;
+	}
+	if (request.bucket_next != none)
+	{
+		its_requests[request.bucket_next].bucket_prev = request.bucket_prev;
+	}
+	else
+	{
+		bucket->second.tail = request.bucket_prev;
+	}
+	if (bucket->second.head == none)
+	{
+		its_buckets.erase(bucket);
+	}
+	auto key_info = its_keys.find(static_cast<uint32_t>(request.bucket >> 27));
+	if ((key_info != its_keys.end()) && (--key_info->second.count == 0))
+	{
+		its_keys.erase(key_info);
+	}
+	wheel_remove(index);
+	request.id = 0;
+	request.done = nullptr;
+	its_free.push_back(index);
+	its_pending--;
+}
+
+// Tick of the next non-empty 1 ms slot, or of the next cascade
+int64_t Req_correlator::next_event()
+{
+	if (its_pending == 0)
+	{
+		return std::numeric_limits<int64_t>::max();
+	}
+	int64_t boundary = (its_now | 255) + 1;
+	unsigned int first = static_cast<unsigned int>((its_now + 1) & 255);
+	if (first == 0)
+	{
+		return boundary;
+	}
+	for (unsigned int word = first >> 6;word<4;word++)
+	{
+		uint64_t bits = its_used[0][word];
+		if (word == (first >> 6))
+		{
+			bits &= ~uint64_t(0) << (first & 63);
+		}
+		if (bits != 0)
+		{
+			unsigned int slot = (word << 6) + static_cast<unsigned int>(__builtin_ctzll(bits));
+			return (its_now & ~int64_t(255)) + slot;
+		}
+	}
+	return boundary;
+}
+
+// Move the wheel to now_ms, collect all requests due. Requires its_mutex.
+void Req_correlator::expire(vector<Fired>& fired, int64_t now_ms)
+{
+	while (its_now < now_ms)
+	{
+		int64_t next = next_event();
+		if (next > now_ms)
+		{
+			its_now = now_ms;
+			break;
+		}
+		its_now = next;
+		if ((its_now & 255) == 0)
+		{
+			// Hand the due slots of the upper levels down
+			for (unsigned int level = wheel_levels - 1;level>0;level--)
+			{
+				int64_t mask = (int64_t(1) << level_shift[level]) - 1;
+				if ((its_now & mask) != 0)
+				{
+					continue;
+				}
+				unsigned int slot = static_cast<unsigned int>(its_now >> level_shift[level]) & \
+					(level_slots[level] - 1);
+				uint32_t index = its_slots[level][slot];
+				its_slots[level][slot] = none;
+				its_used[level][slot >> 6] &= ~(uint64_t(1) << (slot & 63));
+				while (index != none)
+				{
+					uint32_t next_index = its_requests[index].slot_next;
+					wheel_insert(index);
+					index = next_index;
+				}
+			}
+		}
+		unsigned int slot = static_cast<unsigned int>(its_now & 255);
+		uint32_t index = its_slots[0][slot];
+		while (index != none)
+		{
+			uint32_t next_index = its_requests[index].slot_next;
+			fired.push_back(Fired { std::move(its_requests[index].done), Result::timed_out });
+			unlink(index);
+			its_timed_out++;
+			index = next_index;
+		}
+	}
+}
+
+void Req_correlator::fire(vector<Fired>& fired)
+{
+	for (auto& entry: fired)
+	{
+		if (entry.done)
+		{
+			entry.done(entry.result,nullptr,0);
+		}
+	}
+}
+
+void Req_correlator::run()
+{
+	vector<Fired> fired;
+	std::unique_lock<std::mutex> lock(its_mutex);
+	while (its_stop_flag == false)
+	{
+		int64_t next = next_event();
+		if (next == std::numeric_limits<int64_t>::max())
+		{
+			its_cond.wait(lock);
+		}
+		else
+		{
+			its_cond.wait_until(lock,its_start + std::chrono::milliseconds(next));
+		}
+		if (its_stop_flag == true)
+		{
+			break;
+		}
+		expire(fired,steady_ms());
+		if (!fired.empty())
+		{
+			lock.unlock();
+			fire(fired);
+			fired.clear();
+			lock.lock();
+		}
+	}
+}
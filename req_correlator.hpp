@@ -0,0 +1,157 @@
+/* req_correlator.hpp - definition of the Req_correlator class, which
+ * matches answers of the synthesizer to outstanding requests.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_REQ_CORRELATOR_HPP
+#define MWSD_REQ_CORRELATOR_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/* Req_pattern - what the answer to a request looks like
+ * key identifies the SysEx message type, see Req_correlator::message_key.
+ * The device ID and two further bytes (e.g. bank and patch) can be
+ * required or left open with Req_pattern::any. All requests with the same
+ * key must use the same check positions.
+*/
+
+struct Req_pattern
+{
+	static const int any = -1;
+
+	std::uint32_t key;
+	int dev_id;
+	unsigned int check_pos[2]; // byte positions in the answer
+	int check_value[2]; // both any or both given
+
+		// Answer to a Waldorf style request: F0 man equip dev cmd ...
+	static Req_pattern sysex(unsigned char man_id, unsigned char equip_id, \
+		unsigned char cmd, int dev_id = any);
+		// Answer to a universal identity request from man_id/equip_id
+	static Req_pattern identity(unsigned char man_id, unsigned char equip_id, \
+		int dev_id = any);
+};
+
+/* Req_correlator - outstanding requests, their answers and timeouts
+ * Answers are found with at most four hash lookups. Deadlines live in a
+ * hierarchical timer wheel (1 ms, 256 ms and 16.4 s slots), which the
+ * timer thread advances exactly when the next deadline is due. Without
+ * start() there is no thread and advance() has to be called instead,
+ * e.g. for a simulated clock. Completions are called without any lock
+ * held, from the thread calling accept() or from the timer thread.
+*/
+
+class Req_correlator
+{
+	public:
+		enum class Result { answered, timed_out, cancelled };
+		typedef std::function<void(Result result, const unsigned char *msg, \
+			unsigned long int size)> Completion;
+
+		Req_correlator();
+		~Req_correlator();
+
+			// Access methods
+		unsigned long int get_pending();
+		unsigned long int get_answered() const { return its_answered.load(); }
+		unsigned long int get_timed_out() const { return its_timed_out.load(); }
+		std::int64_t get_now(); // current tick in milliseconds
+
+			// Utility methods
+		void start(); // run the timer thread
+		void stop(); // stop the timer thread, cancel all requests
+			// Register a request, returns its ID for cancel() or 0 if the
+			// check positions differ from other requests with the same key
+		std::uint64_t add(const Req_pattern& pattern, unsigned int timeout_ms, Completion done);
+		bool cancel(std::uint64_t id);
+			// Complete the oldest matching request, true if there was one
+		bool accept(const unsigned char *msg, unsigned long int size);
+			// Fire all timeouts up to tick now_ms
+		void advance(std::int64_t now_ms);
+
+			// Key of a SysEx message: universal messages (F0 7E/7F dev a b)
+			// give 7E/7F, a, b; others (F0 man equip dev cmd) man, equip, cmd.
+			// Identity replies without the device byte (F0 7E 06 02 ..., as
+			// sent by the Microwave II/XT) are read as if it were 7F.
+		static bool message_key(const unsigned char *msg, unsigned long int size, \
+			std::uint32_t& key, int& dev_id);
+	private:
+		static const std::uint32_t none = 0xffffffff;
+		static const unsigned int wheel_levels = 3;
+
+		struct Request
+		{
+			std::uint64_t id; // 0 while free
+			std::uint64_t bucket; // match bucket
+			std::int64_t deadline; // tick
+			Completion done;
+			std::uint32_t bucket_prev, bucket_next; // FIFO of the bucket
+			std::uint32_t slot_prev, slot_next; // list of the wheel slot
+			unsigned int level, slot;
+		};
+		struct Bucket
+		{
+			std::uint32_t head, tail;
+		};
+		struct Key_info
+		{
+			unsigned int check_pos[2];
+			unsigned long int count; // requests using this key
+		};
+		struct Fired
+		{
+			Completion done;
+			Result result;
+		};
+
+		static std::uint64_t bucket_key(std::uint32_t key, int dev_id, int value0, int value1);
+		std::int64_t steady_ms() const;
+		void run(); // main loop of the timer thread
+		std::int64_t next_event(); // tick of the next possible timeout
+		void wheel_insert(std::uint32_t index);
+		void wheel_remove(std::uint32_t index);
+		void unlink(std::uint32_t index); // from bucket and wheel, free it
+		void expire(std::vector<Fired>& fired, std::int64_t now_ms);
+		void fire(std::vector<Fired>& fired);
+
+		std::vector<Request> its_requests; // slab, indices are stable
+		std::vector<std::uint32_t> its_free; // free request indices
+		std::unordered_map<std::uint64_t, Bucket> its_buckets;
+		std::unordered_map<std::uint32_t, Key_info> its_keys;
+		std::vector<std::uint32_t> its_slots[wheel_levels]; // list heads
+		std::uint64_t its_used[wheel_levels][4]; // bitmaps of non-empty slots
+		std::int64_t its_now; // tick of the wheel
+		std::uint64_t its_next_id;
+		unsigned long int its_pending;
+		std::atomic_ulong its_answered;
+		std::atomic_ulong its_timed_out;
+		std::chrono::steady_clock::time_point its_start;
+		bool its_stop_flag;
+		std::mutex its_mutex;
+		std::condition_variable its_cond;
+		std::thread its_thread;
+};
+
+#endif // #ifndef MWSD_REQ_CORRELATOR_HPP
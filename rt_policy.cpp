@@ -0,0 +1,221 @@
+/* rt_policy.cpp - implementation of the Rt_policy class, which gives the MIDI
+ * threads real-time priority and keeps memory from being paged out.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include "rt_policy.hpp"
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+const int Rt_policy::default_priority;
+const std::size_t Rt_policy::reserve_bytes;
+const unsigned int Rt_policy::cap_ipc_lock;
+
+Rt_policy::Rt_policy():
+	its_enabled(false), its_policy(SCHED_FIFO), its_priority(default_priority),
+	its_cpu(-1), its_error_msg("")
+{
+	its_failures.store(0);
+}
+
+bool Rt_policy::set_policy(string name)
+{
+	if (name == "fifo")
+	{
+		its_enabled = true;
+		its_policy = SCHED_FIFO;
+	}
+	else if (name == "rr")
+	{
+		its_enabled = true;
+		its_policy = SCHED_RR;
+	}
+	else if (name == "off")
+	{
+		its_enabled = false;
+	}
+	else
+	{
+		its_error_msg = string("Unknown real-time policy ") + name + string(", use fifo, rr or off.");
+		return false;
+	}
+	return true;
+}
+
+string Rt_policy::get_policy_name() const
+{
+	if (its_enabled == false)
+	{
+		return string("off");
+	}
+	return (its_policy == SCHED_RR) ? string("rr") : string("fifo");
+}
+
+vector<string> Rt_policy::get_report()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	return its_report;
+}
+
+bool Rt_policy::lock_memory()
+{
+	// Pages mapped later count against a finite memlock limit, thread
+	// stacks among them, so threads could not be started any more once it
+	// is used up. Without a limit they are locked as they come.
+	bool future = unlimited_lock();
+	if (mlockall((future == true) ? (MCL_CURRENT | MCL_FUTURE) : MCL_CURRENT) <0)
+	{
+		int error = errno;
+		record(string("Memory"),string("Memory: not locked, ") + string(std::strerror(error)) + \
+			string(" (needs a higher memlock limit)"),false);
+		return false;
+	}
+#ifdef __GLIBC__
+	// Freed memory stays in the heap instead of going back to the kernel
+	mallopt(M_TRIM_THRESHOLD,-1);
+	mallopt(M_MMAP_MAX,0);
+#endif
+	// Touch every page of the reserve, so it is mapped and locked now
+	char *reserve = static_cast<char *>(std::malloc(reserve_bytes));
+	if (reserve != nullptr)
+	{
+		long int page_size = sysconf(_SC_PAGESIZE);
+		for (std::size_t i = 0;i<reserve_bytes;i += static_cast<std::size_t>(page_size))
+		{
+			reserve[i] = 0;
+		}
+		std::free(reserve);
+	}
+	string line = string("Memory: locked, ") + to_string(reserve_bytes / (1024 * 1024)) + \
+		string(" MB heap reserved");
+	if (future == false)
+	{
+		// The reserve was mapped after the lock
+		if (mlockall(MCL_CURRENT) <0)
+		{
+			line = string("Memory: locked, no heap reserve (needs a higher memlock limit)");
+		}
+		line += string(", new thread stacks not locked (memlock limit)");
+	}
+	record(string("Memory"),line,true);
+	return true;
+}
+
+// No memlock limit applies, either none is set or CAP_IPC_LOCK lifts it
+bool Rt_policy::unlimited_lock()
+{
+	struct rlimit limit;
+	if ((getrlimit(RLIMIT_MEMLOCK,&limit) == 0) && (limit.rlim_cur == RLIM_INFINITY))
+	{
+		return true;
+	}
+#ifdef __linux__
+	std::ifstream status("/proc/self/status");
+	string line;
+	while (std::getline(status,line))
+	{
+		if (line.compare(0,7,"CapEff:") == 0)
+		{
+			unsigned long long int caps = std::strtoull(line.c_str() + 7,nullptr,16);
+			return ((caps >> cap_ipc_lock) & 1) == 1;
+		}
+	}
+#endif
+	return false;
+}
+
+bool Rt_policy::enter(const string& thread_name)
+{
+	bool ok = true;
+	string line = thread_name + string(": ");
+	sched_param param;
+	std::memset(&param,0,sizeof(param));
+	param.sched_priority = its_priority;
+	int error = pthread_setschedparam(pthread_self(),its_policy,&param);
+	if (error == 0)
+	{
+		line += ((its_policy == SCHED_RR) ? string("SCHED_RR") : string("SCHED_FIFO")) + \
+			string(" priority ") + to_string(its_priority);
+	}
+	else
+	{
+		ok = false;
+		line += string("no real-time priority, ") + string(std::strerror(error));
+		if (error == EPERM)
+		{
+			line += string(" (needs CAP_SYS_NICE or an rtprio limit)");
+		}
+	}
+	if (its_cpu >= 0)
+	{
+#ifdef __linux__
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(its_cpu,&cpus);
+		error = pthread_setaffinity_np(pthread_self(),sizeof(cpus),&cpus);
+		if (error == 0)
+		{
+			line += string(", CPU ") + to_string(its_cpu);
+		}
+		else
+		{
+			ok = false;
+			line += string(", not bound to CPU ") + to_string(its_cpu) + string(", ") + \
+				string(std::strerror(error));
+		}
+#else
+		ok = false;
+		line += string(", CPU affinity is only supported on Linux");
+#endif
+	}
+	record(thread_name,line,ok);
+	return ok;
+}
+
+// Replace the line of name, a thread may enter again, e.g. a new MIDI port
+void Rt_policy::record(const string& name, const string& line, bool ok)
+{
+	if (ok == false)
+	{
+		its_failures++;
+	}
+	std::lock_guard<std::mutex> lock(its_mutex);
+	for (std::size_t i = 0;i<its_names.size();i++)
+	{
+		if (its_names[i] == name)
+		{
+			its_report[i] = line;
+			return;
+		}
+	}
+	its_names.push_back(name);
+	its_report.push_back(line);
+}
@@ -0,0 +1,81 @@
+/* rt_policy.hpp - definition of the Rt_policy class, which gives the MIDI
+ * threads real-time priority and keeps memory from being paged out.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_RT_POLICY_HPP
+#define MWSD_RT_POLICY_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* Rt_policy - opt-in real-time mode for the threads handling MIDI
+ * Each such thread calls enter once it runs, which sets its scheduling
+ * policy (SCHED_FIFO or SCHED_RR) and priority and, on Linux, binds it to
+ * one CPU. lock_memory locks all pages of the process with mlockall and
+ * grows the heap by reserve_bytes, which is kept, so later allocations on
+ * the hot path neither page-fault nor call the kernel. Pages mapped later
+ * are only locked without a memlock limit, under one they would use it up
+ * and keep new threads from starting. Nothing is fatal: without the
+ * permission (CAP_SYS_NICE, an rtprio or memlock limit) the program runs
+ * as before and the outcome of each step is reported.
+*/
+
+class Rt_policy
+{
+	public:
+		static const int default_priority = 40; // below audio servers and IRQs
+		static const std::size_t reserve_bytes = 8 * 1024 * 1024;
+
+		Rt_policy();
+
+			// Access methods
+		bool set_policy(std::string name); // fifo, rr or off
+		void set_priority(int priority) { its_priority = priority; } // 1-99
+		void set_cpu(int cpu) { its_cpu = cpu; } // -1 for any
+		bool get_enabled() const { return its_enabled; }
+		std::string get_policy_name() const;
+		int get_priority() const { return its_priority; }
+		int get_cpu() const { return its_cpu; }
+		unsigned long int get_failures() const { return its_failures.load(); }
+		std::vector<std::string> get_report(); // one line per thread and memory
+		std::string get_error_msg() const { return its_error_msg; }
+
+			// Utility methods
+		bool lock_memory(); // once, before the threads start
+		bool enter(const std::string& thread_name); // from the thread itself
+	private:
+		static const unsigned int cap_ipc_lock = 14; // bit in CapEff, see capabilities(7)
+
+		static bool unlimited_lock();
+		void record(const std::string& name, const std::string& line, bool ok);
+
+		bool its_enabled;
+		int its_policy; // SCHED_FIFO or SCHED_RR
+		int its_priority;
+		int its_cpu;
+		std::string its_error_msg;
+		std::atomic_ulong its_failures;
+		std::vector<std::string> its_names; // of the lines in its_report
+		std::vector<std::string> its_report;
+		std::mutex its_mutex;
+};
+
+#endif // #ifndef MWSD_RT_POLICY_HPP
@@ -0,0 +1,191 @@
+/* screen_compositor.cpp - implementation of the Screen_compositor class,
+ * the only thread writing to the terminal.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <unistd.h>
+#include "screen_compositor.hpp"
+
+using std::chrono::steady_clock;
+
+const unsigned int Screen_compositor::default_fps;
+
+Screen_compositor::Screen_compositor():
+	its_backend(Screen_backend::curses), its_ansi(nullptr),
+	its_frame_time(std::chrono::microseconds(1000000 / default_fps)),
+	its_oldest_stamp(0), its_stop_flag(false)
+{
+	its_frames.store(0);
+	its_damages.store(0);
+	its_damaged.reserve(8);
+}
+
+Screen_compositor::~Screen_compositor()
+{
+	stop();
+	delete its_ansi;
+}
+
+void Screen_compositor::set_max_fps(unsigned int fps)
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	its_frame_time = std::chrono::microseconds(1000000 / ((fps >0) ? fps : 1));
+}
+
+void Screen_compositor::start()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	if (its_thread.joinable())
+	{
+		return;
+	}
+	its_stop_flag = false;
+	if ((its_backend == Screen_backend::ansi) && (its_ansi == nullptr))
+	{
+		its_ansi = new Ansi_screen(STDOUT_FILENO,LINES,COLS); // clears first
+	}
+	its_thread = std::thread(&Screen_compositor::run,this);
+}
+
+void Screen_compositor::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(its_mutex);
+		its_stop_flag = true;
+	}
+	its_cond.notify_one();
+	if (its_thread.joinable())
+	{
+		its_thread.join();
+	}
+}
+
+unsigned long int Screen_compositor::get_bytes()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	return (its_ansi != nullptr) ? its_ansi->get_bytes() : 0;
+}
+
+unsigned long int Screen_compositor::get_writes()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	return (its_ansi != nullptr) ? its_ansi->get_writes() : 0;
+}
+
+// Move win to the end of the list, requires its_mutex
+void Screen_compositor::mark(WINDOW *win)
+{
+	bool was_idle = its_damaged.empty();
+	for (auto i = its_damaged.begin();i != its_damaged.end();i++)
+	{
+		if (*i == win)
+		{
+			its_damaged.erase(i);
+			break;
+		}
+	}
+	its_damaged.push_back(win);
+	its_damages++;
+	if (was_idle == true)
+	{
+		its_cond.notify_one();
+	}
+}
+
+void Screen_compositor::damage(WINDOW *win, std::int64_t stamp_ns)
+{
+	if ((stamp_ns != 0) && ((its_oldest_stamp == 0) || (stamp_ns < its_oldest_stamp)))
+	{
+		its_oldest_stamp = stamp_ns;
+	}
+	mark(win);
+}
+
+void Screen_compositor::refresh(WINDOW *win)
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	// Change marks may have been lost while a frame was copied
+	touchwin(win);
+	mark(win);
+}
+
+void Screen_compositor::forget(WINDOW *win)
+{
+	for (auto i = its_damaged.begin();i != its_damaged.end();i++)
+	{
+		if (*i == win)
+		{
+			its_damaged.erase(i);
+			break;
+		}
+	}
+}
+
+int Screen_compositor::read_key()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	return getch();
+}
+
+void Screen_compositor::bell()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	beep();
+}
+
+void Screen_compositor::run()
+{
+	std::unique_lock<std::mutex> lock(its_mutex);
+	steady_clock::time_point next_frame = steady_clock::now();
+	while (true)
+	{
+		its_cond.wait(lock,[this]() { return ((its_stop_flag == true) || (!its_damaged.empty())); });
+		if (its_damaged.empty())
+		{
+			break; // stopped and nothing left to draw
+		}
+		// Damage arriving until the next frame is drawn with it
+		if (its_stop_flag == false)
+		{
+			its_cond.wait_until(lock,next_frame,[this]() { return its_stop_flag; });
+		}
+		if (its_ansi != nullptr)
+		{
+			for (auto win: its_damaged)
+			{
+				its_ansi->copy(win);
+			}
+			its_ansi->flush();
+		}
+		else
+		{
+			for (auto win: its_damaged)
+			{
+				wnoutrefresh(win);
+			}
+			doupdate();
+		}
+		its_damaged.clear();
+		its_frames++;
+		if (its_oldest_stamp != 0)
+		{
+			its_latency.add(Latency_stats::now_ns() - its_oldest_stamp);
+			its_oldest_stamp = 0;
+		}
+		next_frame = steady_clock::now() + its_frame_time;
+	}
+}
@@ -0,0 +1,97 @@
+/* screen_compositor.hpp - definition of the Screen_compositor class, the
+ * only thread writing to the terminal.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_SCREEN_COMPOSITOR_HPP
+#define MWSD_SCREEN_COMPOSITOR_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <ncurses.h>
+#include "ansi_screen.hpp"
+#include "latency_stats.hpp"
+
+// How frames get to the terminal
+enum class Screen_backend { curses, ansi };
+
+/* Screen_compositor - one thread owns all terminal output
+ * Other threads draw into their windows and mark them damaged instead of
+ * calling wrefresh. At most max_fps times per second the compositor thread
+ * copies all damaged windows with wnoutrefresh and writes the result with a
+ * single doupdate. The window marked last gets the cursor, as with wrefresh.
+ * Windows drawn by more than one thread are drawn with the mutex held and
+ * marked with damage(). A window drawn by one thread only may be drawn
+ * without it and is handed over with refresh(), which copies all of it at
+ * the next frame. Keyboard input and the bell go through the compositor
+ * as well, since they use the same terminal state. With the ansi backend
+ * an Ansi_screen takes the place of wnoutrefresh and doupdate.
+*/
+
+class Screen_compositor
+{
+	public:
+		static const unsigned int default_fps = 25;
+
+		Screen_compositor();
+		~Screen_compositor();
+
+			// Access methods
+		void set_max_fps(unsigned int fps);
+		void set_backend(Screen_backend backend) { its_backend = backend; } // before start
+		Screen_backend get_backend() const { return its_backend; }
+		std::mutex& get_mutex() { return its_mutex; } // lock to draw shared windows
+		unsigned long int get_frames() const { return its_frames.load(); }
+		unsigned long int get_damages() const { return its_damages.load(); }
+		unsigned long int get_bytes(); // written by the ansi backend
+		unsigned long int get_writes(); // calls of write() by the ansi backend
+			// From the arrival of MIDI input to the frame showing it
+		const Latency_stats& get_latency() const { return its_latency; }
+
+			// Utility methods
+		void start(); // after initscr
+		void stop(); // draws what is pending, call before endwin
+			// The mutex must be held. stamp_ns is the arrival of the MIDI
+			// input drawn, if any.
+		void damage(WINDOW *win, std::int64_t stamp_ns = 0);
+		void refresh(WINDOW *win); // takes the mutex
+		void forget(WINDOW *win); // before delwin, the mutex must be held
+		int read_key(); // getch
+		void bell(); // beep
+	private:
+		void run(); // main loop of the compositor thread
+		void mark(WINDOW *win);
+
+		std::vector<WINDOW *> its_damaged; // in order of their last damage
+		Screen_backend its_backend;
+		Ansi_screen *its_ansi; // only with the ansi backend
+		std::chrono::steady_clock::duration its_frame_time;
+		std::atomic_ulong its_frames; // calls of doupdate
+		std::atomic_ulong its_damages; // windows marked
+		std::int64_t its_oldest_stamp; // of the input drawn since the last frame
+		Latency_stats its_latency;
+		bool its_stop_flag;
+		std::mutex its_mutex;
+		std::condition_variable its_cond;
+		std::thread its_thread;
+};
+
+#endif // #ifndef MWSD_SCREEN_COMPOSITOR_HPP
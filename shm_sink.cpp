@@ -0,0 +1,132 @@
+/* shm_sink.cpp - implementation of the Shm_sink class, publishing the
+ * display into a shared-memory segment.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include "shm_sink.hpp"
+
+using std::string;
+using std::uint32_t;
+
+Shm_sink::Shm_sink(string name, Synth_info *synth_info, Mwsd_shm_layout *layout):
+	Output_sink(string("shm:") + name,16,Overflow_policy::coalesce),
+	its_shm_name(name), its_synth_info(synth_info), its_layout(layout)
+{
+	std::memset(&its_shadow,0,sizeof(its_shadow));
+	its_shadow.magic = mwsd_shm_magic;
+	its_shadow.version = mwsd_shm_version;
+	its_shadow.dev_id = its_synth_info->get_dev_id();
+	its_layout->seq.store(0,std::memory_order_relaxed);
+	std::memcpy(&its_layout->data,&its_shadow,sizeof(its_shadow));
+	its_layout->seq.store(2,std::memory_order_release);
+}
+
+Shm_sink::~Shm_sink()
+{
+	stop(); // the dispatch thread calls write_event
+	munmap(its_layout,sizeof(Mwsd_shm_layout));
+	shm_unlink(its_shm_name.c_str());
+}
+
+Shm_sink* Shm_sink::create(string name, Synth_info *synth_info, string& error_msg)
+{
+	if ((name.size() <2) || (name[0] != '/') || (name.find('/',1) != string::npos))
+	{
+		error_msg = string("Shared memory names look like /name, not ") + name;
+		return nullptr;
+	}
+	int fd = shm_open(name.c_str(),O_CREAT | O_RDWR,0644);
+	if (fd <0)
+	{
+		error_msg = string("Cannot create shared memory ") + name + string(": ") + \
+			string(std::strerror(errno));
+		return nullptr;
+	}
+	void *address = MAP_FAILED;
+	if (ftruncate(fd,sizeof(Mwsd_shm_layout)) == 0)
+	{
+		address = mmap(nullptr,sizeof(Mwsd_shm_layout),PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+	}
+	if (address == MAP_FAILED)
+	{
+		error_msg = string("Cannot map shared memory ") + name + string(": ") + \
+			string(std::strerror(errno));
+		close(fd);
+		shm_unlink(name.c_str());
+		return nullptr;
+	}
+	close(fd);
+	return new Shm_sink(name,synth_info,static_cast<Mwsd_shm_layout *>(address));
+}
+
+// Copy a line into a fixed field, cut and zero terminated
+void Shm_sink::copy_line(char *target, unsigned long int size, const string& line)
+{
+	unsigned long int length = (line.size() < size) ? line.size() : (size - 1);
+	std::memcpy(target,line.data(),length);
+	std::memset(target + length,0,size - length);
+}
+
+bool Shm_sink::write_event(const Sink_event& event)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	switch(event.kind)
+	{
+		case Sink_event::Kind::display:
+		{
+			unsigned long int rows = (event.lines.size() <4) ? event.lines.size() : 4;
+			for (unsigned long int i = 0;i<4;i++)
+			{
+				copy_line(its_shadow.display[i],sizeof(its_shadow.display[i]), \
+					(i < rows) ? event.lines[i] : string());
+			}
+			its_shadow.rows = static_cast<uint32_t>(rows);
+			its_shadow.frames++;
+			break;
+		}
+		case Sink_event::Kind::midi:
+		{
+			copy_line(its_shadow.midi,sizeof(its_shadow.midi), \
+				event.lines.empty() ? string() : event.lines[0]);
+			its_shadow.midi_events++;
+			break;
+		}
+		case Sink_event::Kind::status:
+		{
+			copy_line(its_shadow.mode,sizeof(its_shadow.mode), \
+				event.lines.empty() ? string() : event.lines[0]);
+			its_shadow.status_changes++;
+			break;
+		}
+	}
+	its_shadow.dev_id = its_synth_info->get_dev_id();
+	its_shadow.time_ms = event.time_ms;
+
+	// Seqlock: odd while the data is inconsistent
+	uint32_t seq = its_layout->seq.load(std::memory_order_relaxed);
+	its_layout->seq.store(seq + 1,std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(&its_layout->data,&its_shadow,sizeof(its_shadow));
+	its_layout->seq.store(seq + 2,std::memory_order_release);
+
+	its_shadow.publish_ns = std::chrono::duration_cast<std::chrono::nanoseconds>( \
+		std::chrono::steady_clock::now() - start).count(); // shown with the next update
+	return true;
+}
@@ -0,0 +1,51 @@
+/* shm_sink.hpp - definition of the Shm_sink class, publishing the display
+ * into a shared-memory segment.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_SHM_SINK_HPP
+#define MWSD_SHM_SINK_HPP
+
+#include <string>
+#include "output_sink.hpp"
+#include "synth_info.hpp"
+#include "mwsd_shm.hpp"
+
+/* Shm_sink - the writer side of the seqlock in mwsd_shm.hpp
+ * Only the latest state matters to readers, so events are coalesced.
+*/
+
+class Shm_sink: public Output_sink
+{
+	public:
+		Shm_sink() = delete;
+		~Shm_sink();
+			// Create the segment name (e.g. /mwsd), nullptr on error
+		static Shm_sink* create(std::string name, Synth_info *synth_info, std::string& error_msg);
+	protected:
+		bool write_event(const Sink_event& event);
+	private:
+		Shm_sink(std::string name, Synth_info *synth_info, Mwsd_shm_layout *layout);
+		static void copy_line(char *target, unsigned long int size, const std::string& line);
+
+		std::string its_shm_name;
+		Synth_info *its_synth_info;
+		Mwsd_shm_layout *its_layout; // the mapped segment
+		Mwsd_shm_data its_shadow; // prepared here, copied in one go
+};
+
+#endif // #ifndef MWSD_SHM_SINK_HPP
@@ -0,0 +1,410 @@
+/* socket_sink.cpp - implementation of the Socket_sink class, a local
+ * socket server streaming events to any number of clients.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "config.h"
+#include "socket_sink.hpp"
+
+using std::string;
+using std::vector;
+
+const unsigned long int Socket_sink::max_clients = 256;
+const unsigned long int Socket_sink::max_backlog = 65536;
+
+Socket_sink::Socket_sink(string path, int listen_fd):
+	Output_sink(string("socket:") + path,256,Overflow_policy::drop_oldest),
+	its_path(path), its_listen_fd(listen_fd)
+{
+	its_wake_fd[0] = -1;
+	its_wake_fd[1] = -1;
+	if (pipe(its_wake_fd) == 0)
+	{
+		fcntl(its_wake_fd[0],F_SETFL,O_NONBLOCK);
+	}
+	its_frame.reserve(1024);
+}
+
+Socket_sink::~Socket_sink()
+{
+	stop(); // the dispatch thread calls our virtual methods
+	close(its_listen_fd);
+	unlink(its_path.c_str());
+	close(its_wake_fd[0]);
+	close(its_wake_fd[1]);
+}
+
+Socket_sink* Socket_sink::create(string path, string& error_msg)
+{
+	struct sockaddr_un address;
+	if (path.size() >= sizeof(address.sun_path))
+	{
+		error_msg = string("Socket path too long: ") + path;
+		return nullptr;
+	}
+	int fd = socket(AF_UNIX,SOCK_STREAM,0);
+	if (fd <0)
+	{
+		error_msg = string("Cannot create socket: ") + string(std::strerror(errno));
+		return nullptr;
+	}
+	std::memset(&address,0,sizeof(address));
+	address.sun_family = AF_UNIX;
+	std::strncpy(address.sun_path,path.c_str(),sizeof(address.sun_path) - 1);
+	unlink(path.c_str()); // left behind by an earlier run
+	if ((bind(fd,reinterpret_cast<struct sockaddr *>(&address),sizeof(address)) <0) || \
+		(listen(fd,16) <0))
+	{
+		error_msg = string("Cannot listen on ") + path + string(": ") + \
+			string(std::strerror(errno));
+		close(fd);
+		return nullptr;
+	}
+	fcntl(fd,F_SETFL,O_NONBLOCK);
+	return new Socket_sink(path,fd);
+}
+
+unsigned long int Socket_sink::get_clients()
+{
+	std::lock_guard<std::mutex> lock(its_client_mutex);
+	return its_clients.size();
+}
+
+bool Socket_sink::take_command(string& command)
+{
+	std::lock_guard<std::mutex> lock(its_cmd_mutex);
+	if (its_commands.empty())
+	{
+		return false;
+	}
+	command = its_commands.front();
+	its_commands.pop_front();
+	return true;
+}
+
+bool Socket_sink::open_sink()
+{
+	if (!its_server.joinable())
+	{
+		its_server = std::thread(&Socket_sink::serve,this);
+	}
+	return true;
+}
+
+void Socket_sink::close_sink()
+{
+	if (its_server.joinable())
+	{
+		char byte = 0;
+		while ((write(its_wake_fd[1],&byte,1) <0) && (errno == EINTR));
+		its_server.join();
+	}
+	std::lock_guard<std::mutex> lock(its_client_mutex);
+	for (auto& client: its_clients)
+	{
+		close(client.fd);
+	}
+	its_clients.clear();
+}
+
+// Encode the event once, then hand the same buffer to every client
+bool Socket_sink::write_event(const Sink_event& event)
+{
+	its_frame.clear();
+	switch(event.kind)
+	{
+		case Sink_event::Kind::display:
+		{
+			its_frame += "display ";
+			break;
+		}
+		case Sink_event::Kind::midi:
+		{
+			its_frame += "midi ";
+			break;
+		}
+		case Sink_event::Kind::status:
+		{
+			its_frame += "status ";
+			break;
+		}
+	}
+	its_frame += std::to_string(event.time_ms) + string(" ") + \
+		std::to_string(event.post_us) + string(" ") + \
+		std::to_string(event.lines.size()) + string("\n");
+	for (auto& line: event.lines)
+	{
+		its_frame += line;
+		its_frame += '\n';
+	}
+
+	std::lock_guard<std::mutex> lock(its_client_mutex);
+	if (event.kind == Sink_event::Kind::display)
+	{
+		its_last_display = its_frame;
+	}
+	for (auto& client: its_clients)
+	{
+		if ((client.dead == false) && (send_to(client,its_frame) == false))
+		{
+			// Too slow or gone, the server thread will close it
+			client.dead = true;
+			shutdown(client.fd,SHUT_RDWR);
+		}
+	}
+	return true;
+}
+
+/* Write any backlog and then data with a single writev. What the client
+ * cannot take now is kept for later, false if the backlog grows too large
+ * or the connection is broken. Requires its_client_mutex.
+*/
+bool Socket_sink::send_to(Client& client, const string& data)
+{
+	struct iovec parts[2];
+	int count = 0;
+	if (!client.backlog.empty())
+	{
+		parts[count].iov_base = const_cast<char *>(client.backlog.data());
+		parts[count].iov_len = client.backlog.size();
+		count++;
+	}
+	if (!data.empty())
+	{
+		parts[count].iov_base = const_cast<char *>(data.data());
+		parts[count].iov_len = data.size();
+		count++;
+	}
+	if (count == 0)
+	{
+		return true;
+	}
+	ssize_t written = 0;
+	do
+	{
+		written = writev(client.fd,parts,count);
+	} while ((written <0) && (errno == EINTR));
+	if (written <0)
+	{
+		if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+		{
+			return false;
+		}
+		written = 0;
+	}
+	unsigned long int done = static_cast<unsigned long int>(written);
+	if (done >= client.backlog.size())
+	{
+		done -= client.backlog.size();
+		client.backlog.assign(data,done,string::npos);
+	}
+	else
+	{
+		client.backlog.erase(0,done);
+		client.backlog += data;
+	}
+	return (client.backlog.size() <= max_backlog);
+}
+
+// Accept new clients, read their commands and reap broken connections
+void Socket_sink::serve()
+{
+	vector<struct pollfd> poll_fds;
+	char byte = 0;
+	while (read(its_wake_fd[0],&byte,1) >0); // left over from an earlier stop
+	while (true)
+	{
+		poll_fds.clear();
+		poll_fds.push_back(pollfd { its_wake_fd[0], POLLIN, 0 });
+		poll_fds.push_back(pollfd { its_listen_fd, POLLIN, 0 });
+		{
+			std::lock_guard<std::mutex> lock(its_client_mutex);
+			for (auto& client: its_clients)
+			{
+				short int events = POLLIN;
+				if (!client.backlog.empty())
+				{
+					events |= POLLOUT;
+				}
+				poll_fds.push_back(pollfd { client.fd, events, 0 });
+			}
+		}
+		if (poll(poll_fds.data(),poll_fds.size(),-1) <0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			break;
+		}
+		if (poll_fds[0].revents != 0) // stop
+		{
+			break;
+		}
+		if (poll_fds[1].revents & POLLIN)
+		{
+			accept_clients();
+		}
+
+		std::lock_guard<std::mutex> lock(its_client_mutex);
+		for (unsigned long int i = 2;i<poll_fds.size();i++)
+		{
+			if (poll_fds[i].revents == 0)
+			{
+				continue;
+			}
+			for (auto& client: its_clients)
+			{
+				if (client.fd != poll_fds[i].fd)
+				{
+					continue;
+				}
+				if ((poll_fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) || \
+					((poll_fds[i].revents & POLLIN) && (read_commands(client) == false)) || \
+					((poll_fds[i].revents & POLLOUT) && (send_to(client,string()) == false)))
+				{
+					client.dead = true;
+				}
+				break;
+			}
+		}
+		for (auto client = its_clients.begin();client != its_clients.end();)
+		{
+			if (client->dead == true)
+			{
+				close(client->fd);
+				client = its_clients.erase(client);
+			}
+			else
+			{
+				client++;
+			}
+		}
+	}
+}
+
+void Socket_sink::accept_clients()
+{
+	while (true)
+	{
+		int fd = accept(its_listen_fd,nullptr,nullptr);
+		if (fd <0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return; // EAGAIN: no more waiting clients
+		}
+		fcntl(fd,F_SETFL,O_NONBLOCK);
+		std::lock_guard<std::mutex> lock(its_client_mutex);
+		if (its_clients.size() >= max_clients)
+		{
+			string refusal("error too many clients\n");
+			while ((write(fd,refusal.data(),refusal.size()) <0) && (errno == EINTR));
+			close(fd);
+			continue;
+		}
+		its_clients.push_back(Client { fd, false, string(), string() });
+		// Greet the client and show it the current display right away
+		send_to(its_clients.back(),string("mwsd " PACKAGE_VERSION "\n") + its_last_display);
+	}
+}
+
+// Read and answer complete command lines, false on end of file or error.
+// Requires its_client_mutex.
+bool Socket_sink::read_commands(Client& client)
+{
+	char buffer[256];
+	ssize_t count = 0;
+	do
+	{
+		count = read(client.fd,buffer,sizeof(buffer));
+	} while ((count <0) && (errno == EINTR));
+	if (count == 0)
+	{
+		return false;
+	}
+	if (count <0)
+	{
+		return ((errno == EAGAIN) || (errno == EWOULDBLOCK));
+	}
+	client.input.append(buffer,static_cast<unsigned long int>(count));
+	string::size_type end = client.input.find('\n');
+	while (end != string::npos)
+	{
+		string line = client.input.substr(0,end);
+		client.input.erase(0,end + 1);
+		if ((!line.empty()) && (line.back() == '\r'))
+		{
+			line.pop_back();
+		}
+		if ((!line.empty()) && (send_to(client,run_command(line) + string("\n")) == false))
+		{
+			return false;
+		}
+		end = client.input.find('\n');
+	}
+	return (client.input.size() <= 256); // no endless lines
+}
+
+// Check a command and queue it for the UI, return the answer
+string Socket_sink::run_command(const string& line)
+{
+	string command;
+	if (line == "disp")
+	{
+		command = line;
+	}
+	else if (line.compare(0,4,"key ") == 0)
+	{
+		static const char *keys[] = { "space", "d", "g", "[", "]", "up", \
+			"down", "left", "right" };
+		string key = line.substr(4);
+		for (auto name: keys)
+		{
+			if (key == name)
+			{
+				command = line;
+				break;
+			}
+		}
+		if (command.empty())
+		{
+			return string("error unsupported key ") + key;
+		}
+	}
+	else
+	{
+		return string("error unknown command");
+	}
+	std::lock_guard<std::mutex> lock(its_cmd_mutex);
+	if (its_commands.size() >= 64)
+	{
+		return string("error busy");
+	}
+	its_commands.push_back(command);
+	return string("ok");
+}
@@ -0,0 +1,89 @@
+/* socket_sink.hpp - definition of the Socket_sink class, a local socket
+ * server streaming events to any number of clients.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_SOCKET_SINK_HPP
+#define MWSD_SOCKET_SINK_HPP
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "output_sink.hpp"
+
+/* Socket_sink - UNIX domain socket server for remote displays
+ * Every event is encoded once and written to all clients with writev,
+ * together with whatever a slow client still has to receive. The
+ * protocol is line based, an event is sent as
+ *   <kind> <time_ms> <post_us> <line count>
+ * followed by its lines. Clients may send the commands
+ *   disp          request a display update
+ *   key <key>     press one of space, d, g, [, ], up, down, left, right
+ * which are answered with "ok" or "error <reason>".
+*/
+
+class Socket_sink: public Output_sink
+{
+	public:
+		Socket_sink() = delete;
+		~Socket_sink();
+			// Listen on path, nullptr on error
+		static Socket_sink* create(std::string path, std::string& error_msg);
+
+			// Access methods
+		unsigned long int get_clients();
+
+			// Utility methods
+		bool take_command(std::string& command); // next command, UI thread
+
+		static const unsigned long int max_clients;
+		static const unsigned long int max_backlog; // bytes per client
+	protected:
+		bool open_sink();
+		bool write_event(const Sink_event& event);
+		void close_sink();
+	private:
+		struct Client
+		{
+			int fd;
+			bool dead; // to be closed by the server thread
+			std::string backlog; // not yet written part of previous events
+			std::string input; // incomplete command line
+		};
+
+		Socket_sink(std::string path, int listen_fd);
+		void serve(); // main loop of the server thread
+		void accept_clients();
+		bool read_commands(Client& client);
+		std::string run_command(const std::string& line);
+		bool send_to(Client& client, const std::string& data);
+
+		std::string its_path;
+		int its_listen_fd;
+		int its_wake_fd[2]; // wakes the server thread to stop
+		std::thread its_server;
+		std::mutex its_client_mutex; // guards all client data
+		std::vector<Client> its_clients;
+		std::string its_frame; // encoded event, shared by all clients
+		std::string its_last_display; // sent to new clients
+		std::mutex its_cmd_mutex;
+		std::deque<std::string> its_commands;
+};
+
+#endif // #ifndef MWSD_SOCKET_SINK_HPP
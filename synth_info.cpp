@@ -19,12 +19,19 @@
 */
 
 #include "synth_info.hpp"
-#include <stdexcept>
+#include "sysex_check.hpp"
 
 using std::vector;
 using std::string;
 using std::unordered_map;
-using std::out_of_range;
+
+// Value for cmd in table or 0 for commands without one. Unknown commands
+// are common (every SysEx is checked), so they must not throw.
+static unsigned int lookup(const unordered_map<unsigned char,unsigned int>& table, unsigned char cmd)
+{
+	unordered_map<unsigned char,unsigned int>::const_iterator entry = table.find(cmd);
+	return (entry != table.end()) ? entry->second : 0;
+}
 
 Synth_info::Synth_info(unsigned char man_id, unsigned char equip_id, \
 	unsigned char dev_id, unsigned char disp_req_cmd, \
@@ -49,22 +56,32 @@ Synth_info::Synth_info(unsigned char man_id, unsigned char equip_id, \
 	its_dump_patch.reserve(10);
 	its_dump_name_start.reserve(2);
 	its_dump_name_chars.reserve(2);
+	its_dump_length.reserve(4);
+	its_dump_chk_start.reserve(4);
 	its_dump_cmds.emplace(0x10,string("sound"));
 	its_dump_bank.emplace(0x10,5);
 	its_dump_patch.emplace(0x10,6);
 	its_dump_name_start.emplace(0x10,247);
 	its_dump_name_chars.emplace(0x10,16);
+	its_dump_length.emplace(0x10,265);
+	its_dump_chk_start.emplace(0x10,7);
 	its_dump_cmds.emplace(0x11,string("multi"));
 	its_dump_bank.emplace(0x11,5);
 	its_dump_patch.emplace(0x11,6);
 	its_dump_name_start.emplace(0x11,23);
 	its_dump_name_chars.emplace(0x11,16);
+	its_dump_length.emplace(0x11,265);
+	its_dump_chk_start.emplace(0x11,7);
 	its_dump_cmds.emplace(0x12,string("wave"));
 	its_dump_bank.emplace(0x12,5);
 	its_dump_patch.emplace(0x12,6);
+	its_dump_length.emplace(0x12,137);
+	its_dump_chk_start.emplace(0x12,7);
 	its_dump_cmds.emplace(0x13,string("wave control table"));
 	its_dump_bank.emplace(0x13,5);
 	its_dump_patch.emplace(0x13,6);
+	its_dump_length.emplace(0x13,265);
+	its_dump_chk_start.emplace(0x13,7);
 	its_dump_cmds.emplace(0x14,string("global parameter"));
 	its_dump_cmds.emplace(0x15,string("display"));
 	its_dump_cmds.emplace(0x26,string("remote"));
@@ -102,72 +119,123 @@ void Synth_info::prepare_disp(vector<unsigned char>* syx_msg, vector<string>* di
 
 string Synth_info::get_dump_name(unsigned char cmd)
 {
-	string cmd_name("");
-	try
-	{
-		cmd_name = its_dump_cmds.at(cmd);
-	}
-	catch (out_of_range& e)
-	{
-		;
-	}
-	return cmd_name;
+	unordered_map<unsigned char,string>::const_iterator entry = its_dump_cmds.find(cmd);
+	return (entry != its_dump_cmds.end()) ? entry->second : string("");
 }
 
 unsigned int Synth_info::get_dump_bank(unsigned char cmd)
 {
-	unsigned int bank_no = 0;
-	try
-	{
-		bank_no = its_dump_bank.at(cmd);
-	}
-	catch(out_of_range& e)
-	{
-		;
-	}
-	return bank_no;
+	return lookup(its_dump_bank,cmd);
 }
 
 unsigned int Synth_info::get_dump_patch(unsigned char cmd)
 {
-	unsigned int patch_no = 0;
-	try
+	return lookup(its_dump_patch,cmd);
+}
+
+unsigned int Synth_info::get_dump_name_start(unsigned char cmd)
+{
+	return lookup(its_dump_name_start,cmd);
+}
+
+unsigned int Synth_info::get_dump_name_chars(unsigned char cmd)
+{
+	return lookup(its_dump_name_chars,cmd);
+}
+
+unsigned int Synth_info::get_dump_length(unsigned char cmd)
+{
+	return lookup(its_dump_length,cmd);
+}
+
+unsigned int Synth_info::get_dump_chk_start(unsigned char cmd)
+{
+	return lookup(its_dump_chk_start,cmd);
+}
+
+// Check a dump for framing, length and checksum. A bank dump arriving as one
+// message is checked as a sequence of single dumps of the expected length.
+Dump_status Synth_info::check_dump(const vector<unsigned char>& syx_msg)
+{
+	if ((syx_msg.size() <5) || (syx_msg[0] != 0xf0))
 	{
-		patch_no = its_dump_patch.at(cmd);
+		return Dump_status::no_dump;
 	}
-	catch (out_of_range& e)
+	unsigned char cmd = syx_msg[4];
+	if (get_dump_name(cmd).empty())
 	{
-		;
+		return Dump_status::no_dump;
+	}
+	if (syx_msg.back() != 0xf7)
+	{
+		return Dump_status::bad_end;
 	}
-	return patch_no;
-}
 
-unsigned int Synth_info::get_dump_name_start(unsigned char cmd)
-{
-	unsigned int name_start = 0;
-	try
+	unsigned long int length = get_dump_length(cmd);
+	if (length == 0) // No fixed length and no checksum known
 	{
-		name_start = its_dump_name_start.at(cmd);
+		return Dump_status::ok;
 	}
-	catch (out_of_range& e)
+	if ((syx_msg.size() % length) != 0)
 	{
-		;
+		return Dump_status::bad_length;
 	}
-	return name_start;
+	unsigned long int chk_start = get_dump_chk_start(cmd);
+	const unsigned char *dump = syx_msg.data();
+	for (unsigned long int pos = 0;pos<syx_msg.size();pos += length, dump += length)
+	{
+		if ((dump[0] != 0xf0) || (dump[4] != cmd))
+		{
+			return Dump_status::bad_start;
+		}
+		if (dump[length - 1] != 0xf7)
+		{
+			return Dump_status::bad_end;
+		}
+		if (chk_start != 0)
+		{
+			// The checksum byte directly precedes 0xf7, 0x7f is always accepted
+			unsigned char chk = dump[length - 2];
+			unsigned long int sum = sysex_sum(dump + chk_start,length - 2 - chk_start);
+			if ((chk != 0x7f) && (chk != (sum & 0x7f)))
+			{
+				return Dump_status::bad_checksum;
+			}
+		}
+	}
+	return Dump_status::ok;
 }
 
-unsigned int Synth_info::get_dump_name_chars(unsigned char cmd)
+string Synth_info::get_dump_status_text(Dump_status status) const
 {
-	unsigned int name_chars;
-	try
+	switch(status)
 	{
-		name_chars = its_dump_name_chars.at(cmd);
-	}
-	catch (out_of_range& e)
-	{
-		;
+		case Dump_status::ok:
+		{
+			return string("valid");
+		}
+		case Dump_status::no_dump:
+		{
+			return string("no dump");
+		}
+		case Dump_status::bad_start:
+		{
+			return string("bad dump header");
+		}
+		case Dump_status::bad_end:
+		{
+			return string("missing end of SysEx");
+		}
+		case Dump_status::bad_length:
+		{
+			return string("truncated or wrong length");
+		}
+		case Dump_status::bad_checksum:
+		{
+			return string("bad checksum");
+		}
 	}
-	return name_chars;
+	return string();
 }
 
 vector<string> Synth_info::get_dump_names() const
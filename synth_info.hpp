@@ -24,6 +24,10 @@
 #include <string>
 #include <unordered_map> // for collection of dump/request commands
 
+/* Dump_status - result of the framing and checksum validation of a dump
+*/
+enum class Dump_status { ok, no_dump, bad_start, bad_end, bad_length, bad_checksum };
+
 /* Synth_info - a data storage class holding basic information about a synth
  * manufacturer ID, equipment ID, device ID (if supported),
  * display request command byte, display dump command byte,
@@ -56,6 +60,11 @@ class Synth_info
 		unsigned int get_dump_patch(unsigned char cmd);
 		unsigned int get_dump_name_start(unsigned char cmd);
 		unsigned int get_dump_name_chars(unsigned char cmd);
+		unsigned int get_dump_length(unsigned char cmd);
+		unsigned int get_dump_chk_start(unsigned char cmd);
+			// Validate framing, length and checksum of a (bank) dump
+		Dump_status check_dump(const std::vector<unsigned char>& syx_msg);
+		std::string get_dump_status_text(Dump_status status) const;
 		std::vector<std::string> get_dump_names() const;
 		void set_dev_id(unsigned char dev_id); // set dev_id and adapt disp_req vector
 		void prepare_disp(std::vector<unsigned char>* syx_msg, \
@@ -79,6 +88,10 @@ class Synth_info
 		std::unordered_map<unsigned char,unsigned int> its_dump_name_start;
 			// Number of name characters, if appropriate
 		std::unordered_map<unsigned char,unsigned int> its_dump_name_chars;
+			// Length of a single dump, if it is fixed
+		std::unordered_map<unsigned char,unsigned int> its_dump_length;
+			// First byte included in the checksum, if the dump has one
+		std::unordered_map<unsigned char,unsigned int> its_dump_chk_start;
 };
 
 #endif // #ifndef SYNTH_INFO_HPP
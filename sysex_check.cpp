@@ -0,0 +1,107 @@
+/* sysex_check.cpp - implementation of helper functions to validate SysEx
+ * messages. The byte sum is vectorised, so that even long bank dumps are
+ * checked in a few microseconds. The byte comparison of two dumps is
+ * vectorised as well, to compare one dump against a large library quickly.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <cstdint>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include "sysex_check.hpp"
+
+using std::size_t;
+using std::uint32_t;
+using std::uint64_t;
+
+unsigned long int sysex_sum(const unsigned char *data, size_t size)
+{
+	unsigned long int sum = 0;
+	size_t i = 0;
+#if defined(__SSE2__)
+	// psadbw against zero adds 8 bytes into each 64 bit lane
+	__m128i zero = _mm_setzero_si128();
+	__m128i acc = _mm_setzero_si128();
+	for (;(i + 16)<=size;i += 16)
+	{
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+		acc = _mm_add_epi64(acc,_mm_sad_epu8(chunk,zero));
+	}
+	uint64_t lanes[2];
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(lanes),acc);
+	sum = static_cast<unsigned long int>(lanes[0] + lanes[1]);
+#elif defined(__ARM_NEON)
+	// pairwise widening adds: 16x8 bit -> 8x16 bit -> accumulated 4x32 bit
+	uint32x4_t acc = vdupq_n_u32(0);
+	for (;(i + 16)<=size;i += 16)
+	{
+		acc = vpadalq_u16(acc,vpaddlq_u8(vld1q_u8(data + i)));
+	}
+	uint32_t lanes[4];
+	vst1q_u32(lanes,acc);
+	sum = static_cast<unsigned long int>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+#endif
+	for (;i<size;i++)
+	{
+		sum += data[i];
+	}
+	return sum;
+}
+
+size_t sysex_diff_count(const unsigned char *a, const unsigned char *b, size_t size)
+{
+	size_t count = 0;
+	size_t i = 0;
+#if defined(__SSE2__)
+	for (;(i + 16)<=size;i += 16)
+	{
+		__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+		__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+		unsigned int equal = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(va,vb)));
+		count += static_cast<size_t>(__builtin_popcount(~equal & 0xffff));
+	}
+#elif defined(__ARM_NEON)
+	// equal lanes are 0xff, so subtracting them counts the equal bytes
+	uint8x16_t equal = vdupq_n_u8(0);
+	size_t blocks = 0;
+	for (;(i + 16)<=size;i += 16)
+	{
+		equal = vsubq_u8(equal,vceqq_u8(vld1q_u8(a + i),vld1q_u8(b + i)));
+		blocks++;
+		if (blocks == 255) // flush before the 8 bit lanes overflow
+		{
+			uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(equal)));
+			count += (blocks * 16) - static_cast<size_t>(vgetq_lane_u64(sum,0) + vgetq_lane_u64(sum,1));
+			equal = vdupq_n_u8(0);
+			blocks = 0;
+		}
+	}
+	uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(equal)));
+	count += (blocks * 16) - static_cast<size_t>(vgetq_lane_u64(sum,0) + vgetq_lane_u64(sum,1));
+#endif
+	for (;i<size;i++)
+	{
+		if (a[i] != b[i])
+		{
+			count++;
+		}
+	}
+	return count;
+}
@@ -0,0 +1,31 @@
+/* sysex_check.hpp - declaration of helper functions to validate SysEx
+ * messages, like the checksum kernel for Waldorf dumps.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_SYSEX_CHECK_HPP
+#define MWSD_SYSEX_CHECK_HPP
+
+#include <cstddef>
+
+// Sum of size bytes starting at data, uses SSE2 or NEON where available
+unsigned long int sysex_sum(const unsigned char *data, std::size_t size);
+// Number of differing bytes between a and b, uses SSE2 or NEON where available
+std::size_t sysex_diff_count(const unsigned char *a, const unsigned char *b, \
+	std::size_t size);
+
+#endif // #ifndef MWSD_SYSEX_CHECK_HPP
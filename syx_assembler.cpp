@@ -0,0 +1,180 @@
+/* syx_assembler.cpp - implementation of the Syx_assembler class, which
+ * joins SysEx messages arriving in pieces.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "syx_assembler.hpp"
+
+using std::vector;
+
+const unsigned long int Syx_assembler::default_max_length;
+const unsigned int Syx_assembler::default_timeout_ms;
+
+Syx_assembler::Syx_assembler(unsigned long int max_length, unsigned int timeout_ms):
+	its_max_length(max_length), its_timeout_ms(timeout_ms), its_active(false),
+	its_overflow(false), its_chunks(0), its_last_ms(0)
+{
+	its_assembled.store(0);
+	its_dropped.store(0);
+	its_buffer.reserve((its_max_length < 4096) ? its_max_length : 4096);
+	its_single.reserve(4);
+}
+
+bool Syx_assembler::passes(const vector<unsigned char>& chunk) const
+{
+	if (chunk.empty())
+	{
+		return false;
+	}
+	if (its_active == true)
+	{
+		// Only real time bytes may come between the pieces
+		return ((chunk.size() == 1) && (chunk[0] >= 0xf8));
+	}
+	if (chunk[0] == 0xf0)
+	{
+		return ((chunk.back() == 0xf7) && (chunk.size() <= its_max_length));
+	}
+	return (chunk[0] >= 0x80);
+}
+
+void Syx_assembler::feed(const vector<unsigned char>& chunk, std::int64_t now_ms, \
+	const Emit& emit)
+{
+	if (chunk.empty())
+	{
+		return;
+	}
+	if (its_active == true)
+	{
+		if ((now_ms - its_last_ms) > its_timeout_ms)
+		{
+			drop(); // the rest of it is not coming anymore
+		}
+		else
+		{
+			its_chunks++;
+			its_last_ms = now_ms;
+		}
+	}
+	unsigned long int size = chunk.size();
+	for (unsigned long int i = 0;i<size;i++)
+	{
+		unsigned char byte = chunk[i];
+		if (byte >= 0xf8) // real time
+		{
+			its_single.assign(1,byte);
+			emit(its_single);
+		}
+		else if (byte == 0xf0)
+		{
+			if (its_active == true)
+			{
+				drop(); // a new SysEx before the end of the last one
+			}
+			start(now_ms);
+		}
+		else if (byte == 0xf7)
+		{
+			if (its_active == false)
+			{
+				its_dropped++;
+				continue;
+			}
+			append(byte);
+			if (((i + 1) < size) && (chunk[i + 1] == 0xf0))
+			{
+				append(0xf0); // the next dump of a bank
+				i++;
+				continue;
+			}
+			its_active = false;
+			if (its_overflow == true)
+			{
+				its_dropped++;
+			}
+			else
+			{
+				if (its_chunks >1)
+				{
+					its_assembled++;
+				}
+				emit(its_buffer);
+			}
+			its_buffer.clear();
+		}
+		else if (byte >= 0x80) // any other message ends SysEx
+		{
+			if (its_active == true)
+			{
+				drop();
+			}
+			its_single.assign(chunk.begin() + static_cast<long>(i),chunk.end());
+			emit(its_single);
+			return;
+		}
+		else if (its_active == true)
+		{
+			append(byte);
+		}
+		else // data without a status byte
+		{
+			its_dropped++;
+			while (((i + 1) < size) && (chunk[i + 1] < 0x80))
+			{
+				i++;
+			}
+		}
+	}
+}
+
+void Syx_assembler::start(std::int64_t now_ms)
+{
+	its_active = true;
+	its_overflow = false;
+	its_chunks = 1;
+	its_last_ms = now_ms;
+	its_buffer.clear();
+	append(0xf0);
+}
+
+void Syx_assembler::append(unsigned char byte)
+{
+	if (its_buffer.size() < its_max_length)
+	{
+		its_buffer.push_back(byte);
+	}
+	else
+	{
+		its_overflow = true;
+	}
+}
+
+void Syx_assembler::reset()
+{
+	if (its_active == true)
+	{
+		drop();
+	}
+}
+
+void Syx_assembler::drop()
+{
+	its_active = false;
+	its_buffer.clear();
+	its_dropped++;
+}
@@ -0,0 +1,80 @@
+/* syx_assembler.hpp - definition of the Syx_assembler class, which joins
+ * SysEx messages arriving in pieces.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_SYX_ASSEMBLER_HPP
+#define MWSD_SYX_ASSEMBLER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/* Syx_assembler - complete MIDI messages from the chunks of a backend
+ * Some backends hand over long SysEx in pieces: F0 and the first bytes,
+ * then data bytes, the last piece ending with F7. Complete messages,
+ * which are nearly all, pass without a copy (see passes()). Other
+ * chunks are fed byte by byte into a buffer, which is reserved once
+ * and grows up to max_length. Longer SysEx is dropped as a whole, as is
+ * one whose next piece takes longer than timeout_ms or which is cut
+ * short by another status byte. Real time bytes within SysEx are passed
+ * on by themselves. As a bank dump sent in one piece, F0 right after F7
+ * within a chunk continues the message.
+*/
+
+class Syx_assembler
+{
+	public:
+		typedef std::function<void(std::vector<unsigned char>& msg)> Emit;
+
+		static const unsigned long int default_max_length = 262144; // bytes
+		static const unsigned int default_timeout_ms = 2000;
+
+		Syx_assembler(unsigned long int max_length = default_max_length, \
+			unsigned int timeout_ms = default_timeout_ms);
+
+			// Access methods
+		bool get_active() const { return its_active; } // SysEx is incomplete
+		unsigned long int get_assembled() const { return its_assembled.load(); }
+		unsigned long int get_dropped() const { return its_dropped.load(); }
+
+			// Utility methods
+			// True if chunk is a complete message to be used as it is
+		bool passes(const std::vector<unsigned char>& chunk) const;
+			// Take a chunk that does not pass, complete messages go to emit
+		void feed(const std::vector<unsigned char>& chunk, std::int64_t now_ms, \
+			const Emit& emit);
+		void reset(); // a new source, an incomplete SysEx is dropped
+	private:
+		void start(std::int64_t now_ms);
+		void append(unsigned char byte);
+		void drop(); // forget the incomplete SysEx
+
+		unsigned long int its_max_length;
+		std::int64_t its_timeout_ms;
+		std::vector<unsigned char> its_buffer; // SysEx being assembled
+		std::vector<unsigned char> its_single; // real time byte or other message
+		bool its_active; // F0 seen, F7 not yet
+		bool its_overflow; // the SysEx is longer than its_max_length
+		unsigned long int its_chunks; // pieces of the current SysEx
+		std::int64_t its_last_ms; // time of the last piece
+		std::atomic_ulong its_assembled; // messages of more than one piece
+		std::atomic_ulong its_dropped; // incomplete, too long or stray pieces
+};
+
+#endif // #ifndef MWSD_SYX_ASSEMBLER_HPP
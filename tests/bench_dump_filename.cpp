@@ -0,0 +1,109 @@
+/* bench_dump_filename.cpp - measures how many dump file names per second
+ * Dump_filename builds.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "dump_filename.hpp"
+#include "synth_info.hpp"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+const double target_rate = 100000; // names per second, for batch splitting
+
+// A dump of cmd of its single length (or twice that for a bank) with name
+vector<unsigned char> make_dump(Synth_info& synth_info, unsigned char cmd, bool bank, \
+	unsigned char bank_no, unsigned char patch_no, const string& name)
+{
+	unsigned long int length = synth_info.get_dump_length(cmd);
+	vector<unsigned char> dump((length >0) ? length : 8,0);
+	if (bank == true)
+	{
+		dump.resize(dump.size() * 2);
+	}
+	dump[0] = 0xf0;
+	dump[1] = synth_info.get_man_id();
+	dump[2] = synth_info.get_equip_id();
+	dump[3] = synth_info.get_dev_id();
+	dump[4] = cmd;
+	dump.back() = 0xf7;
+	if ((length >0) && (bank == false))
+	{
+		dump[synth_info.get_dump_bank(cmd)] = bank_no;
+		dump[synth_info.get_dump_patch(cmd)] = patch_no;
+		unsigned long int start = synth_info.get_dump_name_start(cmd);
+		unsigned long int chars = synth_info.get_dump_name_chars(cmd);
+		for (unsigned long int i = 0;(i<chars) && (start + i < dump.size());i++)
+		{
+			dump[start + i] = (i < name.size()) ? name[i] : ' ';
+		}
+	}
+	return dump;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long int count = (argc >1) ? std::strtoul(argv[1],nullptr,10) : 5000000;
+	if (count == 0)
+	{
+		count = 1;
+	}
+	Synth_info synth_info(0x3e,0x0e,0x7f,0x05,0x15,40,2);
+	Dump_filename dump_filename(&synth_info);
+	vector<vector<unsigned char> > dumps = {
+		make_dump(synth_info,0x10,false,0,12,string("  Init Sound")),
+		make_dump(synth_info,0x10,false,1,127,string("Bass/Lead 1     ")),
+		make_dump(synth_info,0x10,false,2,0,string("Edit buffer")),
+		make_dump(synth_info,0x11,false,0,5,string("Split Multi")),
+		make_dump(synth_info,0x12,false,2,100,string()),
+		make_dump(synth_info,0x13,false,0,17,string()),
+		make_dump(synth_info,0x10,true,0,0,string()),
+		make_dump(synth_info,0x14,false,0,0,string()),
+		make_dump(synth_info,0x26,false,0,0,string())
+	};
+
+	char buffer[Dump_filename::max_length];
+	for (auto& dump: dumps)
+	{
+		dump_filename.format(dump.data(),dump.size(),std::time(nullptr),buffer);
+		cout << "  " << buffer << endl;
+	}
+
+	// The clock is read for every name, as when saving
+	unsigned long int total_length = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned long int i = 0;i<count;i++)
+	{
+		const vector<unsigned char>& dump = dumps[i % dumps.size()];
+		total_length += dump_filename.format(dump.data(),dump.size(),std::time(nullptr),buffer);
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	double rate = count / seconds;
+	cout << "Dump_filename::format: " << count << " names, " << (rate / 1000000) << \
+		" million names/s, " << (1e9 * seconds / count) << " ns per name, average length " << \
+		(static_cast<double>(total_length) / count) << endl;
+	cout << "Target of " << target_rate << " names/s " << ((rate >= target_rate) ? "met" : "missed") << endl;
+	return (rate >= target_rate) ? 0 : 1;
+}
@@ -0,0 +1,260 @@
+/* bench_input_mode.cpp - measures the cost per message and the wakeups
+ * per second of the callback and the batch input mode under a CC flood
+ * and a bank dump, from a simulated RtMidi input queue into the miner.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <time.h>
+#include "curses_mw_miner.hpp"
+#include "input_gate.hpp"
+#include "midi_reader.hpp"
+#include "screen_compositor.hpp"
+#include "synth_info.hpp"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+using std::chrono::steady_clock;
+
+double cpu_seconds(clockid_t clock)
+{
+	struct timespec now;
+	clock_gettime(clock,&now);
+	return now.tv_sec + (now.tv_nsec * 1e-9);
+}
+
+/* Sim_port - the input queue of RtMidiIn, filled by the backend thread
+ * at an even pace. Messages beyond the queue size are dropped, as RtMidi
+ * does.
+*/
+
+class Sim_port
+{
+	public:
+		Sim_port(unsigned long int queue_size): its_queue_size(queue_size), its_done(false),
+			its_dropped(0), its_producer_cpu(0.0)
+		{
+		}
+
+		// Send all messages at rate messages per second, then close the port
+		void produce(const vector<vector<unsigned char> >& messages, double rate)
+		{
+			steady_clock::time_point next = steady_clock::now();
+			std::chrono::nanoseconds spacing(static_cast<long long int>(1e9 / rate));
+			for (auto& msg: messages)
+			{
+				std::this_thread::sleep_until(next);
+				next += spacing;
+				{
+					std::lock_guard<std::mutex> lock(its_mutex);
+					if (its_queue.size() < its_queue_size)
+					{
+						its_queue.push_back(msg);
+					}
+					else
+					{
+						its_dropped++;
+					}
+				}
+				its_cond.notify_one();
+			}
+			{
+				std::lock_guard<std::mutex> lock(its_mutex);
+				its_done = true;
+				its_producer_cpu = cpu_seconds(CLOCK_THREAD_CPUTIME_ID);
+			}
+			its_cond.notify_one();
+		}
+
+		// As RtMidiIn::getMessage: the next message or an empty one
+		double get_message(vector<unsigned char>& msg)
+		{
+			std::lock_guard<std::mutex> lock(its_mutex);
+			if (its_queue.empty() == true)
+			{
+				msg.clear();
+				return 0.0;
+			}
+			msg.assign(its_queue.front().begin(),its_queue.front().end());
+			its_queue.pop_front();
+			return 0.0;
+		}
+
+		// As the backend thread of RtMidi before it calls the callback:
+		// block for the next message, false when the port is closed
+		bool wait_message(vector<unsigned char>& msg)
+		{
+			std::unique_lock<std::mutex> lock(its_mutex);
+			its_cond.wait(lock,[this]() { return (its_queue.empty() == false) || (its_done == true); });
+			if (its_queue.empty() == true)
+			{
+				return false;
+			}
+			msg.swap(its_queue.front());
+			its_queue.pop_front();
+			return true;
+		}
+
+		bool get_done()
+		{
+			std::lock_guard<std::mutex> lock(its_mutex);
+			return (its_done == true) && (its_queue.empty() == true);
+		}
+
+		unsigned long int get_dropped()
+		{
+			std::lock_guard<std::mutex> lock(its_mutex);
+			return its_dropped;
+		}
+
+		double get_producer_cpu() // CPU seconds of the producer thread
+		{
+			std::lock_guard<std::mutex> lock(its_mutex);
+			return its_producer_cpu;
+		}
+	private:
+		unsigned long int its_queue_size;
+		std::deque<vector<unsigned char> > its_queue;
+		bool its_done;
+		unsigned long int its_dropped;
+		double its_producer_cpu;
+		std::mutex its_mutex;
+		std::condition_variable its_cond;
+};
+
+// The miner behind an input gate, as Curses_mw_ui sets them up
+struct Pipeline
+{
+	Synth_info synth_info;
+	Screen_compositor compositor;
+	Curses_mw_miner miner;
+	Input_gate gate;
+	unsigned long int generation;
+
+	Pipeline(): synth_info(0x3e,0x0e,0x7f,0x05,0x15,40,2),
+		miner(nullptr,&synth_info,&compositor),
+		gate([this](double delta_time, vector<unsigned char> *msg) { miner.accept_msg(delta_time,msg); },
+			[this]() { miner.restart_input(); })
+	{
+		generation = gate.open_next();
+		gate.swap();
+	}
+};
+
+// Run messages through one input mode, print messages, wakeups and the
+// CPU time of the input side per message
+void run_mode(bool batch, const vector<vector<unsigned char> >& messages, double rate, \
+	unsigned long int queue_size)
+{
+	Pipeline pipeline;
+	Sim_port port(queue_size);
+	unsigned long int wakeups = 0;
+	unsigned long int delivered = 0;
+	double start_cpu = cpu_seconds(CLOCK_PROCESS_CPUTIME_ID);
+	steady_clock::time_point start = steady_clock::now();
+	std::thread producer(&Sim_port::produce,&port,std::cref(messages),rate);
+	if (batch == true)
+	{
+		Midi_reader reader([&port](vector<unsigned char>& msg) { return port.get_message(msg); }, \
+			[&pipeline](vector<vector<unsigned char> >& batch, const vector<double>& delta_times, \
+			unsigned long int count)
+		{
+			pipeline.gate.deliver_batch(pipeline.generation,batch,delta_times,count);
+		});
+		reader.start();
+		while (port.get_done() == false)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		reader.stop();
+		wakeups = reader.get_wakeups();
+		delivered = reader.get_messages();
+	}
+	else
+	{
+		// RtMidi wakes up for every message and hands over a vector of its own
+		std::thread backend([&]()
+		{
+			vector<unsigned char> msg;
+			while (port.wait_message(msg) == true)
+			{
+				wakeups++;
+				vector<unsigned char> message(msg);
+				pipeline.gate.deliver(pipeline.generation,0.0,&message);
+				delivered++;
+			}
+		});
+		backend.join();
+	}
+	producer.join();
+	double seconds = std::chrono::duration<double>(steady_clock::now() - start).count();
+	double input_cpu = cpu_seconds(CLOCK_PROCESS_CPUTIME_ID) - start_cpu - port.get_producer_cpu();
+	cout << "  " << ((batch == true) ? "batch:    " : "callback: ") << delivered << " messages, " << \
+		port.get_dropped() << " dropped, " << wakeups << " wakeups (" << \
+		static_cast<unsigned long int>(wakeups / seconds) << "/s), " << \
+		static_cast<unsigned long int>((input_cpu * 1e9) / ((delivered >0) ? delivered : 1)) << \
+		" ns CPU per message" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long int queue_size = (argc >1) ? std::strtoul(argv[1],nullptr,10) : 100;
+	if (queue_size == 0)
+	{
+		queue_size = 1;
+	}
+	cout << "Input modes into the miner, RtMidi input queue of " << queue_size << " messages" << endl;
+
+	// A controller flood, every value differs from the one before
+	vector<vector<unsigned char> > flood;
+	for (unsigned int i = 0;i<20000;i++)
+	{
+		flood.push_back(vector<unsigned char> { 0xb0, static_cast<unsigned char>(i % 32), \
+			static_cast<unsigned char>((i / 32) % 128) });
+	}
+	cout << "CC flood, " << flood.size() << " messages at 10000/s" << endl;
+	run_mode(false,flood,10000.0,queue_size);
+	run_mode(true,flood,10000.0,queue_size);
+
+	// A bank of sound dumps
+	vector<vector<unsigned char> > bank;
+	for (unsigned int i = 0;i<128;i++)
+	{
+		vector<unsigned char> dump(265,static_cast<unsigned char>(i % 128));
+		dump[0] = 0xf0;
+		dump[1] = 0x3e;
+		dump[2] = 0x00;
+		dump[3] = 0x00;
+		dump[4] = 0x10;
+		dump.back() = 0xf7;
+		bank.push_back(dump);
+	}
+	cout << "Bank dump, " << bank.size() << " dumps of 265 bytes at 2000/s" << endl;
+	run_mode(false,bank,2000.0,queue_size);
+	run_mode(true,bank,2000.0,queue_size);
+	return 0;
+}
@@ -0,0 +1,84 @@
+/* bench_midi_filter.cpp - measures the cost of the compiled MIDI input
+ * filter per message.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "midi_filter.hpp"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+// Nanoseconds per accept() of messages, taken in turn
+double time_filter(const Midi_filter& filter, const vector<vector<unsigned char> >& messages, \
+	unsigned long int count, unsigned long int& accepted)
+{
+	accepted = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned long int i = 0;i<count;i++)
+	{
+		const vector<unsigned char>& msg = messages[i % messages.size()];
+		accepted += filter.accept(msg.data(),msg.size()) ? 1 : 0;
+	}
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double,std::nano>(end - start).count() / count;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long int count = (argc >1) ? std::strtoul(argv[1],nullptr,10) : 50000000;
+	if (count == 0)
+	{
+		count = 1;
+	}
+	// A busy keyboard on other channels, controllers and foreign SysEx
+	vector<vector<unsigned char> > messages = {
+		{ 0x90, 60, 100 }, { 0x80, 60, 0 }, { 0xb0, 7, 100 }, { 0xb0, 74, 64 },
+		{ 0xb3, 1, 10 }, { 0xe0, 0, 64 }, { 0xd0, 30 }, { 0xc0, 5 },
+		{ 0xf0, 0x3e, 0x0e, 0x00, 0x15, 0x20, 0xf7 }, { 0xf0, 0x43, 0x10, 0x4c, 0x00, 0xf7 }
+	};
+	vector<string> expressions = {
+		string(""),
+		string("ch:1 cc:0-31"),
+		string("ch:1-2,10 cc:0-31 note sysex:3e0e program"),
+		string("sysex:3e0e")
+	};
+
+	cout << "Midi_filter::accept over " << count << " messages" << endl;
+	for (auto& expression: expressions)
+	{
+		Midi_filter filter;
+		if (filter.compile(expression) == false)
+		{
+			cout << "Can't compile \"" << expression << "\": " << filter.get_error_msg() << endl;
+			return 1;
+		}
+		unsigned long int accepted = 0;
+		double ns = time_filter(filter,messages,count,accepted);
+		string name = (expression.empty() == true) ? string("no filter") : \
+			string("\"") + expression + string("\"");
+		cout << "  " << name << ": " << ns << " ns per message, " << \
+			(100.0 * accepted / count) << "% accepted" << endl;
+	}
+	return 0;
+}
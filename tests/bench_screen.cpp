@@ -0,0 +1,203 @@
+/* bench_screen.cpp - measures bytes and write() calls per frame of the
+ * curses and the ansi screen backend on a pseudo terminal.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "screen_compositor.hpp"
+
+using std::cout;
+using std::endl;
+using std::string;
+
+// Bytes and calls of write() of this process so far, from /proc/self/io
+// (Linux only, 0 elsewhere)
+void read_io(unsigned long int& bytes, unsigned long int& writes)
+{
+	bytes = 0;
+	writes = 0;
+	std::ifstream io("/proc/self/io");
+	string name;
+	unsigned long int value = 0;
+	while (io >> name >> value)
+	{
+		if (name == "wchar:")
+		{
+			bytes = value;
+		}
+		else if (name == "syscw:")
+		{
+			writes = value;
+		}
+	}
+}
+
+// Run in the child on the pty: draw frames of a changing two line display
+// like the miner does and report to report_fd
+void draw_frames(Screen_backend backend, unsigned int frames, int report_fd)
+{
+	initscr();
+	cbreak();
+	noecho();
+	nodelay(stdscr,TRUE);
+	WINDOW *main_win = newwin(LINES - 5,COLS,0,0);
+	wrefresh(main_win);
+	Screen_compositor compositor;
+	compositor.set_backend(backend);
+	compositor.set_max_fps(1000);
+	compositor.start();
+	WINDOW *data_win = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(compositor.get_mutex());
+		data_win = newwin(5,COLS,LINES - 5,0);
+		box(data_win,0,0);
+		compositor.damage(data_win);
+	}
+	box(main_win,0,0);
+	mvwprintw(main_win,1,5,"mwsd");
+	mvwprintw(main_win,3,3,"MIDI input port: In");
+	compositor.refresh(main_win);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	unsigned long int start_bytes = 0;
+	unsigned long int start_writes = 0;
+	read_io(start_bytes,start_writes);
+	unsigned long int start_frames = compositor.get_frames();
+	for (unsigned int i = 0;i<frames;i++)
+	{
+		{
+			std::lock_guard<std::mutex> lock(compositor.get_mutex());
+			wmove(data_win,1,1);
+			wclrtoeol(data_win);
+			mvwprintw(data_win,1,2,"A%03u Sound name %u     Cutoff %3u",i % 128,i,i % 128);
+			wmove(data_win,2,1);
+			wclrtoeol(data_win);
+			mvwprintw(data_win,2,2,"Filter env attack      %3u",(i * 7) % 128);
+			box(data_win,0,0);
+			wmove(data_win,2,2);
+			compositor.damage(data_win);
+		}
+		// One frame per change
+		std::this_thread::sleep_for(std::chrono::milliseconds(3));
+	}
+	compositor.stop();
+	unsigned long int end_bytes = 0;
+	unsigned long int end_writes = 0;
+	read_io(end_bytes,end_writes);
+	unsigned long int drawn = compositor.get_frames() - start_frames;
+	endwin();
+
+	char report[160];
+	int length = std::snprintf(report,sizeof(report),"%lu %lu %lu\n",drawn, \
+		end_bytes - start_bytes,end_writes - start_writes);
+	if (write(report_fd,report,static_cast<std::size_t>(length)) <0)
+	{
+		std::exit(1);
+	}
+}
+
+// Run one backend on a new pty, false on an error
+bool run_backend(Screen_backend backend, const string& name, unsigned int frames)
+{
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	if ((master <0) || (grantpt(master) <0) || (unlockpt(master) <0))
+	{
+		cout << "No pseudo terminal" << endl;
+		return false;
+	}
+	string slave_name(ptsname(master));
+	int report[2];
+	if (pipe(report) <0)
+	{
+		return false;
+	}
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		setsid();
+		int slave = open(slave_name.c_str(),O_RDWR);
+		if (slave <0)
+		{
+			std::_Exit(1);
+		}
+		dup2(slave,STDIN_FILENO);
+		dup2(slave,STDOUT_FILENO);
+		dup2(slave,STDERR_FILENO);
+		close(master);
+		close(report[0]);
+		setenv("TERM","xterm",1);
+		setenv("LINES","25",1);
+		setenv("COLUMNS","80",1);
+		draw_frames(backend,frames,report[1]);
+		std::_Exit(0);
+	}
+	close(report[1]);
+
+	// Drain the terminal, as a terminal emulator would
+	unsigned long int terminal_bytes = 0;
+	char buffer[65536];
+	ssize_t got = 0;
+	while ((got = read(master,buffer,sizeof(buffer))) >0)
+	{
+		terminal_bytes += static_cast<unsigned long int>(got);
+	}
+	int status = 0;
+	waitpid(pid,&status,0);
+	close(master);
+
+	string line;
+	while ((got = read(report[0],buffer,sizeof(buffer))) >0)
+	{
+		line.append(buffer,static_cast<std::size_t>(got));
+	}
+	close(report[0]);
+	unsigned long int drawn = 0;
+	unsigned long int bytes = 0;
+	unsigned long int writes = 0;
+	if (std::sscanf(line.c_str(),"%lu %lu %lu",&drawn,&bytes,&writes) != 3)
+	{
+		cout << name << ": the drawing process failed" << endl;
+		return false;
+	}
+	cout << "  " << name << ": " << drawn << " frames, " << \
+		(static_cast<double>(writes) / drawn) << " write() calls and " << \
+		(static_cast<double>(bytes) / drawn) << " bytes per frame, " << \
+		terminal_bytes << " bytes on the terminal in all" << endl;
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int frames = (argc >1) ? static_cast<unsigned int>(std::strtoul(argv[1],nullptr,10)) : 500;
+	if (frames == 0)
+	{
+		frames = 1;
+	}
+	cout << "Screen backends on a pty, " << frames << " changes of a two line display" << endl;
+	bool ok = run_backend(Screen_backend::curses,string("curses"),frames);
+	ok = run_backend(Screen_backend::ansi,string("ansi"),frames) && ok;
+	return (ok == true) ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+/* bench_shm.cpp - measures the reader latency and the writer cost per frame
+ * of the shared-memory display mirror.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "mwsd_shm.hpp"
+#include "shm_sink.hpp"
+#include "synth_info.hpp"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::to_string;
+using std::vector;
+
+int main(int argc, char *argv[])
+{
+	unsigned long int frames = (argc >1) ? std::strtoul(argv[1],nullptr,10) : 20000;
+	string name = string("/mwsd_bench_") + to_string(getpid());
+	string error_msg;
+	Synth_info synth_info(0x3e,0x0e,0x7f,0x05,0x15,40,2);
+	Shm_sink *sink = Shm_sink::create(name,&synth_info,error_msg);
+	if (sink == nullptr)
+	{
+		cout << error_msg << endl;
+		return 1;
+	}
+	Sink_hub hub;
+	hub.add_sink(sink);
+	hub.start();
+
+	Mwsd_shm_reader reader;
+	if (reader.open_shm(name) == false)
+	{
+		cout << "Cannot open " << name << endl;
+		return 1;
+	}
+
+	// The reader copies snapshots as fast as it can while frames arrive.
+	// Both lines of a frame carry its number, a torn copy would differ.
+	std::atomic_bool stop_flag(false);
+	unsigned long int reads = 0;
+	unsigned long int failed = 0;
+	unsigned long int torn = 0;
+	unsigned long int publish_count = 0;
+	double publish_ns = 0;
+	double read_ns = 0;
+	std::thread reader_thread([&]()
+	{
+		Mwsd_shm_data data;
+		std::uint64_t last_frame = 0;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		while (stop_flag.load() == false)
+		{
+			reads++;
+			if (reader.read(data) == false)
+			{
+				failed++;
+				continue;
+			}
+			if (std::strncmp(data.display[0],data.display[1],sizeof(data.display[0])) != 0)
+			{
+				torn++;
+			}
+			if ((data.frames != last_frame) && (data.publish_ns >0))
+			{
+				last_frame = data.frames;
+				publish_ns += data.publish_ns;
+				publish_count++;
+			}
+		}
+		read_ns = std::chrono::duration<double,std::nano>( \
+			std::chrono::steady_clock::now() - start).count();
+	});
+
+	vector<string> lines(2);
+	double post_ns = 0;
+	for (unsigned long int i = 0;i<frames;i++)
+	{
+		lines[0] = string("Frame ") + to_string(i) + string(" of the display");
+		lines[1] = lines[0];
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		hub.post(Sink_event::Kind::display,lines);
+		post_ns += std::chrono::duration<double,std::nano>( \
+			std::chrono::steady_clock::now() - start).count();
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+	hub.stop();
+	stop_flag.store(true);
+	reader_thread.join();
+
+	cout << "Shared-memory mirror, " << frames << " frames" << endl;
+	cout << "  Reader: " << (read_ns / reads) << " ns per snapshot, " << reads << " snapshots, " << \
+		failed << " failed, " << torn << " torn" << endl;
+	cout << "  Writer: " << ((publish_count >0) ? (publish_ns / publish_count) : 0.0) << \
+		" ns per frame into the segment, " << (post_ns / frames) << " ns per post" << endl;
+	cout << "  Written " << sink->get_written() << ", coalesced " << sink->get_coalesced() << endl;
+	return (torn == 0) ? 0 : 1;
+}
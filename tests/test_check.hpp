@@ -0,0 +1,58 @@
+/* test_check.hpp - the check macro and result of the tests of mwsd, each
+ * test is a program returning 0 if all checks passed.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_TEST_CHECK_HPP
+#define MWSD_TEST_CHECK_HPP
+
+#include <atomic>
+#include <iostream>
+
+// Failed checks of this test program, checks may run on any thread
+inline std::atomic_ulong& test_failures()
+{
+	static std::atomic_ulong failures(0);
+	return failures;
+}
+
+inline bool test_check(bool ok, const char *text, const char *file, int line)
+{
+	if (ok == false)
+	{
+		test_failures()++;
+		std::cerr << file << ":" << line << ": check failed: " << text << std::endl;
+	}
+	return ok;
+}
+
+// Report and return the exit code of the test program
+inline int test_result(const char *name)
+{
+	unsigned long int failures = test_failures().load();
+	if (failures == 0)
+	{
+		std::cout << name << ": all checks passed" << std::endl;
+		return 0;
+	}
+	std::cout << name << ": " << failures << " checks failed" << std::endl;
+	return 1;
+}
+
+#define CHECK(condition) test_check((condition),#condition,__FILE__,__LINE__)
+
+#endif // #ifndef MWSD_TEST_CHECK_HPP
@@ -0,0 +1,156 @@
+/* test_disp_history.cpp - tests of Disp_history: the ring of frames and
+ * the search by time, and readers copying frames while the writer laps
+ * them. Build with -DMWSD_TSAN=ON to run it under ThreadSanitizer.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "disp_history.hpp"
+#include "test_check.hpp"
+
+using std::int64_t;
+using std::string;
+using std::uint64_t;
+using std::vector;
+
+const unsigned int rows = 2;
+const unsigned int cols = 40;
+
+// Frame number index, every character tells its number
+vector<string> make_frame(uint64_t index)
+{
+	char fill = static_cast<char>('A' + (index % 26));
+	return vector<string> { string(cols,fill), string(cols - 3,fill) };
+}
+
+// A copied frame is all of frame number index
+bool whole(const vector<string>& frame, uint64_t index)
+{
+	char fill = static_cast<char>('A' + (index % 26));
+	if (frame.size() != rows)
+	{
+		return false;
+	}
+	return (frame[0] == string(cols,fill)) && (frame[1] == string(cols - 3,fill) + string("   "));
+}
+
+// Filling, lapping and searching with one thread
+void check_ring()
+{
+	Disp_history history(4,rows,cols);
+	vector<string> frame;
+	int64_t time_ms = 0;
+	CHECK(history.get_count() == 0);
+	CHECK(history.get(0,frame,time_ms) == false);
+	for (uint64_t i = 0;i<3;i++)
+	{
+		history.append(make_frame(i),static_cast<int64_t>(i * 10));
+	}
+	CHECK(history.get_first() == 0);
+	CHECK(history.get(0,frame,time_ms) == true);
+	CHECK((time_ms == 0) && (whole(frame,0) == true));
+
+	// Full: the frame written next is gone already
+	history.append(make_frame(3),30);
+	CHECK(history.get_first() == 1);
+	CHECK(history.get(0,frame,time_ms) == false);
+	for (uint64_t i = 4;i<10;i++)
+	{
+		history.append(make_frame(i),static_cast<int64_t>(i * 10));
+	}
+	CHECK(history.get_count() == 10);
+	CHECK(history.get_first() == 7);
+	CHECK(history.get(6,frame,time_ms) == false);
+	CHECK(history.get(10,frame,time_ms) == false);
+	for (uint64_t i = 7;i<10;i++)
+	{
+		CHECK(history.get(i,frame,time_ms) == true);
+		CHECK((time_ms == static_cast<int64_t>(i * 10)) && (whole(frame,i) == true));
+	}
+	CHECK(history.find_time(85) == 8);
+	CHECK(history.find_time(90) == 9);
+	CHECK(history.find_time(1000) == 9);
+	CHECK(history.find_time(0) == 7);
+}
+
+// One writer laps a small ring while readers copy frames at random. No
+// copy may mix two frames.
+void check_concurrent()
+{
+	const uint64_t frames = 200000;
+	const unsigned int readers = 3;
+	Disp_history history(8,rows,cols);
+	std::atomic_bool stop(false);
+	std::atomic_ulong copied(0);
+	std::atomic_ulong gone(0);
+
+	vector<std::thread> threads;
+	for (unsigned int k = 0;k<readers;k++)
+	{
+		threads.emplace_back([&,k]()
+		{
+			std::mt19937 rng(300 + k);
+			vector<string> frame;
+			int64_t time_ms = 0;
+			while (stop.load() == false)
+			{
+				uint64_t count = history.get_count();
+				uint64_t first = history.get_first();
+				if (count == 0)
+				{
+					continue;
+				}
+				// Half the time the oldest frame, the one the writer takes next
+				uint64_t index = ((rng() % 2) == 0) ? first : first + (rng() % (count - first + 1));
+				if (history.get(index,frame,time_ms) == true)
+				{
+					CHECK(time_ms == static_cast<int64_t>(index));
+					CHECK(whole(frame,index) == true);
+					copied++;
+				}
+				else
+				{
+					gone++;
+				}
+				history.find_time(static_cast<int64_t>(index));
+			}
+		});
+	}
+	for (uint64_t i = 0;i<frames;i++)
+	{
+		history.append(make_frame(i),static_cast<int64_t>(i));
+	}
+	stop.store(true);
+	for (auto& thread: threads)
+	{
+		thread.join();
+	}
+	CHECK(history.get_count() == frames);
+	CHECK(copied.load() >0);
+}
+
+int main()
+{
+	check_ring();
+	check_concurrent();
+	return test_result("test_disp_history");
+}
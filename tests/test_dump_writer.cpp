@@ -0,0 +1,173 @@
+/* test_dump_writer.cpp - tests of Dump_writer: the bounded queue, the
+ * results, complete files without leftovers and the syncs per batch.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+#include "dump_writer.hpp"
+#include "test_check.hpp"
+
+using std::string;
+using std::vector;
+typedef std::shared_ptr<const vector<unsigned char> > Data;
+
+Data make_data(unsigned char tag, unsigned long int size)
+{
+	vector<unsigned char> data(size,tag);
+	data[0] = 0xf0;
+	data.back() = 0xf7;
+	return std::make_shared<const vector<unsigned char> >(data);
+}
+
+vector<unsigned char> read_file(const string& filename)
+{
+	std::ifstream file(filename.c_str(),std::ios::binary);
+	return vector<unsigned char>((std::istreambuf_iterator<char>(file)), \
+		std::istreambuf_iterator<char>());
+}
+
+// Names of all files in folder
+std::set<string> list_folder(const string& folder)
+{
+	std::set<string> names;
+	DIR *dir = opendir(folder.c_str());
+	if (dir == nullptr)
+	{
+		return names;
+	}
+	while (struct dirent *entry = readdir(dir))
+	{
+		string name(entry->d_name);
+		if ((name != ".") && (name != ".."))
+		{
+			names.insert(name);
+		}
+	}
+	closedir(dir);
+	return names;
+}
+
+// Saves queued before the start are written in one batch: one data sync
+// per file and one of the folder
+void check_batch(const string& folder)
+{
+	Dump_writer writer(4);
+	vector<Data> data;
+	for (unsigned char i = 0;i<4;i++)
+	{
+		data.push_back(make_data(i,265 + i));
+		CHECK(writer.save(data[i],folder + "/dump" + std::to_string(i) + ".syx","Sound") == true);
+	}
+	CHECK(writer.save(make_data(9,10),folder + "/dump9.syx","Sound") == false); // full
+	CHECK(writer.get_pending() == 4);
+	writer.start();
+	writer.stop();
+	CHECK(writer.get_pending() == 0);
+	CHECK(writer.get_saved() == 4);
+	CHECK(writer.get_failed() == 0);
+	CHECK(writer.get_syncs() == 5);
+	Save_result result;
+	unsigned int results = 0;
+	while (writer.take_result(result) == true)
+	{
+		CHECK(result.ok == true);
+		CHECK(result.error_msg.empty() == true);
+		CHECK(result.label == "Sound");
+		CHECK(read_file(result.filename) == *data[results]);
+		results++;
+	}
+	CHECK(results == 4);
+	CHECK(list_folder(folder) == std::set<string>({ "dump0.syx", "dump1.syx", "dump2.syx", "dump3.syx" }));
+}
+
+// A save replaces the file, one into a missing folder fails alone
+void check_replace_and_fail(const string& folder)
+{
+	Dump_writer writer;
+	writer.start();
+	Data data = make_data(7,1000);
+	CHECK(writer.save(data,folder + "/dump0.syx","Sound") == true);
+	CHECK(writer.save(make_data(8,20),folder + "/missing/dump.syx","Multi") == true);
+	writer.stop();
+	CHECK(writer.get_saved() == 1);
+	CHECK(writer.get_failed() == 1);
+	Save_result result;
+	while (writer.take_result(result) == true)
+	{
+		if (result.label == "Multi")
+		{
+			CHECK(result.ok == false);
+			CHECK(result.error_msg.empty() == false);
+		}
+		else
+		{
+			CHECK(result.ok == true);
+		}
+	}
+	CHECK(read_file(folder + "/dump0.syx") == *data);
+	CHECK(list_folder(folder).size() == 4); // no temporary files left
+}
+
+// Saving while the writer thread runs, as the UI does
+void check_running(const string& folder)
+{
+	Dump_writer writer;
+	writer.start();
+	unsigned long int accepted = 0;
+	for (unsigned int i = 0;i<200;i++)
+	{
+		string filename = folder + "/run" + std::to_string(i % 10) + ".syx";
+		accepted += (writer.save(make_data(static_cast<unsigned char>(i % 100),100),filename, \
+			"Sound") == true) ? 1 : 0;
+		Save_result result;
+		while (writer.take_result(result) == true)
+		{
+			CHECK(result.ok == true);
+		}
+	}
+	writer.stop();
+	CHECK(accepted >0);
+	CHECK(writer.get_saved() == accepted);
+	CHECK(list_folder(folder).size() == 14);
+}
+
+int main()
+{
+	char folder_template[] = "/tmp/mwsd_test_XXXXXX";
+	const char *folder = mkdtemp(folder_template);
+	CHECK(folder != nullptr);
+	if (folder != nullptr)
+	{
+		check_batch(folder);
+		check_replace_and_fail(folder);
+		check_running(folder);
+		for (auto& name: list_folder(folder))
+		{
+			std::remove((string(folder) + "/" + name).c_str());
+		}
+		rmdir(folder);
+	}
+	return test_result("test_dump_writer");
+}
@@ -0,0 +1,117 @@
+/* test_hex_view.cpp - tests of Hex_view: the rows of offset, hex bytes
+ * and characters, the last short row, the bytes as one string and
+ * scrolling within the bounds of the message.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "hex_view.hpp"
+#include "test_check.hpp"
+
+using std::string;
+using std::vector;
+
+// A SysEx message of size bytes, data counting up from 0x30
+std::shared_ptr<const vector<unsigned char> > make_msg(unsigned long int size)
+{
+	std::shared_ptr<vector<unsigned char> > msg = std::make_shared<vector<unsigned char> >(size);
+	for (unsigned long int i = 0;i<size;i++)
+	{
+		(*msg)[i] = static_cast<unsigned char>((0x30 + i) & 0x7f);
+	}
+	(*msg)[0] = 0xf0;
+	(*msg)[size - 1] = 0xf7;
+	return msg;
+}
+
+void check_format_row()
+{
+	char buffer[Hex_view::row_length + 1];
+	std::shared_ptr<const vector<unsigned char> > msg = make_msg(40);
+	Hex_view::format_row(msg->data(),msg->size(),0,buffer);
+	CHECK(string(buffer) == \
+		"00000 f0 31 32 33 34 35 36 37 38 39 3a 3b 3c 3d 3e 3f  .123456789:;<=>?");
+	CHECK(std::strlen(buffer) == Hex_view::row_length);
+	Hex_view::format_row(msg->data(),msg->size(),16,buffer);
+	CHECK(string(buffer) == \
+		"00010 40 41 42 43 44 45 46 47 48 49 4a 4b 4c 4d 4e 4f  @ABCDEFGHIJKLMNO");
+
+	// The last row is padded to the character column
+	Hex_view::format_row(msg->data(),msg->size(),32,buffer);
+	CHECK(string(buffer) == \
+		"00020 50 51 52 53 54 55 56 f7                          PQRSTUV.");
+
+	// Five digits of the offset, even beyond 64 KB
+	vector<unsigned char> large(0x12345 + 1,0x7f);
+	Hex_view::format_row(large.data(),large.size(),0x12340,buffer);
+	CHECK(string(buffer).compare(0,24,"12340 7f 7f 7f 7f 7f 7f ") == 0);
+	CHECK(string(buffer).substr(24) == string(10 * 3,' ') + " ......");
+}
+
+void check_append_bytes()
+{
+	unsigned char msg[] = { 0xf0, 0x3e, 0x0e, 0x00, 0xf7 };
+	string text("Unknown: ");
+	Hex_view::append_bytes(msg,sizeof(msg),text);
+	CHECK(text == "Unknown: f0 3e 0e 00 f7");
+	Hex_view::append_bytes(msg,0,text);
+	CHECK(text == "Unknown: f0 3e 0e 00 f7");
+}
+
+// 100 bytes are seven rows, four of them visible
+void check_scrolling()
+{
+	Hex_view view(4);
+	CHECK(view.empty() == true);
+	CHECK(view.step(1) == false);
+	view.set_data(make_msg(100));
+	CHECK(view.empty() == false);
+	CHECK(view.get_top() == 0);
+	CHECK(view.step(-1) == false);
+	CHECK(view.step(2) == true);
+	CHECK(view.get_top() == 2);
+	CHECK(view.page(1) == true);
+	CHECK(view.get_top() == 3); // the last four rows
+	CHECK(view.step(1) == false);
+	CHECK(view.page(-5) == true);
+	CHECK(view.get_top() == 0);
+	view.end();
+	CHECK(view.get_top() == 3);
+	view.home();
+	CHECK(view.get_top() == 0);
+
+	// A new message starts at the top, a short one does not scroll
+	view.end();
+	view.set_data(make_msg(50));
+	CHECK(view.get_top() == 0);
+	CHECK(view.step(1) == false);
+	view.end();
+	CHECK(view.get_top() == 0);
+	view.reset();
+	CHECK(view.empty() == true);
+}
+
+int main()
+{
+	check_format_row();
+	check_append_bytes();
+	check_scrolling();
+	return test_result("test_hex_view");
+}
@@ -0,0 +1,161 @@
+/* test_input_clock.cpp - tests of Input_clock: the delay from the driver
+ * to us and the jitter, estimated from RtMidi's delta times, against the
+ * true values of a simulated port whose clock is off by 50 ppm and which
+ * queues some of the messages.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include "latency_stats.hpp"
+#include "test_check.hpp"
+
+using std::int64_t;
+
+const int64_t tolerance_ns = 20000;
+
+/* Sim_port - messages 0.5 to 5 ms apart by the driver's clock, which runs
+ * skew_ppm off ours. Every fourth message waits 0 to 2 ms in a queue,
+ * now and then a stall holds a burst of ten and hands them over at once.
+ * The true delays are summed up for the comparison.
+*/
+
+class Sim_port
+{
+	public:
+		Sim_port(double skew_ppm, unsigned int seed): its_rng(seed), its_skew(skew_ppm * 1e-6),
+			its_driver_ns(0), its_last_driver_ns(0), its_count(0), its_sum(0), its_max(0)
+		{
+		}
+
+		// Feed count messages into clock
+		void run(Input_clock& clock, unsigned long int count)
+		{
+			int64_t start_ns = 1000000000;
+			for (unsigned long int i = 0;i<count;)
+			{
+				if ((i % 1000) == 500) // a burst behind a stall of 3 ms
+				{
+					int64_t release = our_time(its_driver_ns + 2000000 + (9 * 300000)) + 3000000;
+					for (unsigned int k = 0;k<10;k++,i++)
+					{
+						its_driver_ns += (k == 0) ? 2000000 : 300000;
+						deliver(clock,start_ns,release + (k * 1000));
+					}
+					continue;
+				}
+				its_driver_ns += 500000 + (its_rng() % 4500000);
+				int64_t delay = ((i % 4) == 0) ? (its_rng() % 2000000) : 0;
+				deliver(clock,start_ns,our_time(its_driver_ns) + delay);
+				i++;
+			}
+		}
+
+		int64_t get_mean() const { return its_sum / static_cast<int64_t>(its_count); }
+		int64_t get_max() const { return its_max; }
+	private:
+		// The driver's time on our clock
+		int64_t our_time(int64_t driver_ns) const
+		{
+			return static_cast<int64_t>(static_cast<double>(driver_ns) * (1.0 + its_skew));
+		}
+
+		void deliver(Input_clock& clock, int64_t start_ns, int64_t arrival)
+		{
+			double delta_time = (its_driver_ns - its_last_driver_ns) * 1e-9;
+			its_last_driver_ns = its_driver_ns;
+			if (its_count == 0)
+			{
+				delta_time = 0.0; // RtMidi's first delta time
+			}
+			clock.stamp(start_ns + arrival,delta_time);
+			int64_t delay = arrival - our_time(its_driver_ns);
+			if (its_count >0) // the first one only starts the clocks
+			{
+				its_sum += delay;
+				its_max = (delay > its_max) ? delay : its_max;
+			}
+			its_count++;
+		}
+
+		std::mt19937 its_rng;
+		double its_skew;
+		int64_t its_driver_ns;
+		int64_t its_last_driver_ns;
+		unsigned long int its_count;
+		int64_t its_sum;
+		int64_t its_max;
+};
+
+// The estimated delay follows the true one with the clocks drifting
+// either way
+void check_delay(double skew_ppm)
+{
+	Input_clock clock;
+	Sim_port port(skew_ppm,46);
+	port.run(clock,200000);
+	int64_t mean = clock.get_delay().get_mean();
+	std::cout << "  " << skew_ppm << " ppm: mean delay " << Latency_stats::format_ns(mean) << \
+		" (true " << Latency_stats::format_ns(port.get_mean()) << "), max " << \
+		Latency_stats::format_ns(clock.get_delay().get_max()) << " (true " << \
+		Latency_stats::format_ns(port.get_max()) << ")" << std::endl;
+	CHECK(clock.get_delay().get_count() == 200000 - 1);
+	CHECK(std::llabs(mean - port.get_mean()) <= tolerance_ns);
+	CHECK(std::llabs(clock.get_delay().get_max() - port.get_max()) <= tolerance_ns);
+	CHECK(clock.get_jitter().get_max() >= 2000000);
+}
+
+// Without queueing there is neither delay nor jitter, restart starts both
+// clocks again
+void check_steady()
+{
+	Input_clock clock;
+	int64_t arrival = 5000000000;
+	clock.stamp(arrival,0.0);
+	CHECK(clock.get_driver_ns() == arrival);
+	for (unsigned int i = 0;i<1000;i++)
+	{
+		arrival += 1000000;
+		clock.stamp(arrival,0.001);
+	}
+	CHECK(clock.get_delay().get_max() == 0);
+	CHECK(clock.get_jitter().get_max() == 0);
+	CHECK(clock.get_driver_ns() == arrival);
+
+	// A new port, its first delta time counts nothing
+	clock.restart();
+	arrival += 7000000000;
+	clock.stamp(arrival,123.0);
+	CHECK(clock.get_driver_ns() == arrival);
+	CHECK(clock.get_delay().get_count() == 1000);
+	arrival += 1000000;
+	clock.stamp(arrival + 400000,0.001);
+	// Less the drift allowed over 1.4 ms
+	CHECK(clock.get_delay().get_last() == 400000 - ((1400000 * Input_clock::max_drift_ppm) / 1000000));
+}
+
+int main()
+{
+	check_steady();
+	std::cout << "200000 messages, every fourth queued up to 2 ms, bursts after a stall" << std::endl;
+	check_delay(50.0);
+	check_delay(-50.0);
+	check_delay(0.0);
+	return test_result("test_input_clock");
+}
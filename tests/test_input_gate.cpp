@@ -0,0 +1,271 @@
+/* test_input_gate.cpp - tests of Input_gate: held messages handed on at
+ * the swap, the old port dropped after it, the overflow of the held
+ * messages, expected messages and producers on both generations at once.
+ * Build with -DMWSD_TSAN=ON to run it under ThreadSanitizer.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "input_gate.hpp"
+#include "test_check.hpp"
+
+using std::vector;
+typedef vector<unsigned char> Bytes;
+
+const unsigned char restart_tag = 0xff;
+
+// Message number seq of port tag, a controller carrying both
+Bytes make_msg(unsigned char tag, unsigned long int seq)
+{
+	return Bytes { 0xb0, tag, static_cast<unsigned char>(seq & 0x7f), \
+		static_cast<unsigned char>((seq >> 7) & 0x7f), static_cast<unsigned char>((seq >> 14) & 0x7f) };
+}
+
+unsigned long int seq_of(const Bytes& msg)
+{
+	return msg[2] | (static_cast<unsigned long int>(msg[3]) << 7) | \
+		(static_cast<unsigned long int>(msg[4]) << 14);
+}
+
+bool is_reply(const Bytes& msg)
+{
+	return (msg.size() == 3) && (msg[0] == 0xf0) && (msg[1] == 0x7e);
+}
+
+/* Sink - the target of the gate, called with its mutex held. A restart
+ * is recorded as a message of its own.
+*/
+
+struct Sink
+{
+	vector<Bytes> messages;
+	Input_gate gate;
+
+	Sink(): gate([this](double, Bytes *msg) { messages.push_back(*msg); },
+		[this]() { messages.push_back(Bytes { 0xb0, restart_tag, 0, 0, 0 }); })
+	{
+	}
+
+	void send(unsigned long int generation, unsigned char tag, unsigned long int seq)
+	{
+		Bytes msg = make_msg(tag,seq);
+		gate.deliver(generation,0.0,&msg);
+	}
+};
+
+// The held messages come first and in order, then the new port, never
+// the old one again
+void check_swap()
+{
+	Sink sink;
+	unsigned long int old_gen = sink.gate.get_active();
+	for (unsigned long int i = 0;i<3;i++)
+	{
+		sink.send(old_gen,1,i);
+	}
+	unsigned long int new_gen = sink.gate.open_next();
+	CHECK(new_gen != old_gen);
+	for (unsigned long int i = 0;i<5;i++)
+	{
+		sink.send(new_gen,2,i);
+		sink.send(old_gen,1,3 + i); // still active
+	}
+	CHECK(sink.messages.size() == 8);
+	sink.gate.swap();
+	CHECK(sink.gate.get_active() == new_gen);
+	CHECK(sink.gate.get_swaps() == 1);
+	sink.send(old_gen,1,100); // dropped
+	vector<Bytes> batch { make_msg(2,5), make_msg(2,6) };
+	sink.gate.deliver_batch(new_gen,batch,vector<double>(2,0.0),2);
+	vector<Bytes> expected;
+	for (unsigned long int i = 0;i<8;i++)
+	{
+		expected.push_back(make_msg(1,i));
+	}
+	expected.push_back(Bytes { 0xb0, restart_tag, 0, 0, 0 });
+	for (unsigned long int i = 0;i<7;i++)
+	{
+		expected.push_back(make_msg(2,i));
+	}
+	CHECK(sink.messages == expected);
+
+	// Nothing pending: swap changes nothing, a cancelled port is forgotten
+	sink.gate.swap();
+	CHECK(sink.gate.get_swaps() == 1);
+	unsigned long int third_gen = sink.gate.open_next();
+	sink.send(third_gen,3,0);
+	sink.gate.cancel();
+	sink.gate.swap();
+	sink.send(third_gen,3,1);
+	CHECK(sink.gate.get_active() == new_gen);
+	CHECK(sink.gate.get_swaps() == 1);
+	CHECK(sink.messages == expected);
+}
+
+// Beyond max_held the pending port's messages are counted and dropped
+void check_overflow()
+{
+	Sink sink;
+	unsigned long int new_gen = sink.gate.open_next();
+	for (unsigned long int i = 0;i<Input_gate::max_held + 10;i++)
+	{
+		sink.send(new_gen,2,i);
+	}
+	CHECK(sink.messages.empty() == true);
+	CHECK(sink.gate.get_dropped() == 10);
+	sink.gate.swap();
+	CHECK(sink.messages.size() == Input_gate::max_held + 1);
+	for (unsigned long int i = 0;i<Input_gate::max_held;i++)
+	{
+		CHECK(seq_of(sink.messages[i + 1]) == i);
+	}
+}
+
+// An expected message is taken out, others are handed on, without one
+// the wait times out
+void check_expect()
+{
+	Sink sink;
+	unsigned long int old_gen = sink.gate.get_active();
+	unsigned long int new_gen = sink.gate.open_next();
+	Bytes reply { 0xf0, 0x7e, 0xf7 };
+	Bytes caught;
+
+	sink.gate.expect(new_gen,&is_reply);
+	sink.gate.deliver(old_gen,0.0,&reply); // wrong port, handed on
+	sink.send(new_gen,2,0);
+	sink.gate.deliver(new_gen,0.0,&reply);
+	CHECK(sink.gate.wait_expected(0,&caught) == true);
+	CHECK(caught == reply);
+	CHECK(sink.messages == vector<Bytes>({ reply }));
+
+	// Expected no more: a second reply is held like any message
+	sink.gate.deliver(new_gen,0.0,&reply);
+	sink.gate.expect(new_gen,&is_reply);
+	sink.send(new_gen,2,1);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	CHECK(sink.gate.wait_expected(30,&caught) == false);
+	CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(30));
+	sink.gate.swap();
+	CHECK(sink.messages.size() == 5); // reply, restart, 0, reply, 1
+	CHECK(sink.messages[3] == reply);
+
+	// Caught from another thread while waiting
+	sink.gate.expect(new_gen,&is_reply);
+	std::thread port([&]()
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		sink.send(new_gen,2,2);
+		Bytes answer { 0xf0, 0x7e, 0xf7 };
+		sink.gate.deliver(new_gen,0.0,&answer);
+	});
+	caught.clear();
+	CHECK(sink.gate.wait_expected(2000,&caught) == true);
+	port.join();
+	CHECK(caught == reply);
+	CHECK(sink.messages.size() == 6);
+}
+
+// The old and the new port deliver all the time, the swap happens
+// somewhere in between. The stream stays one consistent sequence.
+void check_concurrent()
+{
+	const unsigned long int count = 20000;
+	Sink sink;
+	unsigned long int old_gen = sink.gate.get_active();
+	unsigned long int new_gen = sink.gate.open_next();
+	std::atomic_ulong new_sent(0);
+	std::atomic_bool stop(false);
+	sink.gate.expect(new_gen,&is_reply);
+
+	std::thread old_port([&]()
+	{
+		unsigned long int seq = 0;
+		while (stop.load() == false)
+		{
+			sink.send(old_gen,1,seq++);
+			std::this_thread::yield();
+		}
+	});
+	std::thread new_port([&]()
+	{
+		for (unsigned long int i = 0;i<count;i++)
+		{
+			if ((i % 4) == 0)
+			{
+				vector<Bytes> batch { make_msg(2,i), make_msg(2,i + 1), make_msg(2,i + 2), \
+					make_msg(2,i + 3) };
+				sink.gate.deliver_batch(new_gen,batch,vector<double>(4,0.0),4);
+			}
+			if (i == 100)
+			{
+				Bytes reply { 0xf0, 0x7e, 0xf7 };
+				sink.gate.deliver(new_gen,0.0,&reply);
+			}
+			new_sent.store(i + 1);
+			std::this_thread::yield();
+		}
+	});
+	CHECK(sink.gate.wait_expected(5000) == true);
+	while (new_sent.load() < 1000)
+	{
+		std::this_thread::yield();
+	}
+	sink.gate.swap();
+	new_port.join();
+	stop.store(true);
+	old_port.join();
+
+	// Old port from 0 without gaps, the restart, then the new port rising
+	unsigned long int i = 0;
+	for (;(i < sink.messages.size()) && (sink.messages[i][1] == 1);i++)
+	{
+		CHECK(seq_of(sink.messages[i]) == i);
+	}
+	CHECK(i >0);
+	CHECK((i < sink.messages.size()) && (sink.messages[i][1] == restart_tag));
+	unsigned long int old_count = i;
+	unsigned long int new_count = 0;
+	unsigned long int last = 0;
+	for (i++;i<sink.messages.size();i++)
+	{
+		CHECK(sink.messages[i][1] == 2);
+		unsigned long int seq = seq_of(sink.messages[i]);
+		CHECK((new_count == 0) || (seq > last));
+		last = seq;
+		new_count++;
+	}
+	CHECK(new_count + sink.gate.get_dropped() == count);
+	if (sink.gate.get_dropped() == 0)
+	{
+		CHECK(last == count - 1);
+	}
+	CHECK(old_count + new_count + 1 == sink.messages.size());
+	CHECK(sink.gate.get_swaps() == 1);
+}
+
+int main()
+{
+	check_swap();
+	check_overflow();
+	check_expect();
+	check_concurrent();
+	return test_result("test_input_gate");
+}
@@ -0,0 +1,271 @@
+/* test_midi_out_scheduler.cpp - tests of Midi_out_scheduler against a
+ * simulated MIDI link with the input buffer of a synth.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <rtmidi/RtMidi.h>
+#include "midi_out_scheduler.hpp"
+#include "test_check.hpp"
+
+using std::vector;
+using std::chrono::steady_clock;
+
+/* Sim_link - the wire and the input buffer of the synth
+ * The buffer drains at the wire rate. Its highest level shows how far the
+ * sender got ahead of the wire.
+*/
+
+class Sim_link
+{
+	public:
+		Sim_link(double rate): its_rate(rate), its_level(0), its_max_level(0), its_bytes(0)
+		{
+			its_start = steady_clock::now();
+			its_last = its_start;
+		}
+
+		Midi_out_scheduler::Sender sender()
+		{
+			return [this](vector<unsigned char>& msg) { receive(msg); };
+		}
+
+		void receive(const vector<unsigned char>& msg)
+		{
+			std::lock_guard<std::mutex> lock(its_mutex);
+			steady_clock::time_point now = steady_clock::now();
+			its_level -= std::chrono::duration<double>(now - its_last).count() * its_rate;
+			its_level = (its_level < 0) ? 0 : its_level;
+			its_last = now;
+			its_level += msg.size();
+			its_max_level = std::max(its_max_level,its_level);
+			its_bytes += msg.size();
+			its_messages.push_back(msg);
+		}
+
+		double get_max_level()
+		{
+			std::lock_guard<std::mutex> lock(its_mutex);
+			return its_max_level;
+		}
+
+		unsigned long int get_bytes()
+		{
+			std::lock_guard<std::mutex> lock(its_mutex);
+			return its_bytes;
+		}
+
+		vector<vector<unsigned char> > get_messages()
+		{
+			std::lock_guard<std::mutex> lock(its_mutex);
+			return its_messages;
+		}
+
+		double get_seconds() // since the link was created
+		{
+			return std::chrono::duration<double>(steady_clock::now() - its_start).count();
+		}
+	private:
+		double its_rate;
+		double its_level;
+		double its_max_level;
+		unsigned long int its_bytes;
+		vector<vector<unsigned char> > its_messages;
+		steady_clock::time_point its_start;
+		steady_clock::time_point its_last;
+		std::mutex its_mutex;
+};
+
+// A SysEx message of size bytes, tagged in its second byte
+vector<unsigned char> make_msg(unsigned char tag, unsigned long int size)
+{
+	vector<unsigned char> msg(size,0);
+	msg[0] = 0xf0;
+	msg[1] = tag;
+	msg.back() = 0xf7;
+	return msg;
+}
+
+const unsigned char tag_user = 1;
+const unsigned char tag_dump = 2;
+const unsigned char tag_poll = 3;
+
+// Queued before start: users first, then dump requests, one coalesced poll
+void check_priorities()
+{
+	Sim_link link(Midi_out_scheduler::din_rate);
+	Midi_out_scheduler scheduler(link.sender());
+	scheduler.set_rate(100000,64);
+	vector<unsigned char> poll = make_msg(tag_poll,7);
+	for (unsigned int i = 0;i<3;i++)
+	{
+		CHECK(scheduler.send(Out_priority::dump_request,make_msg(tag_dump,10)) == true);
+	}
+	unsigned int coalesced = 0;
+	for (unsigned int i = 0;i<500;i++)
+	{
+		coalesced += (scheduler.send(Out_priority::display_poll,poll,true) == false) ? 1 : 0;
+	}
+	// Another poll differs and is kept
+	CHECK(scheduler.send(Out_priority::display_poll,make_msg(tag_poll,8),true) == true);
+	for (unsigned int i = 0;i<5;i++)
+	{
+		CHECK(scheduler.send(Out_priority::user,make_msg(tag_user,10)) == true);
+	}
+	CHECK(coalesced == 499);
+	CHECK(scheduler.get_coalesced() == 499);
+	CHECK(scheduler.get_depth(Out_priority::user) == 5);
+	CHECK(scheduler.get_depth(Out_priority::dump_request) == 3);
+	CHECK(scheduler.get_depth(Out_priority::display_poll) == 2);
+
+	scheduler.start();
+	scheduler.stop(); // sends what is queued
+	vector<vector<unsigned char> > messages = link.get_messages();
+	CHECK(messages.size() == 10);
+	vector<unsigned char> tags;
+	for (auto& msg: messages)
+	{
+		tags.push_back(msg[1]);
+	}
+	CHECK(tags == vector<unsigned char>({ 1, 1, 1, 1, 1, 2, 2, 2, 3, 3 }));
+	CHECK(scheduler.get_sent() == 10);
+	CHECK(scheduler.get_depth(Out_priority::display_poll) == 0);
+}
+
+// A user message overtakes dump requests waiting for the wire
+void check_overtaking()
+{
+	Sim_link link(Midi_out_scheduler::din_rate);
+	Midi_out_scheduler scheduler(link.sender());
+	scheduler.start();
+	for (unsigned int i = 0;i<6;i++)
+	{
+		scheduler.send(Out_priority::dump_request,make_msg(tag_dump,265));
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	unsigned long int sent_before = link.get_messages().size();
+	scheduler.send(Out_priority::user,make_msg(tag_user,10));
+	scheduler.stop();
+	vector<vector<unsigned char> > messages = link.get_messages();
+	CHECK(messages.size() == 7);
+	unsigned long int user_pos = messages.size();
+	for (unsigned long int i = 0;i<messages.size();i++)
+	{
+		if (messages[i][1] == tag_user)
+		{
+			user_pos = i;
+		}
+	}
+	// Next, unless a dump went out while the user message was queued
+	CHECK(sent_before < 6);
+	CHECK((user_pos == sent_before) || (user_pos == sent_before + 1));
+}
+
+// The synth's input buffer never holds more than the burst or one larger
+// message beyond what the wire drained, and the rate stays at the wire rate
+void check_pacing(unsigned long int rate, unsigned long int burst, unsigned long int size, \
+	double seconds)
+{
+	Sim_link link(rate);
+	Midi_out_scheduler scheduler(link.sender());
+	scheduler.set_rate(rate,burst);
+	unsigned long int count = static_cast<unsigned long int>((rate * seconds) / size) + 1;
+	for (unsigned long int i = 0;i<count;i++)
+	{
+		scheduler.send(Out_priority::dump_request,make_msg(tag_dump,size));
+	}
+	double start = link.get_seconds();
+	scheduler.start();
+	// get_rate needs a full second of sending
+	std::this_thread::sleep_for(std::chrono::milliseconds(1200));
+	unsigned long int measured = scheduler.get_rate();
+	scheduler.stop();
+	double elapsed = link.get_seconds() - start;
+	double bytes = link.get_bytes();
+	CHECK(bytes == count * size);
+	CHECK(link.get_max_level() <= std::max(burst,size) + 1);
+	CHECK(bytes <= std::max(burst,size) + (rate * elapsed) + 1);
+	// Slow machines only send later
+	CHECK(bytes >= 0.5 * rate * elapsed);
+	CHECK(measured <= rate + std::max(burst,size));
+	CHECK(measured >= rate / 2);
+}
+
+// A failing port sets the error, the scheduler carries on
+void check_errors()
+{
+	unsigned int calls = 0;
+	Midi_out_scheduler scheduler([&calls](vector<unsigned char>&)
+	{
+		calls++;
+		if (calls == 2)
+		{
+			throw RtMidiError(std::string("port gone"));
+		}
+	});
+	scheduler.set_rate(100000,64);
+	for (unsigned int i = 0;i<3;i++)
+	{
+		scheduler.send(Out_priority::user,make_msg(tag_user,10));
+	}
+	scheduler.start();
+	scheduler.stop();
+	CHECK(calls == 3);
+	CHECK(scheduler.get_sent() == 2);
+	CHECK(scheduler.get_error() == true);
+	CHECK(scheduler.get_error_msg() == "port gone");
+	scheduler.clear_error();
+	CHECK(scheduler.get_error() == false);
+	CHECK(scheduler.get_error_msg().empty());
+}
+
+// A new port takes over from the next message on, none is lost
+void check_set_sender()
+{
+	Sim_link old_link(Midi_out_scheduler::din_rate);
+	Sim_link new_link(Midi_out_scheduler::din_rate);
+	Midi_out_scheduler scheduler(old_link.sender());
+	scheduler.set_rate(20000,64);
+	scheduler.start();
+	for (unsigned int i = 0;i<100;i++)
+	{
+		scheduler.send(Out_priority::dump_request,make_msg(tag_dump,40));
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	scheduler.set_sender(new_link.sender());
+	scheduler.stop();
+	unsigned long int old_count = old_link.get_messages().size();
+	unsigned long int new_count = new_link.get_messages().size();
+	CHECK(old_count >0);
+	CHECK(new_count >0);
+	CHECK(old_count + new_count == 100);
+}
+
+int main()
+{
+	check_priorities();
+	check_overtaking();
+	check_pacing(Midi_out_scheduler::din_rate,Midi_out_scheduler::default_burst,7,1.5);
+	check_pacing(Midi_out_scheduler::din_rate * 4,Midi_out_scheduler::default_burst,265,1.5);
+	check_errors();
+	check_set_sender();
+	return test_result("test_midi_out_scheduler");
+}
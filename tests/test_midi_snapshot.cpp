@@ -0,0 +1,168 @@
+/* test_midi_snapshot.cpp - stress test of the snapshot of the last MIDI
+ * message in Curses_mw_miner: the input thread publishes while readers
+ * name and save what they see. Build with -DMWSD_TSAN=ON to run it under
+ * ThreadSanitizer.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "curses_mw_miner.hpp"
+#include "dump_writer.hpp"
+#include "screen_compositor.hpp"
+#include "synth_info.hpp"
+#include "test_check.hpp"
+
+using std::string;
+using std::vector;
+
+// SysEx messages of different sizes, all data bytes equal to the index,
+// and controllers, whose value changes every round
+vector<vector<unsigned char> > make_messages(unsigned int round)
+{
+	vector<vector<unsigned char> > messages;
+	for (unsigned char i = 0;i<64;i++)
+	{
+		vector<unsigned char> msg(3 + (i * 7),i);
+		msg[0] = 0xf0;
+		msg.back() = 0xf7;
+		messages.push_back(msg);
+		messages.push_back(vector<unsigned char> { 0xb0, i, \
+			static_cast<unsigned char>(round % 128) });
+	}
+	return messages;
+}
+
+// A snapshot is one whole message of make_messages
+bool consistent(const vector<unsigned char>& msg)
+{
+	if (msg.empty() == true) // before the first message
+	{
+		return true;
+	}
+	if (msg[0] == 0xb0)
+	{
+		return (msg.size() == 3) && (msg[1] <64) && (msg[2] <128);
+	}
+	if ((msg[0] != 0xf0) || (msg.size() <3) || (msg.size() != 3 + (msg[1] * 7u)) || \
+		(msg.back() != 0xf7))
+	{
+		return false;
+	}
+	for (unsigned long int i = 1;i<msg.size() - 1;i++)
+	{
+		if (msg[i] != msg[1])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	const unsigned int rounds = 1000;
+	Synth_info synth_info(0x3e,0x0e,0x7f,0x05,0x15,40,2);
+	Screen_compositor compositor;
+	// No window and no sinks: the miner stays in direct mode and only publishes
+	Curses_mw_miner miner(nullptr,&synth_info,&compositor);
+
+	char folder_template[] = "/tmp/mwsd_test_XXXXXX";
+	const char *folder = mkdtemp(folder_template);
+	CHECK(folder != nullptr);
+	Dump_writer dump_writer;
+	dump_writer.start();
+
+	std::atomic_bool stop(false);
+	std::atomic_ulong reads(0);
+	std::atomic_ulong controller_reads(0);
+	std::thread input([&]()
+	{
+		for (unsigned int round = 0;round<rounds;round++)
+		{
+			for (auto& msg: make_messages(round))
+			{
+				miner.accept_msg(0.0,&msg);
+			}
+		}
+		stop.store(true);
+	});
+
+	// The UI thread: also names and saves snapshots, as save_dump does
+	vector<string> saved_names;
+	auto reader = [&](bool ui_thread)
+	{
+		unsigned long int count = 0;
+		while (stop.load() == false)
+		{
+			std::shared_ptr<const Midi_snapshot> last = miner.get_last_snapshot();
+			CHECK(consistent(last->msg) == true);
+			CHECK(consistent(miner.get_last_msg()) == true);
+			miner.get_last_type();
+			miner.get_dump_status();
+			if ((last->msg.empty() == false) && (last->msg[0] == 0xb0))
+			{
+				controller_reads++;
+			}
+			if ((ui_thread == true) && (folder != nullptr) && ((count % 50) == 0))
+			{
+				string filename = string(folder) + "/" + std::to_string(count) + "_" + \
+					miner.get_suggested_dump_filename(*last);
+				std::shared_ptr<const vector<unsigned char> > data(last,&last->msg);
+				if (dump_writer.save(data,filename,miner.get_dump_type(*last)) == true)
+				{
+					saved_names.push_back(filename);
+				}
+			}
+			count++;
+			reads++;
+		}
+	};
+	std::thread second_reader(reader,false);
+	reader(true);
+	input.join();
+	second_reader.join();
+	dump_writer.stop();
+	CHECK(reads.load() >0);
+
+	// Every saved file holds one whole message
+	CHECK(dump_writer.get_failed() == 0);
+	CHECK(dump_writer.get_saved() == saved_names.size());
+	for (auto& filename: saved_names)
+	{
+		std::ifstream file(filename.c_str(),std::ios::binary);
+		vector<unsigned char> data((std::istreambuf_iterator<char>(file)), \
+			std::istreambuf_iterator<char>());
+		CHECK(consistent(data) == true);
+		std::remove(filename.c_str());
+	}
+	if (folder != nullptr)
+	{
+		rmdir(folder);
+	}
+	std::printf("%lu snapshots read, %lu of them controllers, %lu saved\n",reads.load(), \
+		controller_reads.load(),static_cast<unsigned long int>(saved_names.size()));
+	return test_result("test_midi_snapshot");
+}
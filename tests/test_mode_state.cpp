@@ -0,0 +1,269 @@
+/* test_mode_state.cpp - tests of Mode_state: every transition of every
+ * reachable state against a simple model, and threads applying random
+ * events at the same time.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <atomic>
+#include <deque>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+#include "mode_state.hpp"
+#include "test_check.hpp"
+
+using std::vector;
+typedef Mode_state::Word Word;
+typedef Mode_state::Event Event;
+
+const vector<Event> all_events { Event::direct_on, Event::direct_off, Event::continuous_on, \
+	Event::continuous_off, Event::pause, Event::resume, Event::answered, Event::timed_out };
+
+// The state as separate fields, the way the miner used to keep it
+struct Model
+{
+	bool thru;
+	bool disp;
+	bool paused;
+	unsigned int unanswered;
+
+	bool operator==(const Model& other) const
+	{
+		return (thru == other.thru) && (disp == other.disp) && (paused == other.paused) && \
+			(unanswered == other.unanswered);
+	}
+
+	// The change of a valid event
+	void apply(Event event)
+	{
+		switch (event)
+		{
+			case Event::direct_on:
+			case Event::direct_off:
+				thru = (event == Event::direct_on);
+				break;
+			case Event::continuous_on:
+			case Event::continuous_off:
+				disp = (event == Event::continuous_on);
+				break;
+			case Event::pause:
+			case Event::resume:
+				paused = (event == Event::pause);
+				unanswered = 0;
+				break;
+			case Event::answered:
+				unanswered = 0;
+				break;
+			case Event::timed_out:
+				unanswered++;
+				break;
+		}
+	}
+
+	// Events that change nothing or break a rule are rejected
+	bool valid(Event event) const
+	{
+		switch (event)
+		{
+			case Event::direct_on: return (thru == false);
+			case Event::direct_off: return (thru == true);
+			case Event::continuous_on: return (disp == false);
+			case Event::continuous_off: return (disp == true);
+			case Event::pause: return (paused == false);
+			case Event::resume: return (paused == true);
+			case Event::answered: return (paused == false) && (unanswered >0);
+			case Event::timed_out: return (paused == false) && \
+				(unanswered < Mode_state::max_unanswered);
+		}
+		return false;
+	}
+};
+
+Model read_model(Word word)
+{
+	return Model { Mode_state::get_thru(word), Mode_state::get_disp(word), \
+		Mode_state::get_paused(word), Mode_state::get_unanswered(word) };
+}
+
+// No bits outside the fields, the counter within its range
+bool well_formed(Word word)
+{
+	Word flags = Mode_state::thru_bit | Mode_state::disp_bit | Mode_state::paused_bit;
+	Word low = word & ((static_cast<Word>(1) << Mode_state::unanswered_shift) - 1);
+	return ((low & ~flags) == 0) && (Mode_state::get_unanswered(word) <= Mode_state::max_unanswered);
+}
+
+// Every event from every state reachable from the start
+void check_all_transitions()
+{
+	Mode_state start;
+	CHECK(Mode_state::get_mode(start.load()) == Mode_state::Mode::direct);
+	CHECK(Mode_state::get_paused(start.load()) == false);
+	CHECK(Mode_state::get_unanswered(start.load()) == 0);
+
+	std::set<Word> reached { start.load() };
+	std::deque<Word> todo { start.load() };
+	unsigned long int transitions = 0;
+	unsigned long int rejected = 0;
+	while (todo.empty() == false)
+	{
+		Word state = todo.front();
+		todo.pop_front();
+		CHECK(well_formed(state) == true);
+		for (auto event: all_events)
+		{
+			Model model = read_model(state);
+			bool valid = model.valid(event);
+			Word after = state;
+			bool accepted = Mode_state::next(state,event,after);
+			transitions++;
+			CHECK(accepted == valid);
+			if (accepted == false)
+			{
+				rejected++;
+				continue;
+			}
+			model.apply(event);
+			CHECK(read_model(after) == model);
+			CHECK(after != state);
+			if (reached.insert(after).second == true)
+			{
+				todo.push_back(after);
+			}
+		}
+	}
+	// direct x continuous x paused, the counter only counts while running
+	CHECK(reached.size() == (4 * (Mode_state::max_unanswered + 1)) + 4);
+	CHECK(transitions == reached.size() * all_events.size());
+	CHECK(rejected >0);
+
+	// The continuous display keeps the direct flag for leaving it
+	Mode_state state;
+	CHECK(state.apply(Event::continuous_on) == true);
+	CHECK(Mode_state::get_mode(state.load()) == Mode_state::Mode::continuous);
+	CHECK(state.apply(Event::continuous_off) == true);
+	CHECK(Mode_state::get_mode(state.load()) == Mode_state::Mode::direct);
+	CHECK(state.apply(Event::direct_off) == true);
+	CHECK(state.apply(Event::continuous_on) == true);
+	CHECK(state.apply(Event::continuous_off) == true);
+	CHECK(Mode_state::get_mode(state.load()) == Mode_state::Mode::on_demand);
+
+	// A rejected event leaves the word and reports it
+	Word after = 0;
+	CHECK(state.apply(Event::direct_off,after) == false);
+	CHECK(after == state.load());
+}
+
+// Threads apply random events while a reader checks every word it loads.
+// Accepted switches of each flag alternate, so their counts give its end
+// value.
+void check_concurrent()
+{
+	const unsigned int threads = 4;
+	const unsigned int per_thread = 200000;
+	Mode_state state;
+	std::atomic_bool stop(false);
+	std::atomic_long thru_changes(0);
+	std::atomic_long disp_changes(0);
+	std::atomic_long pause_changes(0);
+	std::atomic_ulong bad_words(0);
+
+	std::thread reader([&]()
+	{
+		while (stop.load() == false)
+		{
+			Word word = state.load();
+			if ((well_formed(word) == false) || \
+				((Mode_state::get_paused(word) == true) && (Mode_state::get_unanswered(word) >0)))
+			{
+				bad_words++;
+			}
+		}
+	});
+	vector<std::thread> workers;
+	for (unsigned int k = 0;k<threads;k++)
+	{
+		workers.emplace_back([&,k]()
+		{
+			std::mt19937 rng(200 + k);
+			for (unsigned int i = 0;i<per_thread;i++)
+			{
+				Event event = all_events[rng() % all_events.size()];
+				Word after = 0;
+				bool accepted = state.apply(event,after);
+				CHECK(well_formed(after) == true);
+				if (accepted == false)
+				{
+					continue;
+				}
+				switch (event)
+				{
+					case Event::direct_on:
+						CHECK(Mode_state::get_thru(after) == true);
+						thru_changes++;
+						break;
+					case Event::direct_off:
+						CHECK(Mode_state::get_thru(after) == false);
+						thru_changes--;
+						break;
+					case Event::continuous_on:
+						CHECK(Mode_state::get_disp(after) == true);
+						disp_changes++;
+						break;
+					case Event::continuous_off:
+						CHECK(Mode_state::get_disp(after) == false);
+						disp_changes--;
+						break;
+					case Event::pause:
+						CHECK(Mode_state::get_paused(after) == true);
+						pause_changes++;
+						break;
+					case Event::resume:
+						CHECK(Mode_state::get_paused(after) == false);
+						pause_changes--;
+						break;
+					case Event::answered:
+						CHECK(Mode_state::get_unanswered(after) == 0);
+						break;
+					case Event::timed_out:
+						CHECK(Mode_state::get_unanswered(after) >0);
+						break;
+				}
+			}
+		});
+	}
+	for (auto& worker: workers)
+	{
+		worker.join();
+	}
+	stop.store(true);
+	reader.join();
+
+	Word word = state.load();
+	CHECK(bad_words.load() == 0);
+	CHECK(thru_changes.load() == ((Mode_state::get_thru(word) == true) ? 0 : -1));
+	CHECK(disp_changes.load() == ((Mode_state::get_disp(word) == true) ? 1 : 0));
+	CHECK(pause_changes.load() == ((Mode_state::get_paused(word) == true) ? 1 : 0));
+}
+
+int main()
+{
+	check_all_transitions();
+	check_concurrent();
+	return test_result("test_mode_state");
+}
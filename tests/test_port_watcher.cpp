@@ -0,0 +1,195 @@
+/* test_port_watcher.cpp - tests of Port_watcher: port names with and
+ * without ALSA numbers, and a fake lister changing and failing while the
+ * watcher thread scans.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "port_watcher.hpp"
+#include "test_check.hpp"
+
+using std::string;
+using std::vector;
+
+/* Fake_ports - the ports of the system as a lister sees them. A failing
+ * listing returns only the first port, as RtMidi does when a port goes
+ * away while it is read.
+*/
+
+class Fake_ports
+{
+	public:
+		Fake_ports(): its_failing(false)
+		{
+		}
+
+		void set(const vector<string>& inputs, const vector<string>& outputs)
+		{
+			std::lock_guard<std::mutex> lock(its_mutex);
+			its_inputs = inputs;
+			its_outputs = outputs;
+		}
+
+		void set_failing(bool failing)
+		{
+			std::lock_guard<std::mutex> lock(its_mutex);
+			its_failing = failing;
+		}
+
+		bool list(vector<string>& inputs, vector<string>& outputs)
+		{
+			std::lock_guard<std::mutex> lock(its_mutex);
+			inputs = its_inputs;
+			outputs = its_outputs;
+			if (its_failing == true)
+			{
+				inputs.resize((inputs.empty() == true) ? 0 : 1);
+				outputs.clear();
+				return false;
+			}
+			return true;
+		}
+
+		Port_watcher::Lister lister()
+		{
+			return [this](vector<string>& inputs, vector<string>& outputs)
+			{
+				return list(inputs,outputs);
+			};
+		}
+	private:
+		vector<string> its_inputs;
+		vector<string> its_outputs;
+		bool its_failing;
+		std::mutex its_mutex;
+};
+
+// Poll until done or two seconds passed
+bool wait_until(std::function<bool()> done)
+{
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + \
+		std::chrono::seconds(2);
+	while (done() == false)
+	{
+		if (std::chrono::steady_clock::now() >= end)
+		{
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+void check_base_name()
+{
+	CHECK(Port_watcher::base_name("UM-ONE:UM-ONE MIDI 1 24:0") == "UM-ONE:UM-ONE MIDI 1");
+	CHECK(Port_watcher::base_name("Midi Through:Midi Through Port-0 14:0") == \
+		"Midi Through:Midi Through Port-0");
+	CHECK(Port_watcher::base_name("IAC Driver Bus 1") == "IAC Driver Bus 1");
+	CHECK(Port_watcher::base_name("Port 24:") == "Port 24:");
+	CHECK(Port_watcher::base_name("Port :0") == "Port :0");
+	CHECK(Port_watcher::base_name("Port24:0") == "Port24:0");
+	CHECK(Port_watcher::base_name("24:0") == "24:0");
+	CHECK(Port_watcher::base_name("") == "");
+}
+
+void check_find()
+{
+	vector<string> names { "Midi Through:Midi Through Port-0 14:0", \
+		"UM-ONE:UM-ONE MIDI 1 28:0", "UM-ONE:UM-ONE MIDI 1 24:0" };
+	CHECK(Port_watcher::find(names,"UM-ONE:UM-ONE MIDI 1 24:0") == 2); // exact first
+	CHECK(Port_watcher::find(names,"UM-ONE:UM-ONE MIDI 1 32:0") == 1); // plugged in again
+	CHECK(Port_watcher::find(names,"UM-ONE:UM-ONE MIDI 1") == 1);
+	CHECK(Port_watcher::find(names,"UM-TWO:UM-TWO MIDI 1 24:0") == -1);
+	CHECK(Port_watcher::find(vector<string>(),"UM-ONE:UM-ONE MIDI 1 24:0") == -1);
+}
+
+// Changes are committed, scans failing halfway are not
+void check_watching()
+{
+	vector<string> inputs { "Midi Through 14:0", "UM-ONE 24:0" };
+	vector<string> outputs { "Midi Through 14:0", "UM-ONE 24:0" };
+	Fake_ports ports;
+	ports.set(inputs,outputs);
+	Port_watcher watcher(ports.lister(),1);
+	CHECK(watcher.get_inputs() == inputs);
+	CHECK(watcher.get_outputs() == outputs);
+	CHECK(watcher.start() == true);
+	CHECK(watcher.start() == true); // already running
+	CHECK(wait_until([&watcher]() { return watcher.get_scans() >= 5; }) == true);
+	CHECK(watcher.get_changes() == 0);
+
+	ports.set_failing(true);
+	CHECK(wait_until([&watcher]() { return watcher.get_failed_scans() >= 5; }) == true);
+	CHECK(watcher.get_changes() == 0);
+	CHECK(watcher.get_inputs() == inputs);
+	CHECK(watcher.get_outputs() == outputs);
+
+	// A port came while the listing failed, it is seen once that works
+	inputs.push_back("Synth 28:0");
+	outputs.push_back("Synth 28:0");
+	ports.set(inputs,outputs);
+	ports.set_failing(false);
+	CHECK(wait_until([&watcher]() { return watcher.get_changes() == 1; }) == true);
+	CHECK(watcher.get_inputs() == inputs);
+	CHECK(watcher.get_outputs() == outputs);
+	CHECK(watcher.get_change_ns() != 0);
+
+	// The interface unplugged
+	inputs.erase(inputs.begin() + 1);
+	outputs.erase(outputs.begin() + 1);
+	ports.set(inputs,outputs);
+	CHECK(wait_until([&watcher]() { return watcher.get_changes() == 2; }) == true);
+	CHECK(Port_watcher::find(watcher.get_inputs(),"UM-ONE 24:0") == -1);
+
+	watcher.stop();
+	unsigned long int scans = watcher.get_scans();
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	CHECK(watcher.get_scans() == scans);
+	CHECK(watcher.get_changes() == 2);
+}
+
+// A failed first listing leaves the lists empty, the thread fills them
+void check_failed_start()
+{
+	Fake_ports ports;
+	ports.set(vector<string> { "A 20:0", "B 21:0" },vector<string> { "A 20:0" });
+	ports.set_failing(true);
+	Port_watcher watcher(ports.lister(),1);
+	CHECK(watcher.get_inputs().empty() == true);
+	CHECK(watcher.get_outputs().empty() == true);
+	ports.set_failing(false);
+	CHECK(watcher.start() == true);
+	CHECK(wait_until([&watcher]() { return watcher.get_changes() == 1; }) == true);
+	CHECK(watcher.get_inputs().size() == 2);
+	CHECK(watcher.get_outputs().size() == 1);
+}
+
+int main()
+{
+	check_base_name();
+	check_find();
+	check_watching();
+	check_failed_start();
+	return test_result("test_port_watcher");
+}
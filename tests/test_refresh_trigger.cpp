@@ -0,0 +1,345 @@
+/* test_refresh_trigger.cpp - replays controller sweeps through
+ * Refresh_trigger on a simulated clock, with a synth answering display
+ * requests after a round trip. Checks the settle time and the rate cap,
+ * and prints the time to the correct display and the requests per sweep
+ * next to the old flag, which requested while messages kept coming.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "refresh_trigger.hpp"
+#include "test_check.hpp"
+
+using std::cout;
+using std::endl;
+using std::int64_t;
+using std::vector;
+
+const int64_t round_trip_ms = 35; // request out, display dump back
+const int64_t old_frame_ms = 40; // the old loop slept a frame per pass
+const int64_t old_poll_ms = 100;
+const int64_t missed = -1;
+
+// Messages of one knob movement, each with a value of its own
+struct Sweep
+{
+	vector<int64_t> times;
+	vector<long int> values;
+};
+
+// What happened to one sweep until the next one started
+struct Sweep_result
+{
+	unsigned long int requests;
+	int64_t correct_ms; // after the last message, missed if never
+};
+
+struct Run
+{
+	vector<int64_t> sent; // times of the requests
+	vector<int64_t> answered; // times of the replies
+	vector<long int> shown; // the display value of each reply
+};
+
+// The capture: sweeps of 128 messages 3 to 8 ms apart and single changes,
+// 1.5 s apart, or a slow sweep with gaps longer than the settle time
+vector<Sweep> make_capture(bool slow)
+{
+	std::mt19937 rng(37);
+	vector<Sweep> sweeps;
+	int64_t start = 1000;
+	for (unsigned int i = 0;i<6;i++)
+	{
+		Sweep sweep;
+		unsigned int length = ((i % 2) == 0) ? 128 : 1;
+		if (slow == true)
+		{
+			length = 12;
+		}
+		int64_t time = start;
+		for (unsigned int k = 0;k<length;k++)
+		{
+			sweep.times.push_back(time);
+			sweep.values.push_back(static_cast<long int>((i * 1000) + k));
+			time += (slow == true) ? 70 + (rng() % 20) : 3 + (rng() % 6);
+		}
+		sweeps.push_back(sweep);
+		start += 1500;
+	}
+	return sweeps;
+}
+
+/* Sim_synth - the display of the synth at any time is the value of the
+ * last message it received. A request is read halfway through the round
+ * trip.
+*/
+
+class Sim_synth
+{
+	public:
+		Sim_synth(const vector<Sweep>& sweeps)
+		{
+			for (auto& sweep: sweeps)
+			{
+				for (unsigned long int i = 0;i<sweep.times.size();i++)
+				{
+					its_times.push_back(sweep.times[i]);
+					its_values.push_back(sweep.values[i]);
+				}
+			}
+		}
+
+		long int display_at(int64_t time) const
+		{
+			long int value = -1;
+			for (unsigned long int i = 0;(i < its_times.size()) && (its_times[i] <= time);i++)
+			{
+				value = its_values[i];
+			}
+			return value;
+		}
+
+		// The message due at time or -1
+		long int message_at(int64_t time) const
+		{
+			for (unsigned long int i = 0;i<its_times.size();i++)
+			{
+				if (its_times[i] == time)
+				{
+					return its_values[i];
+				}
+			}
+			return -1;
+		}
+
+		int64_t get_end() const { return its_times.back() + 1500; }
+	private:
+		vector<int64_t> its_times;
+		vector<long int> its_values;
+};
+
+// The miner with Refresh_trigger: it wakes on messages, on replies and at
+// next_check, one request at a time
+Run run_trigger(const Sim_synth& synth, unsigned int settle_ms, unsigned int max_rate)
+{
+	Refresh_trigger trigger;
+	trigger.set_settle_time(settle_ms);
+	trigger.set_max_rate(max_rate);
+	Run run;
+	bool pending = false;
+	int64_t reply_time = 0;
+	long int reply_value = 0;
+	int64_t wake_time = Refresh_trigger::never;
+	for (int64_t now = 0;now<synth.get_end();now++)
+	{
+		bool woken = (now >= wake_time);
+		if (synth.message_at(now) >= 0)
+		{
+			trigger.activity(now);
+			woken = true;
+		}
+		if ((pending == true) && (now == reply_time))
+		{
+			pending = false;
+			run.answered.push_back(now);
+			run.shown.push_back(reply_value);
+			woken = true;
+		}
+		if ((woken == false) || (pending == true))
+		{
+			continue;
+		}
+		if (trigger.take(now) == true)
+		{
+			pending = true;
+			reply_time = now + round_trip_ms;
+			reply_value = synth.display_at(now + (round_trip_ms / 2));
+			run.sent.push_back(now);
+			wake_time = Refresh_trigger::never; // the reply wakes it
+		}
+		else
+		{
+			wake_time = trigger.next_check(now);
+		}
+	}
+	return run;
+}
+
+// The old miner: a message set a flag, a reply cleared it, and a pass of
+// the loop every frame requested while it was set, at most every 100 ms
+Run run_flag(const Sim_synth& synth)
+{
+	Run run;
+	bool flag = false;
+	bool pending = false;
+	int64_t reply_time = 0;
+	long int reply_value = 0;
+	int64_t next_request = 0;
+	for (int64_t now = 0;now<synth.get_end();now++)
+	{
+		if (synth.message_at(now) >= 0)
+		{
+			flag = true;
+		}
+		if ((pending == true) && (now == reply_time))
+		{
+			pending = false;
+			flag = false; // also by a reply older than the last message
+			run.answered.push_back(now);
+			run.shown.push_back(reply_value);
+		}
+		if (((now % old_frame_ms) == 0) && (flag == true) && (pending == false) && \
+			(now >= next_request))
+		{
+			pending = true;
+			reply_time = now + round_trip_ms;
+			reply_value = synth.display_at(now + (round_trip_ms / 2));
+			run.sent.push_back(now);
+			next_request = now + old_poll_ms;
+		}
+	}
+	return run;
+}
+
+// Requests and the time to the correct display of each sweep
+vector<Sweep_result> evaluate(const vector<Sweep>& sweeps, const Run& run, int64_t end)
+{
+	vector<Sweep_result> results;
+	for (unsigned long int i = 0;i<sweeps.size();i++)
+	{
+		int64_t from = sweeps[i].times.front();
+		int64_t to = (i + 1 < sweeps.size()) ? sweeps[i + 1].times.front() : end;
+		Sweep_result result { 0, missed };
+		for (auto time: run.sent)
+		{
+			result.requests += ((time >= from) && (time < to)) ? 1 : 0;
+		}
+		for (unsigned long int k = 0;k<run.answered.size();k++)
+		{
+			if ((run.answered[k] >= from) && (run.answered[k] < to) && \
+				(run.shown[k] == sweeps[i].values.back()))
+			{
+				result.correct_ms = run.answered[k] - sweeps[i].times.back();
+				break;
+			}
+		}
+		results.push_back(result);
+	}
+	return results;
+}
+
+void print(const char *name, const vector<Sweep_result>& results)
+{
+	unsigned long int requests = 0;
+	cout << "  " << name;
+	for (auto& result: results)
+	{
+		requests += result.requests;
+		cout << " " << result.requests << "/";
+		if (result.correct_ms == missed)
+		{
+			cout << "missed";
+		}
+		else
+		{
+			cout << result.correct_ms << "ms";
+		}
+	}
+	cout << ", " << requests << " requests" << endl;
+}
+
+// The bounds of the trigger for one capture and setting
+void check_trigger(const vector<Sweep>& sweeps, unsigned int settle_ms, unsigned int max_rate)
+{
+	Sim_synth synth(sweeps);
+	Run run = run_trigger(synth,settle_ms,max_rate);
+	vector<Sweep_result> results = evaluate(sweeps,run,synth.get_end());
+	int64_t min_interval = 1000 / max_rate;
+
+	// Rate cap
+	for (unsigned long int i = 1;i<run.sent.size();i++)
+	{
+		CHECK(run.sent[i] - run.sent[i - 1] >= min_interval);
+	}
+	for (unsigned long int i = 0;i<sweeps.size();i++)
+	{
+		const vector<int64_t>& times = sweeps[i].times;
+		// Correct at the latest one settle time, a rate interval and a
+		// round trip after the last message
+		CHECK(results[i].correct_ms != missed);
+		CHECK(results[i].correct_ms <= settle_ms + min_interval + round_trip_ms);
+		// Leading edge at the first message, trailing edge only once the
+		// messages have settled
+		unsigned long int early = 0;
+		bool leading = false;
+		for (auto time: run.sent)
+		{
+			leading = leading || (time == times.front());
+			for (unsigned long int k = 1;k<times.size();k++)
+			{
+				bool busy = (times[k] - times[k - 1] < settle_ms);
+				early += ((busy == true) && (time > times[k - 1]) && (time <= times[k])) ? 1 : 0;
+			}
+		}
+		CHECK(leading == true);
+		CHECK(early == 0);
+	}
+}
+
+// Both policies on the capture, the trigger with the correct display after
+// every sweep. Where the messages come faster than the settle time it
+// also sends fewer requests, slower ones are each a burst of their own.
+void compare(const vector<Sweep>& sweeps, const char *name, bool fewer)
+{
+	Sim_synth synth(sweeps);
+	vector<Sweep_result> flag = evaluate(sweeps,run_flag(synth),synth.get_end());
+	vector<Sweep_result> trigger = evaluate(sweeps,run_trigger(synth, \
+		Refresh_trigger::default_settle_ms,Refresh_trigger::default_max_rate),synth.get_end());
+	cout << name << ", requests/time to the correct display per sweep:" << endl;
+	print("flag:   ",flag);
+	print("trigger:",trigger);
+	unsigned long int flag_requests = 0;
+	unsigned long int trigger_requests = 0;
+	for (unsigned long int i = 0;i<sweeps.size();i++)
+	{
+		flag_requests += flag[i].requests;
+		trigger_requests += trigger[i].requests;
+		CHECK(trigger[i].correct_ms != missed);
+		if (sweeps[i].times.size() == 1)
+		{
+			CHECK(trigger[i].requests == 1);
+		}
+	}
+	CHECK((fewer == false) || (trigger_requests < flag_requests));
+}
+
+int main()
+{
+	vector<Sweep> fast = make_capture(false);
+	vector<Sweep> slow = make_capture(true);
+	check_trigger(fast,Refresh_trigger::default_settle_ms,Refresh_trigger::default_max_rate);
+	check_trigger(fast,20,25);
+	check_trigger(fast,150,5);
+	check_trigger(slow,Refresh_trigger::default_settle_ms,Refresh_trigger::default_max_rate);
+	check_trigger(slow,20,25);
+	compare(fast,"Sweeps of 128 messages and single changes",true);
+	compare(slow,"Slow sweeps of 12 messages",false);
+	return test_result("test_refresh_trigger");
+}
@@ -0,0 +1,333 @@
+/* test_req_correlator.cpp - tests of Req_correlator with thousands of
+ * outstanding requests, on a simulated clock and with concurrent threads.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#include "req_correlator.hpp"
+#include "test_check.hpp"
+
+using std::int64_t;
+using std::uint64_t;
+using std::vector;
+typedef Req_correlator::Result Result;
+
+// A request for patch number of a sound dump, answered by patch_answer
+Req_pattern patch_pattern(unsigned int number)
+{
+	Req_pattern pattern = Req_pattern::sysex(0x3e,0x0e,0x10,0);
+	pattern.check_pos[0] = 5;
+	pattern.check_pos[1] = 6;
+	pattern.check_value[0] = static_cast<int>(number / 128);
+	pattern.check_value[1] = static_cast<int>(number % 128);
+	return pattern;
+}
+
+vector<unsigned char> patch_answer(unsigned int number, unsigned char dev_id = 0)
+{
+	return vector<unsigned char> { 0xf0, 0x3e, 0x0e, dev_id, 0x10, \
+		static_cast<unsigned char>(number / 128), static_cast<unsigned char>(number % 128), \
+		0x00, 0x00, 0xf7 };
+}
+
+// Answered, cancelled and timed out requests on a simulated clock
+void check_simulated()
+{
+	const unsigned int count = 5000;
+	Req_correlator correlator;
+	std::mt19937 rng(7);
+	vector<int> calls(count,0);
+	vector<Result> results(count,Result::cancelled);
+	vector<int64_t> deadlines(count,0);
+	vector<int64_t> fired_at(count,-1);
+	vector<uint64_t> ids(count,0);
+	for (unsigned int i = 0;i<count;i++)
+	{
+		unsigned int timeout = 1 + (rng() % (((i % 3) == 0) ? 40000 : 300));
+		deadlines[i] = timeout;
+		ids[i] = correlator.add(patch_pattern(i),timeout,[&,i](Result result, \
+			const unsigned char *, unsigned long int)
+		{
+			calls[i]++;
+			results[i] = result;
+			fired_at[i] = correlator.get_now();
+		});
+		CHECK(ids[i] != 0);
+	}
+	CHECK(correlator.get_pending() == count);
+
+	// Another device ID must not match
+	vector<unsigned char> other = patch_answer(1,5);
+	CHECK(correlator.accept(other.data(),other.size()) == false);
+	for (unsigned int i = 0;i<count;i += 4)
+	{
+		vector<unsigned char> answer = patch_answer(i);
+		CHECK(correlator.accept(answer.data(),answer.size()) == true);
+	}
+	for (unsigned int i = 1;i<count;i += 7)
+	{
+		CHECK(correlator.cancel(ids[i]) == ((i % 4) != 0));
+	}
+	int64_t now = 0;
+	while (now < 50000)
+	{
+		now += 1 + (rng() % 900);
+		correlator.advance(now);
+	}
+	for (unsigned int i = 0;i<count;i++)
+	{
+		CHECK(calls[i] == 1);
+		if ((i % 4) == 0)
+		{
+			CHECK(results[i] == Result::answered);
+		}
+		else if ((i % 7) == 1)
+		{
+			CHECK(results[i] == Result::cancelled);
+		}
+		else
+		{
+			CHECK(results[i] == Result::timed_out);
+			CHECK(fired_at[i] >= deadlines[i]);
+		}
+	}
+	CHECK(correlator.get_pending() == 0);
+	CHECK(correlator.get_answered() == (count + 3) / 4);
+}
+
+// Advancing one tick at a time fires every timeout exactly on its deadline,
+// across all levels of the wheel
+void check_exact_ticks()
+{
+	const unsigned int count = 2000;
+	Req_correlator correlator;
+	std::mt19937 rng(11);
+	vector<int64_t> deadlines(count,0);
+	vector<int64_t> fired_at(count,-1);
+	for (unsigned int i = 0;i<count;i++)
+	{
+		unsigned int timeout = 1 + (rng() % 70000);
+		deadlines[i] = timeout;
+		correlator.add(Req_pattern::sysex(0x3e,0x0e,0x15),timeout,[&,i](Result result, \
+			const unsigned char *, unsigned long int)
+		{
+			CHECK(result == Result::timed_out);
+			fired_at[i] = correlator.get_now();
+		});
+	}
+	for (int64_t tick = 1;tick <= 80000;tick++)
+	{
+		correlator.advance(tick);
+	}
+	for (unsigned int i = 0;i<count;i++)
+	{
+		CHECK(fired_at[i] == deadlines[i]);
+	}
+	CHECK(correlator.get_timed_out() == count);
+}
+
+// Large jumps of the clock never fire early and keep the deadline order
+void check_jumps()
+{
+	const unsigned int count = 3000;
+	Req_correlator correlator;
+	std::mt19937 rng(13);
+	vector<int64_t> deadlines(count,0);
+	vector<int64_t> fired_at(count,-1);
+	int64_t last_deadline = -1;
+	bool ordered = true;
+	for (unsigned int i = 0;i<count;i++)
+	{
+		unsigned int timeout = 1 + (rng() % 2000000);
+		deadlines[i] = timeout;
+		correlator.add(Req_pattern::sysex(1,2,3),timeout,[&,i](Result, \
+			const unsigned char *, unsigned long int)
+		{
+			fired_at[i] = correlator.get_now();
+			ordered = ordered && (deadlines[i] >= last_deadline);
+			last_deadline = deadlines[i];
+		});
+	}
+	for (int64_t tick = 0;tick <= 2100000;tick += 1 + (rng() % 5000))
+	{
+		correlator.advance(tick);
+	}
+	correlator.advance(2200000);
+	for (unsigned int i = 0;i<count;i++)
+	{
+		CHECK(fired_at[i] >= deadlines[i]);
+	}
+	CHECK(ordered == true);
+}
+
+// The Microwave answers identity requests without the device byte
+void check_identity()
+{
+	Req_correlator correlator;
+	correlator.start();
+	std::promise<int> dev_id;
+	std::future<int> answered = dev_id.get_future();
+	correlator.add(Req_pattern::identity(0x3e,0x0e),1000,[&dev_id](Result result, \
+		const unsigned char *msg, unsigned long int size)
+	{
+		dev_id.set_value(((result == Result::answered) && (size == 14)) ? msg[6] : -1);
+	});
+	unsigned char reply[14] = { 0xf0, 0x7e, 0x06, 0x02, 0x3e, 0x0e, 0x23, 0, 0, 0, 0, 0, 0, 0xf7 };
+	CHECK(correlator.accept(reply,sizeof(reply)) == true);
+	CHECK(answered.get() == 0x23);
+
+	// A real timeout from the timer thread
+	std::promise<Result> timeout;
+	std::future<Result> timed_out = timeout.get_future();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	correlator.add(Req_pattern::identity(0x3e,0x0e),50,[&timeout](Result result, \
+		const unsigned char *, unsigned long int)
+	{
+		timeout.set_value(result);
+	});
+	CHECK(timed_out.get() == Result::timed_out);
+	// The wheel counts whole milliseconds, the part of the first is lost
+	CHECK((std::chrono::steady_clock::now() - start) >= std::chrono::milliseconds(49));
+}
+
+// Threads adding, answering and cancelling thousands of requests while the
+// timer thread times out the rest: every request completes exactly once
+void check_concurrent()
+{
+	const unsigned int threads = 8;
+	const unsigned int per_thread = 1000;
+	const unsigned int count = threads * per_thread;
+	Req_correlator correlator;
+	correlator.start();
+	std::unique_ptr<std::atomic_int[]> calls(new std::atomic_int[count]);
+	std::unique_ptr<std::atomic_int[]> results(new std::atomic_int[count]);
+	std::unique_ptr<std::atomic_uint[]> added(new std::atomic_uint[threads]);
+	vector<uint64_t> ids(count,0);
+	vector<char> cancelled(count,0); // not vector<bool>, written by several threads
+	for (unsigned int i = 0;i<count;i++)
+	{
+		calls[i].store(0);
+		results[i].store(-1);
+	}
+	for (unsigned int i = 0;i<threads;i++)
+	{
+		added[i].store(0);
+	}
+
+	// Thread k owns the requests k * per_thread ... and answers the even
+	// ones of thread k + 1 as soon as they are added
+	vector<std::thread> workers;
+	for (unsigned int k = 0;k<threads;k++)
+	{
+		workers.emplace_back([&,k]()
+		{
+			std::mt19937 rng(100 + k);
+			unsigned int neighbour = (k + 1) % threads;
+			unsigned int answered = 0;
+			for (unsigned int i = 0;i<per_thread;i++)
+			{
+				unsigned int number = (k * per_thread) + i;
+				unsigned int timeout = ((i % 2) == 0) ? 10000 : 1 + (rng() % 50);
+				ids[number] = correlator.add(patch_pattern(number),timeout, \
+					[&,number](Result result, const unsigned char *, unsigned long int)
+				{
+					calls[number]++;
+					results[number].store(static_cast<int>(result));
+				});
+				CHECK(ids[number] != 0);
+				added[k].store(i + 1);
+				if ((i % 10) == 3)
+				{
+					cancelled[number] = correlator.cancel(ids[number]) ? 1 : 0;
+				}
+				while ((answered < added[neighbour].load()) && (answered < per_thread))
+				{
+					if ((answered % 2) == 0)
+					{
+						vector<unsigned char> answer = patch_answer((neighbour * per_thread) + answered);
+						CHECK(correlator.accept(answer.data(),answer.size()) == true);
+					}
+					answered++;
+				}
+			}
+			while (answered < per_thread)
+			{
+				if (answered < added[neighbour].load())
+				{
+					if ((answered % 2) == 0)
+					{
+						vector<unsigned char> answer = patch_answer((neighbour * per_thread) + answered);
+						CHECK(correlator.accept(answer.data(),answer.size()) == true);
+					}
+					answered++;
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+	for (auto& worker: workers)
+	{
+		worker.join();
+	}
+	std::chrono::steady_clock::time_point give_up = std::chrono::steady_clock::now() + \
+		std::chrono::seconds(10);
+	while ((correlator.get_pending() >0) && (std::chrono::steady_clock::now() < give_up))
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	CHECK(correlator.get_pending() == 0);
+	unsigned long int answered = 0;
+	for (unsigned int i = 0;i<count;i++)
+	{
+		CHECK(calls[i].load() == 1);
+		if ((i % 2) == 0)
+		{
+			CHECK(results[i].load() == static_cast<int>(Result::answered));
+			answered++;
+		}
+		else if (cancelled[i] == 1)
+		{
+			CHECK(results[i].load() == static_cast<int>(Result::cancelled));
+		}
+		else
+		{
+			CHECK(results[i].load() == static_cast<int>(Result::timed_out));
+		}
+	}
+	CHECK(correlator.get_answered() == answered);
+	correlator.stop();
+}
+
+int main()
+{
+	check_simulated();
+	check_exact_ticks();
+	check_jumps();
+	check_identity();
+	check_concurrent();
+	return test_result("test_req_correlator");
+}
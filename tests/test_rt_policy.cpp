@@ -0,0 +1,154 @@
+/* test_rt_policy.cpp - tests of Rt_policy::lock_memory under a finite
+ * memlock limit: it reports the outcome and threads still start after it.
+ * Not built with ThreadSanitizer, whose shadow memory can't be locked.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <linux/capability.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "rt_policy.hpp"
+#include "test_check.hpp"
+
+using std::string;
+using std::vector;
+
+const rlim_t memlock_limit = 64 * 1024 * 1024;
+
+// The memlock limit applies to this process, as to a user without
+// CAP_IPC_LOCK. The hard limit is set while that may still be raised.
+void limit_memlock()
+{
+	struct rlimit limit;
+	getrlimit(RLIMIT_MEMLOCK,&limit);
+	if ((limit.rlim_max == RLIM_INFINITY) || (limit.rlim_max > memlock_limit))
+	{
+		limit.rlim_max = memlock_limit;
+	}
+	limit.rlim_cur = limit.rlim_max;
+	CHECK(setrlimit(RLIMIT_MEMLOCK,&limit) == 0);
+#ifdef __linux__
+	struct __user_cap_header_struct header;
+	struct __user_cap_data_struct data[2];
+	header.version = _LINUX_CAPABILITY_VERSION_3;
+	header.pid = 0;
+	if (syscall(SYS_capget,&header,data) == 0)
+	{
+		data[0].effective &= ~(1u << CAP_IPC_LOCK);
+		data[0].permitted &= ~(1u << CAP_IPC_LOCK);
+		CHECK(syscall(SYS_capset,&header,data) == 0);
+	}
+#endif
+}
+
+void set_soft_limit(rlim_t bytes)
+{
+	struct rlimit limit;
+	getrlimit(RLIMIT_MEMLOCK,&limit);
+	limit.rlim_cur = (bytes < limit.rlim_max) ? bytes : limit.rlim_max;
+	CHECK(setrlimit(RLIMIT_MEMLOCK,&limit) == 0);
+}
+
+bool report_has(Rt_policy& policy, const string& text)
+{
+	for (auto& line: policy.get_report())
+	{
+		if (line.find(text) != string::npos)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Start threads which all live at the same time, each with a stack of the
+// default size, the number of those started
+unsigned int start_threads(unsigned int count)
+{
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool done = false;
+	vector<std::thread> threads;
+	for (unsigned int i = 0;i<count;i++)
+	{
+		try
+		{
+			threads.emplace_back([&]()
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cond.wait(lock,[&done]() { return done; });
+			});
+		}
+		catch (std::system_error&)
+		{
+			break;
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		done = true;
+	}
+	cond.notify_all();
+	unsigned int started = static_cast<unsigned int>(threads.size());
+	for (auto& thread: threads)
+	{
+		thread.join();
+	}
+	return started;
+}
+
+// The pages there are, before any thread ran, fit the limit. The stacks
+// of the threads started afterwards are beyond it.
+void check_finite_limit()
+{
+	set_soft_limit(memlock_limit);
+	Rt_policy policy;
+	CHECK(policy.lock_memory() == true);
+	CHECK(policy.get_failures() == 0);
+	CHECK(report_has(policy,"new thread stacks not locked") == true);
+	CHECK(start_threads(24) == 24);
+	munlockall();
+}
+
+// No pages may be locked: a failure is reported, nothing else changes
+void check_no_lock()
+{
+	set_soft_limit(0);
+	Rt_policy policy;
+	CHECK(policy.lock_memory() == false);
+	CHECK(policy.get_failures() == 1);
+	CHECK(report_has(policy,"Memory: not locked") == true);
+	CHECK(start_threads(4) == 4);
+}
+
+int main()
+{
+	limit_memlock();
+	check_finite_limit();
+	check_no_lock();
+	return test_result("test_rt_policy");
+}
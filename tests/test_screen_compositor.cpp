@@ -0,0 +1,249 @@
+/* test_screen_compositor.cpp - tests of Screen_compositor on a curses
+ * screen without a terminal: the frame rate cap, the cursor of the window
+ * marked last, refresh and forget, the latency of stamped damage and the
+ * ansi backend writing one frame with one write().
+ * Build with -DMWSD_TSAN=ON to run it under ThreadSanitizer.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "screen_compositor.hpp"
+#include "test_check.hpp"
+
+using std::string;
+
+// Row of the terminal as the last frame left it
+string shown_row(int row)
+{
+	char text[81];
+	mvwinnstr(curscr,row,0,text,80);
+	return string(text);
+}
+
+bool shown(int row, const char *text)
+{
+	return (shown_row(row).find(text) != string::npos);
+}
+
+// Wait until frames frames have been drawn or two seconds passed
+bool wait_frames(const Screen_compositor& compositor, unsigned long int frames)
+{
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + \
+		std::chrono::seconds(2);
+	while (compositor.get_frames() < frames)
+	{
+		if (std::chrono::steady_clock::now() >= end)
+		{
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+// Damage every 2 ms is drawn at most 20 times a second, the last one shown
+void check_frame_rate()
+{
+	const unsigned int changes = 150;
+	WINDOW *win = newwin(3,40,0,0);
+	Screen_compositor compositor;
+	compositor.set_max_fps(20);
+	compositor.start();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0;i<changes;i++)
+	{
+		{
+			std::lock_guard<std::mutex> lock(compositor.get_mutex());
+			mvwprintw(win,1,1,"change %3u",i);
+			compositor.damage(win);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+	long int elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>( \
+		std::chrono::steady_clock::now() - start).count();
+	compositor.stop();
+	CHECK(compositor.get_damages() == changes);
+	CHECK(compositor.get_frames() >= 2);
+	CHECK(compositor.get_frames() <= static_cast<unsigned long int>(elapsed_ms / 50) + 2);
+	CHECK(shown(1,"change 149") == true);
+	delwin(win);
+}
+
+// The window marked last has the cursor, as if it had been refreshed last
+void check_cursor()
+{
+	WINDOW *upper = newwin(3,40,5,0);
+	WINDOW *lower = newwin(3,40,10,0);
+	Screen_compositor compositor;
+	compositor.set_max_fps(1000);
+	compositor.start();
+	{
+		std::lock_guard<std::mutex> lock(compositor.get_mutex());
+		wmove(upper,1,5);
+		compositor.damage(upper);
+		wmove(lower,2,7);
+		compositor.damage(lower);
+	}
+	CHECK(wait_frames(compositor,1) == true);
+	compositor.stop();
+	CHECK((getcury(curscr) == 12) && (getcurx(curscr) == 7));
+
+	compositor.start();
+	{
+		std::lock_guard<std::mutex> lock(compositor.get_mutex());
+		compositor.damage(lower);
+		compositor.damage(upper);
+		compositor.damage(lower); // moves to the end once more
+		compositor.damage(upper);
+	}
+	CHECK(wait_frames(compositor,2) == true);
+	compositor.stop();
+	CHECK(compositor.get_frames() == 2);
+	CHECK((getcury(curscr) == 6) && (getcurx(curscr) == 5));
+	delwin(upper);
+	delwin(lower);
+}
+
+// A window of one thread is handed over whole, a forgotten one not drawn
+void check_refresh_forget()
+{
+	WINDOW *own = newwin(1,40,15,0);
+	WINDOW *kept = newwin(1,40,16,0);
+	WINDOW *gone = newwin(1,40,17,0);
+	Screen_compositor compositor;
+	compositor.set_max_fps(1000);
+	compositor.start();
+	mvwprintw(own,0,0,"drawn without the mutex");
+	compositor.refresh(own);
+	CHECK(wait_frames(compositor,1) == true);
+	CHECK(shown(15,"drawn without the mutex") == true);
+	{
+		std::lock_guard<std::mutex> lock(compositor.get_mutex());
+		mvwprintw(gone,0,0,"deleted window");
+		compositor.damage(gone);
+		mvwprintw(kept,0,0,"kept window");
+		compositor.damage(kept);
+		compositor.forget(gone);
+	}
+	compositor.stop();
+	CHECK(shown(16,"kept window") == true);
+	CHECK(shown(17,"deleted window") == false);
+	delwin(own);
+	delwin(kept);
+	delwin(gone);
+}
+
+// The oldest input drawn in a frame counts, once per frame
+void check_latency()
+{
+	WINDOW *win = newwin(1,40,20,0);
+	Screen_compositor compositor;
+	compositor.set_max_fps(1000);
+	compositor.start();
+	{
+		std::lock_guard<std::mutex> lock(compositor.get_mutex());
+		std::int64_t now = Latency_stats::now_ns();
+		compositor.damage(win,now - 1000000);
+		compositor.damage(win,now - 5000000);
+		compositor.damage(win,now - 2000000);
+		compositor.damage(win); // not from MIDI input
+	}
+	compositor.stop();
+	CHECK(compositor.get_frames() == 1);
+	CHECK(compositor.get_latency().get_count() == 1);
+	CHECK(compositor.get_latency().get_last() >= 5000000);
+	CHECK(compositor.get_latency().get_last() < 1000000000);
+	delwin(win);
+}
+
+// The ansi backend writes to standard output, caught here in a pipe
+void check_ansi()
+{
+	int out[2];
+	if (CHECK(pipe(out) == 0) == false)
+	{
+		return;
+	}
+	std::fflush(stdout);
+	int saved = dup(STDOUT_FILENO);
+	dup2(out[1],STDOUT_FILENO);
+	close(out[1]);
+	WINDOW *win = newwin(3,40,2,10);
+	unsigned long int bytes = 0;
+	{
+		Screen_compositor compositor;
+		compositor.set_backend(Screen_backend::ansi);
+		compositor.set_max_fps(1000);
+		compositor.start();
+		for (unsigned int i = 0;i<3;i++)
+		{
+			{
+				std::lock_guard<std::mutex> lock(compositor.get_mutex());
+				mvwprintw(win,1,1,"ansi frame %u",i);
+				compositor.damage(win);
+			}
+			CHECK(wait_frames(compositor,i + 1) == true);
+		}
+		compositor.stop();
+		CHECK(compositor.get_frames() == 3);
+		CHECK(compositor.get_writes() == 3);
+		bytes = compositor.get_bytes();
+	}
+	delwin(win);
+	dup2(saved,STDOUT_FILENO);
+	close(saved);
+
+	string written;
+	char buffer[4096];
+	ssize_t got = 0;
+	while ((got = read(out[0],buffer,sizeof(buffer))) >0)
+	{
+		written.append(buffer,static_cast<std::size_t>(got));
+	}
+	close(out[0]);
+	CHECK(written.size() == bytes);
+	CHECK(written.find("ansi frame 0") != string::npos);
+	// Later frames rewrite only the digit that changed
+	CHECK(written.find("ansi frame 1") == string::npos);
+}
+
+int main()
+{
+	// A screen of 25 by 80 on /dev/null
+	setenv("LINES","25",1);
+	setenv("COLUMNS","80",1);
+	FILE *terminal = std::fopen("/dev/null","r+");
+	if ((terminal == nullptr) || (newterm("xterm",terminal,terminal) == nullptr))
+	{
+		std::cerr << "No curses screen for xterm" << std::endl;
+		return 1;
+	}
+	check_frame_rate();
+	check_cursor();
+	check_refresh_forget();
+	check_latency();
+	check_ansi();
+	endwin();
+	return test_result("test_screen_compositor");
+}
@@ -0,0 +1,130 @@
+/* test_silent_synth.cpp - runs the miner thread on a curses screen
+ * without a terminal, against a synth that stops answering display
+ * requests. Checks that it goes silent instead of ending the session,
+ * asks only every silent_poll_ms meanwhile and comes back with the first
+ * answer.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "curses_mw_miner.hpp"
+#include "screen_compositor.hpp"
+#include "synth_info.hpp"
+#include "test_check.hpp"
+
+using std::vector;
+using std::chrono::steady_clock;
+
+/* Requests - the times of the display requests the miner sent
+*/
+
+class Requests
+{
+	public:
+		void add()
+		{
+			std::lock_guard<std::mutex> lock(its_mutex);
+			its_times.push_back(steady_clock::now());
+		}
+
+		unsigned long int count()
+		{
+			std::lock_guard<std::mutex> lock(its_mutex);
+			return its_times.size();
+		}
+
+		// Milliseconds between request first and request second
+		long int gap_ms(unsigned long int first, unsigned long int second)
+		{
+			std::lock_guard<std::mutex> lock(its_mutex);
+			return std::chrono::duration_cast<std::chrono::milliseconds>( \
+				its_times[second] - its_times[first]).count();
+		}
+	private:
+		vector<steady_clock::time_point> its_times;
+		std::mutex its_mutex;
+};
+
+// Poll until done or seconds passed
+bool wait_until(std::function<bool()> done, unsigned int seconds)
+{
+	steady_clock::time_point end = steady_clock::now() + std::chrono::seconds(seconds);
+	while (done() == false)
+	{
+		if (steady_clock::now() >= end)
+		{
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+int main()
+{
+	setenv("LINES","25",1);
+	setenv("COLUMNS","80",1);
+	FILE *terminal = std::fopen("/dev/null","r+");
+	if ((terminal == nullptr) || (newterm("xterm",terminal,terminal) == nullptr))
+	{
+		std::cerr << "No curses screen for xterm" << std::endl;
+		return 1;
+	}
+	Synth_info synth_info(0x3e,0x0e,0x7f,0x05,0x15,40,2);
+	Screen_compositor compositor;
+	compositor.start();
+	Curses_mw_miner miner(nullptr,&synth_info,&compositor);
+	Requests requests;
+	miner.get_out_scheduler().set_sender([&requests](vector<unsigned char>&) { requests.add(); });
+	std::thread miner_thread(&Curses_mw_miner::run,&miner);
+	// set_disp draws into the window the thread sets up first
+	CHECK(wait_until([&compositor]() { return compositor.get_damages() >0; },1) == true);
+	miner.set_disp(true);
+
+	// Every request times out, after max_unanswered of them the synth is silent
+	CHECK(wait_until([&miner]() { return miner.get_silent(); },10) == true);
+	unsigned long int first = requests.count();
+	CHECK(first >= Curses_mw_miner::max_unanswered);
+	CHECK(wait_until([&requests,first]() { return requests.count() >= first + 2; },10) == true);
+	CHECK(requests.gap_ms(first,first + 1) >= Curses_mw_miner::silent_poll_ms - 10);
+	CHECK(miner.get_quit() == false);
+	CHECK(miner.get_error() == false);
+	CHECK(miner.get_offline() == false);
+
+	// The synth is back and answers the pending request
+	vector<unsigned char> dump { 0xf0, 0x3e, 0x0e, 0x00, 0x15 };
+	dump.insert(dump.end(),80,'A');
+	dump.push_back(0xf7);
+	miner.accept_msg(0.0,&dump);
+	CHECK(wait_until([&miner]() { return miner.get_silent() == false; },1) == true);
+	CHECK(miner.get_unanswered() == 0);
+	// Polled every 100 ms again, each request timing out after 200 ms
+	unsigned long int back = requests.count();
+	CHECK(wait_until([&requests,back]() { return requests.count() >= back + 3; },2) == true);
+
+	miner.set_quit(true);
+	miner_thread.join();
+	compositor.stop();
+	endwin();
+	return test_result("test_silent_synth");
+}
@@ -0,0 +1,262 @@
+/* test_syx_assembler.cpp - tests of Syx_assembler: dumps and banks of
+ * dumps replayed in pieces cut at random boundaries, with clock bytes in
+ * between, as a backend with small buffers delivers them.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "syx_assembler.hpp"
+#include "test_check.hpp"
+
+using std::int64_t;
+using std::vector;
+typedef vector<unsigned char> Bytes;
+
+/* Sim_port - hands chunks to the assembler the way Curses_mw_miner's
+ * accept_msg does and collects what comes out
+*/
+
+class Sim_port
+{
+	public:
+		Sim_port(Syx_assembler& assembler): its_assembler(assembler), its_clocks(0), its_copies(0)
+		{
+		}
+
+		void deliver(const Bytes& chunk, int64_t now_ms)
+		{
+			if (its_assembler.passes(chunk) == true)
+			{
+				take(chunk);
+				return;
+			}
+			its_assembler.feed(chunk,now_ms,[this](Bytes& msg)
+			{
+				its_copies++;
+				take(msg);
+			});
+		}
+
+		// The messages, a bank continued across F7 F0 split into its dumps
+		vector<Bytes> get_messages() const { return its_messages; }
+		unsigned long int get_clocks() const { return its_clocks; }
+		unsigned long int get_copies() const { return its_copies; }
+	private:
+		void take(const Bytes& msg)
+		{
+			if ((msg.size() == 1) && (msg[0] >= 0xf8))
+			{
+				its_clocks++;
+				return;
+			}
+			if (msg[0] != 0xf0)
+			{
+				its_messages.push_back(msg);
+				return;
+			}
+			Bytes dump;
+			for (auto byte: msg)
+			{
+				dump.push_back(byte);
+				if (byte == 0xf7)
+				{
+					its_messages.push_back(dump);
+					dump.clear();
+				}
+			}
+			CHECK(dump.empty() == true); // ends with F7
+		}
+
+		Syx_assembler& its_assembler;
+		vector<Bytes> its_messages;
+		unsigned long int its_clocks;
+		unsigned long int its_copies;
+};
+
+// A sound dump of the Microwave II, 265 bytes
+Bytes make_dump(std::mt19937& rng)
+{
+	Bytes dump(265,0);
+	dump[0] = 0xf0;
+	dump[1] = 0x3e;
+	dump[2] = 0x0e;
+	dump[4] = 0x10;
+	for (unsigned long int i = 5;i<dump.size() - 1;i++)
+	{
+		dump[i] = static_cast<unsigned char>(rng() % 128);
+	}
+	dump.back() = 0xf7;
+	return dump;
+}
+
+// Cut a SysEx of one or more dumps into pieces of 1 to max_piece bytes,
+// with clock bytes in between and inside the pieces
+void cut(const Bytes& sysex, std::mt19937& rng, unsigned long int max_piece, \
+	vector<Bytes>& chunks, unsigned long int& clocks)
+{
+	unsigned long int pos = 0;
+	while (pos < sysex.size())
+	{
+		unsigned long int size = 1 + (rng() % max_piece);
+		size = (pos + size > sysex.size()) ? sysex.size() - pos : size;
+		Bytes piece(sysex.begin() + static_cast<long>(pos),sysex.begin() + static_cast<long>(pos + size));
+		bool whole = (pos == 0) && (size == sysex.size());
+		// A piece starting with F0 may be whole and pass unchanged
+		if ((whole == false) && (piece[0] != 0xf0) && ((rng() % 4) == 0))
+		{
+			piece.insert(piece.begin() + static_cast<long>(rng() % piece.size()),0xf8);
+			clocks++;
+		}
+		chunks.push_back(piece);
+		pos += size;
+		if ((pos < sysex.size()) && ((rng() % 8) == 0))
+		{
+			chunks.push_back(Bytes { 0xf8 });
+			clocks++;
+		}
+	}
+}
+
+// Thousands of messages, the SysEx in random pieces: every message comes
+// out whole and in order, every clock byte at once
+void check_replay(unsigned int seed, unsigned long int max_piece)
+{
+	std::mt19937 rng(seed);
+	Syx_assembler assembler;
+	Sim_port port(assembler);
+	vector<Bytes> sent;
+	vector<Bytes> chunks;
+	unsigned long int clocks = 0;
+	for (unsigned int i = 0;i<3000;i++)
+	{
+		unsigned int kind = rng() % 10;
+		if (kind <5) // a controller, always whole
+		{
+			Bytes cc { 0xb0, static_cast<unsigned char>(rng() % 128), \
+				static_cast<unsigned char>(rng() % 128) };
+			sent.push_back(cc);
+			chunks.push_back(cc);
+		}
+		else
+		{
+			// A single dump, a small bank or now and then a whole bank of 128
+			unsigned int dumps = (kind <8) ? 1 : (((rng() % 20) == 0) ? 128 : 2 + (rng() % 4));
+			Bytes sysex;
+			for (unsigned int j = 0;j<dumps;j++)
+			{
+				Bytes dump = make_dump(rng);
+				sent.push_back(dump);
+				sysex.insert(sysex.end(),dump.begin(),dump.end());
+			}
+			cut(sysex,rng,max_piece,chunks,clocks);
+		}
+	}
+	int64_t now_ms = 0;
+	for (auto& chunk: chunks)
+	{
+		now_ms += rng() % 3;
+		port.deliver(chunk,now_ms);
+	}
+	CHECK(port.get_messages() == sent);
+	CHECK(port.get_clocks() == clocks);
+	CHECK(assembler.get_dropped() == 0);
+	CHECK(assembler.get_assembled() >0);
+	CHECK(assembler.get_active() == false);
+	CHECK(port.get_copies() >0);
+}
+
+// Cut short, too slow or too long SysEx is dropped, the next message is
+// whole again
+void check_drops()
+{
+	std::mt19937 rng(5);
+	Bytes dump = make_dump(rng);
+	Bytes head(dump.begin(),dump.begin() + 100);
+	Bytes tail(dump.begin() + 100,dump.end());
+	Bytes cc { 0xb0, 7, 100 };
+
+	// A new SysEx before the end of the last one
+	{
+		Syx_assembler assembler;
+		Sim_port port(assembler);
+		port.deliver(head,0);
+		port.deliver(head,1);
+		port.deliver(tail,2);
+		CHECK(port.get_messages() == vector<Bytes>({ dump }));
+		CHECK(assembler.get_dropped() == 1);
+	}
+
+	// Another status byte ends SysEx and is passed on
+	{
+		Syx_assembler assembler;
+		Sim_port port(assembler);
+		port.deliver(head,0);
+		port.deliver(cc,1);
+		port.deliver(tail,2); // stray data and F7
+		port.deliver(dump,3);
+		CHECK(port.get_messages() == vector<Bytes>({ cc, dump }));
+		CHECK(assembler.get_dropped() == 3);
+	}
+
+	// The rest arrives after the timeout
+	{
+		Syx_assembler assembler(Syx_assembler::default_max_length,100);
+		Sim_port port(assembler);
+		port.deliver(head,0);
+		port.deliver(tail,101);
+		port.deliver(head,200);
+		port.deliver(tail,300);
+		CHECK(port.get_messages() == vector<Bytes>({ dump }));
+		CHECK(assembler.get_dropped() == 3);
+	}
+
+	// Longer than the limit, whole or in pieces
+	{
+		Syx_assembler assembler(200);
+		Sim_port port(assembler);
+		port.deliver(dump,0);
+		port.deliver(head,1);
+		port.deliver(tail,2);
+		Bytes short_dump { 0xf0, 0x3e, 0x0e, 0x00, 0x05, 0x00, 0xf7 };
+		port.deliver(short_dump,3);
+		CHECK(port.get_messages() == vector<Bytes>({ short_dump }));
+		CHECK(assembler.get_dropped() == 2);
+	}
+
+	// A new source drops what the old one left incomplete
+	{
+		Syx_assembler assembler;
+		Sim_port port(assembler);
+		port.deliver(head,0);
+		assembler.reset();
+		CHECK(assembler.get_active() == false);
+		port.deliver(tail,1);
+		CHECK(port.get_messages().empty() == true);
+		CHECK(assembler.get_dropped() == 3);
+	}
+}
+
+int main()
+{
+	check_replay(1,1);
+	check_replay(2,16);
+	check_replay(3,600);
+	check_drops();
+	return test_result("test_syx_assembler");
+}
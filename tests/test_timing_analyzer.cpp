@@ -0,0 +1,201 @@
+/* test_timing_analyzer.cpp - tests of Timing_analyzer: the jitter
+ * histogram bins, a synthetic 24 ppqn clock with known jitter and dropped
+ * ticks, pauses, active sensing and the reset when the miner's input port
+ * is swapped.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include "curses_mw_miner.hpp"
+#include "screen_compositor.hpp"
+#include "synth_info.hpp"
+#include "timing_analyzer.hpp"
+#include "test_check.hpp"
+
+using std::int64_t;
+using std::vector;
+
+const int64_t tick_ns = 20833333; // 24 ppqn at 120 BPM
+const int64_t small_jitter_ns = 50000;
+const int64_t large_jitter_ns = 1000000;
+
+bool near(double value, double expected, double tolerance)
+{
+	return std::abs(value - expected) <= tolerance;
+}
+
+// Every jitter lands in a bin whose upper end is at most 12.5% above it
+void check_bins()
+{
+	for (int64_t ns = 0;ns<8;ns++)
+	{
+		CHECK(Timing_analyzer::bin_value(Timing_analyzer::bin_of(ns)) == ns);
+	}
+	CHECK(Timing_analyzer::bin_of(-5) == 0);
+	unsigned int last_bin = 0;
+	for (int64_t ns = 8;ns < (static_cast<int64_t>(1) << 32);ns += 1 + (ns / 37))
+	{
+		unsigned int bin = Timing_analyzer::bin_of(ns);
+		double value = Timing_analyzer::bin_value(bin);
+		CHECK(bin >= last_bin);
+		CHECK(value > static_cast<double>(ns));
+		CHECK(value <= static_cast<double>(ns) * 1.125);
+		last_bin = bin;
+	}
+	CHECK(Timing_analyzer::bin_of(static_cast<int64_t>(1) << 40) == Timing_analyzer::bins - 1);
+}
+
+/* A clock at 120 BPM. The intervals alternate between tick_ns + jitter
+ * and tick_ns - jitter, so the tempo stays put. The jitter is large for
+ * large_every pairs of intervals in 64 pairs, small otherwise. Every
+ * drop_every-th clock is left out. The stamps of the clocks are returned.
+*/
+vector<int64_t> make_clock(unsigned long int count, unsigned int large_every, \
+	unsigned long int drop_every, unsigned long int& dropped)
+{
+	vector<int64_t> stamps;
+	int64_t stamp = 1000000000;
+	dropped = 0;
+	for (unsigned long int i = 0;i<count;i++)
+	{
+		bool large = ((i / 2) % 64) < large_every;
+		int64_t jitter = (large == true) ? large_jitter_ns : small_jitter_ns;
+		stamp += tick_ns + (((i % 2) == 0) ? jitter : -jitter);
+		if ((drop_every >0) && (i >0) && ((i % drop_every) == 0))
+		{
+			dropped++;
+			continue;
+		}
+		stamps.push_back(stamp);
+	}
+	return stamps;
+}
+
+// Tempo, dropouts and the 99th percentile of the jitter
+void check_clock(unsigned int large_every, int64_t p99_ns)
+{
+	unsigned long int dropped = 0;
+	vector<int64_t> stamps = make_clock(24 * 400,large_every,500,dropped);
+	Timing_analyzer analyzer;
+	analyzer.tick(0xfa,stamps.front() - tick_ns);
+	for (auto stamp: stamps)
+	{
+		analyzer.tick(0xf8,stamp);
+	}
+	Timing_report report = analyzer.get_report(stamps.back());
+	CHECK(report.clocks == stamps.size());
+	CHECK(report.dropouts == dropped);
+	CHECK(dropped == 19);
+	CHECK(report.starts == 1);
+	CHECK(report.running == true);
+	CHECK(near(report.bpm,120.0,0.5));
+	CHECK(near(static_cast<double>(report.interval_ns),tick_ns,tick_ns * 0.001));
+	// Measured against the moving average, which moves by jitter / 24
+	CHECK(near(static_cast<double>(report.jitter_p99_ns),p99_ns,p99_ns * 0.2));
+	CHECK(report.jitter_p99_ns >= p99_ns * 0.95);
+	// The average starts as the first interval, tick_ns - jitter, so the
+	// second one is off by twice the jitter
+	int64_t max_ns = 2 * ((large_every >0) ? large_jitter_ns : small_jitter_ns);
+	CHECK(near(static_cast<double>(report.jitter_max_ns),max_ns,max_ns * 0.01));
+	CHECK(report.jitter_sd_ns >= small_jitter_ns * 0.9);
+}
+
+// A stop, a pause and continue is no dropout, the tempo is kept
+void check_pause()
+{
+	Timing_analyzer analyzer;
+	int64_t stamp = 1000000000;
+	for (unsigned int i = 0;i<48;i++)
+	{
+		analyzer.tick(0xf8,stamp);
+		stamp += tick_ns;
+	}
+	analyzer.tick(0xfc,stamp);
+	stamp += 3000000000;
+	analyzer.tick(0xfb,stamp);
+	for (unsigned int i = 0;i<48;i++)
+	{
+		stamp += tick_ns;
+		analyzer.tick(0xf8,stamp);
+	}
+	Timing_report report = analyzer.get_report(stamp);
+	CHECK(report.clocks == 96);
+	CHECK(report.dropouts == 0);
+	CHECK((report.stops == 1) && (report.continues == 1) && (report.running == true));
+	CHECK(near(report.bpm,120.0,0.01));
+	CHECK(report.jitter_max_ns == 0);
+}
+
+// Active sensing every 300 ms, once 400 ms late
+void check_sensing()
+{
+	Timing_analyzer analyzer;
+	int64_t stamp = 1000000000;
+	for (unsigned int i = 0;i<10;i++)
+	{
+		analyzer.tick(0xfe,stamp);
+		stamp += (i == 4) ? 400000000 : 300000000;
+	}
+	stamp -= 300000000;
+	Timing_report report = analyzer.get_report(stamp + 100000000);
+	CHECK(report.sensings == 10);
+	CHECK(report.sensing_timeouts == 1);
+	CHECK(report.sensing_max_ns == 400000000);
+	CHECK(near(static_cast<double>(report.sensing_interval_ns),311111111,1));
+	CHECK(report.sensing_alive == true);
+	CHECK(analyzer.get_report(stamp + Timing_analyzer::sensing_timeout_ns + 1).sensing_alive == false);
+}
+
+// A swapped port starts the analysis anew: the old clock and sensing are
+// forgotten, the first interval of the new port is no dropout
+void check_port_swap()
+{
+	Synth_info synth_info(0x3e,0x0e,0x7f,0x05,0x15,40,2);
+	Screen_compositor compositor;
+	Curses_mw_miner miner(nullptr,&synth_info,&compositor);
+	vector<unsigned char> clock { 0xf8 };
+	vector<unsigned char> sensing { 0xfe };
+	miner.accept_msg(0.0,&sensing);
+	for (unsigned int i = 0;i<48;i++)
+	{
+		miner.accept_msg(0.0208,&clock);
+	}
+	CHECK(miner.get_timing().get_report(0).clocks == 48);
+	miner.restart_input();
+	Timing_report report = miner.get_timing().get_report(0);
+	CHECK((report.clocks == 0) && (report.sensings == 0) && (report.bpm == 0.0));
+	miner.accept_msg(5.0,&clock); // the first delta of the new port
+	miner.accept_msg(0.0208,&clock);
+	miner.accept_msg(0.0208,&clock);
+	report = miner.get_timing().get_report(0);
+	CHECK(report.clocks == 3);
+	CHECK(report.dropouts == 0);
+	CHECK(report.sensing_alive == false);
+}
+
+int main()
+{
+	check_bins();
+	check_clock(0,small_jitter_ns); // all small
+	check_clock(2,large_jitter_ns); // 3.1% large, above the 1% of p99
+	check_pause();
+	check_sensing();
+	check_port_swap();
+	return test_result("test_timing_analyzer");
+}
@@ -0,0 +1,220 @@
+/* timing_analyzer.cpp - implementation of the Timing_analyzer class, which
+ * measures MIDI clock and active sensing.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include <cmath>
+#include "timing_analyzer.hpp"
+
+using std::int64_t;
+
+const int64_t Timing_analyzer::sensing_timeout_ns;
+const unsigned int Timing_analyzer::sub_bins;
+const unsigned int Timing_analyzer::bins;
+const unsigned int Timing_analyzer::gaps_for_tempo;
+
+Timing_analyzer::Timing_analyzer()
+{
+	reset();
+}
+
+Timing_report Timing_analyzer::get_report(int64_t now_ns)
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	Timing_report report;
+	report.clocks = its_clocks;
+	report.dropouts = its_dropouts;
+	report.starts = its_starts;
+	report.continues = its_continues;
+	report.stops = its_stops;
+	report.running = its_running;
+	report.bpm = (its_average >0) ? (60e9 / (its_average * 24)) : 0;
+	report.interval_ns = 0;
+	report.jitter_sd_ns = 0;
+	report.jitter_p99_ns = 0;
+	report.jitter_max_ns = std::llround(its_jitter_max);
+	if (its_intervals >0)
+	{
+		report.interval_ns = std::llround(its_interval_sum / its_intervals);
+		report.jitter_sd_ns = std::llround(std::sqrt(its_jitter_m2 / its_intervals));
+		// The bin holding the 99th percentile, at most 12.5% too high
+		unsigned long int rank = its_intervals - its_intervals / 100;
+		unsigned long int seen = 0;
+		for (unsigned int bin = 0;bin<bins;bin++)
+		{
+			seen += its_histogram[bin];
+			if (seen >= rank)
+			{
+				report.jitter_p99_ns = std::llround(bin_value(bin));
+				break;
+			}
+		}
+	}
+	report.sensings = its_sensings;
+	report.sensing_timeouts = its_sensing_timeouts;
+	report.sensing_interval_ns = (its_sensings >1) ? \
+		std::llround(its_sensing_sum / (its_sensings - 1)) : 0;
+	report.sensing_max_ns = std::llround(its_sensing_max);
+	report.sensing_alive = (its_last_sensing != 0) && \
+		((now_ns - its_last_sensing) <= sensing_timeout_ns);
+	return report;
+}
+
+void Timing_analyzer::tick(unsigned char status, int64_t stamp_ns)
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	switch (status)
+	{
+		case 0xf8: // clock
+		{
+			its_clocks++;
+			if (its_last_clock == 0)
+			{
+				its_last_clock = stamp_ns;
+				break;
+			}
+			double interval = static_cast<double>(stamp_ns - its_last_clock);
+			its_last_clock = stamp_ns;
+			if (its_average <= 0)
+			{
+				its_average = interval;
+				break;
+			}
+			if (interval > (its_average * 1.5))
+			{
+				// At least one clock is missing, the tempo stays. Gaps in a
+				// row are a slower tempo, which is followed then.
+				its_dropouts++;
+				its_gaps++;
+				if (its_gaps >= gaps_for_tempo)
+				{
+					its_average += (interval - its_average) / 24;
+				}
+				break;
+			}
+			its_gaps = 0;
+			double jitter = interval - its_average;
+			its_average += jitter / 24;
+			its_intervals++;
+			its_interval_sum += interval;
+			double delta = jitter - its_jitter_mean;
+			its_jitter_mean += delta / its_intervals;
+			its_jitter_m2 += delta * (jitter - its_jitter_mean);
+			jitter = std::fabs(jitter);
+			if (jitter > its_jitter_max)
+			{
+				its_jitter_max = jitter;
+			}
+			its_histogram[bin_of(static_cast<int64_t>(jitter))]++;
+			break;
+		}
+		case 0xfa: // start
+			its_starts++;
+			its_running = true;
+			restart_clock();
+			break;
+		case 0xfb: // continue
+			its_continues++;
+			its_running = true;
+			restart_clock();
+			break;
+		case 0xfc: // stop
+			its_stops++;
+			its_running = false;
+			restart_clock();
+			break;
+		case 0xfe: // active sensing
+		{
+			its_sensings++;
+			if (its_last_sensing != 0)
+			{
+				double interval = static_cast<double>(stamp_ns - its_last_sensing);
+				its_sensing_sum += interval;
+				if (interval > its_sensing_max)
+				{
+					its_sensing_max = interval;
+				}
+				if (interval > sensing_timeout_ns)
+				{
+					its_sensing_timeouts++;
+				}
+			}
+			its_last_sensing = stamp_ns;
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+void Timing_analyzer::reset()
+{
+	std::lock_guard<std::mutex> lock(its_mutex);
+	its_last_clock = 0;
+	its_average = 0;
+	its_intervals = 0;
+	its_interval_sum = 0;
+	its_jitter_mean = 0;
+	its_jitter_m2 = 0;
+	its_jitter_max = 0;
+	for (unsigned int bin = 0;bin<bins;bin++)
+	{
+		its_histogram[bin] = 0;
+	}
+	its_clocks = 0;
+	its_dropouts = 0;
+	its_gaps = 0;
+	its_starts = 0;
+	its_continues = 0;
+	its_stops = 0;
+	its_running = false;
+	its_last_sensing = 0;
+	its_sensings = 0;
+	its_sensing_timeouts = 0;
+	its_sensing_sum = 0;
+	its_sensing_max = 0;
+}
+
+// The bins below sub_bins hold single nanoseconds, above that each power
+// of two is split into sub_bins equal parts
+unsigned int Timing_analyzer::bin_of(int64_t ns)
+{
+	if (ns < static_cast<int64_t>(sub_bins))
+	{
+		return (ns >0) ? static_cast<unsigned int>(ns) : 0;
+	}
+	int exponent = std::ilogb(static_cast<double>(ns)); // sub_bins is 2^3
+	unsigned int bin = exponent * sub_bins + ((ns >> (exponent - 3)) & (sub_bins - 1));
+	return (bin < bins) ? bin : (bins - 1);
+}
+
+double Timing_analyzer::bin_value(unsigned int bin)
+{
+	if (bin < sub_bins)
+	{
+		return bin;
+	}
+	int exponent = bin / sub_bins;
+	return std::ldexp(static_cast<double>(sub_bins + (bin % sub_bins) + 1),exponent - 3);
+}
+
+void Timing_analyzer::restart_clock()
+{
+	// The next clock starts anew, a pause is no dropout. The tempo is kept
+	its_last_clock = 0;
+	its_gaps = 0;
+}
@@ -0,0 +1,106 @@
+/* timing_analyzer.hpp - definition of the Timing_analyzer class, which
+ * measures MIDI clock and active sensing.
+ * Copyright (C) 2018-2020 Jeanette C. <jeanette@juliencoder.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef MWSD_TIMING_ANALYZER_HPP
+#define MWSD_TIMING_ANALYZER_HPP
+
+#include <cstdint>
+#include <mutex>
+
+// What the analyzer has seen so far, times in nanoseconds
+struct Timing_report
+{
+	unsigned long int clocks; // F8 received
+	unsigned long int dropouts; // gaps of at least one missing clock
+	unsigned long int starts, continues, stops;
+	bool running; // a start or continue was last
+	double bpm; // current tempo, 0 if unknown
+	std::int64_t interval_ns; // mean clock interval
+	std::int64_t jitter_sd_ns; // deviation of the intervals from the tempo
+	std::int64_t jitter_p99_ns;
+	std::int64_t jitter_max_ns;
+	unsigned long int sensings; // FE received
+	unsigned long int sensing_timeouts; // gaps longer than sensing_timeout_ns
+	std::int64_t sensing_interval_ns; // mean
+	std::int64_t sensing_max_ns;
+	bool sensing_alive; // FE seen within the timeout
+};
+
+/* Timing_analyzer - tempo, jitter and dropouts of MIDI clock
+ * Each tick costs a constant amount of work and nothing is stored per
+ * tick. The tempo follows a moving average of the clock interval over
+ * about one beat (24 clocks). Jitter is the difference of each interval
+ * from that average: its mean and deviation are kept with Welford's
+ * method, its distribution in a histogram with 8 bins per power of two,
+ * which gives p99 within 12.5%. An interval of more than one and a half
+ * times the average counts as a dropout and leaves the jitter and the
+ * tempo alone, unless gaps_for_tempo of them come in a row.
+ * Start, continue and stop begin the clock anew, so a pause is no
+ * dropout. Active sensing is due every 300 ms, a gap of more than 330 ms
+ * is a timeout.
+*/
+
+class Timing_analyzer
+{
+	public:
+		static const std::int64_t sensing_timeout_ns = 330000000; // 300 ms and some slack
+
+		Timing_analyzer();
+
+			// Access methods
+		Timing_report get_report(std::int64_t now_ns);
+
+			// Utility methods
+			// A real time message (F8-FF) arrived at stamp_ns
+		void tick(unsigned char status, std::int64_t stamp_ns);
+		void reset(); // forget everything, e.g. for a new input port
+
+		static const unsigned int sub_bins = 8; // per power of two
+		static const unsigned int bins = 32 * sub_bins; // up to 2^32 ns
+
+			// The histogram bin of a jitter and the upper end of a bin
+		static unsigned int bin_of(std::int64_t ns);
+		static double bin_value(unsigned int bin);
+	private:
+		static const unsigned int gaps_for_tempo = 3; // in a row, a slower tempo
+
+		void restart_clock(); // forget the last clock, e.g. after a stop
+
+		std::int64_t its_last_clock; // 0 if none since the last (re)start
+		double its_average; // moving average interval in ns
+		unsigned long int its_intervals; // counted in the Welford sums
+		double its_interval_sum;
+		double its_jitter_mean;
+		double its_jitter_m2; // sum of squared deviations
+		double its_jitter_max;
+		unsigned long int its_histogram[bins]; // of the jitter
+		unsigned long int its_clocks;
+		unsigned long int its_dropouts;
+		unsigned int its_gaps; // dropouts in a row
+		unsigned long int its_starts, its_continues, its_stops;
+		bool its_running;
+		std::int64_t its_last_sensing;
+		unsigned long int its_sensings;
+		unsigned long int its_sensing_timeouts;
+		double its_sensing_sum; // of the intervals
+		double its_sensing_max;
+		std::mutex its_mutex;
+};
+
+#endif // #ifndef MWSD_TIMING_ANALYZER_HPP